@@ -20,6 +20,18 @@
 #include <string.h>
 #include <stdio.h>
 #include "general.h"
+#include "performance.h"
+
+#if !defined(_WIN32) && !defined(RARCH_CONSOLE)
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define AUTOSAVE_POSIX_IO
+#endif
+
+// SRAM is tracked in blocks. Each block's hash is compared against the live SRAM
+// without holding the lock, so the emulation thread is only blocked while changed blocks are copied.
+#define AUTOSAVE_BLOCK_SIZE 4096
 
 struct autosave
 {
@@ -35,8 +47,140 @@ struct autosave
    const char *path;
    size_t bufsize;
    unsigned interval;
+
+   uint64_t *block_hash; // Hash of each block in buffer.
+   bool *dirty;
+   size_t num_blocks;
+
+   bool rewrite; // Next write replaces the whole file.
+   bool retry; // Last write failed, write again even if nothing changed.
 };
 
+static uint64_t autosave_hash_block(const uint8_t *data, size_t size)
+{
+   uint64_t hash = size;
+   for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t))
+   {
+      uint64_t word;
+      memcpy(&word, data, sizeof(word));
+      hash = ((hash << 31) | (hash >> 33)) ^ word;
+      hash *= UINT64_C(0x9e3779b97f4a7c15);
+   }
+
+   while (size--)
+      hash = (hash ^ *data++) * UINT64_C(0x100000001b3);
+   return hash ^ (hash >> 29);
+}
+
+static inline size_t autosave_block_size(const autosave_t *save, size_t block)
+{
+   size_t offset = block * AUTOSAVE_BLOCK_SIZE;
+   return save->bufsize - offset < AUTOSAVE_BLOCK_SIZE ? save->bufsize - offset : AUTOSAVE_BLOCK_SIZE;
+}
+
+// Writes the full buffer to a temporary file, syncs it and renames it over the old save,
+// so a crash never leaves a half written save file behind.
+static bool autosave_write_full(autosave_t *save)
+{
+   bool failed = false;
+   char tmp_path[PATH_MAX];
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", save->path);
+
+#ifdef AUTOSAVE_POSIX_IO
+   int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+      return false;
+
+   const uint8_t *data = (const uint8_t*)save->buffer;
+   size_t written = 0;
+   while (!failed && written < save->bufsize)
+   {
+      ssize_t ret = write(fd, data + written, save->bufsize - written);
+      if (ret <= 0)
+         failed = true;
+      else
+         written += ret;
+   }
+   failed |= fsync(fd) != 0;
+   failed |= close(fd) != 0;
+#else
+   FILE *file = fopen(tmp_path, "wb");
+   if (!file)
+      return false;
+
+   failed |= fwrite(save->buffer, 1, save->bufsize, file) != save->bufsize;
+   failed |= fflush(file) != 0;
+   failed |= fclose(file) != 0;
+#ifdef _WIN32
+   // rename() does not replace existing files on Windows.
+   if (!failed)
+      remove(save->path);
+#endif
+#endif
+
+   if (!failed)
+      failed = rename(tmp_path, save->path) != 0;
+   if (failed)
+      remove(tmp_path);
+   return !failed;
+}
+
+// Rewrites only the changed blocks of the existing save file in place.
+static bool autosave_write_dirty(autosave_t *save)
+{
+#ifdef AUTOSAVE_POSIX_IO
+   size_t i;
+   bool failed = false;
+   int fd = open(save->path, O_WRONLY);
+   if (fd < 0)
+      return false;
+
+   if (lseek(fd, 0, SEEK_END) != (off_t)save->bufsize)
+   {
+      close(fd);
+      return false;
+   }
+
+   for (i = 0; i < save->num_blocks && !failed; i++)
+   {
+      size_t first = i;
+      if (!save->dirty[i])
+         continue;
+
+      // Coalesce runs of dirty blocks into one write.
+      while (i + 1 < save->num_blocks && save->dirty[i + 1])
+         i++;
+
+      size_t offset = first * AUTOSAVE_BLOCK_SIZE;
+      size_t size = i * AUTOSAVE_BLOCK_SIZE + autosave_block_size(save, i) - offset;
+      const uint8_t *data = (const uint8_t*)save->buffer + offset;
+
+      while (!failed && size)
+      {
+         ssize_t ret = pwrite(fd, data, size, offset);
+         if (ret <= 0)
+            failed = true;
+         else
+         {
+            data += ret;
+            offset += ret;
+            size -= ret;
+         }
+      }
+   }
+
+#ifdef __APPLE__
+   failed |= fsync(fd) != 0;
+#else
+   failed |= fdatasync(fd) != 0;
+#endif
+   failed |= close(fd) != 0;
+   return !failed;
+#else
+   return autosave_write_full(save);
+#endif
+}
+
 static void autosave_thread(void *data)
 {
    autosave_t *save = (autosave_t*)data;
@@ -45,34 +189,67 @@ static void autosave_thread(void *data)
 
    while (!save->quit)
    {
-      autosave_lock(save);
-      bool differ = memcmp(save->buffer, save->retro_buffer, save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      autosave_unlock(save);
+      size_t i, dirty = 0;
+      const uint8_t *retro_buffer = (const uint8_t*)save->retro_buffer;
+      uint8_t *buffer = (uint8_t*)save->buffer;
+
+      // The core may write SRAM while it is hashed here. A block changed under our feet
+      // is either copied below in its new state or seen as dirty on the next pass.
+      for (i = 0; i < save->num_blocks; i++)
+      {
+         size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+         save->dirty[i] = autosave_hash_block(retro_buffer + offset,
+               autosave_block_size(save, i)) != save->block_hash[i];
+         dirty += save->dirty[i];
+      }
+
+      if (dirty)
+      {
+         retro_time_t lock_start = rarch_get_time_usec();
+         autosave_lock(save);
+         for (i = 0; i < save->num_blocks; i++)
+         {
+            size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+            if (save->dirty[i])
+               memcpy(buffer + offset, retro_buffer + offset, autosave_block_size(save, i));
+         }
+         autosave_unlock(save);
+         retro_time_t lock_time = rarch_get_time_usec() - lock_start;
+
+         for (i = 0; i < save->num_blocks; i++)
+         {
+            size_t offset = i * AUTOSAVE_BLOCK_SIZE;
+            if (save->dirty[i])
+               save->block_hash[i] = autosave_hash_block(buffer + offset, autosave_block_size(save, i));
+         }
+
+         // Avoid spamming down stderr ... :)
+         if (first_log)
+         {
+            RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n", save->path, save->interval);
+            first_log = false;
+         }
+         RARCH_LOG("SRAM changed ... autosaving %u of %u blocks (lock held for %lld usec) ...\n",
+                  (unsigned)dirty, (unsigned)save->num_blocks, (long long)lock_time);
+      }
 
-      if (differ)
+      if (dirty || save->retry)
       {
-         // Should probably deal with this more elegantly.
-         FILE *file = fopen(save->path, "wb");
-         if (file)
+         bool success = save->rewrite ? autosave_write_full(save) : autosave_write_dirty(save);
+
+         // After a failed partial write, the file on disk is in an unknown state,
+         // so fall back to replacing all of it.
+         if (!success && !save->rewrite)
          {
-            // Avoid spamming down stderr ... :)
-            if (first_log)
-            {
-               RARCH_LOG("Autosaving SRAM to \"%s\", will continue to check every %u seconds ...\n", save->path, save->interval);
-               first_log = false;
-            }
-            else
-               RARCH_LOG("SRAM changed ... autosaving ...\n");
-
-            bool failed = false;
-            failed |= fwrite(save->buffer, 1, save->bufsize, file) != save->bufsize;
-            failed |= fflush(file) != 0;
-            failed |= fclose(file) != 0;
-            if (failed)
-               RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+            save->rewrite = true;
+            success = autosave_write_full(save);
          }
+
+         if (success)
+            save->rewrite = false;
+         else
+            RARCH_WARN("Failed to autosave SRAM. Disk might be full.\n");
+         save->retry = !success;
       }
 
       slock_lock(save->cond_lock);
@@ -84,6 +261,7 @@ static void autosave_thread(void *data)
 
 autosave_t *autosave_new(const char *path, const void *data, size_t size, unsigned interval)
 {
+   size_t i;
    autosave_t *handle = (autosave_t*)calloc(1, sizeof(*handle));
    if (!handle)
       return NULL;
@@ -93,14 +271,27 @@ autosave_t *autosave_new(const char *path, const void *data, size_t size, unsign
    handle->path = path;
    handle->buffer = malloc(size);
    handle->retro_buffer = data;
+   handle->num_blocks = (size + AUTOSAVE_BLOCK_SIZE - 1) / AUTOSAVE_BLOCK_SIZE;
+   handle->block_hash = (uint64_t*)calloc(handle->num_blocks, sizeof(uint64_t));
+   handle->dirty = (bool*)calloc(handle->num_blocks, sizeof(bool));
+
+   // The save file was either just loaded or does not exist yet, so make sure the first write is a full one.
+   handle->rewrite = true;
 
-   if (!handle->buffer)
+   if (!handle->buffer || !handle->block_hash || !handle->dirty)
    {
+      free(handle->buffer);
+      free(handle->block_hash);
+      free(handle->dirty);
       free(handle);
       return NULL;
    }
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
 
+   for (i = 0; i < handle->num_blocks; i++)
+      handle->block_hash[i] = autosave_hash_block((const uint8_t*)handle->buffer + i * AUTOSAVE_BLOCK_SIZE,
+            autosave_block_size(handle, i));
+
    handle->lock = slock_new();
    handle->cond_lock = slock_new();
    handle->cond = scond_new();
@@ -136,6 +327,8 @@ void autosave_free(autosave_t *handle)
    scond_free(handle->cond);
 
    free(handle->buffer);
+   free(handle->block_hash);
+   free(handle->dirty);
    free(handle);
 }
 
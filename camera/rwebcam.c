@@ -14,11 +14,19 @@
  */
 
 #include "../driver.h"
+#include "../general.h"
 #include "../emscripten/RWebCam.h"
 
 static void *rwebcam_init(const char *device, uint64_t caps, unsigned width, unsigned height)
 {
    (void)device;
+
+   if ((caps & ((1ULL << RETRO_CAMERA_BUFFER_OPENGL_TEXTURE) | (1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER))) == 0)
+   {
+      RARCH_ERR("rwebcam returns OpenGL textures or XRGB8888 framebuffers.\n");
+      return NULL;
+   }
+
    return RWebCamInit(caps, width, height);
 }
 
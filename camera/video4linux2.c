@@ -24,11 +24,12 @@
 #include "../driver.h"
 #include "../performance.h"
 #include "../miscellaneous.h"
-#include "../gfx/scaler/scaler.h"
+#include "../gfx/scaler/pixconv.h"
 #include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
@@ -36,9 +37,19 @@
 #include <sys/ioctl.h>
 #include "../compat/strl.h"
 
+#ifdef HAVE_THREADS
+#include "../thread.h"
+#endif
+
 #include <asm/types.h>
 #include <linux/videodev2.h>
 
+// A regular file of raw YUYV frames can stand in for a device. It is played back in a loop at this rate.
+#define V4L_FILE_FRAME_MSEC 33
+
+// How long the capture thread waits for a frame before checking if it should stop.
+#define V4L_POLL_MSEC 100
+
 struct buffer
 {
    void *start;
@@ -54,18 +65,61 @@ typedef struct video4linux
    unsigned height;
    size_t pitch;
 
-   struct scaler_ctx scaler;
-   uint32_t *buffer_output;
+   struct buffer file;
+   bool is_file;
+   unsigned file_frames;
+   unsigned file_frame;
+   retro_time_t file_next;
+
+   // Cores which only ask for YUYV get frames as captured, otherwise they are converted to XRGB8888.
+   bool yuyv;
+   size_t out_pitch;
+
+   // Triple buffered output. Capture always has a buffer which is
+   // neither the latest frame nor the one poll is handing to the core.
+   uint32_t *frames[3];
+   int latest;
+   int reading;
+   bool fresh;
+
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   bool die;
+#endif
    bool ready;
 
    char dev_name[PATH_MAX];
 } video4linux_t;
 
-static void process_image(video4linux_t *v4l, const uint8_t *buffer_yuv)
+static inline void v4l_lock(video4linux_t *v4l)
+{
+#ifdef HAVE_THREADS
+   slock_lock(v4l->lock);
+#endif
+}
+
+static inline void v4l_unlock(video4linux_t *v4l)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(v4l->lock);
+#endif
+}
+
+static void process_image(video4linux_t *v4l, uint32_t *output, const uint8_t *buffer_yuv)
 {
+   unsigned y;
+
+   if (v4l->yuyv)
+   {
+      for (y = 0; y < v4l->height; y++)
+         memcpy((uint8_t*)output + y * v4l->out_pitch, buffer_yuv + y * v4l->pitch, v4l->width * 2);
+      return;
+   }
+
    RARCH_PERFORMANCE_INIT(yuv_convert_direct);
    RARCH_PERFORMANCE_START(yuv_convert_direct);
-   scaler_ctx_scale(&v4l->scaler, v4l->buffer_output, buffer_yuv);
+   conv_yuyv_argb8888(output, buffer_yuv, v4l->width, v4l->height, v4l->out_pitch, v4l->pitch);
    RARCH_PERFORMANCE_STOP(yuv_convert_direct);
 }
 
@@ -237,12 +291,129 @@ static bool init_device(void *data)
    return init_mmap(v4l);
 }
 
+// Captures one frame into a free output buffer and makes it the latest one.
+// Straight from the mmap'd V4L2 buffer, which is queued again right after.
+static bool preprocess_image(video4linux_t *v4l)
+{
+   struct v4l2_buffer buf;
+   const uint8_t *src;
+   unsigned i;
+   int index = 0;
+
+   if (v4l->is_file)
+   {
+      retro_time_t now = rarch_get_time_usec();
+      if (now < v4l->file_next)
+         return false;
+      v4l->file_next = now + V4L_FILE_FRAME_MSEC * 1000;
+
+      src = (const uint8_t*)v4l->file.start + v4l->file_frame * v4l->pitch * v4l->height;
+      v4l->file_frame = (v4l->file_frame + 1) % v4l->file_frames;
+   }
+   else
+   {
+      memset(&buf, 0, sizeof(buf));
+
+      buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buf.memory = V4L2_MEMORY_MMAP;
+
+      if (xioctl(v4l->fd, VIDIOC_DQBUF, &buf) == -1)
+      {
+         switch (errno)
+         {
+            case EAGAIN:
+               return false;
+            default:
+               RARCH_ERR("VIDIOC_DQBUF.\n");
+               return false;
+         }
+      }
+
+      rarch_assert(buf.index < v4l->n_buffers);
+      src = (const uint8_t*)v4l->buffers[buf.index].start;
+   }
+
+   v4l_lock(v4l);
+   for (i = 0; i < 3; i++)
+   {
+      if ((int)i != v4l->latest && (int)i != v4l->reading)
+      {
+         index = i;
+         break;
+      }
+   }
+   v4l_unlock(v4l);
+
+   process_image(v4l, v4l->frames[index], src);
+
+   if (!v4l->is_file && xioctl(v4l->fd, VIDIOC_QBUF, &buf) == -1)
+      RARCH_ERR("VIDIOC_QBUF\n");
+
+   v4l_lock(v4l);
+   v4l->latest = index;
+   v4l->fresh = true;
+   v4l_unlock(v4l);
+
+   return true;
+}
+
+#ifdef HAVE_THREADS
+static void v4l_thread(void *data)
+{
+   video4linux_t *v4l = (video4linux_t*)data;
+
+   for (;;)
+   {
+      bool die;
+
+      slock_lock(v4l->lock);
+      die = v4l->die;
+      slock_unlock(v4l->lock);
+      if (die)
+         break;
+
+      if (v4l->is_file)
+      {
+         preprocess_image(v4l);
+         rarch_sleep(V4L_FILE_FRAME_MSEC);
+      }
+      else
+      {
+         struct pollfd fds;
+         fds.fd = v4l->fd;
+         fds.events = POLLIN;
+         fds.revents = 0;
+
+         if (poll(&fds, 1, V4L_POLL_MSEC) > 0)
+            preprocess_image(v4l);
+      }
+   }
+}
+
+static void v4l_stop_thread(video4linux_t *v4l)
+{
+   if (!v4l->thread)
+      return;
+
+   slock_lock(v4l->lock);
+   v4l->die = true;
+   slock_unlock(v4l->lock);
+
+   sthread_join(v4l->thread);
+   v4l->thread = NULL;
+}
+#endif
+
 static void v4l_stop(void *data)
 {
    video4linux_t *v4l = (video4linux_t*)data;
    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-   if (xioctl(v4l->fd, VIDIOC_STREAMOFF, &type) == -1)
+#ifdef HAVE_THREADS
+   v4l_stop_thread(v4l);
+#endif
+
+   if (!v4l->is_file && xioctl(v4l->fd, VIDIOC_STREAMOFF, &type) == -1)
       RARCH_ERR("Error - VIDIOC_STREAMOFF.\n");
 
    v4l->ready = false;
@@ -273,12 +444,29 @@ static bool v4l_start(void *data)
 
    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-   if (xioctl(v4l->fd, VIDIOC_STREAMON, &type) == -1)
+   if (!v4l->is_file && xioctl(v4l->fd, VIDIOC_STREAMON, &type) == -1)
    {
       RARCH_ERR("Error - VIDIOC_STREAMON.\n");
       return false;
    }
 
+   v4l->latest    = -1;
+   v4l->reading   = -1;
+   v4l->fresh     = false;
+   v4l->file_next = 0;
+
+#ifdef HAVE_THREADS
+   v4l->die = false;
+   v4l->thread = sthread_create(v4l_thread, v4l);
+   if (!v4l->thread)
+   {
+      RARCH_ERR("V4L2: Failed to start capture thread.\n");
+      if (!v4l->is_file)
+         xioctl(v4l->fd, VIDIOC_STREAMOFF, &type);
+      return false;
+   }
+#endif
+
    v4l->ready = true;
 
    return true;
@@ -289,23 +477,70 @@ static void v4l_free(void *data)
    video4linux_t *v4l = (video4linux_t*)data;
 
    unsigned i;
+
+#ifdef HAVE_THREADS
+   v4l_stop_thread(v4l);
+   if (v4l->lock)
+      slock_free(v4l->lock);
+#endif
+
    for (i = 0; i < v4l->n_buffers; i++)
       if (munmap(v4l->buffers[i].start, v4l->buffers[i].length) == -1)
          RARCH_ERR("munmap failed.\n");
+   free(v4l->buffers);
+
+   if (v4l->file.start && munmap(v4l->file.start, v4l->file.length) == -1)
+      RARCH_ERR("munmap failed.\n");
 
    if (v4l->fd >= 0)
       close(v4l->fd);
 
-   free(v4l->buffer_output);
-   scaler_ctx_gen_reset(&v4l->scaler);
+   for (i = 0; i < 3; i++)
+      free(v4l->frames[i]);
    free(v4l);
 }
 
+// Maps a file of width x height YUYV frames.
+static bool init_file(video4linux_t *v4l, const struct stat *st)
+{
+   size_t frame_size = v4l->width * 2 * v4l->height;
+   void *ptr;
+
+   if (!frame_size || (v4l->width & 1))
+   {
+      RARCH_ERR("V4L2: Reading frames from %s needs an even width and a height.\n", v4l->dev_name);
+      return false;
+   }
+
+   v4l->file_frames = st->st_size / frame_size;
+   if (!v4l->file_frames)
+   {
+      RARCH_ERR("V4L2: %s does not hold a single %u x %u frame.\n", v4l->dev_name, v4l->width, v4l->height);
+      return false;
+   }
+
+   ptr = mmap(NULL, v4l->file_frames * frame_size, PROT_READ, MAP_PRIVATE, v4l->fd, 0);
+   if (ptr == MAP_FAILED)
+   {
+      RARCH_ERR("Error - mmap.\n");
+      return false;
+   }
+
+   v4l->file.start  = ptr;
+   v4l->file.length = v4l->file_frames * frame_size;
+   v4l->pitch       = v4l->width * 2;
+
+   RARCH_LOG("V4L2: Playing %u YUYV frame(s) of %u x %u from %s.\n",
+         v4l->file_frames, v4l->width, v4l->height, v4l->dev_name);
+   return true;
+}
+
 static void *v4l_init(const char *device, uint64_t caps, unsigned width, unsigned height)
 {
    struct stat st;
+   unsigned i;
 
-   if ((caps & (1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER)) == 0)
+   if ((caps & ((1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER) | (1ULL << RETRO_CAMERA_BUFFER_RAW_YUYV_FRAMEBUFFER))) == 0)
    {
       RARCH_ERR("video4linux2 returns raw framebuffers.\n");
       return NULL;
@@ -317,9 +552,12 @@ static void *v4l_init(const char *device, uint64_t caps, unsigned width, unsigne
 
    strlcpy(v4l->dev_name, device ? device : "/dev/video0", sizeof(v4l->dev_name));
 
+   v4l->fd     = -1;
    v4l->width  = width;
    v4l->height = height;
    v4l->ready  = false;
+   v4l->yuyv   = (caps & (1ULL << RETRO_CAMERA_BUFFER_RAW_YUYV_FRAMEBUFFER)) &&
+      !(caps & (1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER));
 
    if (stat(v4l->dev_name, &st) == -1)
    {
@@ -327,13 +565,15 @@ static void *v4l_init(const char *device, uint64_t caps, unsigned width, unsigne
       goto error;
    }
 
-   if (!S_ISCHR(st.st_mode))
+   v4l->is_file = S_ISREG(st.st_mode);
+
+   if (!v4l->is_file && !S_ISCHR(st.st_mode))
    {
       RARCH_ERR("%s is no device.\n", v4l->dev_name);
       goto error;
    }
 
-   v4l->fd = open(v4l->dev_name, O_RDWR | O_NONBLOCK, 0);
+   v4l->fd = open(v4l->dev_name, v4l->is_file ? O_RDONLY : O_RDWR | O_NONBLOCK, 0);
 
    if (v4l->fd == -1)
    {
@@ -341,28 +581,28 @@ static void *v4l_init(const char *device, uint64_t caps, unsigned width, unsigne
       goto error;
    }
 
-   if (!init_device(v4l))
+   if (v4l->is_file ? !init_file(v4l, &st) : !init_device(v4l))
       goto error;
 
-   v4l->buffer_output = (uint32_t*)malloc(v4l->width * v4l->height * sizeof(uint32_t));
-   if (!v4l->buffer_output)
+   v4l->out_pitch = v4l->width * (v4l->yuyv ? 2 : 4);
+   for (i = 0; i < 3; i++)
    {
-      RARCH_ERR("Failed to allocate output buffer.\n");
-      goto error;
+      v4l->frames[i] = (uint32_t*)malloc(v4l->out_pitch * v4l->height);
+      if (!v4l->frames[i])
+      {
+         RARCH_ERR("Failed to allocate output buffer.\n");
+         goto error;
+      }
    }
 
-   v4l->scaler.in_width = v4l->scaler.out_width = v4l->width;
-   v4l->scaler.in_height = v4l->scaler.out_height = v4l->height;
-   v4l->scaler.in_fmt = SCALER_FMT_YUYV;
-   v4l->scaler.out_fmt = SCALER_FMT_ARGB8888;
-   v4l->scaler.in_stride = v4l->pitch;
-   v4l->scaler.out_stride = v4l->width * 4;
-
-   if (!scaler_ctx_gen_filter(&v4l->scaler))
-   {
-      RARCH_ERR("Failed to create scaler.\n");
+#ifdef HAVE_THREADS
+   v4l->lock = slock_new();
+   if (!v4l->lock)
       goto error;
-   }
+#endif
+
+   if (v4l->yuyv)
+      RARCH_LOG("V4L2: Passing YUYV frames to the core.\n");
 
    return v4l;
 
@@ -372,56 +612,39 @@ error:
    return NULL;
 }
 
-static bool preprocess_image(void *data)
-{
-   video4linux_t *v4l = (video4linux_t*)data;
-   struct v4l2_buffer buf;
-   unsigned i;
-
-   memset(&buf, 0, sizeof(buf));
-
-   buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-   buf.memory = V4L2_MEMORY_MMAP;
-
-   if (xioctl(v4l->fd, VIDIOC_DQBUF, &buf) == -1)
-   {
-      switch (errno)
-      {
-         case EAGAIN:
-            return false;
-         default:
-            RARCH_ERR("VIDIOC_DQBUF.\n");
-            return false;
-      }
-   }
-
-   rarch_assert(buf.index < v4l->n_buffers);
-
-   process_image(v4l, (const uint8_t*)v4l->buffers[buf.index].start);
-
-   if (xioctl(v4l->fd, VIDIOC_QBUF, &buf) == -1)
-      RARCH_ERR("VIDIOC_QBUF\n");
-
-   return true;
-}
-
+// Hands the latest captured frame to the core, if there is a new one. Never waits for the device.
 static bool v4l_poll(void *data, retro_camera_frame_raw_framebuffer_t frame_raw_cb,
       retro_camera_frame_opengl_texture_t frame_gl_cb)
 {
    video4linux_t *v4l = (video4linux_t*)data;
+   int index;
+
    if (!v4l->ready)
       return false;
 
    (void)frame_gl_cb;
 
-   if (preprocess_image(data))
-   {
-      if (frame_raw_cb != NULL)
-         frame_raw_cb(v4l->buffer_output, v4l->width, v4l->height, v4l->width * 4);
-      return true;
-   }
-   else
+#ifndef HAVE_THREADS
+   preprocess_image(v4l);
+#endif
+
+   v4l_lock(v4l);
+   index = v4l->fresh ? v4l->latest : -1;
+   v4l->reading = index;
+   v4l->fresh = false;
+   v4l_unlock(v4l);
+
+   if (index < 0)
       return false;
+
+   if (frame_raw_cb != NULL)
+      frame_raw_cb(v4l->frames[index], v4l->width, v4l->height, v4l->out_pitch);
+
+   v4l_lock(v4l);
+   v4l->reading = -1;
+   v4l_unlock(v4l);
+
+   return true;
 }
 
 const camera_driver_t camera_v4l2 = {
@@ -432,4 +655,3 @@ const camera_driver_t camera_v4l2 = {
    v4l_poll,
    "video4linux2",
 };
-
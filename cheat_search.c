@@ -0,0 +1,451 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cheat_search.h"
+#include "general.h"
+#include "dynamic.h"
+#include "libretro.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The comparison a search op boils down to. Ops against the previous RAM use the same
+// relations in the same order, so op & 3 is the relation.
+enum cheat_relation
+{
+   CHEAT_REL_EQ = 0,
+   CHEAT_REL_NE,
+   CHEAT_REL_GT,
+   CHEAT_REL_LT
+};
+
+struct cheat_poke
+{
+   size_t offset;
+   unsigned width;
+   uint8_t bytes[4]; // Value in native byte order.
+};
+
+static struct
+{
+   const uint8_t *ram; // RAM the search was started on, to catch the core moving it.
+   size_t size;
+   unsigned width;
+   size_t elements;
+   uint64_t *bits;     // A candidate bit per element.
+   uint8_t *prev;      // RAM at the last search step.
+   size_t count;
+
+   struct cheat_poke *pokes;
+   unsigned num_pokes;
+   unsigned max_pokes;
+
+   void (*run)(void);
+} cs;
+
+static bool cheat_get_ram(uint8_t **ram, size_t *size)
+{
+   if (!pretro_get_memory_data || !pretro_get_memory_size)
+      return false;
+
+   *ram  = (uint8_t*)pretro_get_memory_data(RETRO_MEMORY_SYSTEM_RAM);
+   *size = pretro_get_memory_size(RETRO_MEMORY_SYSTEM_RAM);
+   return *ram && *size;
+}
+
+static inline uint32_t cheat_load(const uint8_t *ptr, unsigned width)
+{
+   uint16_t val16;
+   uint32_t val32;
+
+   switch (width)
+   {
+      case 1:
+         return *ptr;
+      case 2:
+         memcpy(&val16, ptr, sizeof(val16));
+         return val16;
+      default:
+         memcpy(&val32, ptr, sizeof(val32));
+         return val32;
+   }
+}
+
+static inline bool cheat_match(uint32_t a, uint32_t b, unsigned rel)
+{
+   switch (rel)
+   {
+      case CHEAT_REL_EQ:
+         return a == b;
+      case CHEAT_REL_NE:
+         return a != b;
+      case CHEAT_REL_GT:
+         return a > b;
+      default:
+         return a < b;
+   }
+}
+
+static inline unsigned cheat_popcount64(uint64_t v)
+{
+   v = v - ((v >> 1) & UINT64_C(0x5555555555555555));
+   v = (v & UINT64_C(0x3333333333333333)) + ((v >> 2) & UINT64_C(0x3333333333333333));
+   v = (v + (v >> 4)) & UINT64_C(0x0f0f0f0f0f0f0f0f);
+   return (unsigned)((v * UINT64_C(0x0101010101010101)) >> 56);
+}
+
+#if defined(__SSE2__)
+// sel holds all-ones in the lanes of the relations which count as a match: EQ, GT, LT.
+static inline __m128i cheat_select(__m128i eq, __m128i gt, const __m128i *sel)
+{
+   __m128i lt = _mm_andnot_si128(_mm_or_si128(eq, gt), sel[2]);
+   return _mm_or_si128(_mm_or_si128(_mm_and_si128(eq, sel[0]), _mm_and_si128(gt, sel[1])), lt);
+}
+
+// Match bits of 16 elements. Compares are signed in SSE2, so flip the sign bits first.
+static inline unsigned cheat_match16(const uint8_t *cur, const uint8_t *prev,
+      __m128i value, unsigned width, const __m128i *sel)
+{
+   unsigned i;
+   __m128i res[4];
+
+   for (i = 0; i < width; i++)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)cur + i);
+      __m128i b = prev ? _mm_loadu_si128((const __m128i*)prev + i) : value;
+      __m128i sign, eq, gt;
+
+      switch (width)
+      {
+         case 1:
+            sign = _mm_set1_epi8((char)0x80);
+            eq = _mm_cmpeq_epi8(a, b);
+            gt = _mm_cmpgt_epi8(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+            break;
+         case 2:
+            sign = _mm_set1_epi16((short)0x8000);
+            eq = _mm_cmpeq_epi16(a, b);
+            gt = _mm_cmpgt_epi16(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+            break;
+         default:
+            sign = _mm_set1_epi32((int)0x80000000);
+            eq = _mm_cmpeq_epi32(a, b);
+            gt = _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+            break;
+      }
+
+      res[i] = cheat_select(eq, gt, sel);
+   }
+
+   // Narrow the lanes down to a byte each. Lanes are all-ones or zero, so saturation keeps them intact.
+   switch (width)
+   {
+      case 1:
+         return _mm_movemask_epi8(res[0]);
+      case 2:
+         return _mm_movemask_epi8(_mm_packs_epi16(res[0], res[1]));
+      default:
+         return _mm_movemask_epi8(_mm_packs_epi16(
+                  _mm_packs_epi32(res[0], res[1]), _mm_packs_epi32(res[2], res[3])));
+   }
+}
+#endif
+
+// Clears the candidate bits of elements which don't match, a 64 element word at a time.
+// Words without candidates left are skipped, so later steps of a search get cheaper.
+static inline void cheat_filter_width(const uint8_t *ram, unsigned rel, bool vs_prev,
+      uint32_t value, unsigned width)
+{
+   size_t w;
+   unsigned j;
+   size_t words = (cs.elements + 63) / 64;
+
+#if defined(__SSE2__)
+   size_t full_words = cs.elements / 64;
+   __m128i sel[3], value_vec;
+   sel[0] = _mm_set1_epi32(rel == CHEAT_REL_EQ ? -1 : 0);
+   sel[1] = _mm_set1_epi32(rel == CHEAT_REL_GT || rel == CHEAT_REL_NE ? -1 : 0);
+   sel[2] = _mm_set1_epi32(rel == CHEAT_REL_LT || rel == CHEAT_REL_NE ? -1 : 0);
+   if (width == 1)
+      value_vec = _mm_set1_epi8((char)value);
+   else if (width == 2)
+      value_vec = _mm_set1_epi16((short)value);
+   else
+      value_vec = _mm_set1_epi32((int)value);
+#endif
+
+   for (w = 0; w < words; w++)
+   {
+      uint64_t bits = cs.bits[w];
+      uint64_t match = 0;
+      const uint8_t *cur  = ram + w * 64 * width;
+      const uint8_t *prev = cs.prev + w * 64 * width;
+
+      if (!bits)
+         continue;
+
+#if defined(__SSE2__)
+      if (w < full_words)
+      {
+         for (j = 0; j < 64; j += 16)
+         {
+            if (!((bits >> j) & 0xffff))
+               continue;
+            match |= (uint64_t)cheat_match16(cur + j * width, vs_prev ? prev + j * width : NULL,
+                  value_vec, width, sel) << j;
+         }
+      }
+      else
+#endif
+      {
+         for (j = 0; j < 64; j++)
+         {
+            if (!((bits >> j) & 1))
+               continue;
+            if (cheat_match(cheat_load(cur + j * width, width),
+                     vs_prev ? cheat_load(prev + j * width, width) : value, rel))
+               match |= UINT64_C(1) << j;
+         }
+      }
+
+      cs.bits[w] = bits & match;
+   }
+}
+
+// Inlined with a constant width, so the compares above are specialized for it.
+static void cheat_filter(const uint8_t *ram, unsigned rel, bool vs_prev, uint32_t value)
+{
+   switch (cs.width)
+   {
+      case 1:
+         cheat_filter_width(ram, rel, vs_prev, value, 1);
+         break;
+      case 2:
+         cheat_filter_width(ram, rel, vs_prev, value, 2);
+         break;
+      default:
+         cheat_filter_width(ram, rel, vs_prev, value, 4);
+         break;
+   }
+}
+
+static void cheat_search_free(void)
+{
+   free(cs.bits);
+   free(cs.prev);
+   cs.bits     = NULL;
+   cs.prev     = NULL;
+   cs.ram      = NULL;
+   cs.size     = 0;
+   cs.width    = 0;
+   cs.elements = 0;
+   cs.count    = 0;
+}
+
+bool cheat_search_start(unsigned width)
+{
+   uint8_t *ram;
+   size_t size, words;
+
+   if (width != 1 && width != 2 && width != 4)
+      return false;
+
+   cheat_search_free();
+   if (!cheat_get_ram(&ram, &size))
+   {
+      RARCH_ERR("Core does not expose system RAM, cannot search it.\n");
+      return false;
+   }
+
+   cs.elements = size / width;
+   words       = (cs.elements + 63) / 64;
+   cs.bits     = (uint64_t*)malloc(words * sizeof(uint64_t));
+   cs.prev     = (uint8_t*)malloc(size);
+   if (!cs.bits || !cs.prev)
+   {
+      cheat_search_free();
+      return false;
+   }
+
+   memset(cs.bits, 0xff, words * sizeof(uint64_t));
+   if (cs.elements % 64)
+      cs.bits[words - 1] = (UINT64_C(1) << (cs.elements % 64)) - 1;
+   memcpy(cs.prev, ram, size);
+
+   cs.ram   = ram;
+   cs.size  = size;
+   cs.width = width;
+   cs.count = cs.elements;
+   return true;
+}
+
+bool cheat_search_refine(enum cheat_search_op op, uint32_t value)
+{
+   size_t w, words, count = 0;
+   uint8_t *ram;
+   size_t size;
+
+   if (!cs.bits || op >= CHEAT_SEARCH_OP_LAST)
+      return false;
+
+   if (!cheat_get_ram(&ram, &size) || ram != cs.ram || size != cs.size)
+   {
+      RARCH_ERR("System RAM changed since the cheat search was started.\n");
+      return false;
+   }
+
+   if (cs.width == 1)
+      value &= 0xff;
+   else if (cs.width == 2)
+      value &= 0xffff;
+
+   cheat_filter(ram, op & 3, op >= CHEAT_SEARCH_UNCHANGED, value);
+   memcpy(cs.prev, ram, size);
+
+   words = (cs.elements + 63) / 64;
+   for (w = 0; w < words; w++)
+      count += cheat_popcount64(cs.bits[w]);
+   cs.count = count;
+   return true;
+}
+
+size_t cheat_search_count(void)
+{
+   return cs.count;
+}
+
+unsigned cheat_search_width(void)
+{
+   return cs.width;
+}
+
+size_t cheat_search_candidates(size_t *offsets, size_t max)
+{
+   size_t w, num = 0;
+   size_t words = (cs.elements + 63) / 64;
+
+   for (w = 0; w < words && num < max; w++)
+   {
+      unsigned j;
+      uint64_t bits = cs.bits[w];
+      for (j = 0; bits && j < 64 && num < max; j++, bits >>= 1)
+         if (bits & 1)
+            offsets[num++] = (w * 64 + j) * cs.width;
+   }
+
+   return num;
+}
+
+bool cheat_search_read(size_t offset, unsigned width, uint32_t *value)
+{
+   uint8_t *ram;
+   size_t size;
+
+   if (!cheat_get_ram(&ram, &size) || offset > size || width > size - offset)
+      return false;
+
+   *value = cheat_load(ram + offset, width);
+   return true;
+}
+
+bool cheat_poke_add(size_t offset, unsigned width, uint32_t value)
+{
+   unsigned i;
+   uint8_t val8    = value;
+   uint16_t val16  = value;
+   struct cheat_poke *poke = NULL;
+
+   if (width != 1 && width != 2 && width != 4)
+      return false;
+
+   for (i = 0; i < cs.num_pokes; i++)
+      if (cs.pokes[i].offset == offset)
+         poke = &cs.pokes[i];
+
+   if (!poke)
+   {
+      if (cs.num_pokes == cs.max_pokes)
+      {
+         unsigned max_pokes = cs.max_pokes ? cs.max_pokes * 2 : 16;
+         struct cheat_poke *pokes = (struct cheat_poke*)realloc(cs.pokes, max_pokes * sizeof(*pokes));
+         if (!pokes)
+            return false;
+         cs.pokes     = pokes;
+         cs.max_pokes = max_pokes;
+      }
+      poke = &cs.pokes[cs.num_pokes++];
+   }
+
+   poke->offset = offset;
+   poke->width  = width;
+   if (width == 1)
+      memcpy(poke->bytes, &val8, 1);
+   else if (width == 2)
+      memcpy(poke->bytes, &val16, 2);
+   else
+      memcpy(poke->bytes, &value, 4);
+   return true;
+}
+
+void cheat_poke_clear(void)
+{
+   free(cs.pokes);
+   cs.pokes     = NULL;
+   cs.num_pokes = 0;
+   cs.max_pokes = 0;
+}
+
+unsigned cheat_poke_count(void)
+{
+   return cs.num_pokes;
+}
+
+static void cheat_search_run(void)
+{
+   unsigned i;
+   uint8_t *ram;
+   size_t size;
+
+   cs.run();
+
+   if (!cs.num_pokes || !cheat_get_ram(&ram, &size))
+      return;
+
+   for (i = 0; i < cs.num_pokes; i++)
+   {
+      const struct cheat_poke *poke = &cs.pokes[i];
+      if (poke->offset <= size && poke->width <= size - poke->offset)
+         memcpy(ram + poke->offset, poke->bytes, poke->width);
+   }
+}
+
+void cheat_search_hook_core(void)
+{
+   if (pretro_run == cheat_search_run)
+      return;
+
+   cs.run = pretro_run;
+   pretro_run = cheat_search_run;
+}
+
+void cheat_search_deinit(void)
+{
+   cheat_search_free();
+   cheat_poke_clear();
+}
+
@@ -0,0 +1,78 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_CHEAT_SEARCH_H
+#define __RARCH_CHEAT_SEARCH_H
+
+#include "boolean.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frontend side RAM search and patching on RETRO_MEMORY_SYSTEM_RAM,
+// for cores which don't implement retro_cheat_set().
+// Values are unsigned, 1, 2 or 4 bytes wide, aligned to their width and in native byte order.
+
+enum cheat_search_op
+{
+   // Against a value.
+   CHEAT_SEARCH_EQ = 0,
+   CHEAT_SEARCH_NE,
+   CHEAT_SEARCH_GT,
+   CHEAT_SEARCH_LT,
+
+   // Against the RAM at the previous search step.
+   CHEAT_SEARCH_UNCHANGED,
+   CHEAT_SEARCH_CHANGED,
+   CHEAT_SEARCH_INCREASED,
+   CHEAT_SEARCH_DECREASED,
+
+   CHEAT_SEARCH_OP_LAST
+};
+
+// Makes every value of the given width a candidate, and snapshots RAM.
+bool cheat_search_start(unsigned width);
+
+// Drops candidates which don't match. Returns false if no search was started,
+// or if the core's RAM moved or changed size since.
+bool cheat_search_refine(enum cheat_search_op op, uint32_t value);
+
+size_t cheat_search_count(void);
+unsigned cheat_search_width(void);
+
+// Offsets of the first candidates, at most max. Returns how many were written.
+size_t cheat_search_candidates(size_t *offsets, size_t max);
+
+bool cheat_search_read(size_t offset, unsigned width, uint32_t *value);
+
+// Pokes are written to RAM after every retro_run(). A poke at the same offset replaces the old one.
+bool cheat_poke_add(size_t offset, unsigned width, uint32_t value);
+void cheat_poke_clear(void);
+unsigned cheat_poke_count(void);
+
+// Routes retro_run() through the poke path. Must be called after the core symbols are loaded.
+void cheat_search_hook_core(void);
+// Frees the search and pokes, they are not valid for another core.
+void cheat_search_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -22,6 +22,8 @@
 
 #include "driver.h"
 #include "general.h"
+#include "input/input_common.h"
+#include "cheat_search.h"
 #include "compat/strl.h"
 #include "compat/posix_string.h"
 #include <stdio.h>
@@ -32,6 +34,25 @@
 #include <unistd.h>
 #endif
 
+#if defined(HAVE_NETWORK_CMD) && defined(HAVE_THREADS) && !defined(_WIN32)
+#define HAVE_BIN_CMD
+#include "thread.h"
+#include "dynamic.h"
+#include "performance.h"
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/tcp.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+struct cmd_bin;
+static struct cmd_bin *cmd_bin_new(uint16_t port, const char *path);
+static void cmd_bin_free(struct cmd_bin *bin);
+#endif
+
 #define DEFAULT_NETWORK_CMD_PORT 55355
 #define STDIN_BUF_SIZE 4096
 
@@ -47,6 +68,9 @@ struct rarch_cmd
    int net_fd;
 #endif
 
+#ifdef HAVE_BIN_CMD
+   struct cmd_bin *bin;
+#endif
    bool state[RARCH_BIND_LIST_END];
 };
 
@@ -145,6 +169,12 @@ rarch_cmd_t *rarch_cmd_new(bool stdin_enable, bool network_enable, uint16_t port
    (void)stdin_enable;
 #endif
 
+#ifdef HAVE_BIN_CMD
+   if ((g_settings.network_cmd_bin_port || *g_settings.network_cmd_bin_socket) &&
+         !(handle->bin = cmd_bin_new(g_settings.network_cmd_bin_port, g_settings.network_cmd_bin_socket)))
+      goto error;
+#endif
+
    return handle;
 
 error:
@@ -159,6 +189,11 @@ void rarch_cmd_free(rarch_cmd_t *handle)
       close(handle->net_fd);
 #endif
 
+#ifdef HAVE_BIN_CMD
+   if (handle->bin)
+      cmd_bin_free(handle->bin);
+#endif
+
    free(handle);
 }
 
@@ -237,8 +272,126 @@ static bool cmd_set_shader(const char *arg)
    return video_set_shader_func(type, arg);
 }
 
+static bool cmd_perf_report(const char *arg)
+{
+   rarch_perf_report(strcmp(arg, "*") == 0 ? NULL : arg);
+   return true;
+}
+
+static bool cmd_perf_dump(const char *arg)
+{
+   if (!rarch_perf_dump_trace(arg))
+      return false;
+
+   RARCH_LOG("Wrote performance trace to \"%s\".\n", arg);
+   return true;
+}
+
+#if defined(HAVE_UDEV) && defined(HAVE_THREADS)
+static bool cmd_input_latency(const char *arg)
+{
+   struct udev_joypad_latency latency;
+
+   if (strcmp(arg, "reset") == 0)
+   {
+      udev_joypad_reset_latency();
+      return true;
+   }
+   else if (strcmp(arg, "log"))
+      return false;
+
+   udev_joypad_get_latency(&latency);
+   RARCH_LOG("Joypad input latency over %llu events: avg %lld us, p50 %lld us, p99 %lld us, max %lld us, %u dropped.\n",
+         (unsigned long long)latency.events, (long long)latency.avg, (long long)latency.p50,
+         (long long)latency.p99, (long long)latency.max, latency.dropped);
+   return true;
+}
+#endif
+
+static bool cmd_cheat_search(const char *arg)
+{
+   static const char *ops[CHEAT_SEARCH_OP_LAST] = {
+      "eq", "ne", "gt", "lt", "unchanged", "changed", "increased", "decreased",
+   };
+   unsigned i;
+   uint32_t value = 0;
+   size_t len = strcspn(arg, " ");
+
+   if (strncmp(arg, "start ", 6) == 0)
+   {
+      if (!cheat_search_start(strtoul(arg + 6, NULL, 0)))
+         return false;
+      RARCH_LOG("Cheat search: %lu candidates.\n", (unsigned long)cheat_search_count());
+      return true;
+   }
+   else if (strcmp(arg, "list") == 0)
+   {
+      size_t offsets[32];
+      size_t num = cheat_search_candidates(offsets, ARRAY_SIZE(offsets));
+      for (i = 0; i < num; i++)
+      {
+         cheat_search_read(offsets[i], cheat_search_width(), &value);
+         RARCH_LOG("Cheat search: 0x%06lx = %u\n", (unsigned long)offsets[i], value);
+      }
+      return true;
+   }
+
+   for (i = 0; i < CHEAT_SEARCH_OP_LAST; i++)
+      if (strlen(ops[i]) == len && strncmp(arg, ops[i], len) == 0)
+         break;
+
+   if (i == CHEAT_SEARCH_OP_LAST)
+      return false;
+   if (i < CHEAT_SEARCH_UNCHANGED)
+   {
+      if (!arg[len])
+         return false;
+      value = strtoul(arg + len + 1, NULL, 0);
+   }
+
+   if (!cheat_search_refine((enum cheat_search_op)i, value))
+      return false;
+
+   RARCH_LOG("Cheat search: %lu candidates.\n", (unsigned long)cheat_search_count());
+   return true;
+}
+
+static bool cmd_cheat_poke(const char *arg)
+{
+   char *end;
+   unsigned long offset, width, value;
+
+   if (strcmp(arg, "clear") == 0)
+   {
+      cheat_poke_clear();
+      return true;
+   }
+
+   // All three fields are required, a missing value is not a poke of 0.
+   offset = strtoul(arg, &end, 0);
+   if (end == arg)
+      return false;
+   arg    = end;
+   width  = strtoul(arg, &end, 0);
+   if (end == arg)
+      return false;
+   arg    = end;
+   value  = strtoul(arg, &end, 0);
+   if (end == arg || *end)
+      return false;
+
+   return cheat_poke_add(offset, width, value);
+}
+
 static const struct cmd_action_map action_map[] = {
-   { "SET_SHADER", cmd_set_shader, "<shader path>" },
+   { "SET_SHADER",    cmd_set_shader,    "<shader path>" },
+   { "PERF_REPORT",   cmd_perf_report,   "<counter name filter, or * for all>" },
+   { "PERF_DUMP",     cmd_perf_dump,     "<trace file path>" },
+#if defined(HAVE_UDEV) && defined(HAVE_THREADS)
+   { "INPUT_LATENCY", cmd_input_latency, "<log|reset>" },
+#endif
+   { "CHEAT_SEARCH",  cmd_cheat_search,  "<start 1|2|4, eq|ne|gt|lt value, unchanged|changed|increased|decreased, list>" },
+   { "CHEAT_POKE",    cmd_cheat_poke,    "<offset width value, or clear>" },
 };
 
 static bool command_get_arg(const char *tok, const char **arg, unsigned *index)
@@ -280,7 +433,7 @@ static bool command_get_arg(const char *tok, const char **arg, unsigned *index)
    return false;
 }
 
-static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
+static bool parse_sub_msg(rarch_cmd_t *handle, const char *tok)
 {
    const char *arg = NULL;
    unsigned index  = 0;
@@ -290,24 +443,32 @@ static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
       if (arg)
       {
          if (!action_map[index].action(arg))
+         {
             RARCH_ERR("Command \"%s\" failed.\n", arg);
+            return false;
+         }
       }
       else
          handle->state[map[index].id] = true;
+      return true;
    }
-   else
-      RARCH_WARN("Unrecognized command \"%s\" received.\n", tok);
+
+   RARCH_WARN("Unrecognized command \"%s\" received.\n", tok);
+   return false;
 }
 
-static void parse_msg(rarch_cmd_t *handle, char *buf)
+// Returns false if any of the commands was not recognized or failed.
+static bool parse_msg(rarch_cmd_t *handle, char *buf)
 {
    char *save;
+   bool ret = true;
    const char *tok = strtok_r(buf, "\n", &save);
    while (tok)
    {
-      parse_sub_msg(handle, tok);
+      ret = parse_sub_msg(handle, tok) && ret;
       tok = strtok_r(NULL, "\n", &save);
    }
+   return ret;
 }
 
 void rarch_cmd_set(rarch_cmd_t *handle, unsigned id)
@@ -489,6 +650,795 @@ static void stdin_cmd_poll(rarch_cmd_t *handle)
 }
 #endif
 
+#ifdef HAVE_BIN_CMD
+// Binary protocol (see command.h). Sockets are serviced on their own thread, complete requests
+// are handed over to the main thread through lock-free rings, so rarch_cmd_poll() makes no syscalls
+// unless it has something to send back.
+
+#define CMD_BIN_HEADER_SIZE 12
+#define CMD_BIN_MAX_CLIENTS 8
+#define CMD_BIN_RING_SIZE 256
+#define CMD_BIN_TELEMETRY_SIZE 24
+#define CMD_BIN_MAX_PAYLOAD (16 * 1024 * 1024)
+#define CMD_BIN_RECV_SIZE (64 * 1024)
+// Telemetry is dropped for clients which don't keep up with it.
+#define CMD_BIN_MAX_BACKLOG (4 * 1024 * 1024)
+
+#define cmd_bin_barrier() __sync_synchronize()
+
+struct cmd_bin_msg
+{
+   unsigned client;
+   unsigned generation;
+   uint16_t op;
+   uint16_t status;
+   uint32_t id;
+   size_t size;
+   uint8_t *data; // Follows the struct, always NUL terminated.
+};
+
+// Single producer, single consumer.
+struct cmd_bin_ring
+{
+   volatile unsigned head;
+   volatile unsigned tail;
+   struct cmd_bin_msg *msgs[CMD_BIN_RING_SIZE];
+};
+
+struct cmd_bin_client
+{
+   int fd;
+   bool stalled; // The request ring was full, the rest of the input waits for the main thread.
+   uint8_t *in;
+   size_t in_size;
+   size_t in_cap;
+   uint8_t *out;
+   size_t out_size;
+   size_t out_cap;
+};
+
+// Telemetry subscription. Only used by the main thread.
+struct cmd_bin_sub
+{
+   unsigned generation;
+   unsigned interval;
+   unsigned frame;
+   unsigned mem_id;
+   uint32_t offset;
+   uint32_t size;
+};
+
+struct cmd_bin
+{
+   sthread_t *thread;
+   volatile bool quit;
+   int listen_fd[2]; // TCP, Unix socket.
+   int wake_fd[2];
+   char socket_path[PATH_MAX];
+
+   struct cmd_bin_ring requests; // Socket thread to main thread.
+   struct cmd_bin_ring replies;  // Main thread to socket thread.
+
+   // Bumped by the socket thread whenever a client slot connects or disconnects.
+   // Replies and subscriptions of an older generation are dropped.
+   volatile unsigned generation[CMD_BIN_MAX_CLIENTS];
+   struct cmd_bin_client clients[CMD_BIN_MAX_CLIENTS];
+
+   struct cmd_bin_sub subs[CMD_BIN_MAX_CLIENTS];
+   retro_time_t last_poll;
+};
+
+static inline void cmd_bin_put16(uint8_t *p, uint16_t val)
+{
+   p[0] = val;
+   p[1] = val >> 8;
+}
+
+static inline void cmd_bin_put32(uint8_t *p, uint32_t val)
+{
+   cmd_bin_put16(p, val);
+   cmd_bin_put16(p + 2, val >> 16);
+}
+
+static inline void cmd_bin_put64(uint8_t *p, uint64_t val)
+{
+   cmd_bin_put32(p, (uint32_t)val);
+   cmd_bin_put32(p + 4, (uint32_t)(val >> 32));
+}
+
+static inline uint16_t cmd_bin_get16(const uint8_t *p)
+{
+   return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t cmd_bin_get32(const uint8_t *p)
+{
+   return cmd_bin_get16(p) | ((uint32_t)cmd_bin_get16(p + 2) << 16);
+}
+
+static struct cmd_bin_msg *cmd_bin_msg_new(unsigned client, unsigned generation,
+      uint16_t op, uint32_t id, size_t size)
+{
+   struct cmd_bin_msg *msg = (struct cmd_bin_msg*)malloc(sizeof(*msg) + size + 1);
+   if (!msg)
+      return NULL;
+
+   msg->client     = client;
+   msg->generation = generation;
+   msg->op         = op;
+   msg->status     = CMD_BIN_OK;
+   msg->id         = id;
+   msg->size       = size;
+   msg->data       = (uint8_t*)(msg + 1);
+   msg->data[size] = '\0';
+   return msg;
+}
+
+static inline bool cmd_bin_ring_full(const struct cmd_bin_ring *ring)
+{
+   return ring->head - ring->tail >= CMD_BIN_RING_SIZE;
+}
+
+static bool cmd_bin_ring_push(struct cmd_bin_ring *ring, struct cmd_bin_msg *msg)
+{
+   unsigned head = ring->head;
+   if (head - ring->tail >= CMD_BIN_RING_SIZE)
+      return false;
+
+   ring->msgs[head % CMD_BIN_RING_SIZE] = msg;
+   cmd_bin_barrier();
+   ring->head = head + 1;
+   return true;
+}
+
+static struct cmd_bin_msg *cmd_bin_ring_pop(struct cmd_bin_ring *ring)
+{
+   struct cmd_bin_msg *msg;
+   unsigned tail = ring->tail;
+   if (tail == ring->head)
+      return NULL;
+
+   cmd_bin_barrier();
+   msg = ring->msgs[tail % CMD_BIN_RING_SIZE];
+   cmd_bin_barrier();
+   ring->tail = tail + 1;
+   return msg;
+}
+
+static void cmd_bin_wake(struct cmd_bin *bin)
+{
+   // If the pipe is full, a wakeup is pending anyway.
+   char c = 0;
+   ssize_t ret = write(bin->wake_fd[1], &c, 1);
+   (void)ret;
+}
+
+static bool cmd_bin_reserve(uint8_t **buf, size_t *cap, size_t size)
+{
+   uint8_t *new_buf;
+   size_t new_cap = *cap ? *cap : 4096;
+   if (size <= *cap)
+      return true;
+
+   while (new_cap < size)
+      new_cap *= 2;
+
+   new_buf = (uint8_t*)realloc(*buf, new_cap);
+   if (!new_buf)
+      return false;
+
+   *buf = new_buf;
+   *cap = new_cap;
+   return true;
+}
+
+static void cmd_bin_client_close(struct cmd_bin *bin, unsigned i)
+{
+   struct cmd_bin_client *client = &bin->clients[i];
+   close(client->fd);
+   free(client->in);
+   free(client->out);
+   memset(client, 0, sizeof(*client));
+   client->fd = -1;
+   bin->generation[i]++;
+}
+
+// Hands complete requests over to the main thread.
+static bool cmd_bin_client_parse(struct cmd_bin *bin, unsigned i)
+{
+   struct cmd_bin_client *client = &bin->clients[i];
+   size_t pos = 0;
+
+   client->stalled = false;
+   while (client->in_size - pos >= CMD_BIN_HEADER_SIZE)
+   {
+      struct cmd_bin_msg *msg;
+      const uint8_t *header = client->in + pos;
+      uint32_t size = cmd_bin_get32(header);
+
+      if (size > CMD_BIN_MAX_PAYLOAD)
+      {
+         RARCH_WARN("Binary command client sent a %u byte message, disconnecting.\n", size);
+         return false;
+      }
+
+      if (client->in_size - pos < CMD_BIN_HEADER_SIZE + size)
+         break;
+
+      if (cmd_bin_ring_full(&bin->requests))
+      {
+         client->stalled = true;
+         break;
+      }
+
+      msg = cmd_bin_msg_new(i, bin->generation[i], cmd_bin_get16(header + 4), cmd_bin_get32(header + 8), size);
+      if (!msg)
+         return false;
+
+      memcpy(msg->data, header + CMD_BIN_HEADER_SIZE, size);
+      cmd_bin_ring_push(&bin->requests, msg);
+      pos += CMD_BIN_HEADER_SIZE + size;
+   }
+
+   memmove(client->in, client->in + pos, client->in_size - pos);
+   client->in_size -= pos;
+   return true;
+}
+
+static bool cmd_bin_client_read(struct cmd_bin *bin, unsigned i)
+{
+   ssize_t ret;
+   struct cmd_bin_client *client = &bin->clients[i];
+
+   if (!cmd_bin_reserve(&client->in, &client->in_cap, client->in_size + CMD_BIN_RECV_SIZE))
+      return false;
+
+   ret = recv(client->fd, client->in + client->in_size, CMD_BIN_RECV_SIZE, 0);
+   if (ret == 0)
+      return false;
+   if (ret < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+   client->in_size += ret;
+   return cmd_bin_client_parse(bin, i);
+}
+
+static bool cmd_bin_client_write(struct cmd_bin_client *client)
+{
+   size_t written = 0;
+   while (written < client->out_size)
+   {
+      ssize_t ret = send(client->fd, client->out + written, client->out_size - written, MSG_NOSIGNAL);
+      if (ret < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return false;
+         break;
+      }
+      written += ret;
+   }
+
+   memmove(client->out, client->out + written, client->out_size - written);
+   client->out_size -= written;
+   return true;
+}
+
+// Moves replies from the main thread into the output buffers of their clients.
+static void cmd_bin_deliver(struct cmd_bin *bin)
+{
+   struct cmd_bin_msg *msg;
+   while ((msg = cmd_bin_ring_pop(&bin->replies)))
+   {
+      struct cmd_bin_client *client = &bin->clients[msg->client];
+      size_t size = CMD_BIN_HEADER_SIZE + msg->size;
+
+      if (client->fd >= 0 && msg->generation == bin->generation[msg->client] &&
+            !(msg->op == CMD_BIN_TELEMETRY && client->out_size > CMD_BIN_MAX_BACKLOG) &&
+            cmd_bin_reserve(&client->out, &client->out_cap, client->out_size + size))
+      {
+         uint8_t *header = client->out + client->out_size;
+         cmd_bin_put32(header, msg->size);
+         cmd_bin_put16(header + 4, msg->op);
+         cmd_bin_put16(header + 6, msg->status);
+         cmd_bin_put32(header + 8, msg->id);
+         memcpy(header + CMD_BIN_HEADER_SIZE, msg->data, msg->size);
+         client->out_size += size;
+      }
+
+      free(msg);
+   }
+}
+
+static void cmd_bin_accept(struct cmd_bin *bin, int listen_fd)
+{
+   unsigned i;
+   int yes = 1;
+   int fd = accept(listen_fd, NULL, NULL);
+   if (fd < 0)
+      return;
+
+   for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+      if (bin->clients[i].fd < 0)
+         break;
+
+   if (i == CMD_BIN_MAX_CLIENTS || !socket_nonblock(fd))
+   {
+      RARCH_WARN("Rejecting binary command client, %u clients are connected.\n", CMD_BIN_MAX_CLIENTS);
+      close(fd);
+      return;
+   }
+
+   // Fails harmlessly on Unix sockets.
+   setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, CONST_CAST &yes, sizeof(int));
+
+   bin->clients[i].fd = fd;
+   bin->generation[i]++;
+}
+
+static void cmd_bin_thread(void *data)
+{
+   unsigned i;
+   struct cmd_bin *bin = (struct cmd_bin*)data;
+
+   while (!bin->quit)
+   {
+      fd_set read_fds, write_fds;
+      int max_fd = bin->wake_fd[0];
+
+      FD_ZERO(&read_fds);
+      FD_ZERO(&write_fds);
+      FD_SET(bin->wake_fd[0], &read_fds);
+
+      for (i = 0; i < 2; i++)
+      {
+         if (bin->listen_fd[i] < 0)
+            continue;
+         FD_SET(bin->listen_fd[i], &read_fds);
+         max_fd = max(max_fd, bin->listen_fd[i]);
+      }
+
+      for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+      {
+         const struct cmd_bin_client *client = &bin->clients[i];
+         if (client->fd < 0)
+            continue;
+
+         if (!client->stalled)
+            FD_SET(client->fd, &read_fds);
+         if (client->out_size)
+            FD_SET(client->fd, &write_fds);
+         max_fd = max(max_fd, client->fd);
+      }
+
+      if (select(max_fd + 1, &read_fds, &write_fds, NULL, NULL) < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         RARCH_ERR("Binary command interface failed to wait for sockets.\n");
+         break;
+      }
+
+      if (FD_ISSET(bin->wake_fd[0], &read_fds))
+      {
+         char buf[64];
+         while (read(bin->wake_fd[0], buf, sizeof(buf)) > 0);
+      }
+
+      cmd_bin_deliver(bin);
+
+      for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+      {
+         struct cmd_bin_client *client = &bin->clients[i];
+         bool ok = true;
+         if (client->fd < 0)
+            continue;
+
+         if (client->stalled)
+            ok = cmd_bin_client_parse(bin, i);
+         if (ok && FD_ISSET(client->fd, &read_fds))
+            ok = cmd_bin_client_read(bin, i);
+         if (ok && client->out_size)
+            ok = cmd_bin_client_write(client);
+
+         if (!ok)
+            cmd_bin_client_close(bin, i);
+      }
+
+      for (i = 0; i < 2; i++)
+         if (bin->listen_fd[i] >= 0 && FD_ISSET(bin->listen_fd[i], &read_fds))
+            cmd_bin_accept(bin, bin->listen_fd[i]);
+   }
+}
+
+static int cmd_bin_listen_tcp(uint16_t port)
+{
+   int fd = -1;
+   int yes = 1;
+   char port_buf[16];
+   struct addrinfo hints, *res = NULL;
+
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family   = AF_UNSPEC;
+   hints.ai_socktype = SOCK_STREAM;
+   hints.ai_flags    = AI_PASSIVE;
+
+   snprintf(port_buf, sizeof(port_buf), "%hu", (unsigned short)port);
+   if (getaddrinfo(NULL, port_buf, &hints, &res) < 0)
+      return -1;
+
+   fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+   if (fd < 0)
+      goto error;
+
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, CONST_CAST &yes, sizeof(int));
+   if (bind(fd, res->ai_addr, res->ai_addrlen) < 0 ||
+         listen(fd, CMD_BIN_MAX_CLIENTS) < 0 || !socket_nonblock(fd))
+   {
+      RARCH_ERR("Failed to listen on port %hu.\n", (unsigned short)port);
+      goto error;
+   }
+
+   freeaddrinfo(res);
+   return fd;
+
+error:
+   if (fd >= 0)
+      close(fd);
+   freeaddrinfo(res);
+   return -1;
+}
+
+static int cmd_bin_listen_unix(const char *path)
+{
+   int fd;
+   struct stat st;
+   struct sockaddr_un addr;
+
+   memset(&addr, 0, sizeof(addr));
+   if (strlen(path) >= sizeof(addr.sun_path))
+   {
+      RARCH_ERR("Socket path \"%s\" is too long.\n", path);
+      return -1;
+   }
+   addr.sun_family = AF_UNIX;
+   strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+   // Left behind by an earlier run which didn't shut down cleanly.
+   if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+      unlink(path);
+
+   fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0)
+      return -1;
+
+   if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+         listen(fd, CMD_BIN_MAX_CLIENTS) < 0 || !socket_nonblock(fd))
+   {
+      RARCH_ERR("Failed to listen on \"%s\".\n", path);
+      close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+static void cmd_bin_free(struct cmd_bin *bin)
+{
+   unsigned i;
+   struct cmd_bin_msg *msg;
+
+   if (bin->thread)
+   {
+      bin->quit = true;
+      cmd_bin_wake(bin);
+      sthread_join(bin->thread);
+   }
+
+   for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+      if (bin->clients[i].fd >= 0)
+         cmd_bin_client_close(bin, i);
+
+   for (i = 0; i < 2; i++)
+   {
+      if (bin->listen_fd[i] >= 0)
+         close(bin->listen_fd[i]);
+      if (bin->wake_fd[i] >= 0)
+         close(bin->wake_fd[i]);
+   }
+
+   if (*bin->socket_path)
+      unlink(bin->socket_path);
+
+   while ((msg = cmd_bin_ring_pop(&bin->requests)))
+      free(msg);
+   while ((msg = cmd_bin_ring_pop(&bin->replies)))
+      free(msg);
+
+   free(bin);
+}
+
+static struct cmd_bin *cmd_bin_new(uint16_t port, const char *path)
+{
+   unsigned i;
+   struct cmd_bin *bin = (struct cmd_bin*)calloc(1, sizeof(*bin));
+   if (!bin)
+      return NULL;
+
+   for (i = 0; i < 2; i++)
+      bin->listen_fd[i] = bin->wake_fd[i] = -1;
+   for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+      bin->clients[i].fd = -1;
+
+   if (port)
+   {
+      RARCH_LOG("Bringing up binary command interface on port %hu.\n", (unsigned short)port);
+      if ((bin->listen_fd[0] = cmd_bin_listen_tcp(port)) < 0)
+         goto error;
+   }
+
+   if (*path)
+   {
+      RARCH_LOG("Bringing up binary command interface on \"%s\".\n", path);
+      if ((bin->listen_fd[1] = cmd_bin_listen_unix(path)) < 0)
+         goto error;
+      strlcpy(bin->socket_path, path, sizeof(bin->socket_path));
+   }
+
+   if (pipe(bin->wake_fd) < 0 || !socket_nonblock(bin->wake_fd[0]) || !socket_nonblock(bin->wake_fd[1]))
+      goto error;
+
+   bin->last_poll = rarch_get_time_usec();
+   if (!(bin->thread = sthread_create(cmd_bin_thread, bin)))
+      goto error;
+
+   return bin;
+
+error:
+   cmd_bin_free(bin);
+   return NULL;
+}
+
+// Main thread side.
+
+static bool cmd_bin_memory(unsigned mem_id, uint32_t offset, uint32_t size, uint8_t **ptr)
+{
+   uint8_t *data;
+   size_t mem_size;
+   if (!pretro_get_memory_data)
+      return false;
+
+   data     = (uint8_t*)pretro_get_memory_data(mem_id);
+   mem_size = pretro_get_memory_size(mem_id);
+   if (!data || offset > mem_size || size > mem_size - offset)
+      return false;
+
+   *ptr = data + offset;
+   return true;
+}
+
+static struct cmd_bin_msg *cmd_bin_perf_counters(const struct cmd_bin_msg *req)
+{
+   unsigned i, j, num[2];
+   size_t size = 4;
+   uint8_t *ptr;
+   struct cmd_bin_msg *reply;
+   const struct retro_perf_counter **counters[2];
+
+   counters[0] = rarch_perf_get_counters(&num[0]);
+   counters[1] = retro_perf_get_counters(&num[1]);
+   for (j = 0; j < 2; j++)
+      for (i = 0; i < num[j]; i++)
+         size += 1 + 2 + min(strlen(counters[j][i]->ident), 0xffff) + 16;
+
+   if (!(reply = cmd_bin_msg_new(req->client, req->generation, req->op, req->id, size)))
+      return NULL;
+
+   ptr = reply->data;
+   cmd_bin_put32(ptr, num[0] + num[1]);
+   ptr += 4;
+   for (j = 0; j < 2; j++)
+   {
+      for (i = 0; i < num[j]; i++)
+      {
+         const struct retro_perf_counter *counter = counters[j][i];
+         size_t len = min(strlen(counter->ident), 0xffff);
+
+         *ptr++ = j;
+         cmd_bin_put16(ptr, len);
+         memcpy(ptr + 2, counter->ident, len);
+         ptr += 2 + len;
+         cmd_bin_put64(ptr, counter->total);
+         cmd_bin_put64(ptr + 8, counter->call_cnt);
+         ptr += 16;
+      }
+   }
+
+   return reply;
+}
+
+static uint16_t cmd_bin_subscribe(struct cmd_bin *bin, const struct cmd_bin_msg *req)
+{
+   uint8_t *mem;
+   struct cmd_bin_sub *sub = &bin->subs[req->client];
+   if (req->size != 16)
+      return CMD_BIN_ERR_ARGS;
+
+   sub->generation = req->generation;
+   sub->interval   = cmd_bin_get32(req->data);
+   sub->frame      = 0;
+   sub->mem_id     = cmd_bin_get32(req->data + 4);
+   sub->offset     = cmd_bin_get32(req->data + 8);
+   sub->size       = cmd_bin_get32(req->data + 12);
+
+   if (sub->size && !cmd_bin_memory(sub->mem_id, sub->offset, sub->size, &mem))
+   {
+      sub->interval = 0;
+      return CMD_BIN_ERR_MEMORY;
+   }
+
+   bin->last_poll = rarch_get_time_usec();
+   return CMD_BIN_OK;
+}
+
+static struct cmd_bin_msg *cmd_bin_handle(rarch_cmd_t *handle, struct cmd_bin_msg *req)
+{
+   uint8_t *mem;
+   uint32_t size;
+   uint16_t status = CMD_BIN_OK;
+   struct cmd_bin_msg *reply = NULL;
+
+   switch (req->op)
+   {
+      case CMD_BIN_PING:
+         break;
+
+      case CMD_BIN_COMMAND:
+         if (!parse_msg(handle, (char*)req->data))
+            status = CMD_BIN_ERR_FAILED;
+         break;
+
+      case CMD_BIN_READ_MEMORY:
+         if (req->size != 12)
+         {
+            status = CMD_BIN_ERR_ARGS;
+            break;
+         }
+
+         size = cmd_bin_get32(req->data + 8);
+         if (!cmd_bin_memory(cmd_bin_get32(req->data), cmd_bin_get32(req->data + 4), size, &mem))
+            status = CMD_BIN_ERR_MEMORY;
+         else if ((reply = cmd_bin_msg_new(req->client, req->generation, req->op, req->id, size)))
+            memcpy(reply->data, mem, size);
+         break;
+
+      case CMD_BIN_WRITE_MEMORY:
+         if (req->size < 8)
+         {
+            status = CMD_BIN_ERR_ARGS;
+            break;
+         }
+
+         size = req->size - 8;
+         if (!cmd_bin_memory(cmd_bin_get32(req->data), cmd_bin_get32(req->data + 4), size, &mem))
+            status = CMD_BIN_ERR_MEMORY;
+         else
+            memcpy(mem, req->data + 8, size);
+         break;
+
+      case CMD_BIN_PERF_COUNTERS:
+         reply = cmd_bin_perf_counters(req);
+         break;
+
+      case CMD_BIN_SUBSCRIBE:
+         status = cmd_bin_subscribe(handle->bin, req);
+         break;
+
+      default:
+         status = CMD_BIN_ERR_OP;
+         break;
+   }
+
+   if (!reply)
+   {
+      // Out of memory for a reply with data.
+      if (status == CMD_BIN_OK && (req->op == CMD_BIN_READ_MEMORY || req->op == CMD_BIN_PERF_COUNTERS))
+         status = CMD_BIN_ERR_FAILED;
+      if (!(reply = cmd_bin_msg_new(req->client, req->generation, req->op, req->id, 0)))
+         return NULL;
+   }
+
+   reply->status = status;
+   return reply;
+}
+
+// Queues telemetry for subscriptions which are due this frame.
+static bool cmd_bin_telemetry(struct cmd_bin *bin)
+{
+   unsigned i;
+   bool active = false, sent = false;
+   retro_time_t now, frame_time;
+   uint32_t flags;
+
+   for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+   {
+      struct cmd_bin_sub *sub = &bin->subs[i];
+      // The client has disconnected since.
+      if (sub->interval && sub->generation != bin->generation[i])
+         sub->interval = 0;
+      active = active || sub->interval;
+   }
+
+   if (!active)
+      return false;
+
+   now = rarch_get_time_usec();
+   frame_time = now - bin->last_poll;
+   bin->last_poll = now;
+
+   flags = (g_extern.is_paused ? CMD_BIN_FLAG_PAUSED : 0) |
+      (driver.nonblock_state ? CMD_BIN_FLAG_FAST_FORWARD : 0) |
+      (g_extern.is_slowmotion ? CMD_BIN_FLAG_SLOWMOTION : 0);
+
+   for (i = 0; i < CMD_BIN_MAX_CLIENTS; i++)
+   {
+      uint8_t *mem = NULL;
+      uint32_t size;
+      struct cmd_bin_msg *msg;
+      struct cmd_bin_sub *sub = &bin->subs[i];
+
+      if (!sub->interval || ++sub->frame < sub->interval)
+         continue;
+      sub->frame = 0;
+
+      // The core might have dropped the memory since, e.g. after unloading content.
+      size = sub->size;
+      if (size && !cmd_bin_memory(sub->mem_id, sub->offset, size, &mem))
+         size = 0;
+
+      msg = cmd_bin_msg_new(i, sub->generation, CMD_BIN_TELEMETRY, 0, CMD_BIN_TELEMETRY_SIZE + size);
+      if (!msg)
+         continue;
+
+      cmd_bin_put64(msg->data, g_extern.frame_count);
+      cmd_bin_put64(msg->data + 8, now);
+      cmd_bin_put32(msg->data + 16, (uint32_t)frame_time);
+      cmd_bin_put32(msg->data + 20, flags);
+      if (size)
+         memcpy(msg->data + CMD_BIN_TELEMETRY_SIZE, mem, size);
+
+      if (cmd_bin_ring_push(&bin->replies, msg))
+         sent = true;
+      else
+         free(msg);
+   }
+
+   return sent;
+}
+
+static void cmd_bin_poll(rarch_cmd_t *handle)
+{
+   struct cmd_bin_msg *req;
+   struct cmd_bin *bin = handle->bin;
+   // Before handling requests, so a new subscription starts counting frames with the next poll.
+   bool wake = cmd_bin_telemetry(bin);
+
+   // Every request gets a reply, leave requests queued while the reply ring is full.
+   while (!cmd_bin_ring_full(&bin->replies) && (req = cmd_bin_ring_pop(&bin->requests)))
+   {
+      struct cmd_bin_msg *reply = cmd_bin_handle(handle, req);
+      if (reply)
+         cmd_bin_ring_push(&bin->replies, reply);
+      free(req);
+      wake = true;
+   }
+
+   if (wake)
+      cmd_bin_wake(bin);
+}
+#endif
+
 void rarch_cmd_poll(rarch_cmd_t *handle)
 {
    memset(handle->state, 0, sizeof(handle->state));
@@ -500,6 +1450,11 @@ void rarch_cmd_poll(rarch_cmd_t *handle)
 #ifdef HAVE_STDIN_CMD
    stdin_cmd_poll(handle);
 #endif
+
+#ifdef HAVE_BIN_CMD
+   if (handle->bin)
+      cmd_bin_poll(handle);
+#endif
 }
 
 #ifdef HAVE_NETWORK_CMD
@@ -40,6 +40,44 @@ bool rarch_cmd_get(rarch_cmd_t *handle, unsigned id);
 bool network_cmd_send(const char *cmd);
 #endif
 
+// Binary command and telemetry protocol, over TCP (network_cmd_bin_port) and/or
+// a Unix socket (network_cmd_bin_socket).
+// Both directions are a stream of messages: a 12 byte header followed by the payload.
+// All integers are little endian.
+//    uint32 payload size, uint16 op, uint16 status, uint32 id
+// Every request gets exactly one reply with the same op and id. Requests can be pipelined,
+// all requests that have arrived are handled in order on the next rarch_cmd_poll().
+enum cmd_bin_op
+{
+   CMD_BIN_PING = 0,       // Empty reply.
+   CMD_BIN_COMMAND,        // Newline separated commands, as sent to network_cmd_port.
+   CMD_BIN_READ_MEMORY,    // uint32 memory id (RETRO_MEMORY_*), uint32 offset, uint32 size. Replies with the bytes.
+   CMD_BIN_WRITE_MEMORY,   // uint32 memory id, uint32 offset, then the bytes to write.
+   CMD_BIN_PERF_COUNTERS,  // Replies with uint32 count, then per counter:
+                           //    uint8 source (0 RetroArch, 1 core), uint16 name length, name,
+                           //    uint64 total ticks, uint64 calls.
+   CMD_BIN_SUBSCRIBE,      // uint32 interval in frames (0 to stop), uint32 memory id, uint32 offset, uint32 size.
+                           // Starts telemetry pushes, optionally with a range of core memory.
+
+   // Pushed every interval frames with id 0 to subscribed clients:
+   //    uint64 frame, uint64 time (usec), uint32 time since last poll (usec), uint32 flags (CMD_BIN_FLAG_*),
+   //    then the subscribed memory.
+   CMD_BIN_TELEMETRY = 0x80
+};
+
+enum cmd_bin_status
+{
+   CMD_BIN_OK = 0,
+   CMD_BIN_ERR_OP,         // Unknown op.
+   CMD_BIN_ERR_ARGS,       // Malformed payload, or a command was not recognized.
+   CMD_BIN_ERR_MEMORY,     // Memory id not exposed by the core, or range out of bounds.
+   CMD_BIN_ERR_FAILED      // Command failed.
+};
+
+#define CMD_BIN_FLAG_PAUSED       (1 << 0)
+#define CMD_BIN_FLAG_FAST_FORWARD (1 << 1)
+#define CMD_BIN_FLAG_SLOWMOTION   (1 << 2)
+
 #ifdef __cplusplus
 }
 #endif
@@ -49,6 +49,8 @@ enum
    VIDEO_VG,
    VIDEO_NULL,
    VIDEO_OMAP,
+   VIDEO_FBDEV,
+   VIDEO_SOFT,
 
    AUDIO_RSOUND,
    AUDIO_OSS,
@@ -120,6 +122,8 @@ enum
 #define VIDEO_DEFAULT_DRIVER VIDEO_XVIDEO
 #elif defined(HAVE_SDL)
 #define VIDEO_DEFAULT_DRIVER VIDEO_SDL
+#elif defined(HAVE_FBDEV)
+#define VIDEO_DEFAULT_DRIVER VIDEO_FBDEV
 #elif defined(HAVE_DYLIB) && !defined(ANDROID)
 #define VIDEO_DEFAULT_DRIVER VIDEO_EXT
 #else
@@ -278,6 +282,9 @@ static unsigned swap_interval = 1;
 // Threaded video. Will possibly increase performance significantly at cost of worse synchronization and latency.
 static const bool video_threaded = false;
 
+// Threads to run the CPU filter (video_filter) on. 0 uses one per CPU core.
+static const unsigned video_filter_threads = 0;
+
 // Smooths picture
 static const bool video_smooth = true;
 
@@ -496,6 +503,10 @@ static const bool netplay_client_swap_input = true;
 // This could potentially lead to buggy games.
 static const bool block_sram_overwrite = false;
 
+// Compress savestates with zlib before writing them.
+// Compressed states are detected and decompressed automatically on load.
+static const bool savestate_compression = true;
+
 // When saving savestates, state index is automatically incremented before saving.
 // When the ROM is loaded, state index will be set to the highest existing value.
 static const bool savestate_auto_index = false;
@@ -512,11 +523,22 @@ static const float slowmotion_ratio = 3.0;
 // Maximum fast forward ratio (Negative => no limit).
 static const float fastforward_ratio = -1.0;
 
+// Turbo fast forward. While fast forwarding, video frames are dropped before they reach the video driver
+// and audio is discarded instead of being resampled. fastforward_ratio is enforced with a precise timer.
+static const bool fastforward_turbo = false;
+
+// In turbo fast forward, only every Nth frame is presented.
+static const unsigned fastforward_present_interval = 8;
+
 // Enable stdin/network command interface
 static const bool network_cmd_enable = false;
 static const uint16_t network_cmd_port = 55355;
 static const bool stdin_cmd_enable = false;
 
+// TCP port of the binary command/telemetry protocol, 0 to disable. See command.h.
+// It can also listen on a Unix socket with network_cmd_bin_socket.
+static const uint16_t network_cmd_bin_port = 0;
+
 // Number of entries that will be kept in ROM history file.
 static const unsigned game_history_size = 100;
 
@@ -546,6 +568,10 @@ static const bool input_debug_enable = false;
 // gamepads, plug-and-play style.
 static const bool input_autodetect_enable = true;
 
+// Joypad drivers with an input thread (udev) normally apply queued events once per input poll.
+// Enabling this also applies them right before every input state query, i.e. with sub-frame latency.
+static const bool input_joypad_poll_on_state = false;
+
 #ifndef IS_SALAMANDER
 
 #if defined(__CELLOS_LV2__)
@@ -419,6 +419,13 @@ typedef struct location_driver
 struct rarch_viewport;
 
 #ifdef HAVE_OVERLAY
+struct video_overlay_update
+{
+   unsigned image;
+   float x, y, w, h; // As in vertex_geom.
+   float alpha;      // As in set_alpha.
+};
+
 typedef struct video_overlay_interface
 {
    void (*enable)(void *data, bool state);
@@ -427,6 +434,10 @@ typedef struct video_overlay_interface
    void (*vertex_geom)(void *data, unsigned image, float x, float y, float w, float h);
    void (*full_screen)(void *data, bool enable);
    void (*set_alpha)(void *data, unsigned image, float mod);
+
+   // Optional. Same as vertex_geom and set_alpha for every update, but in one call per frame.
+   // The updates array is only valid during the call.
+   void (*update)(void *data, const struct video_overlay_update *updates, unsigned num_updates);
 } video_overlay_interface_t;
 #endif
 
@@ -449,6 +460,13 @@ typedef struct video_poke_interface
 
    void (*show_mouse)(void *data, bool state);
    void (*grab_mouse_toggle)(void *data);
+
+#ifdef HAVE_MENU
+   // Optional. Like set_texture_frame, but only rows [first_row, first_row + rows) changed since the last call.
+   // The whole frame is uploaded if the current texture does not match it.
+   void (*set_texture_frame_rows)(void *data, const void *frame, bool rgb32, unsigned width, unsigned height,
+         unsigned first_row, unsigned rows, float alpha);
+#endif
 } video_poke_interface_t;
 
 typedef struct video_driver
@@ -703,8 +721,10 @@ extern const video_driver_t video_xdk_d3d;
 extern const video_driver_t video_sdl;
 extern const video_driver_t video_vg;
 extern const video_driver_t video_null;
+extern const video_driver_t video_soft;
 extern const video_driver_t video_lima;
 extern const video_driver_t video_omap;
+extern const video_driver_t video_fbdev;
 extern const input_driver_t input_android;
 extern const input_driver_t input_sdl;
 extern const input_driver_t input_dinput;
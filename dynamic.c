@@ -20,6 +20,9 @@
 #include "retroarch_logger.h"
 #include "performance.h"
 #include "file.h"
+#include "frame_trace.h"
+#include "fastforward.h"
+#include "cheat_search.h"
 #include <string.h>
 #include <ctype.h>
 
@@ -427,6 +430,16 @@ void init_libretro_sym(bool dummy)
 
    load_symbols(dummy);
 
+   // Innermost, so pokes land before anything else sees the frame.
+   cheat_search_hook_core();
+
+   if (g_settings.fastforward_turbo)
+      fastforward_hook_core();
+
+   if (*g_settings.frame_trace_path &&
+         frame_trace_init(g_settings.frame_trace_path, FRAME_TRACE_MAX_FRAMES))
+      frame_trace_hook_core();
+
    pretro_set_environment(rarch_environment_cb);
 }
 
@@ -457,6 +470,9 @@ void uninit_libretro_sym(void)
 
    // Performance counters no longer valid.
    retro_perf_clear();
+
+   frame_trace_deinit();
+   cheat_search_deinit();
 }
 
 #ifdef NEED_DYNAMIC
@@ -911,7 +927,7 @@ bool rarch_environment_cb(unsigned cmd, void *data)
          RARCH_LOG("Environ GET_PERF_INTERFACE.\n");
          struct retro_perf_callback *cb = (struct retro_perf_callback*)data;
          cb->get_time_usec    = rarch_get_time_usec;
-         cb->get_cpu_features = rarch_get_cpu_features;
+         cb->get_cpu_features = retro_get_cpu_features; // libretro specific path.
          cb->get_perf_counter = rarch_get_perf_counter;
          cb->perf_register    = retro_perf_register; // libretro specific path.
          cb->perf_start       = rarch_perf_start;
@@ -0,0 +1,181 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fastforward.h"
+#include "general.h"
+#include "driver.h"
+#include "dynamic.h"
+#include "performance.h"
+#include <string.h>
+
+// Sleeping is only good to a millisecond or two, the rest of the wait is spun.
+#define FASTFORWARD_SPIN_USEC 2000
+
+static struct
+{
+   void (*run)(void);
+   void (*set_video_refresh)(retro_video_refresh_t);
+   void (*set_audio_sample)(retro_audio_sample_t);
+   void (*set_audio_sample_batch)(retro_audio_sample_batch_t);
+
+   retro_video_refresh_t video_refresh_cb;
+   retro_audio_sample_t audio_sample_cb;
+   retro_audio_sample_batch_t audio_sample_batch_cb;
+
+   bool active;
+   bool present;
+   unsigned frame;
+
+   retro_time_t next_frame_time;
+   uint64_t frames;
+   uint64_t presented;
+   retro_time_t start_time;
+} ff;
+
+bool fastforward_turbo_active(void)
+{
+   return ff.active;
+}
+
+static void fastforward_set_active(bool active)
+{
+   ff.active = active;
+
+   // Drop any partially filled audio chunk, it would be glued to audio from far later on.
+   g_extern.audio_data.data_ptr = 0;
+
+   if (active)
+   {
+      ff.frame           = 0;
+      ff.frames          = 0;
+      ff.presented       = 0;
+      ff.start_time      = rarch_get_time_usec();
+      ff.next_frame_time = ff.start_time;
+   }
+   else
+   {
+      retro_time_t elapsed = rarch_get_time_usec() - ff.start_time;
+      double fps = g_extern.system.av_info.timing.fps;
+
+      // Regular frame limiting picks up from here instead of trying to catch up.
+      g_extern.frame_limit.last_frame_time = rarch_get_time_usec();
+
+      if (elapsed > 0 && fps > 0.0)
+         RARCH_LOG("Turbo fast forward: %llu frames (%llu presented) at %.2fx speed.\n",
+               (unsigned long long)ff.frames, (unsigned long long)ff.presented,
+               ff.frames * 1000000.0 / (elapsed * fps));
+   }
+}
+
+// Waits for the next frame slot when fastforward_ratio caps the speed.
+static void fastforward_limit(void)
+{
+   retro_time_t now, frame_time;
+   double fps = g_extern.system.av_info.timing.fps;
+
+   if (g_settings.fastforward_ratio <= 0.0f || fps <= 0.0)
+      return;
+
+   frame_time = (retro_time_t)(1000000.0 / (fps * g_settings.fastforward_ratio));
+   now = rarch_get_time_usec();
+
+   // Fell behind by more than a frame, e.g. a slow frame or the core stalled. Don't try to catch up.
+   if (now - ff.next_frame_time > frame_time)
+      ff.next_frame_time = now;
+
+   if (ff.next_frame_time - now > FASTFORWARD_SPIN_USEC)
+      rarch_sleep((unsigned)((ff.next_frame_time - now - FASTFORWARD_SPIN_USEC) / 1000));
+   while (rarch_get_time_usec() < ff.next_frame_time);
+
+   ff.next_frame_time += frame_time;
+}
+
+static void fastforward_run(void)
+{
+   bool turbo = driver.nonblock_state;
+   if (turbo != ff.active)
+      fastforward_set_active(turbo);
+
+   if (ff.active)
+   {
+      fastforward_limit();
+
+      ff.present = ++ff.frame >= g_settings.fastforward_present_interval;
+      if (ff.present)
+         ff.frame = 0;
+      ff.frames++;
+   }
+
+   ff.run();
+}
+
+static void fastforward_video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+   if (ff.active)
+   {
+      if (!ff.present)
+         return;
+      ff.presented++;
+   }
+   ff.video_refresh_cb(data, width, height, pitch);
+}
+
+static void fastforward_audio_sample(int16_t left, int16_t right)
+{
+   if (!ff.active)
+      ff.audio_sample_cb(left, right);
+}
+
+static size_t fastforward_audio_sample_batch(const int16_t *data, size_t frames)
+{
+   if (ff.active)
+      return frames;
+   return ff.audio_sample_batch_cb(data, frames);
+}
+
+static void fastforward_set_video_refresh(retro_video_refresh_t cb)
+{
+   ff.video_refresh_cb = cb;
+   ff.set_video_refresh(cb ? fastforward_video_refresh : NULL);
+}
+
+static void fastforward_set_audio_sample(retro_audio_sample_t cb)
+{
+   ff.audio_sample_cb = cb;
+   ff.set_audio_sample(cb ? fastforward_audio_sample : NULL);
+}
+
+static void fastforward_set_audio_sample_batch(retro_audio_sample_batch_t cb)
+{
+   ff.audio_sample_batch_cb = cb;
+   ff.set_audio_sample_batch(cb ? fastforward_audio_sample_batch : NULL);
+}
+
+void fastforward_hook_core(void)
+{
+   if (pretro_run == fastforward_run)
+      return;
+
+   memset(&ff, 0, sizeof(ff));
+   ff.run                    = pretro_run;
+   ff.set_video_refresh      = pretro_set_video_refresh;
+   ff.set_audio_sample       = pretro_set_audio_sample;
+   ff.set_audio_sample_batch = pretro_set_audio_sample_batch;
+
+   pretro_run                    = fastforward_run;
+   pretro_set_video_refresh      = fastforward_set_video_refresh;
+   pretro_set_audio_sample       = fastforward_set_audio_sample;
+   pretro_set_audio_sample_batch = fastforward_set_audio_sample_batch;
+}
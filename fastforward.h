@@ -0,0 +1,43 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_FASTFORWARD_H
+#define __RARCH_FASTFORWARD_H
+
+#include "boolean.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Turbo fast forward (fastforward_turbo).
+// While driver.nonblock_state is set, the core's video frames are dropped before any conversion,
+// only every fastforward_present_interval'th frame is passed on to the frontend.
+// Audio is discarded before it reaches conversion, DSP and resampling.
+// If fastforward_ratio is positive, frames are paced with a precise timer instead of blocking on audio,
+// so the frontend's own millisecond frame limiter should not be applied while fastforward_turbo_active().
+
+// Routes retro_run() and the core's video/audio callbacks through the turbo path.
+// Must be called after the core symbols are loaded and before callbacks are set.
+void fastforward_hook_core(void);
+
+bool fastforward_turbo_active(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
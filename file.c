@@ -27,6 +27,14 @@
 #include "hash.h"
 #include "file_extract.h"
 
+#ifdef HAVE_THREADS
+#include "thread.h"
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #ifdef _WIN32
 #ifdef _XBOX
 #include <xtl.h>
@@ -39,104 +47,229 @@
 #endif
 #endif
 
-static void patch_rom(uint8_t **buf, ssize_t *size)
+// Loads the content at path with a soft-patch applied, if one is found.
+// The patch is applied straight from the files on disk, so the unpatched content is never loaded.
+static bool patch_rom(const char *path, uint8_t **buf, ssize_t *size)
 {
-   uint8_t *ret_buf = *buf;
-   ssize_t ret_size = *size;
-
    const char *patch_desc = NULL;
    const char *patch_path = NULL;
+   enum patch_type type = PATCH_TYPE_BPS;
    patch_error_t err = PATCH_UNKNOWN;
-   patch_func_t func = NULL;
-
-   ssize_t patch_size = 0;
-   void *patch_data = NULL;
-   bool success = false;
+   uint8_t *patched_rom = NULL;
+   size_t target_size = 0;
 
    if (g_extern.ups_pref + g_extern.bps_pref + g_extern.ips_pref > 1)
    {
       RARCH_WARN("Several patches are explicitly defined, ignoring all ...\n");
-      return;
+      return false;
    }
 
    bool allow_bps = !g_extern.ups_pref && !g_extern.ips_pref;
    bool allow_ups = !g_extern.bps_pref && !g_extern.ips_pref;
    bool allow_ips = !g_extern.ups_pref && !g_extern.bps_pref;
 
-   if (allow_ups && *g_extern.ups_name && (patch_size = read_file(g_extern.ups_name, &patch_data)) >= 0)
+   if (allow_ups && *g_extern.ups_name && path_file_exists(g_extern.ups_name))
    {
       patch_desc = "UPS";
       patch_path = g_extern.ups_name;
-      func = ups_apply_patch;
+      type = PATCH_TYPE_UPS;
    }
-   else if (allow_bps && *g_extern.bps_name && (patch_size = read_file(g_extern.bps_name, &patch_data)) >= 0)
+   else if (allow_bps && *g_extern.bps_name && path_file_exists(g_extern.bps_name))
    {
       patch_desc = "BPS";
       patch_path = g_extern.bps_name;
-      func = bps_apply_patch;
+      type = PATCH_TYPE_BPS;
    }
-   else if (allow_ips && *g_extern.ips_name && (patch_size = read_file(g_extern.ips_name, &patch_data)) >= 0)
+   else if (allow_ips && *g_extern.ips_name && path_file_exists(g_extern.ips_name))
    {
       patch_desc = "IPS";
       patch_path = g_extern.ips_name;
-      func = ips_apply_patch;
+      type = PATCH_TYPE_IPS;
    }
    else
    {
       RARCH_LOG("Did not find a valid ROM patch.\n");
-      return;
+      return false;
    }
 
    RARCH_LOG("Found %s file in \"%s\", attempting to patch ...\n", patch_desc, patch_path);
 
-   size_t target_size = ret_size * 4; // Just to be sure ...
-   uint8_t *patched_rom = (uint8_t*)malloc(target_size);
-   if (!patched_rom)
+   err = patch_apply_file(type, patch_path, path, &patched_rom, &target_size);
+   if (err != PATCH_SUCCESS)
    {
-      RARCH_ERR("Failed to allocate memory for patched ROM ...\n");
-      goto error;
+      RARCH_ERR("Failed to patch %s: Error #%u\n", patch_desc, (unsigned)err);
+      return false;
    }
 
-   err = func((const uint8_t*)patch_data, patch_size, ret_buf, ret_size, patched_rom, &target_size);
-   if (err == PATCH_SUCCESS)
+   RARCH_LOG("ROM patched successfully (%s).\n", patch_desc);
+   *buf = patched_rom;
+   *size = target_size;
+   return true;
+}
+
+#ifdef HAVE_THREADS
+// Hashes content on a worker thread while it is still being read from disk.
+// The reader publishes how many bytes of the buffer are valid, the hasher
+// catches up with CRC32 and SHA256 until the reader is done.
+typedef struct content_hasher
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   const uint8_t *data;
+   size_t avail;
+   bool done;
+
+   uint32_t crc;
+   struct sha256_ctx sha;
+} content_hasher_t;
+
+static void content_hasher_thread(void *data)
+{
+   content_hasher_t *hasher = (content_hasher_t*)data;
+   size_t hashed = 0;
+
+   for (;;)
    {
-      RARCH_LOG("ROM patched successfully (%s).\n", patch_desc);
-      success = true;
+      size_t avail;
+      bool done;
+
+      slock_lock(hasher->lock);
+      while (hasher->avail == hashed && !hasher->done)
+         scond_wait(hasher->cond, hasher->lock);
+      avail = hasher->avail;
+      done = hasher->done;
+      slock_unlock(hasher->lock);
+
+      if (avail > hashed)
+      {
+         hasher->crc = crc32_update(hasher->crc, hasher->data + hashed, avail - hashed);
+         sha256_update(&hasher->sha, hasher->data + hashed, avail - hashed);
+         hashed = avail;
+      }
+      else if (done)
+         break;
    }
-   else
-      RARCH_ERR("Failed to patch %s: Error #%u\n", patch_desc, (unsigned)err);
+}
+
+#define CONTENT_READ_CHUNK (1 << 20)
+
+// Like read_file(), but computes g_extern.cart_crc and g_extern.sha256 as a side effect,
+// overlapping the hashing with the file I/O.
+static ssize_t read_file_hashed(const char *path, uint8_t **buf)
+{
+   content_hasher_t hasher = {0};
+   uint8_t digest[32];
+   uint8_t *ret_buf = NULL;
+   long len = 0, pos = 0;
+   FILE *file = fopen(path, "rb");
+
+   *buf = NULL;
+   if (!file)
+      return -1;
 
-   if (success)
+   fseek(file, 0, SEEK_END);
+   len = ftell(file);
+   rewind(file);
+
+   // Same contract as read_file(), the buffer is NUL-terminated.
+   ret_buf = (uint8_t*)malloc(len + 1);
+   if (!ret_buf)
    {
-      free(ret_buf);
-      *buf = patched_rom;
-      *size = target_size;
+      RARCH_ERR("Couldn't allocate memory.\n");
+      fclose(file);
+      return -1;
    }
+   ret_buf[len] = '\0';
 
-   free(patch_data);
-   return;
+   hasher.data = ret_buf;
+   sha256_init(&hasher.sha);
+   hasher.lock = slock_new();
+   hasher.cond = scond_new();
+   if (hasher.lock && hasher.cond)
+      hasher.thread = sthread_create(content_hasher_thread, &hasher);
+
+   while (pos < len)
+   {
+      long chunk = len - pos;
+      size_t rc;
+      if (chunk > CONTENT_READ_CHUNK)
+         chunk = CONTENT_READ_CHUNK;
+
+      rc = fread(ret_buf + pos, 1, chunk, file);
+      pos += rc;
+
+      if (hasher.thread)
+      {
+         slock_lock(hasher.lock);
+         hasher.avail = pos;
+         scond_signal(hasher.cond);
+         slock_unlock(hasher.lock);
+      }
+
+      if (rc < (size_t)chunk)
+      {
+         RARCH_WARN("Didn't read whole file.\n");
+         break;
+      }
+   }
+   fclose(file);
+
+   if (hasher.thread)
+   {
+      slock_lock(hasher.lock);
+      hasher.done = true;
+      scond_signal(hasher.cond);
+      slock_unlock(hasher.lock);
+      sthread_join(hasher.thread);
+   }
+   else
+   {
+      hasher.crc = crc32_update(0, ret_buf, pos);
+      sha256_update(&hasher.sha, ret_buf, pos);
+   }
+
+   if (hasher.lock)
+      slock_free(hasher.lock);
+   if (hasher.cond)
+      scond_free(hasher.cond);
+
+   g_extern.cart_crc = hasher.crc;
+   sha256_final(&hasher.sha, digest);
+   sha256_digest_string(g_extern.sha256, digest);
 
-error:
    *buf = ret_buf;
-   *size = ret_size;
-   free(patch_data);
+   return pos;
 }
+#endif
 
 static ssize_t read_rom_file(const char *path, void **buf)
 {
    uint8_t *ret_buf = NULL;
-   ssize_t ret = read_file(path, (void**)&ret_buf);
-   if (ret <= 0)
-      return ret;
+   ssize_t ret = -1;
 
-   if (!g_extern.block_patch)
+   if (!g_extern.block_patch && patch_rom(path, &ret_buf, &ret))
    {
-      // Attempt to apply a patch.
-      patch_rom(&ret_buf, &ret);
+      g_extern.cart_crc = crc32_calculate(ret_buf, ret);
+      sha256_hash(g_extern.sha256, ret_buf, ret);
    }
-   
-   g_extern.cart_crc = crc32_calculate(ret_buf, ret);
-   sha256_hash(g_extern.sha256, ret_buf, ret);
+   else
+   {
+#ifdef HAVE_THREADS
+      ret = read_file_hashed(path, &ret_buf);
+#else
+      ret = read_file(path, (void**)&ret_buf);
+      if (ret > 0)
+      {
+         g_extern.cart_crc = crc32_calculate(ret_buf, ret);
+         sha256_hash(g_extern.sha256, ret_buf, ret);
+      }
+#endif
+      if (ret <= 0)
+         return ret;
+   }
+
    RARCH_LOG("CRC32: 0x%x, SHA256: %s\n",
          (unsigned)g_extern.cart_crc, g_extern.sha256);
    *buf = ret_buf;
@@ -177,9 +310,237 @@ error:
    RARCH_WARN("Failed ... Cannot recover save file.\n");
 }
 
+// Compressed states start with a small header, followed by a zlib stream:
+// 4 bytes magic, 4 bytes little-endian uncompressed size.
+#define STATE_COMPRESSED_MAGIC "RASZ"
+#define STATE_HEADER_SIZE 8
+
+// Keeps the most recently saved or loaded state in memory,
+// so reloading the same slot right away does not touch the disk.
+static struct
+{
+   char path[PATH_MAX];
+   void *data;
+   size_t size;
+} state_cache;
+
+static void state_cache_set(const char *path, void *data, size_t size)
+{
+   free(state_cache.data);
+   strlcpy(state_cache.path, path, sizeof(state_cache.path));
+   state_cache.data = data;
+   state_cache.size = size;
+}
+
+static void state_cache_clear(void)
+{
+   free(state_cache.data);
+   memset(&state_cache, 0, sizeof(state_cache));
+}
+
+// Compresses (if enabled) and writes a state through a temporary file,
+// so an interrupted save never leaves a truncated state behind.
+static bool write_state_file(const char *path, const void *data, size_t size, bool compress)
+{
+   bool ret = false;
+   uint8_t *packed = NULL;
+   char tmp_path[PATH_MAX];
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (compress)
+   {
+      uLongf packed_size = compressBound(size);
+      packed = (uint8_t*)malloc(STATE_HEADER_SIZE + packed_size);
+
+      if (packed && compress2(packed + STATE_HEADER_SIZE, &packed_size,
+               (const Bytef*)data, size, Z_BEST_SPEED) == Z_OK)
+      {
+         memcpy(packed, STATE_COMPRESSED_MAGIC, 4);
+         packed[4] = (uint8_t)(size >>  0);
+         packed[5] = (uint8_t)(size >>  8);
+         packed[6] = (uint8_t)(size >> 16);
+         packed[7] = (uint8_t)(size >> 24);
+
+         RARCH_LOG("Compressed state: %u -> %u bytes.\n",
+               (unsigned)size, (unsigned)(STATE_HEADER_SIZE + packed_size));
+         data = packed;
+         size = STATE_HEADER_SIZE + packed_size;
+      }
+      else
+         RARCH_WARN("Failed to compress state, saving it uncompressed.\n");
+   }
+#else
+   (void)compress;
+#endif
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+   if (write_file(tmp_path, data, size))
+   {
+#ifdef _WIN32
+      remove(path);
+#endif
+      ret = rename(tmp_path, path) == 0;
+      if (!ret)
+         remove(tmp_path);
+   }
+
+   if (!ret)
+      RARCH_ERR("Failed to save state to \"%s\".\n", path);
+
+   free(packed);
+   return ret;
+}
+
+// Returns the raw serialized state from a file as read from disk.
+// Compressed states are inflated; takes ownership of buf.
+static ssize_t unpack_state(void **buf, ssize_t size)
+{
+   const uint8_t *header = (const uint8_t*)*buf;
+
+   if (size < STATE_HEADER_SIZE || memcmp(header, STATE_COMPRESSED_MAGIC, 4) != 0)
+      return size;
+
+#ifdef HAVE_ZLIB
+   uLongf state_size = (uLongf)header[4] | ((uLongf)header[5] << 8) |
+      ((uLongf)header[6] << 16) | ((uLongf)header[7] << 24);
+   void *state = malloc(state_size ? state_size : 1);
+
+   if (!state || uncompress((Bytef*)state, &state_size,
+            header + STATE_HEADER_SIZE, size - STATE_HEADER_SIZE) != Z_OK)
+   {
+      RARCH_ERR("Failed to decompress state.\n");
+      free(state);
+      free(*buf);
+      *buf = NULL;
+      return -1;
+   }
+
+   free(*buf);
+   *buf = state;
+   return state_size;
+#else
+   RARCH_ERR("State is compressed, but this build has no zlib support.\n");
+   free(*buf);
+   *buf = NULL;
+   return -1;
+#endif
+}
+
+#ifdef HAVE_THREADS
+// Single slot background writer. The job references the state cache buffer,
+// which is only replaced after the job has completed.
+typedef struct state_writer
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   bool quit;
+   bool busy;
+
+   char path[PATH_MAX];
+   const void *data;
+   size_t size;
+   bool compress;
+} state_writer_t;
+
+static state_writer_t *state_writer;
+
+static void state_writer_thread(void *data)
+{
+   state_writer_t *writer = (state_writer_t*)data;
+
+   slock_lock(writer->lock);
+   for (;;)
+   {
+      while (!writer->busy && !writer->quit)
+         scond_wait(writer->cond, writer->lock);
+
+      if (!writer->busy)
+         break;
+
+      slock_unlock(writer->lock);
+      write_state_file(writer->path, writer->data, writer->size, writer->compress);
+      slock_lock(writer->lock);
+
+      writer->busy = false;
+      scond_broadcast(writer->cond);
+   }
+   slock_unlock(writer->lock);
+}
+
+static void state_writer_wait(void)
+{
+   if (!state_writer)
+      return;
+
+   slock_lock(state_writer->lock);
+   while (state_writer->busy)
+      scond_wait(state_writer->cond, state_writer->lock);
+   slock_unlock(state_writer->lock);
+}
+
+static void state_writer_free(state_writer_t *writer)
+{
+   if (writer->thread)
+   {
+      slock_lock(writer->lock);
+      writer->quit = true;
+      scond_broadcast(writer->cond);
+      slock_unlock(writer->lock);
+      sthread_join(writer->thread);
+   }
+
+   if (writer->cond)
+      scond_free(writer->cond);
+   if (writer->lock)
+      slock_free(writer->lock);
+   free(writer);
+}
+
+static state_writer_t *state_writer_new(void)
+{
+   state_writer_t *writer = (state_writer_t*)calloc(1, sizeof(*writer));
+   if (!writer)
+      return NULL;
+
+   writer->lock = slock_new();
+   writer->cond = scond_new();
+   if (writer->lock && writer->cond)
+      writer->thread = sthread_create(state_writer_thread, writer);
+
+   if (!writer->thread)
+   {
+      state_writer_free(writer);
+      return NULL;
+   }
+
+   return writer;
+}
+
+static bool state_writer_push(const char *path, const void *data, size_t size, bool compress)
+{
+   if (!state_writer)
+      state_writer = state_writer_new();
+   if (!state_writer)
+      return false;
+
+   slock_lock(state_writer->lock);
+   strlcpy(state_writer->path, path, sizeof(state_writer->path));
+   state_writer->data     = data;
+   state_writer->size     = size;
+   state_writer->compress = compress;
+   state_writer->busy     = true;
+   scond_broadcast(state_writer->cond);
+   slock_unlock(state_writer->lock);
+   return true;
+}
+#endif
+
 bool save_state(const char *path)
 {
    RARCH_LOG("Saving state: \"%s\".\n", path);
+   retro_time_t start = rarch_get_time_usec();
    size_t size = pretro_serialize_size();
    if (size == 0)
       return false;
@@ -192,17 +553,44 @@ bool save_state(const char *path)
    }
 
    RARCH_LOG("State size: %d bytes.\n", (int)size);
-   bool ret = pretro_serialize(data, size);
-   if (ret)
-      ret = write_file(path, data, size);
-
-   if (!ret)
+   if (!pretro_serialize(data, size))
+   {
       RARCH_ERR("Failed to save state to \"%s\".\n", path);
+      free(data);
+      return false;
+   }
+
+   bool ret = true;
+   bool compress = g_settings.savestate_compression;
+
+#ifdef HAVE_THREADS
+   // A previous write might still reference the cached state.
+   state_writer_wait();
+   state_cache_set(path, data, size);
+   if (!state_writer_push(path, data, size, compress))
+      ret = write_state_file(path, data, size, compress);
+#else
+   state_cache_set(path, data, size);
+   ret = write_state_file(path, data, size, compress);
+#endif
 
-   free(data);
+   RARCH_LOG("Main loop stalled for %.3f ms while saving state.\n",
+         (rarch_get_time_usec() - start) / 1000.0);
    return ret;
 }
 
+void save_state_deinit(void)
+{
+#ifdef HAVE_THREADS
+   if (state_writer)
+   {
+      state_writer_free(state_writer);
+      state_writer = NULL;
+   }
+#endif
+   state_cache_clear();
+}
+
 struct sram_block
 {
    unsigned type;
@@ -214,14 +602,32 @@ bool load_state(const char *path)
 {
    unsigned i;
    void *buf = NULL;
-   ssize_t size = read_file(path, &buf);
+   ssize_t size;
 
    RARCH_LOG("Loading state: \"%s\".\n", path);
 
-   if (size < 0)
+   if (state_cache.data && strcmp(state_cache.path, path) == 0)
    {
-      RARCH_ERR("Failed to load state from \"%s\".\n", path);
-      return false;
+      RARCH_LOG("Using cached state.\n");
+      buf  = state_cache.data;
+      size = state_cache.size;
+   }
+   else
+   {
+      size = read_file(path, &buf);
+      if (size >= 0)
+         size = unpack_state(&buf, size);
+
+      if (size < 0)
+      {
+         RARCH_ERR("Failed to load state from \"%s\".\n", path);
+         return false;
+      }
+
+#ifdef HAVE_THREADS
+      state_writer_wait();
+#endif
+      state_cache_set(path, buf, size);
    }
 
    bool ret = true;
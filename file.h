@@ -32,6 +32,8 @@ extern "C" {
 
 bool load_state(const char *path);
 bool save_state(const char *path);
+// Waits for pending state writes and drops the in-memory state cache.
+void save_state_deinit(void);
 
 void load_ram_file(const char *path, int type);
 void save_ram_file(const char *path, int type);
@@ -0,0 +1,332 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_trace.h"
+#include "general.h"
+#include "dynamic.h"
+#include "performance.h"
+#include "compat/strl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Binary trace layout, all values little-endian:
+// Header: "RAFT", u32 version, u32 stage count, u32 frame count,
+//         u64 ticks and u64 microseconds elapsed while tracing (to convert ticks to time),
+//         then a 16 byte, NUL padded name for every stage.
+// Frames: u64 start (ticks since the first frame), u64 duration (ticks),
+//         then for every stage u64 offset of the first call into the frame (~0 if not called),
+//         u64 ticks spent in the stage and u32 number of calls.
+// Ticks are kept 64-bit throughout, 32 bits of a GHz counter wrap within seconds.
+#define FRAME_TRACE_MAGIC "RAFT"
+#define FRAME_TRACE_VERSION 2
+#define FRAME_TRACE_NAME_SIZE 16
+#define FRAME_TRACE_NONE UINT64_C(0xffffffffffffffff)
+
+struct frame_trace_stage_record
+{
+   uint64_t offset;
+   uint64_t ticks;
+   uint32_t calls;
+};
+
+struct frame_trace_record
+{
+   retro_perf_tick_t start;
+   uint64_t duration;
+   struct frame_trace_stage_record stages[FRAME_TRACE_STAGE_COUNT];
+};
+
+static const char *frame_trace_stage_names[FRAME_TRACE_STAGE_COUNT] = {
+   "core_run",
+   "input_poll",
+   "audio",
+   "video",
+   "video_thread",
+   "gpu_fence",
+};
+
+bool frame_trace_active;
+
+static struct
+{
+   char path[PATH_MAX];
+   struct frame_trace_record *records;
+   unsigned max_frames;
+   volatile unsigned frames;
+
+   // Every stage is only ever traced from one thread at a time.
+   retro_perf_tick_t stage_start[FRAME_TRACE_STAGE_COUNT];
+
+   retro_perf_tick_t epoch_ticks;
+   retro_time_t epoch_usec;
+
+   // The core's entry points and the frontend's callbacks we sit in between.
+   void (*run)(void);
+   void (*set_video_refresh)(retro_video_refresh_t);
+   void (*set_audio_sample)(retro_audio_sample_t);
+   void (*set_audio_sample_batch)(retro_audio_sample_batch_t);
+   void (*set_input_poll)(retro_input_poll_t);
+
+   retro_video_refresh_t video_refresh_cb;
+   retro_audio_sample_t audio_sample_cb;
+   retro_audio_sample_batch_t audio_sample_batch_cb;
+   retro_input_poll_t input_poll_cb;
+} trace;
+
+bool frame_trace_init(const char *path, unsigned max_frames)
+{
+   frame_trace_deinit();
+
+   if (!max_frames)
+      return false;
+
+   trace.records = (struct frame_trace_record*)calloc(max_frames, sizeof(*trace.records));
+   if (!trace.records)
+   {
+      RARCH_ERR("Failed to allocate frame trace buffer.\n");
+      return false;
+   }
+
+   strlcpy(trace.path, path, sizeof(trace.path));
+   trace.max_frames  = max_frames;
+   trace.frames      = 0;
+   memset(trace.stage_start, 0, sizeof(trace.stage_start));
+   trace.epoch_ticks = rarch_get_perf_counter();
+   trace.epoch_usec  = rarch_get_time_usec();
+
+   frame_trace_active = true;
+   RARCH_LOG("Tracing up to %u frames to \"%s\".\n", max_frames, path);
+   return true;
+}
+
+static struct frame_trace_record *frame_trace_current(void)
+{
+   unsigned frames = trace.frames;
+   if (!frames)
+      return NULL;
+   return &trace.records[(frames - 1) % trace.max_frames];
+}
+
+static void frame_trace_next_frame(void)
+{
+   unsigned i;
+   retro_perf_tick_t now = rarch_get_perf_counter();
+   struct frame_trace_record *record = frame_trace_current();
+
+   if (record)
+      record->duration = now - record->start;
+
+   record = &trace.records[trace.frames % trace.max_frames];
+   record->start    = now;
+   record->duration = 0;
+   for (i = 0; i < FRAME_TRACE_STAGE_COUNT; i++)
+   {
+      record->stages[i].offset = FRAME_TRACE_NONE;
+      record->stages[i].ticks  = 0;
+      record->stages[i].calls  = 0;
+   }
+
+   trace.frames++;
+}
+
+void frame_trace_begin(enum frame_trace_stage stage)
+{
+   trace.stage_start[stage] = rarch_get_perf_counter();
+}
+
+void frame_trace_end(enum frame_trace_stage stage)
+{
+   retro_perf_tick_t now = rarch_get_perf_counter();
+   retro_perf_tick_t start = trace.stage_start[stage];
+   struct frame_trace_record *record = frame_trace_current();
+   struct frame_trace_stage_record *stage_record;
+
+   if (!record || !start)
+      return;
+
+   stage_record = &record->stages[stage];
+   if (!stage_record->calls)
+      stage_record->offset = start > record->start ? start - record->start : 0;
+   stage_record->ticks += now - start;
+   stage_record->calls++;
+   trace.stage_start[stage] = 0;
+}
+
+static uint8_t *frame_trace_put_u32(uint8_t *out, uint32_t val)
+{
+   out[0] = (uint8_t)(val >>  0);
+   out[1] = (uint8_t)(val >>  8);
+   out[2] = (uint8_t)(val >> 16);
+   out[3] = (uint8_t)(val >> 24);
+   return out + 4;
+}
+
+static uint8_t *frame_trace_put_u64(uint8_t *out, uint64_t val)
+{
+   out = frame_trace_put_u32(out, (uint32_t)val);
+   return frame_trace_put_u32(out, (uint32_t)(val >> 32));
+}
+
+static bool frame_trace_write(void)
+{
+   unsigned i, j;
+   uint8_t header[16 + 16 + FRAME_TRACE_STAGE_COUNT * FRAME_TRACE_NAME_SIZE];
+   uint8_t frame[8 + 8 + FRAME_TRACE_STAGE_COUNT * (8 + 8 + 4)];
+   uint8_t *ptr = header;
+   unsigned count = trace.frames < trace.max_frames ? trace.frames : trace.max_frames;
+   unsigned first = trace.frames - count;
+   retro_perf_tick_t origin = count ? trace.records[first % trace.max_frames].start : 0;
+   struct frame_trace_record *last = frame_trace_current();
+
+   FILE *file = fopen(trace.path, "wb");
+   if (!file)
+      return false;
+
+   // The last frame is still open.
+   if (last && !last->duration)
+      last->duration = rarch_get_perf_counter() - last->start;
+
+   memcpy(ptr, FRAME_TRACE_MAGIC, 4);
+   ptr = frame_trace_put_u32(ptr + 4, FRAME_TRACE_VERSION);
+   ptr = frame_trace_put_u32(ptr, FRAME_TRACE_STAGE_COUNT);
+   ptr = frame_trace_put_u32(ptr, count);
+   ptr = frame_trace_put_u64(ptr, rarch_get_perf_counter() - trace.epoch_ticks);
+   ptr = frame_trace_put_u64(ptr, rarch_get_time_usec() - trace.epoch_usec);
+   for (i = 0; i < FRAME_TRACE_STAGE_COUNT; i++, ptr += FRAME_TRACE_NAME_SIZE)
+   {
+      memset(ptr, 0, FRAME_TRACE_NAME_SIZE);
+      strlcpy((char*)ptr, frame_trace_stage_names[i], FRAME_TRACE_NAME_SIZE);
+   }
+   fwrite(header, 1, ptr - header, file);
+
+   for (i = 0; i < count; i++)
+   {
+      const struct frame_trace_record *record = &trace.records[(first + i) % trace.max_frames];
+
+      ptr = frame_trace_put_u64(frame, record->start - origin);
+      ptr = frame_trace_put_u64(ptr, record->duration);
+      for (j = 0; j < FRAME_TRACE_STAGE_COUNT; j++)
+      {
+         ptr = frame_trace_put_u64(ptr, record->stages[j].offset);
+         ptr = frame_trace_put_u64(ptr, record->stages[j].ticks);
+         ptr = frame_trace_put_u32(ptr, record->stages[j].calls);
+      }
+      fwrite(frame, 1, ptr - frame, file);
+   }
+
+   RARCH_LOG("Wrote %u traced frames to \"%s\".\n", count, trace.path);
+   return fclose(file) == 0;
+}
+
+void frame_trace_deinit(void)
+{
+   if (!trace.records)
+      return;
+
+   frame_trace_active = false;
+   if (!frame_trace_write())
+      RARCH_ERR("Failed to write frame trace to \"%s\".\n", trace.path);
+
+   free(trace.records);
+   trace.records = NULL;
+   trace.frames  = 0;
+}
+
+static void frame_trace_run(void)
+{
+   if (frame_trace_active)
+   {
+      frame_trace_next_frame();
+      frame_trace_begin(FRAME_TRACE_CORE_RUN);
+      trace.run();
+      frame_trace_end(FRAME_TRACE_CORE_RUN);
+   }
+   else
+      trace.run();
+}
+
+static void frame_trace_video_refresh(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+   FRAME_TRACE_BEGIN(FRAME_TRACE_VIDEO);
+   trace.video_refresh_cb(data, width, height, pitch);
+   FRAME_TRACE_END(FRAME_TRACE_VIDEO);
+}
+
+static void frame_trace_audio_sample(int16_t left, int16_t right)
+{
+   FRAME_TRACE_BEGIN(FRAME_TRACE_AUDIO);
+   trace.audio_sample_cb(left, right);
+   FRAME_TRACE_END(FRAME_TRACE_AUDIO);
+}
+
+static size_t frame_trace_audio_sample_batch(const int16_t *data, size_t frames)
+{
+   size_t ret;
+   FRAME_TRACE_BEGIN(FRAME_TRACE_AUDIO);
+   ret = trace.audio_sample_batch_cb(data, frames);
+   FRAME_TRACE_END(FRAME_TRACE_AUDIO);
+   return ret;
+}
+
+static void frame_trace_input_poll(void)
+{
+   FRAME_TRACE_BEGIN(FRAME_TRACE_INPUT_POLL);
+   trace.input_poll_cb();
+   FRAME_TRACE_END(FRAME_TRACE_INPUT_POLL);
+}
+
+static void frame_trace_set_video_refresh(retro_video_refresh_t cb)
+{
+   trace.video_refresh_cb = cb;
+   trace.set_video_refresh(cb ? frame_trace_video_refresh : NULL);
+}
+
+static void frame_trace_set_audio_sample(retro_audio_sample_t cb)
+{
+   trace.audio_sample_cb = cb;
+   trace.set_audio_sample(cb ? frame_trace_audio_sample : NULL);
+}
+
+static void frame_trace_set_audio_sample_batch(retro_audio_sample_batch_t cb)
+{
+   trace.audio_sample_batch_cb = cb;
+   trace.set_audio_sample_batch(cb ? frame_trace_audio_sample_batch : NULL);
+}
+
+static void frame_trace_set_input_poll(retro_input_poll_t cb)
+{
+   trace.input_poll_cb = cb;
+   trace.set_input_poll(cb ? frame_trace_input_poll : NULL);
+}
+
+void frame_trace_hook_core(void)
+{
+   if (pretro_run == frame_trace_run)
+      return;
+
+   trace.run                    = pretro_run;
+   trace.set_video_refresh      = pretro_set_video_refresh;
+   trace.set_audio_sample       = pretro_set_audio_sample;
+   trace.set_audio_sample_batch = pretro_set_audio_sample_batch;
+   trace.set_input_poll         = pretro_set_input_poll;
+
+   pretro_run                    = frame_trace_run;
+   pretro_set_video_refresh      = frame_trace_set_video_refresh;
+   pretro_set_audio_sample       = frame_trace_set_audio_sample;
+   pretro_set_audio_sample_batch = frame_trace_set_audio_sample_batch;
+   pretro_set_input_poll         = frame_trace_set_input_poll;
+}
+
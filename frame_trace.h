@@ -0,0 +1,72 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_FRAME_TRACE_H
+#define __RARCH_FRAME_TRACE_H
+
+#include "boolean.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Opt-in per-frame timeline of the frontend's stages.
+// A frame starts every time the core's retro_run() is entered.
+// Records live in a buffer allocated up front, tracing a stage never allocates.
+enum frame_trace_stage
+{
+   FRAME_TRACE_CORE_RUN = 0,  // retro_run(), including the callbacks below.
+   FRAME_TRACE_INPUT_POLL,    // Input poll callback.
+   FRAME_TRACE_AUDIO,         // Audio sample callbacks, including resampling and the audio driver.
+   FRAME_TRACE_VIDEO,         // Video refresh callback, i.e. video_frame or the thread wrapper handoff.
+   FRAME_TRACE_VIDEO_THREAD,  // Driver frame on the video thread when threaded video is used.
+   FRAME_TRACE_GPU_FENCE,     // Waiting for GPU fences with video_hard_sync.
+
+   FRAME_TRACE_STAGE_COUNT
+};
+
+// Ten minutes at 60 fps.
+#define FRAME_TRACE_MAX_FRAMES (60 * 60 * 10)
+
+extern bool frame_trace_active;
+
+// Allocates room for max_frames records. Once full, the oldest frames are overwritten.
+bool frame_trace_init(const char *path, unsigned max_frames);
+// Writes the binary trace to the path given to frame_trace_init() and frees the buffer.
+void frame_trace_deinit(void);
+
+// Routes retro_run() and the core's input/audio/video callbacks through the tracer.
+// Must be called after the core symbols are loaded and before callbacks are set.
+void frame_trace_hook_core(void);
+
+void frame_trace_begin(enum frame_trace_stage stage);
+void frame_trace_end(enum frame_trace_stage stage);
+
+#define FRAME_TRACE_BEGIN(stage) do { \
+   if (frame_trace_active) \
+      frame_trace_begin(stage); \
+} while(0)
+
+#define FRAME_TRACE_END(stage) do { \
+   if (frame_trace_active) \
+      frame_trace_end(stage); \
+} while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -19,6 +19,7 @@
 #include "../general.h"
 #include "../conf/config_file.h"
 #include "../file.h"
+#include "../hash.h"
 
 #include "frontend_context.h"
 frontend_ctx_driver_t *frontend_ctx;
@@ -276,12 +277,14 @@ void main_exit(args_type() args)
 
    if (g_extern.main_is_init)
       rarch_main_deinit();
+   save_state_deinit();
    rarch_deinit_msg_queue();
    global_uninit_drivers();
 
 #ifdef PERF_TEST
    rarch_perf_log();
 #endif
+   rarch_perf_free();
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
@@ -318,6 +321,8 @@ returntype main_entry(signature())
          frontend_ctx->init(args);
    }
 
+   hash_init();
+
    if (!ra_preinited)
    {
       rarch_main_clear_state();
@@ -26,6 +26,8 @@
 #include "../general.h"
 #include "../performance.h"
 #include "../driver.h"
+#include "../file.h"
+#include "../hash.h"
 #include "menu/rmenu.h"
 
 #include "../config.def.h"
@@ -181,6 +183,7 @@ static void *android_app_entry(void *data)
    g_android = android_app;
 
    RARCH_LOG("Native Activity started.\n");
+   hash_init();
    rarch_main_clear_state();
 
    while (!android_app->window)
@@ -278,11 +281,13 @@ exit:
 
    if (g_extern.main_is_init)
       rarch_main_deinit();
+   save_state_deinit();
 
    rarch_deinit_msg_queue();
 #ifdef PERF_TEST
    rarch_perf_log();
 #endif
+   rarch_perf_free();
    rarch_main_clear_state();
 
    RARCH_LOG("android_app_destroy!");
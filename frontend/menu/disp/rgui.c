@@ -35,6 +35,7 @@
 
 #include "../../../screenshot.h"
 #include "../../../gfx/fonts/bitmap.h"
+#include "rgui_draw.h"
 
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_HLSL)
 #define HAVE_SHADER_MANAGER
@@ -46,6 +47,9 @@ static uint16_t __attribute((aligned(64))) menu_framebuf[400 * 240];
 static uint16_t menu_framebuf[400 * 240];
 #endif
 
+// Records the menu every frame, and paints only the rows that changed.
+static rgui_draw_t *rgui_draw;
+
 #define RGUI_TERM_START_X 15
 #define RGUI_TERM_START_Y 27
 #define RGUI_TERM_WIDTH (((rgui->width - RGUI_TERM_START_X - 15) / (FONT_WIDTH_STRIDE)))
@@ -96,46 +100,23 @@ static uint16_t green_filler(unsigned x, unsigned y)
 #endif
 }
 
-static void fill_rect(uint16_t *buf, unsigned pitch,
-      unsigned x, unsigned y,
+static void fill_rect(int x, int y,
       unsigned width, unsigned height,
-      uint16_t (*col)(unsigned x, unsigned y))
+      rgui_filler_t col)
 {
-   unsigned j, i;
-   for (j = y; j < y + height; j++)
-      for (i = x; i < x + width; i++)
-         buf[j * (pitch >> 1) + i] = col(i, j);
+   rgui_draw_rect(rgui_draw, x, y, width, height, col);
 }
 
 static void blit_line(rgui_handle_t *rgui,
       int x, int y, const char *message, bool green)
 {
-   int j, i;
-   while (*message)
-   {
-      for (j = 0; j < FONT_HEIGHT; j++)
-      {
-         for (i = 0; i < FONT_WIDTH; i++)
-         {
-            uint8_t rem = 1 << ((i + j * FONT_WIDTH) & 7);
-            int offset = (i + j * FONT_WIDTH) >> 3;
-            bool col = (rgui->font[FONT_OFFSET((unsigned char)*message) + offset] & rem);
-
-            if (col)
-            {
-               rgui->frame_buf[(y + j) * (rgui->frame_buf_pitch >> 1) + (x + i)] = green ?
+   (void)rgui;
+   rgui_draw_text(rgui_draw, x, y, message, green ?
 #if defined(GEKKO)|| defined(PSP)
-               (3 << 0) | (10 << 4) | (3 << 8) | (7 << 12) : 0x7FFF;
+         (3 << 0) | (10 << 4) | (3 << 8) | (7 << 12) : 0x7FFF);
 #else
-               (15 << 0) | (7 << 4) | (15 << 8) | (7 << 12) : 0xFFFF;
+         (15 << 0) | (7 << 4) | (15 << 8) | (7 << 12) : 0xFFFF);
 #endif
-            }
-         }
-      }
-
-      x += FONT_WIDTH_STRIDE;
-      message++;
-   }
 }
 
 static void init_font(rgui_handle_t *rgui, const uint8_t *font_bmp_buf)
@@ -174,20 +155,15 @@ static bool rguidisp_init_font(void *data)
 
 static void rgui_render_background(rgui_handle_t *rgui)
 {
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         0, 0, rgui->width, rgui->height, gray_filler);
+   fill_rect(0, 0, rgui->width, rgui->height, gray_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         5, 5, rgui->width - 10, 5, green_filler);
+   fill_rect(5, 5, rgui->width - 10, 5, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         5, rgui->height - 10, rgui->width - 10, 5, green_filler);
+   fill_rect(5, rgui->height - 10, rgui->width - 10, 5, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         5, 5, 5, rgui->height - 10, green_filler);
+   fill_rect(5, 5, 5, rgui->height - 10, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         rgui->width - 10, 5, 5, rgui->height - 10, green_filler);
+   fill_rect(rgui->width - 10, 5, 5, rgui->height - 10, green_filler);
 }
 
 static void rgui_render_messagebox(void *data, const char *message)
@@ -231,20 +207,15 @@ static void rgui_render_messagebox(void *data, const char *message)
    int x = (rgui->width - width) / 2;
    int y = (rgui->height - height) / 2;
    
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         x + 5, y + 5, width - 10, height - 10, gray_filler);
+   fill_rect(x + 5, y + 5, width - 10, height - 10, gray_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         x, y, width - 5, 5, green_filler);
+   fill_rect(x, y, width - 5, 5, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         x + width - 5, y, 5, height - 5, green_filler);
+   fill_rect(x + width - 5, y, 5, height - 5, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         x + 5, y + height - 5, width - 5, 5, green_filler);
+   fill_rect(x + 5, y + height - 5, width - 5, 5, green_filler);
 
-   fill_rect(rgui->frame_buf, rgui->frame_buf_pitch,
-         x, y + 5, 5, height - 5, green_filler);
+   fill_rect(x, y + 5, 5, height - 5, green_filler);
 
    for (i = 0; i < list->size; i++)
    {
@@ -278,6 +249,7 @@ static void rgui_render(void *data)
    if (end - begin > RGUI_TERM_HEIGHT)
       end = begin + RGUI_TERM_HEIGHT;
 
+   rgui_draw_begin(rgui_draw);
    rgui_render_background(rgui);
 
    char title[256];
@@ -568,6 +540,16 @@ static void *rgui_init(void)
       return NULL;
    }
 
+   rgui_draw = rgui_draw_new(rgui->font);
+   if (!rgui_draw)
+   {
+      RARCH_ERR("Failed to init RGUI renderer.\n");
+      if (rgui->alloc_font)
+         free((uint8_t*)rgui->font);
+      free(rgui);
+      return NULL;
+   }
+
    return rgui;
 }
 
@@ -576,6 +558,9 @@ static void rgui_free(void *data)
    rgui_handle_t *rgui = (rgui_handle_t*)data;
    if (rgui->alloc_font)
       free((uint8_t*)rgui->font);
+
+   rgui_draw_free(rgui_draw);
+   rgui_draw = NULL;
 }
 
 static int rgui_input_postprocess(void *data, uint64_t old_state)
@@ -598,8 +583,18 @@ static int rgui_input_postprocess(void *data, uint64_t old_state)
 void rgui_set_texture(void *data, bool enable)
 {
    rgui_handle_t *rgui = (rgui_handle_t*)data;
+   unsigned first_row = 0, rows = 0;
 
-   if (driver.video_data && driver.video_poke && driver.video_poke->set_texture_enable)
+   rgui_draw_end(rgui_draw, rgui->frame_buf, rgui->frame_buf_pitch,
+         rgui->width, rgui->height, &first_row, &rows);
+
+   if (!driver.video_data || !driver.video_poke || !driver.video_poke->set_texture_enable)
+      return;
+
+   if (driver.video_poke->set_texture_frame_rows)
+      driver.video_poke->set_texture_frame_rows(driver.video_data, menu_framebuf,
+            enable, rgui->width, rgui->height, first_row, rows, 1.0f);
+   else
       driver.video_poke->set_texture_frame(driver.video_data, menu_framebuf,
             enable, rgui->width, rgui->height, 1.0f);
 }
@@ -0,0 +1,376 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rgui_draw.h"
+#include "../../../gfx/fonts/bitmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Longer lines run off the widest RGUI framebuffer anyway.
+#define RGUI_DRAW_MAX_TEXT 128
+#define RGUI_DRAW_MAX_ROWS 480
+
+struct rgui_draw_op
+{
+   rgui_filler_t filler; // NULL for text.
+   int x, y;
+   unsigned width, height;
+   uint16_t color;
+   char text[RGUI_DRAW_MAX_TEXT];
+};
+
+struct rgui_draw_list
+{
+   struct rgui_draw_op *ops;
+   unsigned size;
+   unsigned capacity;
+};
+
+struct rgui_draw
+{
+   // One mask per glyph row, bit i set means pixel i is drawn.
+   uint16_t glyphs[256][FONT_HEIGHT];
+
+   // Frame being recorded, and the one currently in the framebuffer.
+   struct rgui_draw_list lists[2];
+   unsigned cur;
+   bool recording;
+   bool invalid;
+
+   // Framebuffer of the last frame, painting anywhere else starts over.
+   uint16_t *buf;
+   size_t pitch;
+   unsigned width, height;
+
+   uint8_t dirty[RGUI_DRAW_MAX_ROWS];
+};
+
+rgui_draw_t *rgui_draw_new(const uint8_t *font)
+{
+   unsigned c, x, y;
+   rgui_draw_t *draw = (rgui_draw_t*)calloc(1, sizeof(*draw));
+   if (!draw)
+      return NULL;
+
+   for (c = 0; c < 256; c++)
+   {
+      for (y = 0; y < FONT_HEIGHT; y++)
+      {
+         uint16_t mask = 0;
+         for (x = 0; x < FONT_WIDTH; x++)
+         {
+            unsigned bit = x + y * FONT_WIDTH;
+            if (font[FONT_OFFSET(c) + (bit >> 3)] & (1 << (bit & 7)))
+               mask |= 1 << x;
+         }
+         draw->glyphs[c][y] = mask;
+      }
+   }
+
+   draw->invalid = true;
+   return draw;
+}
+
+void rgui_draw_free(rgui_draw_t *draw)
+{
+   if (!draw)
+      return;
+
+   free(draw->lists[0].ops);
+   free(draw->lists[1].ops);
+   free(draw);
+}
+
+void rgui_draw_begin(rgui_draw_t *draw)
+{
+   draw->lists[draw->cur].size = 0;
+   draw->recording = true;
+}
+
+void rgui_draw_invalidate(rgui_draw_t *draw)
+{
+   draw->invalid = true;
+}
+
+static bool rgui_draw_reserve(struct rgui_draw_list *list, unsigned size)
+{
+   unsigned capacity = list->capacity ? list->capacity : 32;
+   struct rgui_draw_op *ops;
+
+   if (size <= list->capacity)
+      return true;
+
+   while (capacity < size)
+      capacity *= 2;
+   ops = (struct rgui_draw_op*)realloc(list->ops, capacity * sizeof(*ops));
+   if (!ops)
+      return false;
+
+   list->ops = ops;
+   list->capacity = capacity;
+   return true;
+}
+
+// Continues recording on top of the previous frame.
+static void rgui_draw_resume(rgui_draw_t *draw)
+{
+   struct rgui_draw_list *list = &draw->lists[draw->cur];
+   const struct rgui_draw_list *prev = &draw->lists[draw->cur ^ 1];
+
+   list->size = 0;
+   draw->recording = true;
+
+   if (!prev->size)
+      return;
+   if (!rgui_draw_reserve(list, prev->size))
+   {
+      draw->invalid = true;
+      return;
+   }
+
+   memcpy(list->ops, prev->ops, prev->size * sizeof(*prev->ops));
+   list->size = prev->size;
+}
+
+static struct rgui_draw_op *rgui_draw_push(rgui_draw_t *draw)
+{
+   struct rgui_draw_list *list = &draw->lists[draw->cur];
+
+   if (!draw->recording)
+      rgui_draw_resume(draw);
+
+   if (!rgui_draw_reserve(list, list->size + 1))
+      return NULL;
+   return &list->ops[list->size++];
+}
+
+void rgui_draw_rect(rgui_draw_t *draw, int x, int y,
+      unsigned width, unsigned height, rgui_filler_t filler)
+{
+   struct rgui_draw_op *op = rgui_draw_push(draw);
+   if (!op)
+      return;
+
+   op->filler = filler;
+   op->x = x;
+   op->y = y;
+   op->width = width;
+   op->height = height;
+   op->color = 0;
+   op->text[0] = '\0';
+}
+
+void rgui_draw_text(rgui_draw_t *draw, int x, int y,
+      const char *msg, uint16_t color)
+{
+   size_t len;
+   struct rgui_draw_op *op = rgui_draw_push(draw);
+   if (!op)
+      return;
+
+   len = strlen(msg);
+   if (len >= RGUI_DRAW_MAX_TEXT)
+      len = RGUI_DRAW_MAX_TEXT - 1;
+   memcpy(op->text, msg, len);
+   op->text[len] = '\0';
+
+   op->filler = NULL;
+   op->x = x;
+   op->y = y;
+   op->width = len * FONT_WIDTH_STRIDE;
+   op->height = FONT_HEIGHT;
+   op->color = color;
+}
+
+static bool rgui_draw_op_equal(const struct rgui_draw_op *a, const struct rgui_draw_op *b)
+{
+   return a->filler == b->filler && a->x == b->x && a->y == b->y &&
+      a->width == b->width && a->height == b->height &&
+      a->color == b->color && strcmp(a->text, b->text) == 0;
+}
+
+static void rgui_draw_mark(rgui_draw_t *draw, const struct rgui_draw_op *op)
+{
+   int y0 = op->y < 0 ? 0 : op->y;
+   int y1 = op->y + (int)op->height;
+   if (y1 > (int)draw->height)
+      y1 = draw->height;
+   if (y0 < y1)
+      memset(draw->dirty + y0, 1, y1 - y0);
+}
+
+// The filler repeats every 4 pixels, so every row is one 64-bit pattern stored over and over.
+static void rgui_paint_rect(rgui_draw_t *draw, const struct rgui_draw_op *op, int y0, int y1)
+{
+   int x0 = op->x < 0 ? 0 : op->x;
+   int x1 = op->x + (int)op->width;
+   int y;
+
+   if (x1 > (int)draw->width)
+      x1 = draw->width;
+   if (op->y > y0)
+      y0 = op->y;
+   if (op->y + (int)op->height < y1)
+      y1 = op->y + op->height;
+
+   for (y = y0; y < y1 && x0 < x1; y++)
+   {
+      uint16_t *dst = draw->buf + y * (draw->pitch >> 1) + x0;
+      unsigned count = x1 - x0, i;
+      uint16_t pixels[4];
+      uint64_t pattern;
+
+      for (i = 0; i < 4; i++)
+         pixels[i] = op->filler(x0 + i, y);
+      memcpy(&pattern, pixels, sizeof(pattern));
+
+      for (i = 0; i + 4 <= count; i += 4)
+         memcpy(dst + i, &pattern, sizeof(pattern));
+      for (; i < count; i++)
+         dst[i] = pixels[i & 3];
+   }
+}
+
+static void rgui_paint_text(rgui_draw_t *draw, const struct rgui_draw_op *op, int y0, int y1)
+{
+   const char *msg;
+   int x = op->x;
+   int first = y0 - op->y, last = y1 - op->y;
+
+   if (first < 0)
+      first = 0;
+   if (last > FONT_HEIGHT)
+      last = FONT_HEIGHT;
+
+   for (msg = op->text; *msg && x < (int)draw->width; msg++, x += FONT_WIDTH_STRIDE)
+   {
+      const uint16_t *glyph = draw->glyphs[(unsigned char)*msg];
+      uint16_t clip = (1 << FONT_WIDTH) - 1;
+      int j;
+
+      if (x + FONT_WIDTH <= 0)
+         continue;
+      if (x < 0)
+         clip &= ~((1 << -x) - 1);
+      if (x + FONT_WIDTH > (int)draw->width)
+         clip &= (1 << (draw->width - x)) - 1;
+
+      for (j = first; j < last; j++)
+      {
+         uint16_t *dst = draw->buf + (op->y + j) * (draw->pitch >> 1) + x;
+         unsigned mask = glyph[j] & clip;
+         unsigned i;
+
+         for (i = 0; mask; i++, mask >>= 1)
+            if (mask & 1)
+               dst[i] = op->color;
+      }
+   }
+}
+
+void rgui_draw_end(rgui_draw_t *draw, uint16_t *buf, size_t pitch,
+      unsigned width, unsigned height,
+      unsigned *first_row, unsigned *rows)
+{
+   const struct rgui_draw_list *list, *prev;
+   unsigned i, common, y, first = height, last = 0;
+
+   *first_row = 0;
+   *rows = 0;
+
+   if (height > RGUI_DRAW_MAX_ROWS)
+      height = RGUI_DRAW_MAX_ROWS;
+   if (buf != draw->buf || pitch != draw->pitch ||
+         width != draw->width || height != draw->height)
+      draw->invalid = true;
+
+   // Nothing was drawn since the last frame, it stays as it is.
+   if (!draw->recording)
+   {
+      if (!draw->invalid)
+         return;
+      rgui_draw_resume(draw);
+   }
+   draw->recording = false;
+
+   draw->buf = buf;
+   draw->pitch = pitch;
+   draw->width = width;
+   draw->height = height;
+
+   list = &draw->lists[draw->cur];
+   prev = &draw->lists[draw->cur ^ 1];
+
+   if (draw->invalid)
+      memset(draw->dirty, 1, height);
+   else
+   {
+      memset(draw->dirty, 0, height);
+      common = list->size < prev->size ? list->size : prev->size;
+
+      for (i = 0; i < common; i++)
+      {
+         if (!rgui_draw_op_equal(&list->ops[i], &prev->ops[i]))
+         {
+            rgui_draw_mark(draw, &list->ops[i]);
+            rgui_draw_mark(draw, &prev->ops[i]);
+         }
+      }
+      for (; i < list->size; i++)
+         rgui_draw_mark(draw, &list->ops[i]);
+      for (i = common; i < prev->size; i++)
+         rgui_draw_mark(draw, &prev->ops[i]);
+   }
+   draw->invalid = false;
+
+   // Repaint every band of dirty rows with all the draws that touch it, in order.
+   for (y = 0; y < height; )
+   {
+      unsigned end;
+      if (!draw->dirty[y])
+      {
+         y++;
+         continue;
+      }
+
+      for (end = y; end < height && draw->dirty[end]; end++);
+
+      for (i = 0; i < list->size; i++)
+      {
+         const struct rgui_draw_op *op = &list->ops[i];
+         if (op->y >= (int)end || op->y + (int)op->height <= (int)y)
+            continue;
+
+         if (op->filler)
+            rgui_paint_rect(draw, op, y, end);
+         else
+            rgui_paint_text(draw, op, y, end);
+      }
+
+      if (y < first)
+         first = y;
+      last = end;
+      y = end;
+   }
+
+   // The new frame is the reference for the next one.
+   draw->cur ^= 1;
+
+   if (first < last)
+   {
+      *first_row = first;
+      *rows = last - first;
+   }
+}
@@ -0,0 +1,62 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RGUI_DRAW_H__
+#define RGUI_DRAW_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../../../boolean.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Software renderer for the 16-bit RGUI framebuffer.
+// A frame is recorded as a list of rectangles and text lines. When the frame ends,
+// it is compared with the previous one, and only rows touched by draws that changed
+// are painted again.
+typedef struct rgui_draw rgui_draw_t;
+
+// Fill pattern for rectangles. Must repeat every 4 pixels horizontally.
+typedef uint16_t (*rgui_filler_t)(unsigned x, unsigned y);
+
+// font holds 256 glyphs in the format of gfx/fonts/bitmap.h.
+rgui_draw_t *rgui_draw_new(const uint8_t *font);
+void rgui_draw_free(rgui_draw_t *draw);
+
+// Starts recording a new frame.
+// Draws made without a call to rgui_draw_begin() are layered on top of the previous frame.
+void rgui_draw_begin(rgui_draw_t *draw);
+
+void rgui_draw_rect(rgui_draw_t *draw, int x, int y,
+      unsigned width, unsigned height, rgui_filler_t filler);
+void rgui_draw_text(rgui_draw_t *draw, int x, int y,
+      const char *msg, uint16_t color);
+
+// Paints the rows that changed since the last frame into buf (pitch in bytes).
+// The painted rows are returned in first_row and rows, rows is 0 if nothing changed.
+void rgui_draw_end(rgui_draw_t *draw, uint16_t *buf, size_t pitch,
+      unsigned width, unsigned height,
+      unsigned *first_row, unsigned *rows);
+
+// Makes the next rgui_draw_end() paint the whole frame.
+void rgui_draw_invalidate(rgui_draw_t *draw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
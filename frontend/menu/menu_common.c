@@ -389,6 +389,7 @@ bool load_menu_game(void)
 {
    if (g_extern.main_is_init)
       rarch_main_deinit();
+   save_state_deinit();
 
    struct rarch_main_wrap args = {0};
 
@@ -18,6 +18,7 @@
 #include "../../apple/common/rarch_wrapper.h"
 #include "../../apple/common/apple_export.h"
 #include "../../apple/common/setting_data.h"
+#include "../../hash.h"
 
 #include "../frontend_context.h"
 
@@ -64,6 +65,7 @@ void apple_refresh_config(void)
 
 int apple_rarch_load_content(int argc, char* argv[])
 {
+   hash_init();
    rarch_main_clear_state();
    rarch_init_msg_queue();
    
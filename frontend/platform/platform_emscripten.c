@@ -19,6 +19,7 @@
 #include "../../general.h"
 #include "../../conf/config_file.h"
 #include "../../file.h"
+#include "../../hash.h"
 #include "../frontend.h"
 
 #ifdef HAVE_MENU
@@ -38,6 +39,7 @@ int main(int argc, char *argv[])
 {
    emscripten_set_canvas_size(800, 600);
 
+   hash_init();
    rarch_main_clear_state();
    rarch_init_msg_queue();
 
@@ -30,6 +30,7 @@
 #include "dynamic.h"
 #include "cheats.h"
 #include "audio/ext/rarch_dsp.h"
+#include "gfx/filter.h"
 #include "compat/strl.h"
 #include "performance.h"
 #include "core_options.h"
@@ -156,10 +157,16 @@ struct settings
       bool shader_enable;
 
       char filter_path[PATH_MAX];
+      unsigned filter_threads;
       float refresh_rate;
       bool threaded;
 
       char shader_dir[PATH_MAX];
+      char shader_cache_dir[PATH_MAX];
+
+      // Output of the soft video driver, empty when unused.
+      char soft_dump_dir[PATH_MAX];
+      char soft_hash_log[PATH_MAX];
 
       char font_path[PATH_MAX];
       float font_size;
@@ -258,6 +265,7 @@ struct settings
       char device_names[MAX_PLAYERS][64];
       bool debug_enable;
       bool autodetect_enable;
+      bool joypad_poll_on_state;
 #ifdef ANDROID
       unsigned back_behavior;
       unsigned icade_profile[MAX_PLAYERS];
@@ -284,6 +292,7 @@ struct settings
    char libretro_info_path[PATH_MAX];
    char cheat_database[PATH_MAX];
    char cheat_settings_path[PATH_MAX];
+   char frame_trace_path[PATH_MAX];
 
    char screenshot_directory[PATH_MAX];
    char system_directory[PATH_MAX];
@@ -296,11 +305,14 @@ struct settings
 
    float slowmotion_ratio;
    float fastforward_ratio;
+   bool fastforward_turbo;
+   unsigned fastforward_present_interval;
 
    bool pause_nonactive;
    unsigned autosave_interval;
 
    bool block_sram_overwrite;
+   bool savestate_compression;
    bool savestate_auto_index;
    bool savestate_auto_save;
    bool savestate_auto_load;
@@ -308,6 +320,8 @@ struct settings
    bool network_cmd_enable;
    uint16_t network_cmd_port;
    bool stdin_cmd_enable;
+   uint16_t network_cmd_bin_port;
+   char network_cmd_bin_socket[PATH_MAX];
 
    char content_directory[PATH_MAX];
 #if defined(HAVE_MENU)
@@ -503,20 +517,11 @@ struct global
 
    struct
    {
-      bool active;
-      uint32_t *buffer;
-      uint32_t *colormap;
+      rarch_softfilter_t *filter;
+      void *buffer;
       unsigned pitch;
-      dylib_t lib;
       unsigned scale;
-
-      void (*psize)(unsigned *width, unsigned *height);
-      void (*prender)(uint32_t *colormap, uint32_t *output, unsigned outpitch,
-            const uint16_t *input, unsigned pitch, unsigned width, unsigned height);
-
-      // CPU filters only work on *XRGB1555*. We have to convert to XRGB1555 first.
-      struct scaler_ctx scaler;
-      uint16_t *scaler_out;
+      bool out_rgb32;
    } filter;
 
    msg_queue_t *msg_queue;
@@ -59,6 +59,32 @@ void *vout_fbdev_flip(struct vout_fbdev *fbdev)
 	return (char *)fbdev->mem + fbdev->fb_size * fbdev->buffer_write;
 }
 
+/* for callers that track the buffers themselves instead of rotating with vout_fbdev_flip() */
+void *vout_fbdev_get_buffer(struct vout_fbdev *fbdev, int buf)
+{
+	return (char *)fbdev->mem + fbdev->fb_size * buf +
+		fbdev->top_border * vout_fbdev_get_stride(fbdev);
+}
+
+int vout_fbdev_pan(struct vout_fbdev *fbdev, int buf)
+{
+	fbdev->fbvar_new.yoffset =
+		(fbdev->top_border + fbdev->fbvar_new.yres + fbdev->bottom_border) * buf +
+		fbdev->top_border;
+
+	return ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->fbvar_new);
+}
+
+int vout_fbdev_get_buffer_count(struct vout_fbdev *fbdev)
+{
+	return fbdev->buffer_count;
+}
+
+int vout_fbdev_get_stride(struct vout_fbdev *fbdev)
+{
+	return fbdev->fbvar_new.xres_virtual * fbdev->fbvar_new.bits_per_pixel / 8;
+}
+
 void vout_fbdev_wait_vsync(struct vout_fbdev *fbdev)
 {
 	int arg = 0;
@@ -7,6 +7,10 @@ struct vout_fbdev *vout_fbdev_preinit(int fbdev_fd);
 int vout_fbdev_init(struct vout_fbdev *fbdev, int *w, int *h, int bpp, int buffer_cnt);
 
 void *vout_fbdev_flip(struct vout_fbdev *fbdev);
+void *vout_fbdev_get_buffer(struct vout_fbdev *fbdev, int buf);
+int   vout_fbdev_pan(struct vout_fbdev *fbdev, int buf);
+int   vout_fbdev_get_buffer_count(struct vout_fbdev *fbdev);
+int   vout_fbdev_get_stride(struct vout_fbdev *fbdev);
 void  vout_fbdev_wait_vsync(struct vout_fbdev *fbdev);
 void *vout_fbdev_resize(struct vout_fbdev *fbdev, int w, int h, int bpp,
 			int left_border, int right_border, int top_border, int bottom_border,
@@ -0,0 +1,532 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Software video driver for plain Linux framebuffers.
+// Frames are scaled and converted straight into one of up to three buffers in the framebuffer,
+// which is then panned to on the next vblank.
+
+#include "../driver.h"
+#include <stdlib.h>
+#include <string.h>
+#include "../general.h"
+#include "../performance.h"
+#include "scaler/scaler.h"
+#include "gfx_common.h"
+#include "soft_common.h"
+#include "soft_overlay.h"
+#include "fbdev.h"
+
+#ifdef HAVE_THREADS
+#include "../thread.h"
+#endif
+
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fb.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define FBDEV_MAX_BUFFERS 3
+
+typedef struct fbdev_video
+{
+   struct vout_fbdev *fb;
+   unsigned width;
+   unsigned height;
+   unsigned bytes_per_pixel;
+   unsigned stride;
+   int buffers;
+
+   // Buffer on screen, buffer panned to but not yet on screen, and buffer waiting to be panned to.
+   // -1 when there is none.
+   int displayed;
+   int panned;
+   int queued;
+   bool need_clear[FBDEV_MAX_BUFFERS];
+   bool nonblock;
+
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool quit;
+#endif
+
+   struct scaler_ctx scaler;
+   struct rarch_viewport vp;
+   unsigned last_width;
+   unsigned last_height;
+   bool keep_aspect;
+   bool should_resize;
+
+   struct soft_font font;
+
+#ifdef HAVE_OVERLAY
+   soft_overlay_t *overlay;
+#endif
+} fbdev_video_t;
+
+static const char *fbdev_get_device(void)
+{
+   static char fbname[32];
+   const char *env = getenv("FRAMEBUFFER");
+
+   if (env && *env)
+      return env;
+   if (g_settings.video.monitor_index == 0)
+      return "/dev/fb0";
+
+   snprintf(fbname, sizeof(fbname), "/dev/fb%u", g_settings.video.monitor_index - 1);
+   return fbname;
+}
+
+#ifdef HAVE_THREADS
+static void fbdev_vsync_thread(void *data)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+
+   slock_lock(vid->lock);
+   for (;;)
+   {
+      int buf;
+      while (vid->queued < 0 && !vid->quit)
+         scond_wait(vid->cond, vid->lock);
+
+      // The last frame is still shown before quitting.
+      if (vid->queued < 0)
+         break;
+
+      buf = vid->queued;
+      vid->queued = -1;
+      vid->panned = buf;
+      slock_unlock(vid->lock);
+
+      // The pan takes effect on the next vblank, the old buffer is scanned out until then.
+      vout_fbdev_pan(vid->fb, buf);
+      vout_fbdev_wait_vsync(vid->fb);
+
+      slock_lock(vid->lock);
+      vid->displayed = buf;
+      vid->panned = -1;
+      scond_signal(vid->cond);
+   }
+   slock_unlock(vid->lock);
+}
+#endif
+
+static int fbdev_free_buffer(fbdev_video_t *vid)
+{
+   int i;
+   for (i = 0; i < vid->buffers; i++)
+      if (i != vid->displayed && i != vid->panned && i != vid->queued)
+         return i;
+   return -1;
+}
+
+// Picks the buffer to render the next frame into.
+// With vsync, waits until the last frame is picked up by the vsync thread, so we run at the refresh rate.
+// Without, a frame still waiting for its vblank is simply replaced.
+static int fbdev_acquire_buffer(fbdev_video_t *vid)
+{
+   int buf;
+
+   if (vid->buffers < 2)
+      return 0;
+
+#ifdef HAVE_THREADS
+   slock_lock(vid->lock);
+   for (;;)
+   {
+      buf = fbdev_free_buffer(vid);
+      if (vid->nonblock && buf < 0 && vid->queued >= 0)
+      {
+         buf = vid->queued;
+         vid->queued = -1;
+      }
+
+      if (buf >= 0 && (vid->nonblock || vid->queued < 0))
+         break;
+      scond_wait(vid->cond, vid->lock);
+   }
+   slock_unlock(vid->lock);
+#else
+   buf = fbdev_free_buffer(vid);
+#endif
+
+   return buf;
+}
+
+static void fbdev_present_buffer(fbdev_video_t *vid, int buf)
+{
+   if (vid->buffers < 2)
+   {
+      if (!vid->nonblock)
+         vout_fbdev_wait_vsync(vid->fb);
+      return;
+   }
+
+#ifdef HAVE_THREADS
+   slock_lock(vid->lock);
+   vid->queued = buf;
+   scond_signal(vid->cond);
+   slock_unlock(vid->lock);
+#else
+   vout_fbdev_pan(vid->fb, buf);
+   if (!vid->nonblock)
+      vout_fbdev_wait_vsync(vid->fb);
+   vid->displayed = buf;
+#endif
+}
+
+static void fbdev_gfx_free(void *data)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+   if (!vid)
+      return;
+
+#ifdef HAVE_THREADS
+   if (vid->thread)
+   {
+      slock_lock(vid->lock);
+      vid->quit = true;
+      scond_signal(vid->cond);
+      slock_unlock(vid->lock);
+      sthread_join(vid->thread);
+   }
+   if (vid->lock)
+      slock_free(vid->lock);
+   if (vid->cond)
+      scond_free(vid->cond);
+#endif
+
+   if (vid->fb)
+   {
+      vout_fbdev_clear(vid->fb);
+      vout_fbdev_release(vid->fb);
+      vout_fbdev_teardown(vid->fb);
+   }
+
+   soft_font_free(&vid->font);
+
+#ifdef HAVE_OVERLAY
+   soft_overlay_free(vid->overlay);
+#endif
+
+   scaler_ctx_gen_reset(&vid->scaler);
+   free(vid);
+}
+
+static bool fbdev_update_scaler(fbdev_video_t *vid, unsigned width, unsigned height)
+{
+   unsigned i;
+
+   soft_calc_viewport(&vid->vp, vid->width, vid->height, width, height, vid->keep_aspect);
+
+   vid->scaler.in_width   = width;
+   vid->scaler.in_height  = height;
+   vid->scaler.out_width  = vid->vp.width;
+   vid->scaler.out_height = vid->vp.height;
+   vid->scaler.out_stride = vid->stride;
+
+   if (!scaler_ctx_gen_filter(&vid->scaler))
+   {
+      RARCH_ERR("video_fbdev: Failed to create scaler for %ux%u -> %ux%u.\n",
+            width, height, vid->vp.width, vid->vp.height);
+      return false;
+   }
+
+   // The borders of every buffer need clearing before it is used again.
+   for (i = 0; i < FBDEV_MAX_BUFFERS; i++)
+      vid->need_clear[i] = true;
+
+   vid->last_width    = width;
+   vid->last_height   = height;
+   vid->should_resize = false;
+   return true;
+}
+
+static void *fbdev_gfx_init(const video_info_t *video, const input_driver_t **input, void **input_data)
+{
+   struct fb_var_screeninfo var;
+   int width = 0, height = 0, bpp, fd;
+   const char *device = fbdev_get_device();
+   fbdev_video_t *vid;
+
+   if (g_extern.filter.filter)
+   {
+      RARCH_ERR("video_fbdev: Filters are not supported.\n");
+      return NULL;
+   }
+
+   vid = (fbdev_video_t*)calloc(1, sizeof(*vid));
+   if (!vid)
+      return NULL;
+
+   fd = open(device, O_RDWR);
+   if (fd < 0)
+   {
+      RARCH_ERR("video_fbdev: Failed to open %s.\n", device);
+      goto error;
+   }
+
+   // Keep the mode of the console, only the depth is picked when it isn't one we can draw to.
+   if (ioctl(fd, FBIOGET_VSCREENINFO, &var) < 0)
+   {
+      RARCH_ERR("video_fbdev: %s is not a framebuffer.\n", device);
+      close(fd);
+      goto error;
+   }
+
+   bpp = var.bits_per_pixel;
+   if (bpp != 16 && bpp != 32)
+      bpp = video->rgb32 ? 32 : 16;
+
+   vid->fb = vout_fbdev_preinit(fd);
+   if (!vid->fb)
+   {
+      close(fd);
+      goto error;
+   }
+
+   if (vout_fbdev_init(vid->fb, &width, &height, bpp, FBDEV_MAX_BUFFERS) < 0)
+   {
+      RARCH_ERR("video_fbdev: Failed to set up %s.\n", device);
+      goto error;
+   }
+
+   vid->width           = width;
+   vid->height          = height;
+   vid->bytes_per_pixel = bpp / 8;
+   vid->stride          = vout_fbdev_get_stride(vid->fb);
+   vid->buffers         = vout_fbdev_get_buffer_count(vid->fb);
+   vid->displayed       = vid->buffers - 1; // vout_fbdev_init() pans to the last one.
+   vid->panned          = -1;
+   vid->queued          = -1;
+   vid->nonblock        = !video->vsync;
+   vid->keep_aspect     = video->force_aspect;
+
+   RARCH_LOG("video_fbdev: %s, %ux%u, %u bpp, %d buffer(s).\n",
+         device, vid->width, vid->height, bpp, vid->buffers);
+
+#ifdef HAVE_THREADS
+   if (vid->buffers > 1)
+   {
+      vid->lock = slock_new();
+      vid->cond = scond_new();
+      if (!vid->lock || !vid->cond)
+         goto error;
+
+      vid->thread = sthread_create(fbdev_vsync_thread, vid);
+      if (!vid->thread)
+         goto error;
+   }
+#endif
+
+   vid->scaler.scaler_type = video->smooth ? SCALER_TYPE_BILINEAR : SCALER_TYPE_POINT;
+   vid->scaler.in_fmt  = video->rgb32 ? SCALER_FMT_ARGB8888 : SCALER_FMT_RGB565;
+   vid->scaler.out_fmt = vid->bytes_per_pixel == 4 ? SCALER_FMT_ARGB8888 : SCALER_FMT_RGB565;
+
+#ifdef HAVE_OVERLAY
+   vid->overlay = soft_overlay_new();
+   if (!vid->overlay)
+      goto error;
+#endif
+
+   if (input && input_data)
+      *input = NULL;
+
+   soft_font_init(&vid->font);
+   return vid;
+
+error:
+   fbdev_gfx_free(vid);
+   return NULL;
+}
+
+static bool fbdev_gfx_frame(void *data, const void *frame, unsigned width, unsigned height, unsigned pitch, const char *msg)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+   uint8_t *buffer;
+   int buf;
+
+   if (!frame || !width || !height)
+      return true;
+
+   if (width != vid->last_width || height != vid->last_height || vid->should_resize)
+   {
+      if (!fbdev_update_scaler(vid, width, height))
+         return false;
+   }
+
+   buf = fbdev_acquire_buffer(vid);
+   buffer = (uint8_t*)vout_fbdev_get_buffer(vid->fb, buf);
+
+   if (vid->need_clear[buf])
+   {
+      memset(buffer, 0, vid->stride * vid->height);
+      vid->need_clear[buf] = false;
+   }
+
+   vid->scaler.in_stride = pitch;
+
+   RARCH_PERFORMANCE_INIT(fbdev_scale);
+   RARCH_PERFORMANCE_START(fbdev_scale);
+   scaler_ctx_scale(&vid->scaler,
+         buffer + vid->vp.y * vid->stride + vid->vp.x * vid->bytes_per_pixel, frame);
+   RARCH_PERFORMANCE_STOP(fbdev_scale);
+
+   if (msg)
+      soft_font_render_msg(&vid->font, buffer + vid->vp.y * vid->stride + vid->vp.x * vid->bytes_per_pixel,
+            vid->stride, vid->bytes_per_pixel, vid->vp.width, vid->vp.height, msg);
+
+#ifdef HAVE_OVERLAY
+   // Full screen overlays draw over the borders, which then need clearing before the buffer is reused.
+   if (soft_overlay_render(vid->overlay, buffer, vid->stride, vid->bytes_per_pixel,
+            vid->width, vid->height, &vid->vp))
+      vid->need_clear[buf] = true;
+#endif
+
+   fbdev_present_buffer(vid, buf);
+   g_extern.frame_count++;
+   return true;
+}
+
+static void fbdev_gfx_set_nonblock_state(void *data, bool state)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+   vid->nonblock = state;
+}
+
+static bool fbdev_gfx_alive(void *data)
+{
+   (void)data;
+   return true;
+}
+
+static bool fbdev_gfx_focus(void *data)
+{
+   (void)data;
+   return true;
+}
+
+static void fbdev_gfx_viewport_info(void *data, struct rarch_viewport *vp)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+   *vp = vid->vp;
+   vp->full_width  = vid->width;
+   vp->full_height = vid->height;
+   if (!vp->width || !vp->height)
+   {
+      vp->width  = vid->width;
+      vp->height = vid->height;
+   }
+}
+
+static void fbdev_gfx_set_aspect_ratio(void *data, unsigned aspect_ratio_idx)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+
+   switch (aspect_ratio_idx)
+   {
+      case ASPECT_RATIO_SQUARE:
+         gfx_set_square_pixel_viewport(g_extern.system.av_info.geometry.base_width, g_extern.system.av_info.geometry.base_height);
+         break;
+
+      case ASPECT_RATIO_CORE:
+         gfx_set_core_viewport();
+         break;
+
+      case ASPECT_RATIO_CONFIG:
+         gfx_set_config_viewport();
+         break;
+
+      default:
+         break;
+   }
+
+   g_extern.system.aspect_ratio = aspectratio_lut[aspect_ratio_idx].value;
+   vid->keep_aspect = true;
+   vid->should_resize = true;
+}
+
+static void fbdev_gfx_apply_state_changes(void *data)
+{
+   fbdev_video_t *vid = (fbdev_video_t*)data;
+   vid->should_resize = true;
+}
+
+static const video_poke_interface_t fbdev_poke_interface = {
+   NULL,
+#ifdef HAVE_FBO
+   NULL,
+   NULL,
+#endif
+   fbdev_gfx_set_aspect_ratio,
+   fbdev_gfx_apply_state_changes,
+#ifdef HAVE_MENU
+   NULL,
+   NULL,
+#endif
+   NULL,
+   NULL,
+   NULL,
+#ifdef HAVE_MENU
+   NULL,
+#endif
+};
+
+#ifdef HAVE_OVERLAY
+SOFT_OVERLAY_INTERFACE(fbdev_gfx, ((fbdev_video_t*)data)->overlay);
+
+static void fbdev_gfx_get_overlay_interface(void *data, const video_overlay_interface_t **iface)
+{
+   (void)data;
+   *iface = &fbdev_gfx_overlay_interface;
+}
+#endif
+
+static void fbdev_gfx_get_poke_interface(void *data, const video_poke_interface_t **iface)
+{
+   (void)data;
+   *iface = &fbdev_poke_interface;
+}
+
+const video_driver_t video_fbdev = {
+   fbdev_gfx_init,
+   fbdev_gfx_frame,
+   fbdev_gfx_set_nonblock_state,
+   fbdev_gfx_alive,
+   fbdev_gfx_focus,
+   NULL,
+   fbdev_gfx_free,
+   "fbdev",
+
+#ifdef HAVE_MENU
+   NULL,
+#endif
+
+   NULL,
+   fbdev_gfx_viewport_info,
+   NULL,
+#ifdef HAVE_OVERLAY
+   fbdev_gfx_get_overlay_interface,
+#endif
+   fbdev_gfx_get_poke_interface,
+};
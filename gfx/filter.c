@@ -0,0 +1,361 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "filter.h"
+#include "filters/softfilter.h"
+#include "../dynamic.h"
+#include "../general.h"
+#include "../performance.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_THREADS
+#include "../thread.h"
+#endif
+
+#define SOFTFILTER_MAX_THREADS 16
+
+// Built-in filters, in gfx/filters/.
+const struct softfilter_implementation *softfilter_get_implementation_scale2x(softfilter_simd_mask_t simd);
+const struct softfilter_implementation *softfilter_get_implementation_2xsai(softfilter_simd_mask_t simd);
+const struct softfilter_implementation *softfilter_get_implementation_ntsc(softfilter_simd_mask_t simd);
+
+static const softfilter_get_implementation_t softfilter_builtins[] = {
+   softfilter_get_implementation_scale2x,
+   softfilter_get_implementation_2xsai,
+   softfilter_get_implementation_ntsc,
+};
+
+#ifdef HAVE_THREADS
+// Thread 0 is the caller of rarch_softfilter_process(), the others wait for one packet per frame.
+struct filter_thread_data
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   void *userdata;
+   const struct softfilter_work_packet *packet;
+   bool done;
+   bool die;
+};
+#endif
+
+struct rarch_softfilter
+{
+#ifdef HAVE_DYLIB
+   dylib_t lib;
+#endif
+
+   const struct softfilter_implementation *impl;
+   void *impl_data;
+
+   unsigned max_width, max_height;
+   unsigned threads;
+   enum retro_pixel_format pix_fmt, out_pix_fmt;
+
+   struct softfilter_work_packet packets[SOFTFILTER_MAX_THREADS];
+#ifdef HAVE_THREADS
+   struct filter_thread_data thread_data[SOFTFILTER_MAX_THREADS];
+#endif
+};
+
+#ifdef HAVE_THREADS
+static void filter_thread_loop(void *data)
+{
+   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+
+   for (;;)
+   {
+      const struct softfilter_work_packet *packet;
+
+      slock_lock(thr->lock);
+      while (!thr->packet && !thr->die)
+         scond_wait(thr->cond, thr->lock);
+      packet = thr->packet;
+      slock_unlock(thr->lock);
+
+      if (!packet)
+         break;
+
+      packet->work(thr->userdata, packet->thread_data);
+
+      slock_lock(thr->lock);
+      thr->packet = NULL;
+      thr->done   = true;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+}
+
+static void filter_threads_free(rarch_softfilter_t *filt)
+{
+   unsigned i;
+   for (i = 1; i < SOFTFILTER_MAX_THREADS; i++)
+   {
+      struct filter_thread_data *thr = &filt->thread_data[i];
+      if (thr->thread)
+      {
+         slock_lock(thr->lock);
+         thr->die = true;
+         scond_signal(thr->cond);
+         slock_unlock(thr->lock);
+         sthread_join(thr->thread);
+      }
+      if (thr->lock)
+         slock_free(thr->lock);
+      if (thr->cond)
+         scond_free(thr->cond);
+      memset(thr, 0, sizeof(*thr));
+   }
+}
+
+static bool filter_threads_init(rarch_softfilter_t *filt)
+{
+   unsigned i;
+   for (i = 1; i < filt->threads; i++)
+   {
+      struct filter_thread_data *thr = &filt->thread_data[i];
+      thr->userdata = filt->impl_data;
+      thr->lock     = slock_new();
+      thr->cond     = scond_new();
+      if (!thr->lock || !thr->cond)
+         return false;
+
+      thr->thread = sthread_create(filter_thread_loop, thr);
+      if (!thr->thread)
+         return false;
+   }
+   return true;
+}
+#endif
+
+static unsigned pix_fmt_to_softfilter(enum retro_pixel_format fmt)
+{
+   switch (fmt)
+   {
+      case RETRO_PIXEL_FORMAT_RGB565:
+         return SOFTFILTER_FMT_RGB565;
+      case RETRO_PIXEL_FORMAT_XRGB8888:
+         return SOFTFILTER_FMT_XRGB8888;
+      default:
+         return SOFTFILTER_FMT_NONE;
+   }
+}
+
+static const struct softfilter_implementation *softfilter_find_builtin(const char *ident,
+      softfilter_simd_mask_t simd)
+{
+   unsigned i;
+   for (i = 0; i < sizeof(softfilter_builtins) / sizeof(softfilter_builtins[0]); i++)
+   {
+      const struct softfilter_implementation *impl = softfilter_builtins[i](simd);
+      if (strcasecmp(impl->ident, ident) == 0)
+         return impl;
+   }
+   return NULL;
+}
+
+rarch_softfilter_t *rarch_softfilter_new(const char *filter,
+      unsigned threads,
+      enum retro_pixel_format in_pixel_format,
+      unsigned max_width, unsigned max_height)
+{
+   unsigned input_fmt, input_fmts, output_fmts, output_fmt;
+   softfilter_simd_mask_t simd = (softfilter_simd_mask_t)rarch_get_cpu_features();
+   rarch_softfilter_t *filt = (rarch_softfilter_t*)calloc(1, sizeof(*filt));
+   if (!filt)
+      return NULL;
+
+   filt->impl = softfilter_find_builtin(filter, simd);
+#ifdef HAVE_DYLIB
+   if (!filt->impl)
+   {
+      softfilter_get_implementation_t cb;
+
+      filt->lib = dylib_load(filter);
+      if (!filt->lib)
+      {
+         RARCH_ERR("Failed to load CPU filter \"%s\".\n", filter);
+         goto error;
+      }
+
+      cb = (softfilter_get_implementation_t)dylib_proc(filt->lib, "softfilter_get_implementation");
+      if (!cb)
+      {
+         RARCH_ERR("Couldn't find softfilter symbol in \"%s\".\n", filter);
+         goto error;
+      }
+
+      filt->impl = cb(simd);
+   }
+#endif
+
+   if (!filt->impl)
+   {
+      RARCH_ERR("CPU filter \"%s\" not found.\n", filter);
+      goto error;
+   }
+
+   if (filt->impl->api_version != SOFTFILTER_API_VERSION)
+   {
+      RARCH_ERR("CPU filter API mismatch. RetroArch: %u, Filter: %u\n",
+            SOFTFILTER_API_VERSION, filt->impl->api_version);
+      goto error;
+   }
+
+   RARCH_LOG("Loaded CPU filter: \"%s\"\n", filt->impl->ident ? filt->impl->ident : "Unknown");
+
+   input_fmt  = pix_fmt_to_softfilter(in_pixel_format);
+   input_fmts = filt->impl->query_input_formats();
+   if (!(input_fmts & input_fmt))
+   {
+      RARCH_ERR("CPU filter does not support the core's pixel format.\n");
+      goto error;
+   }
+
+   // Keep the core's format if we can, the video driver takes it as is then.
+   output_fmts = filt->impl->query_output_formats(input_fmt);
+   if (output_fmts & input_fmt)
+      output_fmt = input_fmt;
+   else if (output_fmts & SOFTFILTER_FMT_XRGB8888)
+      output_fmt = SOFTFILTER_FMT_XRGB8888;
+   else if (output_fmts & SOFTFILTER_FMT_RGB565)
+      output_fmt = SOFTFILTER_FMT_RGB565;
+   else
+   {
+      RARCH_ERR("CPU filter has no output formats.\n");
+      goto error;
+   }
+
+   filt->pix_fmt     = in_pixel_format;
+   filt->out_pix_fmt = output_fmt == SOFTFILTER_FMT_XRGB8888 ?
+      RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   filt->max_width   = max_width;
+   filt->max_height  = max_height;
+
+   if (!threads)
+      threads = rarch_get_cpu_cores();
+#ifndef HAVE_THREADS
+   threads = 1;
+#endif
+   if (threads > SOFTFILTER_MAX_THREADS)
+      threads = SOFTFILTER_MAX_THREADS;
+
+   filt->impl_data = filt->impl->create(input_fmt, output_fmt, max_width, max_height, threads, simd);
+   if (!filt->impl_data)
+   {
+      RARCH_ERR("Failed to create CPU filter instance.\n");
+      goto error;
+   }
+
+   filt->threads = filt->impl->query_num_threads(filt->impl_data);
+   if (!filt->threads || filt->threads > threads)
+   {
+      RARCH_ERR("CPU filter asked for an invalid number of threads (%u).\n", filt->threads);
+      goto error;
+   }
+
+#ifdef HAVE_THREADS
+   if (!filter_threads_init(filt))
+   {
+      RARCH_ERR("Failed to start CPU filter threads.\n");
+      goto error;
+   }
+#endif
+
+   RARCH_LOG("Using %u thread(s) for CPU filter.\n", filt->threads);
+   return filt;
+
+error:
+   rarch_softfilter_free(filt);
+   return NULL;
+}
+
+void rarch_softfilter_free(rarch_softfilter_t *filt)
+{
+   if (!filt)
+      return;
+
+#ifdef HAVE_THREADS
+   filter_threads_free(filt);
+#endif
+
+   if (filt->impl && filt->impl_data)
+      filt->impl->destroy(filt->impl_data);
+#ifdef HAVE_DYLIB
+   if (filt->lib)
+      dylib_close(filt->lib);
+#endif
+   free(filt);
+}
+
+const char *rarch_softfilter_get_ident(rarch_softfilter_t *filt)
+{
+   return filt->impl->ident;
+}
+
+void rarch_softfilter_get_max_output_size(rarch_softfilter_t *filt,
+      unsigned *width, unsigned *height)
+{
+   rarch_softfilter_get_output_size(filt, width, height, filt->max_width, filt->max_height);
+}
+
+void rarch_softfilter_get_output_size(rarch_softfilter_t *filt,
+      unsigned *out_width, unsigned *out_height,
+      unsigned width, unsigned height)
+{
+   filt->impl->query_output_size(filt->impl_data, out_width, out_height, width, height);
+}
+
+enum retro_pixel_format rarch_softfilter_get_output_format(rarch_softfilter_t *filt)
+{
+   return filt->out_pix_fmt;
+}
+
+void rarch_softfilter_process(rarch_softfilter_t *filt,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   unsigned i;
+
+   filt->impl->get_work_packets(filt->impl_data, filt->packets,
+         output, output_stride, input, width, height, input_stride);
+
+#ifdef HAVE_THREADS
+   for (i = 1; i < filt->threads; i++)
+   {
+      struct filter_thread_data *thr = &filt->thread_data[i];
+      slock_lock(thr->lock);
+      thr->packet = &filt->packets[i];
+      thr->done   = false;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+
+   filt->packets[0].work(filt->impl_data, filt->packets[0].thread_data);
+
+   for (i = 1; i < filt->threads; i++)
+   {
+      struct filter_thread_data *thr = &filt->thread_data[i];
+      slock_lock(thr->lock);
+      while (!thr->done)
+         scond_wait(thr->cond, thr->lock);
+      slock_unlock(thr->lock);
+   }
+#else
+   for (i = 0; i < filt->threads; i++)
+      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
+#endif
+}
@@ -0,0 +1,63 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RARCH_FILTER_H__
+#define RARCH_FILTER_H__
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#include "../libretro.h"
+#include "../boolean.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CPU video filters, see gfx/filters/softfilter.h for the plugin API.
+typedef struct rarch_softfilter rarch_softfilter_t;
+
+// filter is the ident of a built-in filter (e.g. "scale2x", "2xsai", "ntsc"), or the path of a plugin.
+// threads is the number of threads to run the filter on, 0 for one per CPU core.
+rarch_softfilter_t *rarch_softfilter_new(const char *filter,
+      unsigned threads,
+      enum retro_pixel_format in_pixel_format,
+      unsigned max_width, unsigned max_height);
+
+void rarch_softfilter_free(rarch_softfilter_t *filt);
+
+const char *rarch_softfilter_get_ident(rarch_softfilter_t *filt);
+
+void rarch_softfilter_get_max_output_size(rarch_softfilter_t *filt,
+      unsigned *width, unsigned *height);
+
+void rarch_softfilter_get_output_size(rarch_softfilter_t *filt,
+      unsigned *out_width, unsigned *out_height,
+      unsigned width, unsigned height);
+
+enum retro_pixel_format rarch_softfilter_get_output_format(rarch_softfilter_t *filt);
+
+// Filters a frame, and returns when the whole output is written. Strides are in bytes.
+void rarch_softfilter_process(rarch_softfilter_t *filt,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
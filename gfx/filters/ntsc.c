@@ -0,0 +1,271 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Composite video look, in the spirit of blargg's NTSC filters.
+// Every line is encoded to a composite signal at two samples per pixel, with the
+// color subcarrier at a quarter of the sample rate, then decoded again with box filters.
+// This gives luma blur, chroma bleed and the color fringes on sharp luma edges.
+// The subcarrier phase flips every line and every frame, like on the real thing.
+// Output is XRGB8888, twice as wide as the input.
+
+#include "softfilter.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NTSC_MAX_THREADS 16
+// Signal samples to each side of a line, for the filter taps.
+#define NTSC_BORDER 4
+
+struct ntsc_thread
+{
+   uint32_t *out;
+   const void *in;
+   size_t out_stride;
+   size_t in_stride;
+   unsigned width;
+   unsigned first;
+   unsigned last;
+   unsigned phase;
+
+   // Composite signal of one line.
+   int *signal;
+};
+
+struct ntsc
+{
+   struct ntsc_thread threads[NTSC_MAX_THREADS];
+   unsigned num_threads;
+   unsigned in_fmt;
+   unsigned frame;
+};
+
+static unsigned ntsc_input_formats(void)
+{
+   return SOFTFILTER_FMT_RGB565 | SOFTFILTER_FMT_XRGB8888;
+}
+
+static unsigned ntsc_output_formats(unsigned input_format)
+{
+   (void)input_format;
+   return SOFTFILTER_FMT_XRGB8888;
+}
+
+static void ntsc_destroy(void *data)
+{
+   unsigned i;
+   struct ntsc *filt = (struct ntsc*)data;
+   if (!filt)
+      return;
+
+   for (i = 0; i < NTSC_MAX_THREADS; i++)
+      free(filt->threads[i].signal);
+   free(filt);
+}
+
+static void *ntsc_create(unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd)
+{
+   unsigned i;
+   struct ntsc *filt;
+   (void)simd;
+
+   if (out_fmt != SOFTFILTER_FMT_XRGB8888)
+      return NULL;
+
+   filt = (struct ntsc*)calloc(1, sizeof(*filt));
+   if (!filt)
+      return NULL;
+
+   filt->in_fmt      = in_fmt;
+   filt->num_threads = threads;
+   if (filt->num_threads > NTSC_MAX_THREADS)
+      filt->num_threads = NTSC_MAX_THREADS;
+   if (filt->num_threads > max_height)
+      filt->num_threads = max_height;
+   if (!filt->num_threads)
+      filt->num_threads = 1;
+
+   for (i = 0; i < filt->num_threads; i++)
+   {
+      filt->threads[i].signal = (int*)malloc((2 * max_width + 2 * NTSC_BORDER) * sizeof(int));
+      if (!filt->threads[i].signal)
+      {
+         ntsc_destroy(filt);
+         return NULL;
+      }
+   }
+
+   return filt;
+}
+
+static unsigned ntsc_threads(void *data)
+{
+   return ((struct ntsc*)data)->num_threads;
+}
+
+static void ntsc_output_size(void *data, unsigned *out_width, unsigned *out_height,
+      unsigned width, unsigned height)
+{
+   (void)data;
+   *out_width  = width * 2;
+   *out_height = height;
+}
+
+// Subcarrier at four samples per cycle.
+static const int ntsc_cos[4] = { 1, 0, -1, 0 };
+static const int ntsc_sin[4] = { 0, 1, 0, -1 };
+
+static inline uint32_t ntsc_load(const void *line, unsigned x, unsigned in_fmt)
+{
+   if (in_fmt == SOFTFILTER_FMT_RGB565)
+   {
+      uint32_t col = ((const uint16_t*)line)[x];
+      uint32_t r = (col >> 11) & 0x1f;
+      uint32_t g = (col >>  5) & 0x3f;
+      uint32_t b = (col >>  0) & 0x1f;
+      r = (r << 3) | (r >> 2);
+      g = (g << 2) | (g >> 4);
+      b = (b << 3) | (b >> 2);
+      return (r << 16) | (g << 8) | b;
+   }
+   return ((const uint32_t*)line)[x];
+}
+
+static inline uint32_t ntsc_clamp(int val)
+{
+   return val < 0 ? 0 : (val > 255 ? 255 : val);
+}
+
+static void ntsc_line(const struct ntsc_thread *thr, const void *line, uint32_t *out,
+      unsigned phase, unsigned in_fmt)
+{
+   int x;
+   int samples = 2 * thr->width;
+   int *signal = thr->signal + NTSC_BORDER;
+
+   // Encode. Samples past the line edges repeat the edge pixel, with the carrier running on.
+   for (x = -NTSC_BORDER; x < samples + NTSC_BORDER; x++)
+   {
+      int px = x < 0 ? 0 : (x >= samples ? samples - 1 : x);
+      uint32_t col = ntsc_load(line, px >> 1, in_fmt);
+      int r = (col >> 16) & 0xff;
+      int g = (col >>  8) & 0xff;
+      int b = (col >>  0) & 0xff;
+
+      // YIQ, fixed point with 8 fractional bits.
+      int y = 77 * r + 150 * g + 29 * b;
+      int i = 153 * r - 70 * g - 82 * b;
+      int q = 54 * r - 134 * g + 80 * b;
+      unsigned p = (x + phase) & 3;
+      signal[x] = y + ntsc_cos[p] * i + ntsc_sin[p] * q;
+   }
+
+   // Decode. Luma with [1 2 2 2 1] / 8, chroma with [1 2 3 4 3 2 1] / 16,
+   // both cancel the subcarrier on flat colors.
+   for (x = 0; x < samples; x++)
+   {
+      int k;
+      int y = (signal[x - 2] + 2 * (signal[x - 1] + signal[x] + signal[x + 1]) + signal[x + 2]) >> 3;
+      int i = 0, q = 0;
+      static const int chroma_taps[7] = { 1, 2, 3, 4, 3, 2, 1 };
+
+      for (k = -3; k <= 3; k++)
+      {
+         unsigned p = (x + k + phase) & 3;
+         i += chroma_taps[k + 3] * ntsc_cos[p] * signal[x + k];
+         q += chroma_taps[k + 3] * ntsc_sin[p] * signal[x + k];
+      }
+      // Demodulation picks up half the amplitude.
+      i >>= 3;
+      q >>= 3;
+
+      out[x] = (ntsc_clamp((y + ((245 * i + 159 * q) >> 8) + 128) >> 8) << 16) |
+         (ntsc_clamp((y - ((70 * i + 166 * q) >> 8) + 128) >> 8) << 8) |
+         (ntsc_clamp((y + ((-283 * i + 436 * q) >> 8) + 128) >> 8) << 0);
+   }
+}
+
+static void ntsc_work_rgb565(void *data, void *thread_data)
+{
+   unsigned y;
+   const struct ntsc_thread *thr = (const struct ntsc_thread*)thread_data;
+   (void)data;
+
+   for (y = thr->first; y < thr->last; y++)
+      ntsc_line(thr, (const uint8_t*)thr->in + y * thr->in_stride,
+            (uint32_t*)((uint8_t*)thr->out + y * thr->out_stride),
+            thr->phase + 2 * y, SOFTFILTER_FMT_RGB565);
+}
+
+static void ntsc_work_xrgb8888(void *data, void *thread_data)
+{
+   unsigned y;
+   const struct ntsc_thread *thr = (const struct ntsc_thread*)thread_data;
+   (void)data;
+
+   for (y = thr->first; y < thr->last; y++)
+      ntsc_line(thr, (const uint8_t*)thr->in + y * thr->in_stride,
+            (uint32_t*)((uint8_t*)thr->out + y * thr->out_stride),
+            thr->phase + 2 * y, SOFTFILTER_FMT_XRGB8888);
+}
+
+static void ntsc_packets(void *data, struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   unsigned i;
+   struct ntsc *filt = (struct ntsc*)data;
+
+   for (i = 0; i < filt->num_threads; i++)
+   {
+      struct ntsc_thread *thr = &filt->threads[i];
+      thr->out        = (uint32_t*)output;
+      thr->in         = input;
+      thr->out_stride = output_stride;
+      thr->in_stride  = input_stride;
+      thr->width      = width;
+      thr->first      = height * i / filt->num_threads;
+      thr->last       = height * (i + 1) / filt->num_threads;
+      thr->phase      = 2 * (filt->frame & 1);
+
+      packets[i].work = filt->in_fmt == SOFTFILTER_FMT_RGB565 ?
+         ntsc_work_rgb565 : ntsc_work_xrgb8888;
+      packets[i].thread_data = thr;
+   }
+
+   filt->frame++;
+}
+
+static const struct softfilter_implementation ntsc_impl = {
+   ntsc_input_formats,
+   ntsc_output_formats,
+
+   ntsc_create,
+   ntsc_destroy,
+
+   ntsc_threads,
+   ntsc_output_size,
+   ntsc_packets,
+
+   "ntsc",
+   SOFTFILTER_API_VERSION,
+};
+
+const struct softfilter_implementation *softfilter_get_implementation_ntsc(softfilter_simd_mask_t simd)
+{
+   (void)simd;
+   return &ntsc_impl;
+}
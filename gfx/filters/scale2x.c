@@ -0,0 +1,190 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Scale2x (AdvMAME2x), edge-directed 2x scaling without blending.
+
+#include "softfilter.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define SCALE2X_MAX_THREADS 16
+
+struct scale2x_thread
+{
+   void *out;
+   const void *in;
+   size_t out_stride;
+   size_t in_stride;
+   unsigned width;
+   unsigned height;
+   unsigned first;
+   unsigned last;
+};
+
+struct scale2x
+{
+   struct scale2x_thread threads[SCALE2X_MAX_THREADS];
+   unsigned num_threads;
+   unsigned in_fmt;
+};
+
+static unsigned scale2x_input_formats(void)
+{
+   return SOFTFILTER_FMT_RGB565 | SOFTFILTER_FMT_XRGB8888;
+}
+
+static unsigned scale2x_output_formats(unsigned input_format)
+{
+   return input_format;
+}
+
+static void *scale2x_create(unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd)
+{
+   struct scale2x *filt;
+   (void)max_width;
+   (void)simd;
+
+   if (in_fmt != out_fmt)
+      return NULL;
+
+   filt = (struct scale2x*)calloc(1, sizeof(*filt));
+   if (!filt)
+      return NULL;
+
+   filt->in_fmt      = in_fmt;
+   filt->num_threads = threads;
+   if (filt->num_threads > SCALE2X_MAX_THREADS)
+      filt->num_threads = SCALE2X_MAX_THREADS;
+   if (filt->num_threads > max_height)
+      filt->num_threads = max_height;
+   if (!filt->num_threads)
+      filt->num_threads = 1;
+   return filt;
+}
+
+static void scale2x_destroy(void *data)
+{
+   free(data);
+}
+
+static unsigned scale2x_threads(void *data)
+{
+   return ((struct scale2x*)data)->num_threads;
+}
+
+static void scale2x_output_size(void *data, unsigned *out_width, unsigned *out_height,
+      unsigned width, unsigned height)
+{
+   (void)data;
+   *out_width  = width * 2;
+   *out_height = height * 2;
+}
+
+//  A B C
+//  D E F  ->  E0 E1
+//  G H I      E2 E3
+// Neighbours outside the frame are clamped to its edge.
+#define SCALE2X_LINES(type) \
+   unsigned x, y; \
+   for (y = thr->first; y < thr->last; y++) \
+   { \
+      const type *src = (const type*)((const uint8_t*)thr->in + y * thr->in_stride); \
+      const type *up  = y > 0 ? (const type*)((const uint8_t*)src - thr->in_stride) : src; \
+      const type *down = y + 1 < thr->height ? (const type*)((const uint8_t*)src + thr->in_stride) : src; \
+      type *out0 = (type*)((uint8_t*)thr->out + 2 * y * thr->out_stride); \
+      type *out1 = (type*)((uint8_t*)out0 + thr->out_stride); \
+      for (x = 0; x < thr->width; x++) \
+      { \
+         unsigned left = x ? x - 1 : x; \
+         unsigned right = x + 1 < thr->width ? x + 1 : x; \
+         type B = up[x], D = src[left], E = src[x], F = src[right], H = down[x]; \
+         if (B != H && D != F) \
+         { \
+            out0[2 * x + 0] = D == B ? D : E; \
+            out0[2 * x + 1] = B == F ? F : E; \
+            out1[2 * x + 0] = D == H ? D : E; \
+            out1[2 * x + 1] = H == F ? F : E; \
+         } \
+         else \
+         { \
+            out0[2 * x + 0] = E; \
+            out0[2 * x + 1] = E; \
+            out1[2 * x + 0] = E; \
+            out1[2 * x + 1] = E; \
+         } \
+      } \
+   }
+
+static void scale2x_work_rgb565(void *data, void *thread_data)
+{
+   const struct scale2x_thread *thr = (const struct scale2x_thread*)thread_data;
+   (void)data;
+   SCALE2X_LINES(uint16_t)
+}
+
+static void scale2x_work_xrgb8888(void *data, void *thread_data)
+{
+   const struct scale2x_thread *thr = (const struct scale2x_thread*)thread_data;
+   (void)data;
+   SCALE2X_LINES(uint32_t)
+}
+
+static void scale2x_packets(void *data, struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   unsigned i;
+   struct scale2x *filt = (struct scale2x*)data;
+
+   for (i = 0; i < filt->num_threads; i++)
+   {
+      struct scale2x_thread *thr = &filt->threads[i];
+      thr->out        = output;
+      thr->in         = input;
+      thr->out_stride = output_stride;
+      thr->in_stride  = input_stride;
+      thr->width      = width;
+      thr->height     = height;
+      thr->first      = height * i / filt->num_threads;
+      thr->last       = height * (i + 1) / filt->num_threads;
+
+      packets[i].work = filt->in_fmt == SOFTFILTER_FMT_RGB565 ?
+         scale2x_work_rgb565 : scale2x_work_xrgb8888;
+      packets[i].thread_data = thr;
+   }
+}
+
+static const struct softfilter_implementation scale2x_impl = {
+   scale2x_input_formats,
+   scale2x_output_formats,
+
+   scale2x_create,
+   scale2x_destroy,
+
+   scale2x_threads,
+   scale2x_output_size,
+   scale2x_packets,
+
+   "scale2x",
+   SOFTFILTER_API_VERSION,
+};
+
+const struct softfilter_implementation *softfilter_get_implementation_scale2x(softfilter_simd_mask_t simd)
+{
+   (void)simd;
+   return &scale2x_impl;
+}
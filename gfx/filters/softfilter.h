@@ -0,0 +1,108 @@
+/////
+// API header for RetroArch software video filter plugins (softfilters).
+//
+// Filters take frames in the core's own pixel format (RGB565 or XRGB8888),
+// and split every frame into work packets which RetroArch runs on its filter threads.
+//
+
+#ifndef __RARCH_SOFTFILTER_API_H
+#define __RARCH_SOFTFILTER_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef _WIN32
+#ifdef RARCH_DLL_IMPORT
+#define SOFTFILTER_API_EXPORT __declspec(dllimport)
+#else
+#define SOFTFILTER_API_EXPORT __declspec(dllexport)
+#endif
+#define SOFTFILTER_API_CALLTYPE __cdecl
+#else
+#define SOFTFILTER_API_EXPORT
+#define SOFTFILTER_API_CALLTYPE
+#endif
+
+#define SOFTFILTER_API_VERSION 1
+
+// Pixel formats, as bits of a mask.
+#define SOFTFILTER_FMT_NONE     0
+#define SOFTFILTER_FMT_RGB565   (1 << 0)
+#define SOFTFILTER_FMT_XRGB8888 (1 << 1)
+
+// Same bits as RETRO_SIMD_* in libretro.h.
+typedef unsigned softfilter_simd_mask_t;
+
+// A part of a frame, usually a range of lines.
+// Packets of one frame run in parallel, and must not write to the same output.
+typedef void (*softfilter_work_t)(void *data, void *thread_data);
+
+struct softfilter_work_packet
+{
+   softfilter_work_t work;
+   void *thread_data;
+};
+
+// Input formats the filter accepts.
+typedef unsigned (*softfilter_query_input_formats_t)(void);
+
+// Output formats the filter can produce from the given input format.
+typedef unsigned (*softfilter_query_output_formats_t)(unsigned input_format);
+
+// Creates a filter instance for frames of at most max_width x max_height.
+// threads is the number of threads RetroArch can run packets on, the filter may use fewer.
+// Returns NULL if failed.
+typedef void *(*softfilter_create_t)(unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd);
+
+typedef void (*softfilter_destroy_t)(void *data);
+
+// Number of packets get_work_packets() fills in for every frame.
+typedef unsigned (*softfilter_query_num_threads_t)(void *data);
+
+typedef void (*softfilter_query_output_size_t)(void *data,
+      unsigned *out_width, unsigned *out_height,
+      unsigned width, unsigned height);
+
+// Fills in the packets for a frame. Strides are in bytes.
+// Nothing is filtered until RetroArch runs the packets.
+typedef void (*softfilter_get_work_packets_t)(void *data,
+      struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride);
+
+struct softfilter_implementation
+{
+   softfilter_query_input_formats_t query_input_formats;
+   softfilter_query_output_formats_t query_output_formats;
+
+   softfilter_create_t create;
+   softfilter_destroy_t destroy;
+
+   softfilter_query_num_threads_t query_num_threads;
+   softfilter_query_output_size_t query_output_size;
+   softfilter_get_work_packets_t get_work_packets;
+
+   // Human readable identification string. Built-in filters are selected by it.
+   const char *ident;
+
+   // Must be set to SOFTFILTER_API_VERSION on compile.
+   unsigned api_version;
+};
+
+typedef const struct softfilter_implementation *(SOFTFILTER_API_CALLTYPE *softfilter_get_implementation_t)(softfilter_simd_mask_t simd);
+
+// Called by RetroArch when the plugin is loaded to get the callback struct.
+// This is NOT dynamically allocated!
+SOFTFILTER_API_EXPORT const struct softfilter_implementation * SOFTFILTER_API_CALLTYPE
+   softfilter_get_implementation(softfilter_simd_mask_t simd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
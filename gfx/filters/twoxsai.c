@@ -0,0 +1,289 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// 2xSaI by Derek Liauw Kie Fa (Kreed), interpolating 2x scaling.
+
+#include "softfilter.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define TWOXSAI_MAX_THREADS 16
+
+struct twoxsai_thread
+{
+   void *out;
+   const void *in;
+   size_t out_stride;
+   size_t in_stride;
+   unsigned width;
+   unsigned height;
+   unsigned first;
+   unsigned last;
+};
+
+struct twoxsai
+{
+   struct twoxsai_thread threads[TWOXSAI_MAX_THREADS];
+   unsigned num_threads;
+   unsigned in_fmt;
+};
+
+static unsigned twoxsai_input_formats(void)
+{
+   return SOFTFILTER_FMT_RGB565 | SOFTFILTER_FMT_XRGB8888;
+}
+
+static unsigned twoxsai_output_formats(unsigned input_format)
+{
+   return input_format;
+}
+
+static void *twoxsai_create(unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd)
+{
+   struct twoxsai *filt;
+   (void)max_width;
+   (void)simd;
+
+   if (in_fmt != out_fmt)
+      return NULL;
+
+   filt = (struct twoxsai*)calloc(1, sizeof(*filt));
+   if (!filt)
+      return NULL;
+
+   filt->in_fmt      = in_fmt;
+   filt->num_threads = threads;
+   if (filt->num_threads > TWOXSAI_MAX_THREADS)
+      filt->num_threads = TWOXSAI_MAX_THREADS;
+   if (filt->num_threads > max_height)
+      filt->num_threads = max_height;
+   if (!filt->num_threads)
+      filt->num_threads = 1;
+   return filt;
+}
+
+static void twoxsai_destroy(void *data)
+{
+   free(data);
+}
+
+static unsigned twoxsai_threads(void *data)
+{
+   return ((struct twoxsai*)data)->num_threads;
+}
+
+static void twoxsai_output_size(void *data, unsigned *out_width, unsigned *out_height,
+      unsigned width, unsigned height)
+{
+   (void)data;
+   *out_width  = width * 2;
+   *out_height = height * 2;
+}
+
+static inline int twoxsai_result(uint32_t A, uint32_t B, uint32_t C, uint32_t D)
+{
+   int x = 0, y = 0, r = 0;
+   if (A == C)
+      x++;
+   else if (B == C)
+      y++;
+   if (A == D)
+      x++;
+   else if (B == D)
+      y++;
+   if (x <= 1)
+      r++;
+   if (y <= 1)
+      r--;
+   return r;
+}
+
+// Averages of two and four pixels, by dropping the low bits of every channel first.
+#define TWOXSAI_INTERPOLATE(A, B) ((((A) & COLOR_MASK) >> 1) + (((B) & COLOR_MASK) >> 1) + ((A) & (B) & LOW_MASK))
+#define TWOXSAI_Q_INTERPOLATE(A, B, C, D) ((((A) & Q_COLOR_MASK) >> 2) + (((B) & Q_COLOR_MASK) >> 2) + \
+      (((C) & Q_COLOR_MASK) >> 2) + (((D) & Q_COLOR_MASK) >> 2) + \
+      (((((A) & Q_LOW_MASK) + ((B) & Q_LOW_MASK) + ((C) & Q_LOW_MASK) + ((D) & Q_LOW_MASK)) >> 2) & Q_LOW_MASK))
+
+//  I E F J
+//  G A B K  ->  A      product
+//  H C D L      product1 product2
+//  M N O P
+// Neighbours outside the frame are clamped to its edge.
+#define TWOXSAI_LINES(type) \
+   unsigned x, y; \
+   for (y = thr->first; y < thr->last; y++) \
+   { \
+      const uint8_t *in = (const uint8_t*)thr->in; \
+      const type *r0 = (const type*)(in + (y > 0 ? y - 1 : 0) * thr->in_stride); \
+      const type *r1 = (const type*)(in + y * thr->in_stride); \
+      const type *r2 = (const type*)(in + (y + 1 < thr->height ? y + 1 : y) * thr->in_stride); \
+      const type *r3 = (const type*)(in + (y + 2 < thr->height ? y + 2 : thr->height - 1) * thr->in_stride); \
+      type *out0 = (type*)((uint8_t*)thr->out + 2 * y * thr->out_stride); \
+      type *out1 = (type*)((uint8_t*)out0 + thr->out_stride); \
+      for (x = 0; x < thr->width; x++) \
+      { \
+         unsigned xl = x ? x - 1 : 0; \
+         unsigned xr = x + 1 < thr->width ? x + 1 : x; \
+         unsigned xrr = x + 2 < thr->width ? x + 2 : thr->width - 1; \
+         uint32_t I = r0[xl], E = r0[x], F = r0[xr], J = r0[xrr]; \
+         uint32_t G = r1[xl], A = r1[x], B = r1[xr], K = r1[xrr]; \
+         uint32_t H = r2[xl], C = r2[x], D = r2[xr], L = r2[xrr]; \
+         uint32_t M = r3[xl], N = r3[x], O = r3[xr]; \
+         uint32_t product, product1, product2; \
+         if (A == D && B != C) \
+         { \
+            if ((A == E && B == L) || (A == C && A == F && B != E && B == J)) \
+               product = A; \
+            else \
+               product = TWOXSAI_INTERPOLATE(A, B); \
+            if ((A == G && C == O) || (A == B && A == H && G != C && C == M)) \
+               product1 = A; \
+            else \
+               product1 = TWOXSAI_INTERPOLATE(A, C); \
+            product2 = A; \
+         } \
+         else if (B == C && A != D) \
+         { \
+            if ((B == F && A == H) || (B == E && B == D && A != F && A == I)) \
+               product = B; \
+            else \
+               product = TWOXSAI_INTERPOLATE(A, B); \
+            if ((C == H && A == F) || (C == G && C == D && A != H && A == I)) \
+               product1 = C; \
+            else \
+               product1 = TWOXSAI_INTERPOLATE(A, C); \
+            product2 = B; \
+         } \
+         else if (A == D && B == C) \
+         { \
+            if (A == B) \
+               product = product1 = product2 = A; \
+            else \
+            { \
+               int r = 0; \
+               product1 = TWOXSAI_INTERPOLATE(A, C); \
+               product  = TWOXSAI_INTERPOLATE(A, B); \
+               r += twoxsai_result(A, B, G, E); \
+               r += twoxsai_result(B, A, K, F); \
+               r += twoxsai_result(B, A, H, N); \
+               r += twoxsai_result(A, B, L, O); \
+               if (r > 0) \
+                  product2 = A; \
+               else if (r < 0) \
+                  product2 = B; \
+               else \
+                  product2 = TWOXSAI_Q_INTERPOLATE(A, B, C, D); \
+            } \
+         } \
+         else \
+         { \
+            product2 = TWOXSAI_Q_INTERPOLATE(A, B, C, D); \
+            if (A == C && A == F && B != E && B == J) \
+               product = A; \
+            else if (B == E && B == D && A != F && A == I) \
+               product = B; \
+            else \
+               product = TWOXSAI_INTERPOLATE(A, B); \
+            if (A == B && A == H && G != C && C == M) \
+               product1 = A; \
+            else if (C == G && C == D && A != H && A == I) \
+               product1 = C; \
+            else \
+               product1 = TWOXSAI_INTERPOLATE(A, C); \
+         } \
+         out0[2 * x + 0] = A; \
+         out0[2 * x + 1] = product; \
+         out1[2 * x + 0] = product1; \
+         out1[2 * x + 1] = product2; \
+      } \
+   }
+
+static void twoxsai_work_rgb565(void *data, void *thread_data)
+{
+   const struct twoxsai_thread *thr = (const struct twoxsai_thread*)thread_data;
+   (void)data;
+#define COLOR_MASK   0xf7deu
+#define LOW_MASK     0x0821u
+#define Q_COLOR_MASK 0xe79cu
+#define Q_LOW_MASK   0x1863u
+   TWOXSAI_LINES(uint16_t)
+#undef COLOR_MASK
+#undef LOW_MASK
+#undef Q_COLOR_MASK
+#undef Q_LOW_MASK
+}
+
+static void twoxsai_work_xrgb8888(void *data, void *thread_data)
+{
+   const struct twoxsai_thread *thr = (const struct twoxsai_thread*)thread_data;
+   (void)data;
+#define COLOR_MASK   0xfefefeu
+#define LOW_MASK     0x010101u
+#define Q_COLOR_MASK 0xfcfcfcu
+#define Q_LOW_MASK   0x030303u
+   TWOXSAI_LINES(uint32_t)
+#undef COLOR_MASK
+#undef LOW_MASK
+#undef Q_COLOR_MASK
+#undef Q_LOW_MASK
+}
+
+static void twoxsai_packets(void *data, struct softfilter_work_packet *packets,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   unsigned i;
+   struct twoxsai *filt = (struct twoxsai*)data;
+
+   for (i = 0; i < filt->num_threads; i++)
+   {
+      struct twoxsai_thread *thr = &filt->threads[i];
+      thr->out        = output;
+      thr->in         = input;
+      thr->out_stride = output_stride;
+      thr->in_stride  = input_stride;
+      thr->width      = width;
+      thr->height     = height;
+      thr->first      = height * i / filt->num_threads;
+      thr->last       = height * (i + 1) / filt->num_threads;
+
+      packets[i].work = filt->in_fmt == SOFTFILTER_FMT_RGB565 ?
+         twoxsai_work_rgb565 : twoxsai_work_xrgb8888;
+      packets[i].thread_data = thr;
+   }
+}
+
+static const struct softfilter_implementation twoxsai_impl = {
+   twoxsai_input_formats,
+   twoxsai_output_formats,
+
+   twoxsai_create,
+   twoxsai_destroy,
+
+   twoxsai_threads,
+   twoxsai_output_size,
+   twoxsai_packets,
+
+   "2xsai",
+   SOFTFILTER_API_VERSION,
+};
+
+const struct softfilter_implementation *softfilter_get_implementation_2xsai(softfilter_simd_mask_t simd)
+{
+   (void)simd;
+   return &twoxsai_impl;
+}
@@ -21,17 +21,21 @@
 #include "../../msvc/msvc_compat.h"
 #include "../../boolean.h"
 
+// All 256 characters are in the atlas, on a 16x16 grid.
 struct font_renderer
 {
    unsigned scale_factor;
-   uint8_t *bitmap_chars[256];
-   uint8_t *bitmap_alloc;
+   unsigned char_width, char_height;
+   struct font_atlas atlas;
 };
 
 static void char_to_texture(font_renderer_t *handle, uint8_t letter)
 {
    unsigned y, x, xo, yo;
-   handle->bitmap_chars[letter] = &handle->bitmap_alloc[letter * FONT_WIDTH * FONT_HEIGHT * handle->scale_factor * handle->scale_factor];
+   unsigned pitch = handle->atlas.width;
+   uint8_t *dst = handle->atlas.buffer +
+      (letter >> 4) * handle->char_height * pitch + (letter & 15) * handle->char_width;
+
    for (y = 0; y < FONT_HEIGHT; y++)
    {
       for (x = 0; x < FONT_WIDTH; x++)
@@ -42,12 +46,11 @@ static void char_to_texture(font_renderer_t *handle, uint8_t letter)
 
          for (xo = 0; xo < handle->scale_factor; xo++)
             for (yo = 0; yo < handle->scale_factor; yo++)
-               handle->bitmap_chars[letter][x * handle->scale_factor + xo + (y * handle->scale_factor + yo) * FONT_WIDTH * handle->scale_factor] = col;
+               dst[x * handle->scale_factor + xo + (y * handle->scale_factor + yo) * pitch] = col;
       }
    }
 }
 
-
 static void *font_renderer_init(const char *font_path, float font_size)
 {
    unsigned i;
@@ -59,9 +62,10 @@ static void *font_renderer_init(const char *font_path, float font_size)
    if (!handle->scale_factor)
       handle->scale_factor = 1;
 
-   handle->bitmap_alloc = (uint8_t*)malloc(FONT_WIDTH * FONT_HEIGHT * handle->scale_factor * handle->scale_factor * 256);
+   handle->char_width  = FONT_WIDTH * handle->scale_factor;
+   handle->char_height = FONT_HEIGHT * handle->scale_factor;
 
-   if (!handle->bitmap_alloc)
+   if (!font_atlas_init(&handle->atlas, 16 * handle->char_width, 16 * handle->char_height))
    {
       free(handle);
       return NULL;
@@ -73,63 +77,40 @@ static void *font_renderer_init(const char *font_path, float font_size)
    return handle;
 }
 
-static void font_renderer_msg(void *data, const char *msg, struct font_output_list *output) 
+static unsigned font_renderer_msg(void *data, const char *msg, struct font_output *output, unsigned max) 
 {
-   size_t i;
+   unsigned i;
    font_renderer_t *handle = (font_renderer_t*)data;
-   output->head = NULL;
-
-   struct font_output *cur = NULL;
-   size_t len = strlen(msg);
    int off_x = 0;
 
-   for (i = 0; i < len; i++)
+   for (i = 0; msg[i] && i < max; i++)
    {
-      struct font_output *tmp = (struct font_output*)calloc(1, sizeof(*tmp));
-      if (!tmp)
-         break;
-
-      tmp->output = handle->bitmap_chars[(unsigned) msg[i]];
-      tmp->width = FONT_WIDTH * handle->scale_factor;
-      tmp->height = FONT_HEIGHT * handle->scale_factor;
-      tmp->pitch = tmp->width;
-      tmp->advance_x = tmp->width;
-      tmp->advance_y = tmp->height;
-      tmp->char_off_x = 0;
-      tmp->char_off_y = tmp->height;
-      tmp->off_x = off_x;
-      tmp->off_y = 0;
-      tmp->next = NULL;
-
-      if (i == 0)
-         output->head = tmp;
-      else
-         cur->next = tmp;
-
-      cur = tmp;
+      unsigned letter = (uint8_t)msg[i];
+      struct font_output *out = &output[i];
+
+      out->atlas_x    = (letter & 15) * handle->char_width;
+      out->atlas_y    = (letter >> 4) * handle->char_height;
+      out->output     = handle->atlas.buffer + out->atlas_y * handle->atlas.width + out->atlas_x;
+      out->width      = handle->char_width;
+      out->height     = handle->char_height;
+      out->pitch      = handle->atlas.width;
+      out->advance_x  = out->width;
+      out->advance_y  = out->height;
+      out->char_off_x = 0;
+      out->char_off_y = out->height;
+      out->off_x      = off_x;
+      out->off_y      = 0;
 
       off_x += FONT_WIDTH_STRIDE * handle->scale_factor;
    }
-}
 
-static void font_renderer_free_output(void *data, struct font_output_list *output)
-{
-   (void)data;
-   struct font_output *itr = output->head;
-   struct font_output *tmp = NULL;
-   while (itr != NULL)
-   {
-      tmp = itr;
-      itr = itr->next;
-      free(tmp);
-   }
-   output->head = NULL;
+   return i;
 }
 
 static void font_renderer_free(void *data)
 {
    font_renderer_t *handle = (font_renderer_t*)data;
-   free(handle->bitmap_alloc);
+   font_atlas_free(&handle->atlas);
    free(handle);
 }
 
@@ -141,7 +122,6 @@ static const char *font_renderer_get_default_font(void)
 const font_renderer_driver_t bitmap_font_renderer = {
    font_renderer_init,
    font_renderer_msg,
-   font_renderer_free_output,
    font_renderer_free,
    font_renderer_get_default_font,
    "bitmap",
@@ -15,6 +15,8 @@
 
 #include "fonts.h"
 #include "../../general.h"
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef HAVE_CONFIG_H
 #include "../../config.h"
@@ -58,3 +60,145 @@ bool font_renderer_create_default(const font_renderer_driver_t **driver, void **
    return false;
 }
 
+
+struct font_skyline
+{
+   unsigned x, y, width;
+};
+
+void font_atlas_clear(struct font_atlas *atlas)
+{
+   memset(atlas->buffer, 0, atlas->width * atlas->height);
+   atlas->skyline[0].x     = 0;
+   atlas->skyline[0].y     = 0;
+   atlas->skyline[0].width = atlas->width;
+   atlas->skyline_count    = 1;
+}
+
+bool font_atlas_init(struct font_atlas *atlas, unsigned width, unsigned height)
+{
+   memset(atlas, 0, sizeof(*atlas));
+
+   // Nodes are at least one pixel wide, one more for while a glyph is being placed.
+   atlas->buffer  = (uint8_t*)calloc(width, height);
+   atlas->skyline = (struct font_skyline*)calloc(width + 1, sizeof(*atlas->skyline));
+   if (!atlas->buffer || !atlas->skyline)
+   {
+      font_atlas_free(atlas);
+      return false;
+   }
+
+   atlas->width  = width;
+   atlas->height = height;
+   font_atlas_clear(atlas);
+   return true;
+}
+
+void font_atlas_free(struct font_atlas *atlas)
+{
+   free(atlas->buffer);
+   free(atlas->skyline);
+   memset(atlas, 0, sizeof(*atlas));
+}
+
+bool font_atlas_grow(struct font_atlas *atlas, unsigned max_height)
+{
+   uint8_t *buffer;
+   unsigned height = atlas->height * 2;
+   if (height > max_height)
+      return false;
+
+   buffer = (uint8_t*)realloc(atlas->buffer, atlas->width * height);
+   if (!buffer)
+      return false;
+
+   memset(buffer + atlas->width * atlas->height, 0, atlas->width * (height - atlas->height));
+   atlas->buffer = buffer;
+   atlas->height = height;
+   return true;
+}
+
+// Returns the y a glyph would land on if placed at the start of node i, or -1 if it doesn't fit there.
+static int font_atlas_fit(const struct font_atlas *atlas, unsigned i, unsigned width, unsigned height)
+{
+   unsigned y = 0;
+   int left = width;
+
+   if (atlas->skyline[i].x + width > atlas->width)
+      return -1;
+
+   // The nodes cover the whole width, so this stays in bounds.
+   for (; left > 0; i++)
+   {
+      if (atlas->skyline[i].y > y)
+         y = atlas->skyline[i].y;
+      if (y + height > atlas->height)
+         return -1;
+      left -= atlas->skyline[i].width;
+   }
+
+   return y;
+}
+
+bool font_atlas_pack(struct font_atlas *atlas, unsigned width, unsigned height,
+      unsigned *x, unsigned *y)
+{
+   unsigned i, end;
+   int best = -1, best_y = 0;
+   struct font_skyline *skyline = atlas->skyline;
+
+   width++;
+   height++;
+
+   for (i = 0; i < atlas->skyline_count; i++)
+   {
+      int fit_y = font_atlas_fit(atlas, i, width, height);
+      if (fit_y >= 0 && (best < 0 || fit_y < best_y ||
+               (fit_y == best_y && skyline[i].width < skyline[best].width)))
+      {
+         best   = i;
+         best_y = fit_y;
+      }
+   }
+
+   if (best < 0)
+      return false;
+
+   *x = skyline[best].x;
+   *y = best_y;
+
+   // The glyph becomes a new node, the nodes it covers are cut back or removed.
+   memmove(&skyline[best + 1], &skyline[best], (atlas->skyline_count - best) * sizeof(*skyline));
+   skyline[best].y     = best_y + height;
+   skyline[best].width = width;
+   atlas->skyline_count++;
+
+   end = skyline[best].x + width;
+   for (i = best + 1; i < atlas->skyline_count && skyline[i].x < end; )
+   {
+      unsigned covered = end - skyline[i].x;
+      if (covered < skyline[i].width)
+      {
+         skyline[i].x     += covered;
+         skyline[i].width -= covered;
+         break;
+      }
+
+      memmove(&skyline[i], &skyline[i + 1], (atlas->skyline_count - i - 1) * sizeof(*skyline));
+      atlas->skyline_count--;
+   }
+
+   for (i = 0; i + 1 < atlas->skyline_count; )
+   {
+      if (skyline[i].y == skyline[i + 1].y)
+      {
+         skyline[i].width += skyline[i + 1].width;
+         memmove(&skyline[i + 1], &skyline[i + 2], (atlas->skyline_count - i - 2) * sizeof(*skyline));
+         atlas->skyline_count--;
+      }
+      else
+         i++;
+   }
+
+   return true;
+}
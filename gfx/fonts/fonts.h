@@ -22,32 +22,51 @@
 
 typedef struct font_renderer font_renderer_t;
 
+// Glyphs are rasterized once into an atlas owned by the renderer.
+struct font_atlas
+{
+   uint8_t *buffer; // 8-bit alpha, width bytes per line.
+   unsigned width, height;
+
+   // Skyline of the packed glyphs, private to the packer.
+   struct font_skyline *skyline;
+   unsigned skyline_count;
+};
+
 struct font_output
 {
-   uint8_t *output; // 8-bit alpha.
+   const uint8_t *output; // 8-bit alpha, points into the atlas.
    unsigned width, height, pitch;
-   unsigned color;
-   unsigned scaling_factor;
+   unsigned atlas_x, atlas_y; // Where output is in the atlas.
    int off_x, off_y;
    int advance_x, advance_y, char_off_x, char_off_y; // for advanced font rendering
-   struct font_output *next; // linked list.
 };
 
-struct font_output_list
-{
-   struct font_output *head;
-};
+// Messages longer than this are cut off.
+#define FONT_MAX_GLYPHS 256
 
 typedef struct font_renderer_driver
 {
    void *(*init)(const char *font_path, float font_size);
-   void (*render_msg)(void *data, const char *msg, struct font_output_list *output);
-   void (*free_output)(void *data, struct font_output_list *list);
+   // Lays out msg into a caller-owned array of at most max glyphs, returns how many were written.
+   // The glyphs stay valid until the next call.
+   unsigned (*render_msg)(void *data, const char *msg, struct font_output *output, unsigned max);
    void (*free)(void *data);
    const char *(*get_default_font)(void);
    const char *ident;
 } font_renderer_driver_t;
 
+bool font_atlas_init(struct font_atlas *atlas, unsigned width, unsigned height);
+void font_atlas_free(struct font_atlas *atlas);
+// Evicts every glyph.
+void font_atlas_clear(struct font_atlas *atlas);
+// Doubles the atlas height, glyphs keep their place. Fails past max_height.
+bool font_atlas_grow(struct font_atlas *atlas, unsigned max_height);
+// Finds room for a width x height glyph along the skyline, as close to the top as possible.
+// A line of padding is kept to the right and below, so filtered sampling doesn't bleed.
+bool font_atlas_pack(struct font_atlas *atlas, unsigned width, unsigned height,
+      unsigned *x, unsigned *y);
+
 extern const font_renderer_driver_t ft_font_renderer;
 extern const font_renderer_driver_t bitmap_font_renderer;
 
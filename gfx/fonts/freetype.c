@@ -22,10 +22,30 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+// The atlas fits about 8 glyphs to a line. It starts square and grows in height,
+// it is flushed once that is used up.
+#define FT_ATLAS_MIN_SIZE 256
+#define FT_ATLAS_GLYPHS_PER_LINE 8
+#define FT_ATLAS_MAX_LINES 64
+
+struct ft_glyph
+{
+   bool loaded;
+   bool valid;
+   unsigned atlas_x, atlas_y;
+   unsigned width, height;
+   int advance_x, advance_y;
+   int left, top;
+};
+
 struct font_renderer
 {
    FT_Library lib;
    FT_Face face;
+
+   struct font_atlas atlas;
+   unsigned atlas_max_height;
+   struct ft_glyph glyphs[256];
 };
 
 static void ft_renderer_free(void *data)
@@ -38,12 +58,13 @@ static void ft_renderer_free(void *data)
       FT_Done_Face(handle->face);
    if (handle->lib)
       FT_Done_FreeType(handle->lib);
+   font_atlas_free(&handle->atlas);
    free(handle);
 }
 
 static void *ft_renderer_init(const char *font_path, float font_size)
 {
-   (void)font_size;
+   unsigned size;
    FT_Error err;
    font_renderer_t *handle = (font_renderer_t*)calloc(1, sizeof(*handle));
    if (!handle)
@@ -61,6 +82,13 @@ static void *ft_renderer_init(const char *font_path, float font_size)
    if (err)
       goto error;
 
+   size = FT_ATLAS_MIN_SIZE;
+   while (size < font_size * FT_ATLAS_GLYPHS_PER_LINE)
+      size *= 2;
+   handle->atlas_max_height = font_size * FT_ATLAS_MAX_LINES;
+   if (!font_atlas_init(&handle->atlas, size, size))
+      goto error;
+
    return handle;
 
 error:
@@ -68,74 +96,111 @@ error:
    return NULL;
 }
 
-static void ft_renderer_msg(void *data, const char *msg, struct font_output_list *output) 
+// Rasterizes a glyph into the atlas. Returns false if the atlas is full.
+static bool ft_renderer_load_glyph(font_renderer_t *handle, unsigned code)
 {
-   size_t i;
-   font_renderer_t *handle = (font_renderer_t*)data;
-   output->head = NULL;
-
+   int r;
+   unsigned x = 0, y = 0;
+   struct ft_glyph *glyph = &handle->glyphs[code];
    FT_GlyphSlot slot = handle->face->glyph;
-   struct font_output *cur = NULL;
-   size_t len = strlen(msg);
-   int off_x = 0, off_y = 0;
 
-   for (i = 0; i < len; i++)
+   if (FT_Load_Char(handle->face, code, FT_LOAD_RENDER))
    {
-      FT_Error err = FT_Load_Char(handle->face, msg[i], FT_LOAD_RENDER);
+      // Don't try again for every message.
+      glyph->loaded = true;
+      glyph->valid  = false;
+      return true;
+   }
 
-      if (!err)
+   if (slot->bitmap.width && slot->bitmap.rows)
+   {
+      while (!font_atlas_pack(&handle->atlas, slot->bitmap.width, slot->bitmap.rows, &x, &y))
       {
-         struct font_output *tmp = (struct font_output*)calloc(1, sizeof(*tmp));
-         if (!tmp)
-            break;
-
-         tmp->output = (uint8_t*)malloc(slot->bitmap.pitch * slot->bitmap.rows);
-         if (!tmp->output)
-         {
-            free(tmp);
-            break;
-         }
-
-         memcpy(tmp->output, slot->bitmap.buffer, slot->bitmap.pitch * slot->bitmap.rows);
-
-         tmp->width = slot->bitmap.width;
-         tmp->height = slot->bitmap.rows;
-         tmp->pitch = slot->bitmap.pitch;
-         tmp->advance_x = slot->advance.x >> 6;
-         tmp->advance_y = slot->advance.y >> 6;
-         tmp->char_off_x = slot->bitmap_left;
-         tmp->char_off_y = slot->bitmap_top - slot->bitmap.rows;
-         tmp->off_x = off_x + tmp->char_off_x;
-         tmp->off_y = off_y + tmp->char_off_y;
-         tmp->next = NULL;
-
-         if (i == 0)
-            output->head = tmp;
-         else
-            cur->next = tmp;
-
-         cur = tmp;
+         if (!font_atlas_grow(&handle->atlas, handle->atlas_max_height))
+            return false;
       }
 
-      off_x += slot->advance.x >> 6;
-      off_y += slot->advance.y >> 6;
+      for (r = 0; r < slot->bitmap.rows; r++)
+      {
+         memcpy(handle->atlas.buffer + (y + r) * handle->atlas.width + x,
+               slot->bitmap.buffer + r * slot->bitmap.pitch, slot->bitmap.width);
+      }
    }
+
+   glyph->loaded    = true;
+   glyph->valid     = true;
+   glyph->atlas_x   = x;
+   glyph->atlas_y   = y;
+   glyph->width     = slot->bitmap.width;
+   glyph->height    = slot->bitmap.rows;
+   glyph->advance_x = slot->advance.x >> 6;
+   glyph->advance_y = slot->advance.y >> 6;
+   glyph->left      = slot->bitmap_left;
+   glyph->top       = slot->bitmap_top;
+   return true;
+}
+
+static void ft_renderer_evict(font_renderer_t *handle)
+{
+   memset(handle->glyphs, 0, sizeof(handle->glyphs));
+   font_atlas_clear(&handle->atlas);
 }
 
-static void ft_renderer_free_output(void *data, struct font_output_list *output)
+static unsigned ft_renderer_msg(void *data, const char *msg, struct font_output *output, unsigned max) 
 {
-   (void)data;
+   size_t i;
+   unsigned count;
+   int off_x, off_y;
+   bool evicted = false;
+   font_renderer_t *handle = (font_renderer_t*)data;
+
+restart:
+   count = 0;
+   off_x = 0;
+   off_y = 0;
+
+   for (i = 0; msg[i] && count < max; i++)
+   {
+      unsigned code = (uint8_t)msg[i];
+      const struct ft_glyph *glyph = &handle->glyphs[code];
+
+      if (!glyph->loaded && !ft_renderer_load_glyph(handle, code))
+      {
+         // The atlas is full of glyphs from older messages, start over with an empty one.
+         if (evicted)
+            continue;
+         ft_renderer_evict(handle);
+         evicted = true;
+         goto restart;
+      }
+
+      if (glyph->valid)
+      {
+         struct font_output *out = &output[count++];
+         out->width      = glyph->width;
+         out->height     = glyph->height;
+         out->atlas_x    = glyph->atlas_x;
+         out->atlas_y    = glyph->atlas_y;
+         out->advance_x  = glyph->advance_x;
+         out->advance_y  = glyph->advance_y;
+         out->char_off_x = glyph->left;
+         out->char_off_y = glyph->top - (int)glyph->height;
+         out->off_x      = off_x + out->char_off_x;
+         out->off_y      = off_y + out->char_off_y;
+      }
+
+      off_x += glyph->advance_x;
+      off_y += glyph->advance_y;
+   }
 
-   struct font_output *itr = output->head;
-   struct font_output *tmp = NULL;
-   while (itr != NULL)
+   // Growing the atlas moves it, so only point into it once everything is loaded.
+   for (i = 0; i < count; i++)
    {
-      free(itr->output);
-      tmp = itr;
-      itr = itr->next;
-      free(tmp);
+      output[i].output = handle->atlas.buffer + output[i].atlas_y * handle->atlas.width + output[i].atlas_x;
+      output[i].pitch  = handle->atlas.width;
    }
-   output->head = NULL;
+
+   return count;
 }
 
 // Not the cleanest way to do things for sure, but should hopefully work ... :)
@@ -173,7 +238,6 @@ static const char *ft_renderer_get_default_font(void)
 const font_renderer_driver_t ft_font_renderer = {
    ft_renderer_init,
    ft_renderer_msg,
-   ft_renderer_free_output,
    ft_renderer_free,
    ft_renderer_get_default_font,
    "freetype",
@@ -92,15 +92,17 @@ struct font_rect
    int pot_width, pot_height;
 };
 
-static void calculate_msg_geometry(const struct font_output *head, struct font_rect *rect)
+static void calculate_msg_geometry(const struct font_output *glyphs, unsigned num_glyphs, struct font_rect *rect)
 {
-   int x_min = head->off_x;
-   int x_max = head->off_x + head->width;
-   int y_min = head->off_y;
-   int y_max = head->off_y + head->height;
+   unsigned i;
+   int x_min = glyphs[0].off_x;
+   int x_max = glyphs[0].off_x + glyphs[0].width;
+   int y_min = glyphs[0].off_y;
+   int y_max = glyphs[0].off_y + glyphs[0].height;
 
-   while ((head = head->next))
+   for (i = 1; i < num_glyphs; i++)
    {
+      const struct font_output *head = &glyphs[i];
       int left = head->off_x;
       int right = head->off_x + head->width;
       int bottom = head->off_y;
@@ -193,15 +195,13 @@ static void copy_glyph(const struct font_output *head, const struct font_rect *g
 
 // Old style "blitting", so we can render all the fonts in one go.
 // TODO: Is it possible that fonts could overlap if we blit without alpha blending?
-static void blit_fonts(gl_t *gl, const struct font_output *head, const struct font_rect *geom)
+static void blit_fonts(gl_t *gl, const struct font_output *glyphs, unsigned num_glyphs, const struct font_rect *geom)
 {
+   unsigned i;
    memset(gl->font_tex_buf, 0, gl->font_tex_w * gl->font_tex_h * sizeof(uint32_t));
 
-   while (head)
-   {
-      copy_glyph(head, geom, gl->font_tex_buf, gl->font_tex_w, gl->font_tex_h);
-      head = head->next;
-   }
+   for (i = 0; i < num_glyphs; i++)
+      copy_glyph(&glyphs[i], geom, gl->font_tex_buf, gl->font_tex_w, gl->font_tex_h);
 
    glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
    glTexSubImage2D(GL_TEXTURE_2D,
@@ -273,20 +273,22 @@ static void setup_font(void *data, const char *msg, GLfloat scale, GLfloat pos_x
 
    gl->coords.tex_coord = font_tex_coords;
 
-   struct font_output_list out;
-
    // If we get the same message, there's obviously no need to render fonts again ...
    if (strcmp(gl->font_last_msg, msg) != 0)
    {
-      gl->font_driver->render_msg(gl->font, msg, &out);
-      struct font_output *head = out.head;
+      // Glyphs come straight out of the renderer's atlas, nothing is rasterized or allocated here
+      // unless the message is larger than any before.
+      struct font_output glyphs[FONT_MAX_GLYPHS];
+      unsigned num_glyphs = gl->font_driver->render_msg(gl->font, msg, glyphs, FONT_MAX_GLYPHS);
 
-      struct font_rect geom;
-      calculate_msg_geometry(head, &geom);
-      adjust_power_of_two(gl, &geom);
-      blit_fonts(gl, head, &geom);
+      struct font_rect geom = {0};
+      if (num_glyphs)
+      {
+         calculate_msg_geometry(glyphs, num_glyphs, &geom);
+         adjust_power_of_two(gl, &geom);
+         blit_fonts(gl, glyphs, num_glyphs, &geom);
+      }
 
-      gl->font_driver->free_output(gl->font, &out);
       strlcpy(gl->font_last_msg, msg, sizeof(gl->font_last_msg));
 
       gl->font_last_width = geom.width;
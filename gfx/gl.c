@@ -21,6 +21,7 @@
 
 #include "../driver.h"
 #include "../performance.h"
+#include "../frame_trace.h"
 #include "scaler/scaler.h"
 #include "image/image.h"
 #include "../file.h"
@@ -1552,6 +1553,7 @@ static bool gl_frame(void *data, const void *frame, unsigned width, unsigned hei
    {
       RARCH_PERFORMANCE_INIT(gl_fence);
       RARCH_PERFORMANCE_START(gl_fence);
+      FRAME_TRACE_BEGIN(FRAME_TRACE_GPU_FENCE);
       glClear(GL_COLOR_BUFFER_BIT);
       gl->fences[gl->fence_count++] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
@@ -1564,6 +1566,7 @@ static bool gl_frame(void *data, const void *frame, unsigned width, unsigned hei
          memmove(gl->fences, gl->fences + 1, gl->fence_count * sizeof(GLsync));
       }
 
+      FRAME_TRACE_END(FRAME_TRACE_GPU_FENCE);
       RARCH_PERFORMANCE_STOP(gl_fence);
    }
 #endif
@@ -2552,6 +2555,17 @@ static void gl_overlay_set_alpha(void *data, unsigned image, float mod)
    gl->overlay[image].alpha_mod = mod;
 }
 
+static void gl_overlay_update(void *data, const struct video_overlay_update *updates, unsigned num_updates)
+{
+   unsigned i;
+   gl_t *gl = (gl_t*)data;
+   for (i = 0; i < num_updates; i++)
+   {
+      gl_overlay_vertex_geom(gl, updates[i].image, updates[i].x, updates[i].y, updates[i].w, updates[i].h);
+      gl->overlay[updates[i].image].alpha_mod = updates[i].alpha;
+   }
+}
+
 static void gl_render_overlay(void *data)
 {
    unsigned i, j;
@@ -2600,6 +2614,7 @@ static const video_overlay_interface_t gl_overlay_interface = {
    gl_overlay_vertex_geom,
    gl_overlay_full_screen,
    gl_overlay_set_alpha,
+   gl_overlay_update,
 };
 
 static void gl_get_overlay_interface(void *data, const video_overlay_interface_t **iface)
@@ -2670,6 +2685,9 @@ static void gl_set_texture_frame(void *data,
       glBindTexture(GL_TEXTURE_2D, gl->rgui_texture);
 
    gl->rgui_texture_alpha = alpha;
+   gl->rgui_texture_width = width;
+   gl->rgui_texture_height = height;
+   gl->rgui_texture_rgb32 = rgb32;
 
    unsigned base_size = rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
    glPixelStorei(GL_UNPACK_ALIGNMENT, get_alignment(width * base_size));
@@ -2692,6 +2710,47 @@ static void gl_set_texture_frame(void *data,
    glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
 }
 
+static void gl_set_texture_frame_rows(void *data,
+      const void *frame, bool rgb32, unsigned width, unsigned height,
+      unsigned first_row, unsigned rows, float alpha)
+{
+   gl_t *gl = (gl_t*)data;
+
+   if (!gl->rgui_texture || gl->rgui_texture_width != width ||
+         gl->rgui_texture_height != height || gl->rgui_texture_rgb32 != rgb32)
+   {
+      gl_set_texture_frame(gl, frame, rgb32, width, height, alpha);
+      return;
+   }
+
+   gl->rgui_texture_alpha = alpha;
+   if (!rows)
+      return;
+
+   // Rows are full width, so the changed ones are contiguous in frame.
+   unsigned base_size = rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
+   const uint8_t *src = (const uint8_t*)frame + first_row * width * base_size;
+
+   glBindTexture(GL_TEXTURE_2D, gl->rgui_texture);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, get_alignment(width * base_size));
+
+   if (rgb32)
+   {
+      glTexSubImage2D(GL_TEXTURE_2D,
+            0, 0, first_row, width, rows,
+            driver.gfx_use_rgba ? GL_RGBA : RARCH_GL_TEXTURE_TYPE32,
+            RARCH_GL_FORMAT32, src);
+   }
+   else
+   {
+      glTexSubImage2D(GL_TEXTURE_2D,
+            0, 0, first_row, width, rows, GL_RGBA,
+            GL_UNSIGNED_SHORT_4_4_4_4, src);
+   }
+
+   glBindTexture(GL_TEXTURE_2D, gl->texture[gl->tex_index]);
+}
+
 static void gl_set_texture_enable(void *data, bool state, bool full_screen)
 {
    gl_t *gl = (gl_t*)data;
@@ -2737,6 +2796,10 @@ static const video_poke_interface_t gl_poke_interface = {
    gl_set_osd_msg,
 
    gl_show_mouse,
+   NULL,
+#if defined(HAVE_MENU)
+   gl_set_texture_frame_rows,
+#endif
 };
 
 static void gl_get_poke_interface(void *data, const video_poke_interface_t **iface)
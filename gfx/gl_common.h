@@ -250,6 +250,9 @@ typedef struct gl
 
 #if defined(HAVE_MENU)
    GLuint rgui_texture;
+   unsigned rgui_texture_width;
+   unsigned rgui_texture_height;
+   bool rgui_texture_rgb32;
    bool rgui_texture_enable;
    bool rgui_texture_full_screen;
    GLfloat rgui_texture_alpha;
@@ -492,8 +492,8 @@ static void lima_init_font(lima_video_t *vid, const char *font_path, unsigned fo
 }
 
 static void lima_render_msg(lima_video_t *vid, const char *msg) {
-  struct font_output_list out;
-  struct font_output *head;
+  unsigned i, num_glyphs;
+  struct font_output glyphs[FONT_MAX_GLYPHS];
 
   unsigned req_size;
   limare_data_t *lima = vid->lima;
@@ -523,9 +523,10 @@ static void lima_render_msg(lima_video_t *vid, const char *msg) {
 
   memset(lima->buffer, 0, req_size);
 
-  vid->font_driver->render_msg(vid->font, msg, &out);
+  num_glyphs = vid->font_driver->render_msg(vid->font, msg, glyphs, FONT_MAX_GLYPHS);
 
-  for (head = out.head; head; head = head->next) {
+  for (i = 0; i < num_glyphs; i++) {
+    const struct font_output *head = &glyphs[i];
     int base_x = msg_base_x + head->off_x;
     int base_y = msg_base_y - head->off_y - head->height;
 
@@ -558,8 +559,6 @@ static void lima_render_msg(lima_video_t *vid, const char *msg) {
                        glyph_width, glyph_height,
                        head->pitch, base_x, base_y);
   }
-
-  vid->font_driver->free_output(vid->font, &out);
 }
 
 static void *lima_gfx_init(const video_info_t *video, const input_driver_t **input, void **input_data) {
@@ -22,6 +22,7 @@
 #include "gfx_common.h"
 #include "gfx_context.h"
 #include "fonts/fonts.h"
+#include "soft_overlay.h"
 
 #include <sys/ioctl.h>
 #include <sys/stat.h>
@@ -690,6 +691,10 @@ typedef struct omap_video {
   /* current dimensions */
   unsigned width;
   unsigned height;
+
+#ifdef HAVE_OVERLAY
+  soft_overlay_t *overlay;
+#endif
 } omap_video_t;
 
 
@@ -702,6 +707,10 @@ static void omap_gfx_free(void *data) {
 
   if (vid->font) vid->font_driver->free(vid->font);
 
+#ifdef HAVE_OVERLAY
+  soft_overlay_free(vid->overlay);
+#endif
+
   free(vid);
 }
 
@@ -726,16 +735,17 @@ static void omap_init_font(omap_video_t *vid, const char *font_path, unsigned fo
 }
 
 static void omap_render_msg(omap_video_t *vid, const char *msg) {
-  struct font_output_list out;
-  struct font_output *head;
+  unsigned i, num_glyphs;
+  struct font_output glyphs[FONT_MAX_GLYPHS];
 
   const int msg_base_x = g_settings.video.msg_pos_x * vid->width;
   const int msg_base_y = (1.0 - g_settings.video.msg_pos_y) * vid->height;
 
   if (vid->font == NULL) return;
-  vid->font_driver->render_msg(vid->font, msg, &out);
+  num_glyphs = vid->font_driver->render_msg(vid->font, msg, glyphs, FONT_MAX_GLYPHS);
 
-  for (head = out.head; head; head = head->next) {
+  for (i = 0; i < num_glyphs; i++) {
+    const struct font_output *head = &glyphs[i];
     int base_x = msg_base_x + head->off_x;
     int base_y = msg_base_y - head->off_y - head->height;
 
@@ -774,8 +784,6 @@ static void omap_render_msg(omap_video_t *vid, const char *msg) {
                                   head->pitch, base_x, base_y);
     }
   }
-
-  vid->font_driver->free_output(vid->font, &out);
 }
 
 static void *omap_gfx_init(const video_info_t *video, const input_driver_t **input, void **input_data) {
@@ -783,7 +791,7 @@ static void *omap_gfx_init(const video_info_t *video, const input_driver_t **inp
 
   /* Don't support filters at the moment since they make estimations  *
    * on the maximum used resolution difficult.                        */
-  if (g_extern.filter.active) {
+  if (g_extern.filter.filter) {
     RARCH_ERR("video_omap: filters are not supported\n");
     return NULL;
   }
@@ -810,6 +818,14 @@ static void *omap_gfx_init(const video_info_t *video, const input_driver_t **inp
 
   omap_init_font(vid, g_settings.video.font_path, g_settings.video.font_size);
 
+#ifdef HAVE_OVERLAY
+  vid->overlay = soft_overlay_new();
+  if (!vid->overlay) {
+    omap_gfx_free(vid);
+    return NULL;
+  }
+#endif
+
   return vid;
 
 fail_omapfb:
@@ -846,6 +862,13 @@ static bool omap_gfx_frame(void *data, const void *frame, unsigned width,
   omapfb_blit_frame(vid->omap, frame, vid->height, pitch);
   if (msg) omap_render_msg(vid, msg);
 
+#ifdef HAVE_OVERLAY
+  /* The plane is scaled to the screen, so overlays are drawn at the resolution of the core. */
+  soft_overlay_render(vid->overlay, vid->omap->cur_page->buf,
+                      vid->omap->current_state->si.xres * vid->omap->bpp, vid->omap->bpp,
+                      vid->width, vid->height, NULL);
+#endif
+
   g_extern.frame_count++;
 
   return true;
@@ -878,6 +901,15 @@ static void omap_gfx_viewport_info(void *data, struct rarch_viewport *vp) {
   vp->height = vp->full_height = vid->height;
 }
 
+#ifdef HAVE_OVERLAY
+SOFT_OVERLAY_INTERFACE(omap_gfx, ((omap_video_t*)data)->overlay);
+
+static void omap_gfx_get_overlay_interface(void *data, const video_overlay_interface_t **iface) {
+  (void)data;
+  *iface = &omap_gfx_overlay_interface;
+}
+#endif
+
 const video_driver_t video_omap = {
   omap_gfx_init,
   omap_gfx_frame,
@@ -897,7 +929,7 @@ const video_driver_t video_omap = {
   NULL, /* read_viewport */
 
 #ifdef HAVE_OVERLAY
-  NULL, /* overlay_interface */
+  omap_gfx_get_overlay_interface,
 #endif
   NULL /* poke_interface */
 };
@@ -25,14 +25,7 @@
 #include <malloc.h>
 #endif
 
-#ifdef RARCH_INTERNAL
 #include "../../hash.h"
-#else
-static inline uint32_t crc32_calculate(const uint8_t *data, size_t length)
-{
-   return crc32(0, data, length);
-}
-#endif
 
 #undef GOTO_END_ERROR
 #define GOTO_END_ERROR() do { \
@@ -25,6 +25,11 @@
 
 #if defined(__SSE2__)
 #include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD) && \
+   !defined(__ARMEB__) && !defined(__AARCH64EB__)
+// NEON versions of the conversions used to blit straight into 16-bit framebuffers, and of camera input.
+#include <arm_neon.h>
+#define SCALER_NEON
 #endif
 
 #if defined(__SSE2_)
@@ -194,7 +199,7 @@ void conv_0rgb1555_argb8888(void *output_, const void *input_,
          g = (g << 3) | (g >> 2);
          b = (b << 3) | (b >> 2);
 
-         output[w] = (0xff << 24) | (r << 16) | (g << 8) | (b << 0);
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
@@ -279,7 +284,50 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
          g = (g << 2) | (g >> 4);
          b = (b << 3) | (b >> 2);
 
-         output[w] = (0xff << 24) | (r << 16) | (g << 8) | (b << 0);
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+#elif defined(SCALER_NEON)
+void conv_rgb565_argb8888(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         // Shift-right-and-insert replicates the top bits of every channel into the bottom ones.
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint8x8_t r = vshrn_n_u16(in, 8);
+         uint8x8_t g = vshrn_n_u16(in, 3);
+         uint8x8_t b = vmovn_u16(vshlq_n_u16(in, 3));
+         uint8x8x4_t res;
+
+         res.val[0] = vsri_n_u8(b, b, 5);
+         res.val[1] = vsri_n_u8(g, g, 6);
+         res.val[2] = vsri_n_u8(r, r, 5);
+         res.val[3] = vdup_n_u8(0xff);
+         vst4_u8((uint8_t*)(output + w), res);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 11) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 2) | (g >> 4);
+         b = (b << 3) | (b >> 2);
+
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
       }
    }
 }
@@ -598,6 +646,99 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
    }
 }
 
+#if defined(__SSE2__)
+void conv_argb8888_rgb565(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m128i mask_r = _mm_set1_epi32(0xf800);
+   const __m128i mask_g = _mm_set1_epi32(0x07e0);
+   const __m128i mask_b = _mm_set1_epi32(0x001f);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height; h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         __m128i lo = _mm_loadu_si128((const __m128i*)(input + w + 0));
+         __m128i hi = _mm_loadu_si128((const __m128i*)(input + w + 4));
+
+         lo = _mm_or_si128(_mm_or_si128(
+                  _mm_and_si128(_mm_srli_epi32(lo, 8), mask_r),
+                  _mm_and_si128(_mm_srli_epi32(lo, 5), mask_g)),
+               _mm_and_si128(_mm_srli_epi32(lo, 3), mask_b));
+         hi = _mm_or_si128(_mm_or_si128(
+                  _mm_and_si128(_mm_srli_epi32(hi, 8), mask_r),
+                  _mm_and_si128(_mm_srli_epi32(hi, 5), mask_g)),
+               _mm_and_si128(_mm_srli_epi32(hi, 3), mask_b));
+
+         // Sign extend, so the signed saturating pack keeps all 16 bits.
+         lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+         hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+         _mm_storeu_si128((__m128i*)(output + w), _mm_packs_epi32(lo, hi));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         output[w] = ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f);
+      }
+   }
+}
+#elif defined(SCALER_NEON)
+void conv_argb8888_rgb565(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height; h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const uint8x8x4_t in = vld4_u8((const uint8_t*)(input + w));
+         uint16x8_t res = vshll_n_u8(in.val[2], 8);
+         res = vsriq_n_u16(res, vshll_n_u8(in.val[1], 8), 5);
+         res = vsriq_n_u16(res, vshll_n_u8(in.val[0], 8), 11);
+         vst1q_u16(output + w, res);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         output[w] = ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f);
+      }
+   }
+}
+#else
+void conv_argb8888_rgb565(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   for (h = 0; h < height; h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < width; w++)
+      {
+         uint32_t col = input[w];
+         output[w] = ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f);
+      }
+   }
+}
+#endif
+
 #if defined(__SSE2__)
 void conv_argb8888_bgr24(void *output_, const void *input_,
       int width, int height,
@@ -800,6 +941,73 @@ void conv_yuyv_argb8888(void *output_, const void *input_,
       }
    }
 }
+#elif defined(SCALER_NEON)
+void conv_yuyv_argb8888(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      // Each loop processes 16 pixels.
+      for (w = 0; w + 16 <= width; w += 16, src += 32, dst += 16)
+      {
+         // Deinterleaves into even Y, U, odd Y and V. Both Y share the chroma.
+         const uint8x8x4_t yuv = vld4_u8(src);
+         int16x8_t y0 = vmulq_n_s16(vreinterpretq_s16_u16(vmovl_u8(yuv.val[0])), YUV_MAT_Y);
+         int16x8_t y1 = vmulq_n_s16(vreinterpretq_s16_u16(vmovl_u8(yuv.val[2])), YUV_MAT_Y);
+         int16x8_t u  = vreinterpretq_s16_u16(vsubl_u8(yuv.val[1], vdup_n_u8(128)));
+         int16x8_t v  = vreinterpretq_s16_u16(vsubl_u8(yuv.val[3], vdup_n_u8(128)));
+
+         int16x8_t cr = vmulq_n_s16(v, YUV_MAT_V_R);
+         int16x8_t cg = vmlaq_n_s16(vmulq_n_s16(u, YUV_MAT_U_G), v, YUV_MAT_V_G);
+         int16x8_t cb = vmulq_n_s16(u, YUV_MAT_U_B);
+
+         // Rounding shift and saturation to 8-bit is the same as clamp_8bit((x + YUV_OFFSET) >> YUV_SHIFT).
+         // Zipping the even and odd pixels back together gives 16 pixels in order.
+         uint8x8x2_t r = vzip_u8(vqrshrun_n_s16(vaddq_s16(y0, cr), YUV_SHIFT), vqrshrun_n_s16(vaddq_s16(y1, cr), YUV_SHIFT));
+         uint8x8x2_t g = vzip_u8(vqrshrun_n_s16(vaddq_s16(y0, cg), YUV_SHIFT), vqrshrun_n_s16(vaddq_s16(y1, cg), YUV_SHIFT));
+         uint8x8x2_t b = vzip_u8(vqrshrun_n_s16(vaddq_s16(y0, cb), YUV_SHIFT), vqrshrun_n_s16(vaddq_s16(y1, cb), YUV_SHIFT));
+         uint8x8x4_t res;
+
+         res.val[3] = vdup_n_u8(0xff);
+         res.val[0] = b.val[0];
+         res.val[1] = g.val[0];
+         res.val[2] = r.val[0];
+         vst4_u8((uint8_t*)(dst + 0), res);
+         res.val[0] = b.val[1];
+         res.val[1] = g.val[1];
+         res.val[2] = r.val[1];
+         vst4_u8((uint8_t*)(dst + 8), res);
+      }
+
+      // Finish off the rest (if any) in C.
+      for (; w < width; w += 2, src += 4, dst += 2)
+      {
+         int y0 = src[0];
+         int  u = src[1] - 128;
+         int y1 = src[2];
+         int  v = src[3] - 128;
+
+         uint8_t r0 = clamp_8bit((YUV_MAT_Y * y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g0 = clamp_8bit((YUV_MAT_Y * y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b0 = clamp_8bit((YUV_MAT_Y * y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         uint8_t r1 = clamp_8bit((YUV_MAT_Y * y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g1 = clamp_8bit((YUV_MAT_Y * y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b1 = clamp_8bit((YUV_MAT_Y * y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
+         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+      }
+   }
+}
 #else
 void conv_yuyv_argb8888(void *output_, const void *input_,
       int width, int height,
@@ -81,6 +81,8 @@ static bool set_direct_pix_conv(struct scaler_ctx *ctx)
       ctx->direct_pixconv = conv_bgr24_argb8888;
    else if (ctx->in_fmt == SCALER_FMT_ARGB8888 && ctx->out_fmt == SCALER_FMT_0RGB1555)
       ctx->direct_pixconv = conv_argb8888_0rgb1555;
+   else if (ctx->in_fmt == SCALER_FMT_ARGB8888 && ctx->out_fmt == SCALER_FMT_RGB565)
+      ctx->direct_pixconv = conv_argb8888_rgb565;
    else if (ctx->in_fmt == SCALER_FMT_ARGB8888 && ctx->out_fmt == SCALER_FMT_BGR24)
       ctx->direct_pixconv = conv_argb8888_bgr24;
    else if (ctx->in_fmt == SCALER_FMT_0RGB1555 && ctx->out_fmt == SCALER_FMT_BGR24)
@@ -129,6 +131,10 @@ static bool set_pix_conv(struct scaler_ctx *ctx)
          ctx->out_pixconv = conv_argb8888_0rgb1555;
          break;
 
+      case SCALER_FMT_RGB565:
+         ctx->out_pixconv = conv_argb8888_rgb565;
+         break;
+
       case SCALER_FMT_BGR24:
          ctx->out_pixconv = conv_argb8888_bgr24;
          break;
@@ -140,10 +146,52 @@ static bool set_pix_conv(struct scaler_ctx *ctx)
    return true;
 }
 
+static bool gen_point_direct(struct scaler_ctx *ctx)
+{
+   int x;
+   int bpp = ctx->out_fmt == SCALER_FMT_ARGB8888 || ctx->out_fmt == SCALER_FMT_ABGR8888 ? 4 :
+      (ctx->out_fmt == SCALER_FMT_0RGB1555 || ctx->out_fmt == SCALER_FMT_RGB565 ? 2 : 0);
+
+   if (!bpp || !set_direct_pix_conv(ctx))
+      return false;
+
+   ctx->point.bpp     = bpp;
+   ctx->point.x_scale = ctx->out_width % ctx->in_width == 0 ? ctx->out_width / ctx->in_width : 0;
+
+   ctx->point.line = scaler_alloc(bpp, ctx->in_width);
+   ctx->point.row  = scaler_alloc(bpp, ctx->out_width);
+   if (!ctx->point.line || !ctx->point.row)
+      return false;
+
+   if (!ctx->point.x_scale)
+   {
+      ctx->point.x_pos = (int*)scaler_alloc(sizeof(int), ctx->out_width);
+      if (!ctx->point.x_pos)
+         return false;
+
+      // Nearest input pixel to the center of every output pixel.
+      for (x = 0; x < ctx->out_width; x++)
+         ctx->point.x_pos[x] = (int)(((2 * (int64_t)x + 1) * ctx->in_width) / (2 * ctx->out_width));
+   }
+
+   ctx->point.enable = true;
+   return true;
+}
+
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 {
+   bool scaled = ctx->in_width != ctx->out_width || ctx->in_height != ctx->out_height;
+
    scaler_ctx_gen_reset(ctx);
 
+   // Also takes unscaled copies, as conv_copy() copies whole strides, which can run past the output.
+   if ((scaled ? ctx->scaler_type == SCALER_TYPE_POINT : ctx->in_fmt == ctx->out_fmt) &&
+         gen_point_direct(ctx))
+   {
+      ctx->unscaled = false;
+      return true;
+   }
+
    if (ctx->in_width == ctx->out_width && ctx->in_height == ctx->out_height)
       ctx->unscaled = true; // Only pixel format conversion ...
    else
@@ -184,12 +232,16 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
    scaler_free(ctx->scaled.frame);
    scaler_free(ctx->input.frame);
    scaler_free(ctx->output.frame);
+   scaler_free(ctx->point.x_pos);
+   scaler_free(ctx->point.line);
+   scaler_free(ctx->point.row);
 
    memset(&ctx->horiz, 0, sizeof(ctx->horiz));
    memset(&ctx->vert, 0, sizeof(ctx->vert));
    memset(&ctx->scaled, 0, sizeof(ctx->scaled));
    memset(&ctx->input, 0, sizeof(ctx->input));
    memset(&ctx->output, 0, sizeof(ctx->output));
+   memset(&ctx->point, 0, sizeof(ctx->point));
 }
 
 void scaler_ctx_scale(struct scaler_ctx *ctx,
@@ -201,6 +253,8 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
             ctx->out_width, ctx->out_height,
             ctx->out_stride, ctx->in_stride);
    }
+   else if (ctx->point.enable)
+      scaler_point_direct(ctx, output, input);
    else if (ctx->scaler_special) // Take some special, and (hopefully) more optimized path.
    {
       const void *inp = input;
@@ -96,6 +96,18 @@ struct scaler_ctx
       uint32_t *frame;
       int stride;
    } output;
+
+   // Point scaling between formats with a direct conversion.
+   // Converts one input line at a time, and only ever writes to the output.
+   struct
+   {
+      bool enable;
+      int bpp;       // Output bytes per pixel.
+      int x_scale;   // Integer horizontal scale, or 0.
+      int *x_pos;    // Input pixel of every output pixel, without integer scale.
+      void *line;    // One converted input line.
+      void *row;     // One scaled output line.
+   } point;
 };
 
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx);
@@ -14,6 +14,7 @@
  */
 
 #include "scaler_int.h"
+#include <string.h>
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
@@ -24,6 +25,9 @@
 #ifdef _WIN32
 #include <intrin.h>
 #endif
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD)
+#include <arm_neon.h>
+#define SCALER_NEON
 #endif
 
 // ARGB8888 scaler is split in two:
@@ -269,3 +273,129 @@ void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
    }
 }
 
+
+// Doubles every pixel of a line.
+static void point_double_16(uint16_t *output, const uint16_t *input, int in_width)
+{
+   int w = 0;
+#if defined(__SSE2__)
+   for (; w + 8 <= in_width; w += 8)
+   {
+      __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+      _mm_storeu_si128((__m128i*)(output + 2 * w + 0), _mm_unpacklo_epi16(in, in));
+      _mm_storeu_si128((__m128i*)(output + 2 * w + 8), _mm_unpackhi_epi16(in, in));
+   }
+#elif defined(SCALER_NEON)
+   for (; w + 8 <= in_width; w += 8)
+   {
+      uint16x8_t in = vld1q_u16(input + w);
+      uint16x8x2_t out = { { in, in } };
+      vst2q_u16(output + 2 * w, out);
+   }
+#endif
+   for (; w < in_width; w++)
+      output[2 * w + 0] = output[2 * w + 1] = input[w];
+}
+
+static void point_double_32(uint32_t *output, const uint32_t *input, int in_width)
+{
+   int w = 0;
+#if defined(__SSE2__)
+   for (; w + 4 <= in_width; w += 4)
+   {
+      __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+      _mm_storeu_si128((__m128i*)(output + 2 * w + 0), _mm_unpacklo_epi32(in, in));
+      _mm_storeu_si128((__m128i*)(output + 2 * w + 4), _mm_unpackhi_epi32(in, in));
+   }
+#elif defined(SCALER_NEON)
+   for (; w + 4 <= in_width; w += 4)
+   {
+      uint32x4_t in = vld1q_u32(input + w);
+      uint32x4x2_t out = { { in, in } };
+      vst2q_u32(output + 2 * w, out);
+   }
+#endif
+   for (; w < in_width; w++)
+      output[2 * w + 0] = output[2 * w + 1] = input[w];
+}
+
+static void point_scale_line(const struct scaler_ctx *ctx, void *output_, const void *input_)
+{
+   int w, i;
+   int scale = ctx->point.x_scale;
+
+   if (ctx->point.bpp == 2)
+   {
+      const uint16_t *input = (const uint16_t*)input_;
+      uint16_t *output      = (uint16_t*)output_;
+
+      if (scale == 2)
+         point_double_16(output, input, ctx->in_width);
+      else if (scale)
+      {
+         for (w = 0; w < ctx->in_width; w++)
+            for (i = 0; i < scale; i++)
+               *output++ = input[w];
+      }
+      else
+      {
+         for (w = 0; w < ctx->out_width; w++)
+            output[w] = input[ctx->point.x_pos[w]];
+      }
+   }
+   else
+   {
+      const uint32_t *input = (const uint32_t*)input_;
+      uint32_t *output      = (uint32_t*)output_;
+
+      if (scale == 2)
+         point_double_32(output, input, ctx->in_width);
+      else if (scale)
+      {
+         for (w = 0; w < ctx->in_width; w++)
+            for (i = 0; i < scale; i++)
+               *output++ = input[w];
+      }
+      else
+      {
+         for (w = 0; w < ctx->out_width; w++)
+            output[w] = input[ctx->point.x_pos[w]];
+      }
+   }
+}
+
+// Every input line used is converted once and scaled once, then copied to all the output lines it covers.
+// The output is only written to, which matters when it is uncached framebuffer memory.
+void scaler_point_direct(const struct scaler_ctx *ctx,
+      void *output_, const void *input_)
+{
+   int h, y, last_y = -1;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint8_t *output      = (uint8_t*)output_;
+   size_t row_size      = ctx->out_width * ctx->point.bpp;
+   bool unscaled_rows   = ctx->point.x_scale == 1;
+
+   for (h = 0; h < ctx->out_height; h++, output += ctx->out_stride)
+   {
+      y = (int)(((2 * (int64_t)h + 1) * ctx->in_height) / (2 * ctx->out_height));
+
+      // Lines which are not repeated go straight to the output.
+      if (unscaled_rows && ctx->out_height <= ctx->in_height)
+      {
+         ctx->direct_pixconv(output, input + y * ctx->in_stride,
+               ctx->in_width, 1, row_size, ctx->in_stride);
+         continue;
+      }
+
+      if (y != last_y)
+      {
+         ctx->direct_pixconv(ctx->point.line, input + y * ctx->in_stride,
+               ctx->in_width, 1, ctx->in_width * ctx->point.bpp, ctx->in_stride);
+         if (!unscaled_rows)
+            point_scale_line(ctx, ctx->point.row, ctx->point.line);
+         last_y = y;
+      }
+
+      memcpy(output, unscaled_rows ? ctx->point.line : ctx->point.row, row_size);
+   }
+}
@@ -27,5 +27,8 @@ void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
       int in_width, int in_height,
       int out_stride, int in_stride);
 
+void scaler_point_direct(const struct scaler_ctx *ctx,
+      void *output, const void *input);
+
 #endif
 
@@ -22,6 +22,7 @@
 #include "gfx_common.h"
 #include "gfx_context.h"
 #include "fonts/fonts.h"
+#include "soft_overlay.h"
 
 #ifdef HAVE_X11
 #include "context/x11_common.h"
@@ -47,6 +48,10 @@ typedef struct sdl_video
    struct scaler_ctx scaler;
    unsigned last_width;
    unsigned last_height;
+
+#ifdef HAVE_OVERLAY
+   soft_overlay_t *overlay;
+#endif
 } sdl_video_t;
 
 static void sdl_gfx_free(void *data)
@@ -62,6 +67,10 @@ static void sdl_gfx_free(void *data)
 
    scaler_ctx_gen_reset(&vid->scaler);
 
+#ifdef HAVE_OVERLAY
+   soft_overlay_free(vid->overlay);
+#endif
+
    free(vid);
 }
 
@@ -95,9 +104,9 @@ static void sdl_render_msg(sdl_video_t *vid, SDL_Surface *buffer,
    if (!vid->font)
       return;
 
-   struct font_output_list out;
-   vid->font_driver->render_msg(vid->font, msg, &out);
-   struct font_output *head = out.head;
+   unsigned i;
+   struct font_output glyphs[FONT_MAX_GLYPHS];
+   unsigned num_glyphs = vid->font_driver->render_msg(vid->font, msg, glyphs, FONT_MAX_GLYPHS);
 
    int msg_base_x = g_settings.video.msg_pos_x * width;
    int msg_base_y = (1.0 - g_settings.video.msg_pos_y) * height;
@@ -106,8 +115,9 @@ static void sdl_render_msg(sdl_video_t *vid, SDL_Surface *buffer,
    unsigned gshift = fmt->Gshift;
    unsigned bshift = fmt->Bshift;
 
-   for (; head; head = head->next)
+   for (i = 0; i < num_glyphs; i++)
    {
+      const struct font_output *head = &glyphs[i];
       int base_x = msg_base_x + head->off_x;
       int base_y = msg_base_y - head->off_y - head->height;
 
@@ -160,8 +170,6 @@ static void sdl_render_msg(sdl_video_t *vid, SDL_Surface *buffer,
          }
       }
    }
-
-   vid->font_driver->free_output(vid->font, &out);
 }
 
 static void sdl_gfx_set_handles(void)
@@ -255,6 +263,12 @@ static void *sdl_gfx_init(const video_info_t *video, const input_driver_t **inpu
    vid->scaler.in_fmt  = video->rgb32 ? SCALER_FMT_ARGB8888 : SCALER_FMT_RGB565;
    vid->scaler.out_fmt = SCALER_FMT_ARGB8888;
 
+#ifdef HAVE_OVERLAY
+   vid->overlay = soft_overlay_new();
+   if (!vid->overlay)
+      goto error;
+#endif
+
    return vid;
 
 error:
@@ -313,6 +327,11 @@ static bool sdl_gfx_frame(void *data, const void *frame, unsigned width, unsigne
    if (msg)
       sdl_render_msg(vid, vid->screen, msg, vid->screen->w, vid->screen->h, vid->screen->format);
 
+#ifdef HAVE_OVERLAY
+   soft_overlay_render(vid->overlay, vid->screen->pixels, vid->screen->pitch, sizeof(uint32_t),
+         vid->screen->w, vid->screen->h, NULL);
+#endif
+
    if (SDL_MUSTLOCK(vid->screen))
       SDL_UnlockSurface(vid->screen);
 
@@ -353,6 +372,16 @@ static void sdl_gfx_viewport_info(void *data, struct rarch_viewport *vp)
    vp->height = vp->full_height = vid->screen->h;
 }
 
+#ifdef HAVE_OVERLAY
+SOFT_OVERLAY_INTERFACE(sdl_gfx, ((sdl_video_t*)data)->overlay);
+
+static void sdl_gfx_get_overlay_interface(void *data, const video_overlay_interface_t **iface)
+{
+   (void)data;
+   *iface = &sdl_gfx_overlay_interface;
+}
+#endif
+
 const video_driver_t video_sdl = {
    sdl_gfx_init,
    sdl_gfx_frame,
@@ -369,5 +398,9 @@ const video_driver_t video_sdl = {
 
    NULL,
    sdl_gfx_viewport_info,
+   NULL,
+#ifdef HAVE_OVERLAY
+   sdl_gfx_get_overlay_interface,
+#endif
 };
 
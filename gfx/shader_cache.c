@@ -0,0 +1,609 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shader_cache.h"
+#include "../compat/posix_string.h"
+#include "../compat/strl.h"
+#include "../file.h"
+#include "../hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define SHADER_CACHE_MAGIC 0x43485352 // "RSHC"
+#define SHADER_CACHE_VERSION 2
+
+// Strings are stored with their length, this one means NULL.
+#define SHADER_CACHE_NULL_STRING 0xffffffffu
+
+// Every entry starts with this, and the payload is thrown away if it doesn't check out.
+// Entries are only ever read back on the machine that wrote them, so native endian is fine.
+struct shader_cache_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t size;
+   uint32_t crc;
+};
+
+struct shader_cache_writer
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+   bool error;
+};
+
+struct shader_cache_reader
+{
+   const uint8_t *data;
+   size_t size;
+   size_t pos;
+};
+
+static void writer_put(struct shader_cache_writer *w, const void *data, size_t size)
+{
+   if (w->error)
+      return;
+
+   if (w->size + size > w->capacity)
+   {
+      size_t capacity = w->capacity ? w->capacity : 4096;
+      uint8_t *buf;
+      while (capacity < w->size + size)
+         capacity *= 2;
+
+      buf = (uint8_t*)realloc(w->data, capacity);
+      if (!buf)
+      {
+         w->error = true;
+         return;
+      }
+      w->data = buf;
+      w->capacity = capacity;
+   }
+
+   memcpy(w->data + w->size, data, size);
+   w->size += size;
+}
+
+static void writer_put_u32(struct shader_cache_writer *w, uint32_t val)
+{
+   writer_put(w, &val, sizeof(val));
+}
+
+static void writer_put_string(struct shader_cache_writer *w, const char *str)
+{
+   uint32_t len = str ? strlen(str) : SHADER_CACHE_NULL_STRING;
+   writer_put_u32(w, len);
+   if (str)
+      writer_put(w, str, len);
+}
+
+static bool reader_get(struct shader_cache_reader *r, void *data, size_t size)
+{
+   if (size > r->size - r->pos)
+      return false;
+
+   memcpy(data, r->data + r->pos, size);
+   r->pos += size;
+   return true;
+}
+
+static bool reader_get_u32(struct shader_cache_reader *r, uint32_t *val)
+{
+   return reader_get(r, val, sizeof(*val));
+}
+
+// Reads a string into a fixed size field. Those are stored like any other string,
+// so mostly empty paths don't take up PATH_MAX in the entry.
+static bool reader_get_array(struct shader_cache_reader *r, char *str, size_t size)
+{
+   uint32_t len;
+   if (!reader_get_u32(r, &len) || len >= size || !reader_get(r, str, len))
+      return false;
+
+   str[len] = '\0';
+   return true;
+}
+
+// Returns false on a truncated entry. A NULL string is returned as NULL.
+static bool reader_get_string(struct shader_cache_reader *r, char **str)
+{
+   uint32_t len;
+   *str = NULL;
+
+   if (!reader_get_u32(r, &len))
+      return false;
+   if (len == SHADER_CACHE_NULL_STRING)
+      return true;
+   if (len > r->size - r->pos)
+      return false;
+
+   *str = (char*)malloc(len + 1);
+   if (!*str)
+      return false;
+
+   memcpy(*str, r->data + r->pos, len);
+   (*str)[len] = '\0';
+   r->pos += len;
+   return true;
+}
+
+static void cache_entry_path(char *path, size_t size, const char *dir,
+      const uint8_t *key, const char *ext)
+{
+   char name[2 * SHADER_CACHE_KEY_SIZE + 1];
+   char file[2 * SHADER_CACHE_KEY_SIZE + 16];
+
+   sha256_digest_string(name, key);
+   snprintf(file, sizeof(file), "%s.%s", name, ext);
+   fill_pathname_join(path, dir, file, size);
+}
+
+// Size and modification time of a file, which is how dependencies are checked.
+static bool file_stat(const char *path, uint64_t *size, int64_t *mtime)
+{
+   struct stat st;
+   if (stat(path, &st) < 0)
+      return false;
+
+   *size = st.st_size;
+   *mtime = st.st_mtime;
+   return true;
+}
+
+// Returns the payload of an entry, or NULL if it doesn't exist or is damaged.
+// mtime, if not NULL, is set to when the entry was written.
+static uint8_t *cache_entry_read(const char *dir, const uint8_t *key,
+      const char *ext, size_t *size, int64_t *mtime)
+{
+   char path[PATH_MAX];
+   struct shader_cache_header header;
+   uint8_t *data = NULL;
+   uint64_t file_size;
+   int64_t file_mtime;
+   long len;
+
+   cache_entry_path(path, sizeof(path), dir, key, ext);
+   if (!file_stat(path, &file_size, &file_mtime))
+      return NULL;
+   if (mtime)
+      *mtime = file_mtime;
+
+   len = read_file(path, (void**)&data);
+   if (len < (long)sizeof(header))
+      goto error;
+
+   memcpy(&header, data, sizeof(header));
+   if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION ||
+         header.size != len - sizeof(header) ||
+         header.crc != crc32_calculate(data + sizeof(header), header.size))
+   {
+      RARCH_WARN("[Shader cache]: Ignoring damaged entry %s.\n", path);
+      goto error;
+   }
+
+   memmove(data, data + sizeof(header), header.size);
+   *size = header.size;
+   return data;
+
+error:
+   free(data);
+   return NULL;
+}
+
+// Written to a temporary file first, so a crash never leaves a half written entry behind.
+static bool cache_entry_write(const char *dir, const uint8_t *key,
+      const char *ext, const void *data, size_t size)
+{
+   char path[PATH_MAX], tmp_path[PATH_MAX + 8];
+   struct shader_cache_header header;
+   uint8_t *buf;
+   bool ret;
+
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+   {
+      RARCH_WARN("[Shader cache]: Cannot create directory %s.\n", dir);
+      return false;
+   }
+
+   buf = (uint8_t*)malloc(sizeof(header) + size);
+   if (!buf)
+      return false;
+
+   header.magic = SHADER_CACHE_MAGIC;
+   header.version = SHADER_CACHE_VERSION;
+   header.size = size;
+   header.crc = crc32_calculate((const uint8_t*)data, size);
+   memcpy(buf, &header, sizeof(header));
+   memcpy(buf + sizeof(header), data, size);
+
+   cache_entry_path(path, sizeof(path), dir, key, ext);
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+   ret = write_file(tmp_path, buf, sizeof(header) + size);
+   free(buf);
+
+   if (ret)
+   {
+      // rename() doesn't replace existing files everywhere.
+      remove(path);
+      ret = rename(tmp_path, path) == 0;
+   }
+   if (!ret)
+   {
+      remove(tmp_path);
+      RARCH_WARN("[Shader cache]: Failed to write %s.\n", path);
+   }
+   return ret;
+}
+
+void *gfx_shader_cache_read_blob(const char *dir, const uint8_t *key, size_t *size)
+{
+   if (!dir || !*dir)
+      return NULL;
+   return cache_entry_read(dir, key, "bin", size, NULL);
+}
+
+bool gfx_shader_cache_write_blob(const char *dir, const uint8_t *key, const void *data, size_t size)
+{
+   if (!dir || !*dir)
+      return false;
+   return cache_entry_write(dir, key, "bin", data, size);
+}
+
+// A preset entry lists the files it was made from, then holds the parsed shader.
+// Files are recorded with their size and modification time, which is all a cache hit looks at.
+// A file modified in the same second the entry was written might change again without its time
+// changing, so those are checked against the hash of their content instead.
+struct shader_cache_dep
+{
+   char path[PATH_MAX];
+   uint64_t size;
+   int64_t mtime;
+   uint8_t hash[SHADER_CACHE_KEY_SIZE];
+};
+
+// The preset and the source of every pass.
+struct shader_cache_deps
+{
+   struct shader_cache_dep dep[GFX_MAX_SHADERS + 1];
+   unsigned count;
+};
+
+static void hash_buffer(uint8_t *hash, const void *data, size_t size)
+{
+   struct sha256_ctx sha;
+   sha256_init(&sha);
+   sha256_update(&sha, (const uint8_t*)data, size);
+   sha256_final(&sha, hash);
+}
+
+// Reads a file, and records it in deps if not NULL.
+// It's stat'ed before it is read, so it's never recorded as newer than the content that was hashed.
+static long deps_read_file(struct shader_cache_deps *deps, const char *path, void **buf)
+{
+   struct shader_cache_dep *dep;
+   long len;
+
+   if (!deps)
+      return read_file(path, buf);
+
+   dep = &deps->dep[deps->count];
+   if (!file_stat(path, &dep->size, &dep->mtime))
+      return -1;
+
+   len = read_file(path, buf);
+   if (len < 0)
+      return len;
+
+   strlcpy(dep->path, path, sizeof(dep->path));
+   hash_buffer(dep->hash, *buf, len);
+   deps->count++;
+   return len;
+}
+
+static void free_sources(struct gfx_shader *shader)
+{
+   unsigned i;
+   for (i = 0; i < GFX_MAX_SHADERS; i++)
+   {
+      free(shader->pass[i].source.xml.vertex);
+      free(shader->pass[i].source.xml.fragment);
+      shader->pass[i].source.xml.vertex = NULL;
+      shader->pass[i].source.xml.fragment = NULL;
+   }
+   free(shader->script);
+   shader->script = NULL;
+}
+
+static bool dep_changed(const char *path, const uint8_t *expected)
+{
+   uint8_t hash[SHADER_CACHE_KEY_SIZE];
+   void *buf = NULL;
+   long len = read_file(path, &buf);
+
+   if (len < 0)
+      return true;
+
+   hash_buffer(hash, buf, len);
+   free(buf);
+   return memcmp(hash, expected, sizeof(hash)) != 0;
+}
+
+// Files that changed since the entry was written make it useless.
+static bool deps_valid(struct shader_cache_reader *r, int64_t entry_mtime)
+{
+   uint32_t count, i;
+   if (!reader_get_u32(r, &count) || count > GFX_MAX_SHADERS + 1)
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      char path[PATH_MAX];
+      uint8_t hash[SHADER_CACHE_KEY_SIZE];
+      uint64_t size, cur_size;
+      int64_t mtime, cur_mtime;
+
+      if (!reader_get_array(r, path, sizeof(path)) ||
+            !reader_get(r, &size, sizeof(size)) ||
+            !reader_get(r, &mtime, sizeof(mtime)) ||
+            !reader_get(r, hash, sizeof(hash)))
+         return false;
+
+      if (!file_stat(path, &cur_size, &cur_mtime) || cur_size != size || cur_mtime != mtime)
+         return false;
+      if (mtime >= entry_mtime && dep_changed(path, hash))
+         return false;
+   }
+
+   return true;
+}
+
+static void deps_write(struct shader_cache_writer *w, const struct shader_cache_deps *deps)
+{
+   unsigned i;
+
+   writer_put_u32(w, deps->count);
+   for (i = 0; i < deps->count; i++)
+   {
+      const struct shader_cache_dep *dep = &deps->dep[i];
+      writer_put_string(w, dep->path);
+      writer_put(w, &dep->size, sizeof(dep->size));
+      writer_put(w, &dep->mtime, sizeof(dep->mtime));
+      writer_put(w, dep->hash, sizeof(dep->hash));
+   }
+}
+
+// Only what the preset uses is stored, struct gfx_shader is mostly empty arrays.
+static void shader_write(struct shader_cache_writer *w, const struct gfx_shader *shader)
+{
+   unsigned i;
+
+   writer_put_u32(w, shader->type);
+   writer_put_u32(w, shader->modern);
+   writer_put_string(w, shader->prefix);
+
+   writer_put_u32(w, shader->passes);
+   for (i = 0; i < shader->passes; i++)
+   {
+      const struct gfx_shader_pass *pass = &shader->pass[i];
+      writer_put_string(w, pass->source.cg);
+      writer_put_string(w, pass->source.xml.vertex);
+      writer_put_string(w, pass->source.xml.fragment);
+      writer_put(w, &pass->fbo, sizeof(pass->fbo));
+      writer_put_u32(w, pass->filter);
+      writer_put_u32(w, pass->wrap);
+      writer_put_u32(w, pass->frame_count_mod);
+   }
+
+   writer_put_u32(w, shader->luts);
+   for (i = 0; i < shader->luts; i++)
+   {
+      const struct gfx_shader_lut *lut = &shader->lut[i];
+      writer_put_string(w, lut->id);
+      writer_put_string(w, lut->path);
+      writer_put_u32(w, lut->filter);
+      writer_put_u32(w, lut->wrap);
+   }
+
+   writer_put_u32(w, shader->variables);
+   writer_put(w, shader->variable, shader->variables * sizeof(shader->variable[0]));
+
+   writer_put_string(w, shader->script_path);
+   writer_put_string(w, shader->script);
+   writer_put_string(w, shader->script_class);
+}
+
+static bool shader_read(struct shader_cache_reader *r, struct gfx_shader *shader)
+{
+   uint32_t type, modern, filter, wrap;
+   unsigned i;
+
+   if (!reader_get_u32(r, &type) || !reader_get_u32(r, &modern) ||
+         !reader_get_array(r, shader->prefix, sizeof(shader->prefix)) ||
+         !reader_get_u32(r, &shader->passes) || shader->passes > GFX_MAX_SHADERS)
+      return false;
+   shader->type = (enum rarch_shader_type)type;
+   shader->modern = modern;
+
+   for (i = 0; i < shader->passes; i++)
+   {
+      struct gfx_shader_pass *pass = &shader->pass[i];
+      if (!reader_get_array(r, pass->source.cg, sizeof(pass->source.cg)) ||
+            !reader_get_string(r, &pass->source.xml.vertex) ||
+            !reader_get_string(r, &pass->source.xml.fragment) ||
+            !reader_get(r, &pass->fbo, sizeof(pass->fbo)) ||
+            !reader_get_u32(r, &filter) || !reader_get_u32(r, &wrap) ||
+            !reader_get_u32(r, &pass->frame_count_mod))
+         return false;
+      pass->filter = (enum gfx_filter_type)filter;
+      pass->wrap = (enum gfx_wrap_type)wrap;
+   }
+
+   if (!reader_get_u32(r, &shader->luts) || shader->luts > GFX_MAX_TEXTURES)
+      return false;
+   for (i = 0; i < shader->luts; i++)
+   {
+      struct gfx_shader_lut *lut = &shader->lut[i];
+      if (!reader_get_array(r, lut->id, sizeof(lut->id)) ||
+            !reader_get_array(r, lut->path, sizeof(lut->path)) ||
+            !reader_get_u32(r, &filter) || !reader_get_u32(r, &wrap))
+         return false;
+      lut->filter = (enum gfx_filter_type)filter;
+      lut->wrap = (enum gfx_wrap_type)wrap;
+   }
+
+   return reader_get_u32(r, &shader->variables) && shader->variables <= GFX_MAX_VARIABLES &&
+      reader_get(r, shader->variable, shader->variables * sizeof(shader->variable[0])) &&
+      reader_get_array(r, shader->script_path, sizeof(shader->script_path)) &&
+      reader_get_string(r, &shader->script) &&
+      reader_get_array(r, shader->script_class, sizeof(shader->script_class)) &&
+      r->pos == r->size;
+}
+
+static bool preset_entry_read(const char *dir, const uint8_t *key, struct gfx_shader *shader)
+{
+   struct shader_cache_reader r = {0};
+   int64_t mtime;
+   bool ret = false;
+   uint8_t *data = cache_entry_read(dir, key, "preset", &r.size, &mtime);
+
+   if (!data)
+      return false;
+   r.data = data;
+
+   if (deps_valid(&r, mtime))
+   {
+      memset(shader, 0, sizeof(*shader));
+      ret = shader_read(&r, shader);
+      if (!ret)
+      {
+         free_sources(shader);
+         memset(shader, 0, sizeof(*shader));
+      }
+   }
+
+   free(data);
+   return ret;
+}
+
+static void preset_entry_write(const char *dir, const uint8_t *key,
+      const struct gfx_shader *shader, const struct shader_cache_deps *deps)
+{
+   struct shader_cache_writer w = {0};
+
+   deps_write(&w, deps);
+   shader_write(&w, shader);
+
+   if (!w.error)
+      cache_entry_write(dir, key, "preset", w.data, w.size);
+   free(w.data);
+}
+
+// Reads the source of every pass into source.xml, like XML shaders have it.
+static bool inline_pass_sources(struct gfx_shader *shader, struct shader_cache_deps *deps)
+{
+   unsigned i;
+   for (i = 0; i < shader->passes; i++)
+   {
+      struct gfx_shader_pass *pass = &shader->pass[i];
+
+      if (!*pass->source.cg)
+         continue;
+
+      if (deps_read_file(deps, pass->source.cg, (void**)&pass->source.xml.vertex) <= 0)
+      {
+         RARCH_ERR("Failed to load shader source: %s.\n", pass->source.cg);
+         return false;
+      }
+
+      pass->source.xml.fragment = strdup(pass->source.xml.vertex);
+      if (!pass->source.xml.fragment)
+         return false;
+
+      *pass->source.cg = '\0';
+   }
+
+   return true;
+}
+
+bool gfx_shader_cache_read_preset(const char *dir, const char *path,
+      struct gfx_shader *shader, bool inline_sources)
+{
+   uint8_t key[SHADER_CACHE_KEY_SIZE];
+   struct shader_cache_deps *deps = NULL;
+   config_file_t *conf;
+   bool ret = false;
+
+   if (dir && *dir)
+   {
+      struct sha256_ctx sha;
+      uint32_t version = SHADER_CACHE_VERSION;
+      uint8_t flags = inline_sources;
+      char *preset = NULL;
+
+      // Named by the preset path only, a changed preset replaces its old entry.
+      sha256_init(&sha);
+      sha256_update(&sha, (const uint8_t*)&version, sizeof(version));
+      sha256_update(&sha, &flags, sizeof(flags));
+      sha256_update(&sha, (const uint8_t*)path, strlen(path) + 1);
+      sha256_final(&sha, key);
+
+      if (preset_entry_read(dir, key, shader))
+      {
+         RARCH_LOG("[Shader cache]: Loaded preset \"%s\" from cache.\n", path);
+         return true;
+      }
+
+      // Included files aren't tracked, so presets with #include are always parsed.
+      deps = (struct shader_cache_deps*)calloc(1, sizeof(*deps));
+      if (deps && (deps_read_file(deps, path, (void**)&preset) < 0 || strstr(preset, "#include")))
+      {
+         free(deps);
+         deps = NULL;
+      }
+      free(preset);
+   }
+
+   conf = config_file_new(path);
+   if (!conf)
+   {
+      RARCH_ERR("Failed to load preset: %s.\n", path);
+      goto end;
+   }
+
+   if (!gfx_shader_read_conf_cgp(conf, shader))
+      goto end;
+   gfx_shader_resolve_relative(shader, path);
+
+   if (inline_sources && !inline_pass_sources(shader, deps))
+      goto end;
+
+   if (deps)
+      preset_entry_write(dir, key, shader, deps);
+   ret = true;
+
+end:
+   if (!ret)
+      free_sources(shader);
+   free(deps);
+   if (conf)
+      config_file_free(conf);
+   return ret;
+}
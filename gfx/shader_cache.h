@@ -0,0 +1,51 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHADER_CACHE_H__
+#define SHADER_CACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../boolean.h"
+#include "shader_parse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cache of parsed shader presets and compiled programs.
+// Every entry is a file in the cache directory, named by a SHA256 key.
+// A NULL or empty directory disables the cache.
+
+#define SHADER_CACHE_KEY_SIZE 32
+
+// Loads a .cgp/.glslp preset, with paths resolved relative to the preset.
+// With inline_sources, the source of every pass is read into source.xml and source.cg is cleared,
+// as the GLSL backend wants it.
+// Parsed presets are cached, keyed by the preset path. An entry is only used while the preset
+// and every source it inlined have the size and modification time they had when it was written.
+bool gfx_shader_cache_read_preset(const char *dir, const char *path,
+      struct gfx_shader *shader, bool inline_sources);
+
+// Opaque binary blobs, e.g. program binaries, keyed by a SHA256 of everything they depend on.
+// Returns NULL if there is no valid entry. The returned buffer must be free'd.
+void *gfx_shader_cache_read_blob(const char *dir, const uint8_t *key, size_t *size);
+bool gfx_shader_cache_write_blob(const char *dir, const uint8_t *key, const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
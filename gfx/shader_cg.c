@@ -32,6 +32,7 @@
 #include "../file.h"
 
 #include "state_tracker.h"
+#include "shader_cache.h"
 
 //#define RARCH_CG_DEBUG
 
@@ -610,28 +611,19 @@ static bool load_preset(const char *path)
       return false;
 
    RARCH_LOG("Loading Cg meta-shader: %s\n", path);
-   config_file_t *conf = config_file_new(path);
-   if (!conf)
-   {
-      RARCH_ERR("Failed to load preset.\n");
-      return false;
-   }
 
    if (!cg_shader)
       cg_shader = (struct gfx_shader*)calloc(1, sizeof(*cg_shader));
    if (!cg_shader)
       return false;
 
-   if (!gfx_shader_read_conf_cgp(conf, cg_shader))
+   // The Cg runtime resolves #includes relative to the source file, so sources stay on disk.
+   if (!gfx_shader_cache_read_preset(g_settings.video.shader_cache_dir, path, cg_shader, false))
    {
       RARCH_ERR("Failed to parse CGP file.\n");
-      config_file_free(conf);
       return false;
    }
 
-   config_file_free(conf);
-   gfx_shader_resolve_relative(cg_shader, path);
-
    if (cg_shader->passes > GFX_MAX_SHADERS - 3)
    {
       RARCH_WARN("Too many shaders ... Capping shader amount to %d.\n", GFX_MAX_SHADERS - 3);
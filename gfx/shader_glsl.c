@@ -20,8 +20,10 @@
 #include "../compat/strl.h"
 #include "../compat/posix_string.h"
 #include "state_tracker.h"
+#include "shader_cache.h"
 #include "../dynamic.h"
 #include "../file.h"
+#include "../hash.h"
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
@@ -65,12 +67,20 @@
 
 #define PREV_TEXTURES (MAX_TEXTURES - 1)
 
+#ifdef HAVE_OPENGLES2
+#define glGetProgramBinary glGetProgramBinaryOES
+#define glProgramBinary glProgramBinaryOES
+#define GL_PROGRAM_BINARY_LENGTH GL_PROGRAM_BINARY_LENGTH_OES
+#define GL_NUM_PROGRAM_BINARY_FORMATS GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#endif
+
 static struct gfx_shader *glsl_shader;
 static bool glsl_core;
 static unsigned glsl_major;
 static unsigned glsl_minor;
 
 static bool glsl_enable;
+static bool glsl_binary_cache;
 static GLuint gl_program[GFX_MAX_SHADERS];
 static unsigned active_index;
 
@@ -420,6 +430,93 @@ static bool link_program(GLuint prog)
       return false;
 }
 
+// Program binaries are only good for the exact driver and context that made them.
+static void program_binary_key(uint8_t *key, const char *vertex, const char *fragment)
+{
+   struct sha256_ctx sha;
+   const GLubyte *strings[] = {
+      glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION),
+   };
+   unsigned context[] = { glsl_core, glsl_major, glsl_minor };
+   unsigned i;
+
+   sha256_init(&sha);
+   for (i = 0; i < ARRAY_SIZE(strings); i++)
+   {
+      const char *str = strings[i] ? (const char*)strings[i] : "";
+      sha256_update(&sha, (const uint8_t*)str, strlen(str) + 1);
+   }
+   sha256_update(&sha, (const uint8_t*)context, sizeof(context));
+   sha256_update(&sha, (const uint8_t*)(vertex ? vertex : ""), vertex ? strlen(vertex) + 1 : 0);
+   sha256_update(&sha, (const uint8_t*)(fragment ? fragment : ""), fragment ? strlen(fragment) + 1 : 0);
+   sha256_final(&sha, key);
+}
+
+// A binary the driver rejects (e.g. after a driver update) is compiled again and replaced.
+static bool load_program_binary(GLuint prog, const uint8_t *key)
+{
+   size_t size = 0;
+   GLenum format;
+   GLint status = GL_FALSE;
+   uint8_t *data = (uint8_t*)gfx_shader_cache_read_blob(g_settings.video.shader_cache_dir, key, &size);
+
+   if (!data)
+      return false;
+
+   if (size > sizeof(format))
+   {
+      memcpy(&format, data, sizeof(format));
+      glProgramBinary(prog, format, data + sizeof(format), size - sizeof(format));
+      glGetProgramiv(prog, GL_LINK_STATUS, &status);
+   }
+
+   free(data);
+   return status == GL_TRUE;
+}
+
+static void save_program_binary(GLuint prog, const uint8_t *key)
+{
+   GLint len = 0;
+   GLsizei written = 0;
+   GLenum format = 0;
+   uint8_t *data;
+
+   glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &len);
+   if (len <= 0)
+      return;
+
+   data = (uint8_t*)malloc(sizeof(format) + len);
+   if (!data)
+      return;
+
+   glGetProgramBinary(prog, len, &written, &format, data + sizeof(format));
+   memcpy(data, &format, sizeof(format));
+   if (written > 0)
+      gfx_shader_cache_write_blob(g_settings.video.shader_cache_dir, key, data, sizeof(format) + written);
+
+   free(data);
+}
+
+static bool program_binary_supported(void)
+{
+   GLint formats = 0;
+   if (!*g_settings.video.shader_cache_dir)
+      return false;
+
+#ifdef HAVE_OPENGLES2
+   if (!glGetProgramBinary || !glProgramBinary)
+      return false;
+#else
+   if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+      return false;
+#endif
+
+   glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+   // Drivers that can't give a binary back may have raised an error on the query.
+   while (glGetError() != GL_NO_ERROR);
+   return formats > 0;
+}
+
 static GLuint compile_program(const char *vertex, const char *fragment, unsigned i)
 {
    GLuint prog = glCreateProgram();
@@ -428,8 +525,19 @@ static GLuint compile_program(const char *vertex, const char *fragment, unsigned
 
    GLuint vert = 0;
    GLuint frag = 0;
+   uint8_t key[SHADER_CACHE_KEY_SIZE];
+   bool use_cache = glsl_binary_cache && (vertex || fragment);
+   bool cached = false;
+
+   if (use_cache)
+   {
+      program_binary_key(key, vertex, fragment);
+      cached = load_program_binary(prog, key);
+      if (cached)
+         RARCH_LOG("Loaded GLSL program #%u from shader cache.\n", i);
+   }
 
-   if (vertex)
+   if (vertex && !cached)
    {
       RARCH_LOG("Found GLSL vertex shader.\n");
       vert = glCreateShader(GL_VERTEX_SHADER);
@@ -442,7 +550,7 @@ static GLuint compile_program(const char *vertex, const char *fragment, unsigned
       glAttachShader(prog, vert);
    }
 
-   if (fragment)
+   if (fragment && !cached)
    {
       RARCH_LOG("Found GLSL fragment shader.\n");
       frag = glCreateShader(GL_FRAGMENT_SHADER);
@@ -455,9 +563,13 @@ static GLuint compile_program(const char *vertex, const char *fragment, unsigned
       glAttachShader(prog, frag);
    }
 
-   if (vertex || fragment)
+   if ((vertex || fragment) && !cached)
    {
       RARCH_LOG("Linking GLSL program.\n");
+#ifndef HAVE_OPENGLES2
+      if (use_cache)
+         glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
       if (!link_program(prog))
       {
          RARCH_ERR("Failed to link program #%u.\n", i);
@@ -471,6 +583,12 @@ static GLuint compile_program(const char *vertex, const char *fragment, unsigned
       if (frag)
          glDeleteShader(frag);
 
+      if (use_cache)
+         save_program_binary(prog, key);
+   }
+
+   if (vertex || fragment)
+   {
       glUseProgram(prog);
       GLint location = get_uniform(prog, "Texture");
       glUniform1i(location, 0);
@@ -744,19 +862,16 @@ static bool gl_glsl_init(void *data, const char *path)
       }
       else if (strcmp(path_get_extension(path), "glslp") == 0)
       {
-         config_file_t *conf = config_file_new(path);
-         if (conf)
-         {
-            ret = gfx_shader_read_conf_cgp(conf, glsl_shader);
-            glsl_shader->modern = true;
-            config_file_free(conf);
-         }
-         else
-            ret = false;
+         // Comes back with paths resolved and pass sources inlined.
+         ret = gfx_shader_cache_read_preset(g_settings.video.shader_cache_dir, path, glsl_shader, true);
+         glsl_shader->modern = true;
       }
       else
          ret = gfx_shader_read_xml(path, glsl_shader);
 
+      if (ret && strcmp(path_get_extension(path), "glslp") != 0)
+         gfx_shader_resolve_relative(glsl_shader, path);
+
       if (!ret)
       {
          RARCH_ERR("[GL]: Failed to parse GLSL shader.\n");
@@ -772,8 +887,6 @@ static bool gl_glsl_init(void *data, const char *path)
       glsl_shader->modern = true;
    }
 
-   gfx_shader_resolve_relative(glsl_shader, path);
-
    const char *stock_vertex = glsl_shader->modern ?
       stock_vertex_modern : stock_vertex_legacy;
    const char *stock_fragment = glsl_shader->modern ?
@@ -799,6 +912,8 @@ static bool gl_glsl_init(void *data, const char *path)
    }
 #endif
 
+   glsl_binary_cache = program_binary_supported();
+
    if (!(gl_program[0] = compile_program(stock_vertex, stock_fragment, 0)))
    {
       RARCH_ERR("GLSL stock programs failed to compile.\n");
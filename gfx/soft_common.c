@@ -0,0 +1,202 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "soft_common.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../general.h"
+#include "../driver.h"
+#include "gfx_common.h"
+
+void soft_calc_viewport(struct rarch_viewport *vp, unsigned screen_width, unsigned screen_height,
+      unsigned width, unsigned height, bool keep_aspect)
+{
+   float desired_aspect = g_extern.system.aspect_ratio > 0.0f ?
+      g_extern.system.aspect_ratio : (float)width / height;
+
+   vp->full_width  = screen_width;
+   vp->full_height = screen_height;
+
+   if (g_settings.video.scale_integer)
+      gfx_scale_integer(vp, screen_width, screen_height, desired_aspect, keep_aspect);
+   else if (keep_aspect && g_settings.video.aspect_ratio_idx == ASPECT_RATIO_CUSTOM)
+   {
+      const struct rarch_viewport *custom = &g_extern.console.screen.viewports.custom_vp;
+      vp->x      = custom->x;
+      vp->y      = custom->y;
+      vp->width  = custom->width;
+      vp->height = custom->height;
+   }
+   else if (!keep_aspect)
+   {
+      vp->x = vp->y = 0;
+      vp->width  = screen_width;
+      vp->height = screen_height;
+   }
+   else
+   {
+      float device_aspect = (float)screen_width / screen_height;
+
+      vp->x = vp->y = 0;
+      vp->width  = screen_width;
+      vp->height = screen_height;
+
+      if (fabs(device_aspect - desired_aspect) < 0.0001)
+         ;
+      else if (device_aspect > desired_aspect)
+      {
+         vp->width = roundf(screen_height * desired_aspect);
+         vp->x = (screen_width - vp->width) / 2;
+      }
+      else
+      {
+         vp->height = roundf(screen_width / desired_aspect);
+         vp->y = (screen_height - vp->height) / 2;
+      }
+   }
+
+   // Integer scale and custom viewports can be larger than the screen.
+   if (vp->x < 0 || vp->width + vp->x > screen_width || !vp->width)
+   {
+      vp->x = 0;
+      vp->width = screen_width;
+   }
+   if (vp->y < 0 || vp->height + vp->y > screen_height || !vp->height)
+   {
+      vp->y = 0;
+      vp->height = screen_height;
+   }
+}
+
+bool soft_font_init(struct soft_font *font)
+{
+   int r, g, b;
+
+   memset(font, 0, sizeof(*font));
+   if (!g_settings.video.font_enable)
+      return false;
+
+   if (!font_renderer_create_default(&font->driver, &font->font))
+   {
+      RARCH_LOG("Could not initialize fonts.\n");
+      return false;
+   }
+
+   r = g_settings.video.msg_color_r * 255;
+   g = g_settings.video.msg_color_g * 255;
+   b = g_settings.video.msg_color_b * 255;
+
+   font->rgb[0] = r < 0 ? 0 : (r > 255 ? 255 : r);
+   font->rgb[1] = g < 0 ? 0 : (g > 255 ? 255 : g);
+   font->rgb[2] = b < 0 ? 0 : (b > 255 ? 255 : b);
+   return true;
+}
+
+void soft_font_free(struct soft_font *font)
+{
+   if (font->font)
+      font->driver->free(font->font);
+   memset(font, 0, sizeof(*font));
+}
+
+void soft_font_render_msg(const struct soft_font *font, void *buffer, unsigned stride,
+      unsigned bytes_per_pixel, unsigned width, unsigned height, const char *msg)
+{
+   unsigned i;
+   int x, y;
+   struct font_output glyphs[FONT_MAX_GLYPHS];
+   unsigned num_glyphs;
+   int msg_base_x = g_settings.video.msg_pos_x * width;
+   int msg_base_y = (1.0 - g_settings.video.msg_pos_y) * height;
+
+   if (!font->font)
+      return;
+
+   num_glyphs = font->driver->render_msg(font->font, msg, glyphs, FONT_MAX_GLYPHS);
+
+   for (i = 0; i < num_glyphs; i++)
+   {
+      const struct font_output *head = &glyphs[i];
+      int base_x = msg_base_x + head->off_x;
+      int base_y = msg_base_y - head->off_y - head->height;
+      int glyph_width  = head->width;
+      int glyph_height = head->height;
+      int max_width, max_height;
+      const uint8_t *src = head->output;
+
+      if (base_x < 0)
+      {
+         src -= base_x;
+         glyph_width += base_x;
+         base_x = 0;
+      }
+
+      if (base_y < 0)
+      {
+         src -= base_y * (int)head->pitch;
+         glyph_height += base_y;
+         base_y = 0;
+      }
+
+      max_width  = width - base_x;
+      max_height = height - base_y;
+      if (max_width <= 0 || max_height <= 0)
+         continue;
+
+      if (glyph_width > max_width)
+         glyph_width = max_width;
+      if (glyph_height > max_height)
+         glyph_height = max_height;
+
+      for (y = 0; y < glyph_height; y++, src += head->pitch)
+      {
+         uint8_t *line = (uint8_t*)buffer + (base_y + y) * stride + base_x * bytes_per_pixel;
+
+         for (x = 0; x < glyph_width; x++)
+         {
+            unsigned blend = src[x];
+            unsigned r, g, b;
+            if (!blend)
+               continue;
+            blend += blend >> 7; // 0 - 256
+
+            if (bytes_per_pixel == 2)
+            {
+               uint16_t *out = (uint16_t*)line + x;
+               r = (*out >> 8) & 0xf8;
+               g = (*out >> 3) & 0xfc;
+               b = (*out << 3) & 0xf8;
+            }
+            else
+            {
+               uint32_t *out = (uint32_t*)line + x;
+               r = (*out >> 16) & 0xff;
+               g = (*out >>  8) & 0xff;
+               b = (*out >>  0) & 0xff;
+            }
+
+            r = (r * (256 - blend) + font->rgb[0] * blend) >> 8;
+            g = (g * (256 - blend) + font->rgb[1] * blend) >> 8;
+            b = (b * (256 - blend) + font->rgb[2] * blend) >> 8;
+
+            if (bytes_per_pixel == 2)
+               ((uint16_t*)line)[x] = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+            else
+               ((uint32_t*)line)[x] = (0xffu << 24) | (r << 16) | (g << 8) | b;
+         }
+      }
+   }
+}
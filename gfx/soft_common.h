@@ -0,0 +1,57 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFT_COMMON_H__
+#define SOFT_COMMON_H__
+
+#include <stdint.h>
+#include "../boolean.h"
+#include "fonts/fonts.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct rarch_viewport;
+
+// Helpers shared by the video drivers which present frames by drawing into memory themselves.
+
+// Lays out a width x height frame on the screen like the GL driver does,
+// honoring integer scaling, custom viewports and the aspect ratio.
+// The result always fits the screen.
+void soft_calc_viewport(struct rarch_viewport *vp, unsigned screen_width, unsigned screen_height,
+      unsigned width, unsigned height, bool keep_aspect);
+
+struct soft_font
+{
+   void *font;
+   const font_renderer_driver_t *driver;
+   uint8_t rgb[3];
+};
+
+// Does nothing and returns false if fonts are disabled or unavailable.
+bool soft_font_init(struct soft_font *font);
+void soft_font_free(struct soft_font *font);
+
+// Blends a message into a width x height RGB565 (bytes_per_pixel 2) or XRGB8888 (4) image,
+// positioned by the msg_pos settings.
+void soft_font_render_msg(const struct soft_font *font, void *buffer, unsigned stride,
+      unsigned bytes_per_pixel, unsigned width, unsigned height, const char *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
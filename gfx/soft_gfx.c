@@ -0,0 +1,414 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Software video driver which presents into an XRGB8888 framebuffer in memory instead of a screen.
+// Meant for headless runs such as regression tests. Every frame can be logged as a CRC32 of the
+// framebuffer (video_soft_hash_log) or dumped as PNG (video_soft_dump_dir),
+// and screenshots read the framebuffer back.
+
+#include "../driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../general.h"
+#include "../performance.h"
+#include "../file_path.h"
+#include "../hash.h"
+#include "scaler/scaler.h"
+#include "gfx_common.h"
+#include "soft_common.h"
+#include "soft_overlay.h"
+
+#ifdef HAVE_ZLIB_DEFLATE
+#include "rpng/rpng.h"
+#endif
+
+#define SOFT_DEFAULT_WIDTH 640
+#define SOFT_DEFAULT_HEIGHT 480
+
+typedef struct soft_video
+{
+   uint32_t *fb;
+   unsigned width;
+   unsigned height;
+   bool need_clear;
+
+   struct scaler_ctx scaler;
+   struct rarch_viewport vp;
+   unsigned last_width;
+   unsigned last_height;
+   bool keep_aspect;
+   bool should_resize;
+
+   struct soft_font font;
+
+   FILE *hash_log;
+   bool dump;
+   unsigned frames;
+
+#ifdef HAVE_OVERLAY
+   soft_overlay_t *overlay;
+#endif
+} soft_video_t;
+
+static void soft_fill(uint32_t *output, unsigned stride, unsigned width, unsigned height, uint32_t color)
+{
+   unsigned x, y;
+   for (y = 0; y < height; y++, output += stride)
+      for (x = 0; x < width; x++)
+         output[x] = color;
+}
+
+static void soft_make_opaque(uint32_t *output, unsigned stride, unsigned width, unsigned height)
+{
+   unsigned x, y;
+   for (y = 0; y < height; y++, output += stride)
+      for (x = 0; x < width; x++)
+         output[x] |= 0xffu << 24;
+}
+
+static void soft_gfx_free(void *data)
+{
+   soft_video_t *vid = (soft_video_t*)data;
+   if (!vid)
+      return;
+
+   if (vid->hash_log)
+      fclose(vid->hash_log);
+
+#ifdef HAVE_OVERLAY
+   soft_overlay_free(vid->overlay);
+#endif
+
+   soft_font_free(&vid->font);
+   scaler_ctx_gen_reset(&vid->scaler);
+   free(vid->fb);
+   free(vid);
+}
+
+static void *soft_gfx_init(const video_info_t *video, const input_driver_t **input, void **input_data)
+{
+   soft_video_t *vid;
+
+   if (g_extern.filter.filter)
+   {
+      RARCH_ERR("video_soft: Filters are not supported.\n");
+      return NULL;
+   }
+
+   vid = (soft_video_t*)calloc(1, sizeof(*vid));
+   if (!vid)
+      return NULL;
+
+   vid->width  = video->width ? video->width : SOFT_DEFAULT_WIDTH;
+   vid->height = video->height ? video->height : SOFT_DEFAULT_HEIGHT;
+   vid->fb = (uint32_t*)malloc(vid->width * vid->height * sizeof(uint32_t));
+   if (!vid->fb)
+      goto error;
+   soft_fill(vid->fb, vid->width, vid->width, vid->height, 0xff000000);
+
+#ifdef HAVE_OVERLAY
+   vid->overlay = soft_overlay_new();
+   if (!vid->overlay)
+      goto error;
+#endif
+
+   vid->keep_aspect = video->force_aspect;
+   vid->scaler.scaler_type = video->smooth ? SCALER_TYPE_BILINEAR : SCALER_TYPE_POINT;
+   vid->scaler.in_fmt  = video->rgb32 ? SCALER_FMT_ARGB8888 : SCALER_FMT_RGB565;
+   vid->scaler.out_fmt = SCALER_FMT_ARGB8888;
+
+   if (*g_settings.video.soft_hash_log)
+   {
+      vid->hash_log = fopen(g_settings.video.soft_hash_log, "w");
+      if (!vid->hash_log)
+      {
+         RARCH_ERR("video_soft: Failed to open %s.\n", g_settings.video.soft_hash_log);
+         goto error;
+      }
+   }
+
+   if (*g_settings.video.soft_dump_dir)
+   {
+#ifdef HAVE_ZLIB_DEFLATE
+      if (!path_is_directory(g_settings.video.soft_dump_dir) && !path_mkdir(g_settings.video.soft_dump_dir))
+      {
+         RARCH_ERR("video_soft: Failed to create %s.\n", g_settings.video.soft_dump_dir);
+         goto error;
+      }
+      vid->dump = true;
+#else
+      RARCH_ERR("video_soft: Frame dumps need PNG support.\n");
+      goto error;
+#endif
+   }
+
+   RARCH_LOG("video_soft: %ux%u framebuffer.\n", vid->width, vid->height);
+
+   if (input && input_data)
+      *input = NULL;
+
+   soft_font_init(&vid->font);
+   return vid;
+
+error:
+   soft_gfx_free(vid);
+   return NULL;
+}
+
+static bool soft_update_scaler(soft_video_t *vid, unsigned width, unsigned height)
+{
+   soft_calc_viewport(&vid->vp, vid->width, vid->height, width, height, vid->keep_aspect);
+
+   vid->scaler.in_width   = width;
+   vid->scaler.in_height  = height;
+   vid->scaler.out_width  = vid->vp.width;
+   vid->scaler.out_height = vid->vp.height;
+   vid->scaler.out_stride = vid->width * sizeof(uint32_t);
+
+   if (!scaler_ctx_gen_filter(&vid->scaler))
+   {
+      RARCH_ERR("video_soft: Failed to create scaler for %ux%u -> %ux%u.\n",
+            width, height, vid->vp.width, vid->vp.height);
+      return false;
+   }
+
+   vid->last_width    = width;
+   vid->last_height   = height;
+   vid->should_resize = false;
+   vid->need_clear    = true;
+   return true;
+}
+
+static void soft_output_frame(soft_video_t *vid)
+{
+   if (vid->hash_log)
+   {
+      uint32_t crc = crc32_calculate((const uint8_t*)vid->fb, vid->width * vid->height * sizeof(uint32_t));
+      fprintf(vid->hash_log, "%u %08x\n", vid->frames, (unsigned)crc);
+      fflush(vid->hash_log);
+   }
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (vid->dump)
+   {
+      char name[64], path[PATH_MAX];
+      snprintf(name, sizeof(name), "frame-%06u.png", vid->frames);
+      fill_pathname_join(path, g_settings.video.soft_dump_dir, name, sizeof(path));
+      if (!rpng_save_image_argb(path, vid->fb, vid->width, vid->height, vid->width * sizeof(uint32_t)))
+         RARCH_ERR("video_soft: Failed to write %s.\n", path);
+   }
+#endif
+
+   vid->frames++;
+}
+
+static bool soft_gfx_frame(void *data, const void *frame, unsigned width, unsigned height, unsigned pitch, const char *msg)
+{
+   soft_video_t *vid = (soft_video_t*)data;
+   uint32_t *output;
+
+   // A duplicated frame leaves the framebuffer as it is, but is still a frame in the log.
+   if (!frame || !width || !height)
+   {
+      soft_output_frame(vid);
+      return true;
+   }
+
+   if (width != vid->last_width || height != vid->last_height || vid->should_resize)
+   {
+      if (!soft_update_scaler(vid, width, height))
+         return false;
+   }
+
+   if (vid->need_clear)
+   {
+      soft_fill(vid->fb, vid->width, vid->width, vid->height, 0xff000000);
+      vid->need_clear = false;
+   }
+
+   output = vid->fb + vid->vp.y * vid->width + vid->vp.x;
+   vid->scaler.in_stride = pitch;
+
+   RARCH_PERFORMANCE_INIT(soft_scale);
+   RARCH_PERFORMANCE_START(soft_scale);
+   scaler_ctx_scale(&vid->scaler, output, frame);
+   RARCH_PERFORMANCE_STOP(soft_scale);
+
+   // X is undefined in XRGB8888 frames. Keep the framebuffer opaque, so hashes only depend on the picture.
+   if (vid->scaler.in_fmt == SCALER_FMT_ARGB8888)
+      soft_make_opaque(output, vid->width, vid->vp.width, vid->vp.height);
+
+   if (msg)
+      soft_font_render_msg(&vid->font, output, vid->width * sizeof(uint32_t), sizeof(uint32_t),
+            vid->vp.width, vid->vp.height, msg);
+
+#ifdef HAVE_OVERLAY
+   // Full screen overlays draw over the borders, which then need clearing for the next frame.
+   if (soft_overlay_render(vid->overlay, vid->fb, vid->width * sizeof(uint32_t), sizeof(uint32_t),
+            vid->width, vid->height, &vid->vp))
+      vid->need_clear = true;
+#endif
+
+   soft_output_frame(vid);
+   g_extern.frame_count++;
+   return true;
+}
+
+static void soft_gfx_set_nonblock_state(void *data, bool state)
+{
+   (void)data;
+   (void)state;
+}
+
+static bool soft_gfx_alive(void *data)
+{
+   (void)data;
+   return true;
+}
+
+static bool soft_gfx_focus(void *data)
+{
+   (void)data;
+   return true;
+}
+
+static void soft_gfx_viewport_info(void *data, struct rarch_viewport *vp)
+{
+   soft_video_t *vid = (soft_video_t*)data;
+   *vp = vid->vp;
+   vp->full_width  = vid->width;
+   vp->full_height = vid->height;
+   if (!vp->width || !vp->height)
+   {
+      vp->width  = vid->width;
+      vp->height = vid->height;
+   }
+}
+
+// Bottom-up BGR24 like the GL driver.
+static bool soft_gfx_read_viewport(void *data, uint8_t *buffer)
+{
+   soft_video_t *vid = (soft_video_t*)data;
+   unsigned x, y;
+
+   if (!vid->vp.width || !vid->vp.height)
+      return false;
+
+   for (y = 0; y < vid->vp.height; y++)
+   {
+      const uint32_t *src = vid->fb + (vid->vp.y + vid->vp.height - 1 - y) * vid->width + vid->vp.x;
+      for (x = 0; x < vid->vp.width; x++, buffer += 3)
+      {
+         buffer[0] = src[x] >>  0;
+         buffer[1] = src[x] >>  8;
+         buffer[2] = src[x] >> 16;
+      }
+   }
+
+   return true;
+}
+
+#ifdef HAVE_OVERLAY
+SOFT_OVERLAY_INTERFACE(soft_gfx, ((soft_video_t*)data)->overlay);
+
+static void soft_gfx_get_overlay_interface(void *data, const video_overlay_interface_t **iface)
+{
+   (void)data;
+   *iface = &soft_gfx_overlay_interface;
+}
+#endif
+
+static void soft_gfx_set_aspect_ratio(void *data, unsigned aspect_ratio_idx)
+{
+   soft_video_t *vid = (soft_video_t*)data;
+
+   switch (aspect_ratio_idx)
+   {
+      case ASPECT_RATIO_SQUARE:
+         gfx_set_square_pixel_viewport(g_extern.system.av_info.geometry.base_width, g_extern.system.av_info.geometry.base_height);
+         break;
+
+      case ASPECT_RATIO_CORE:
+         gfx_set_core_viewport();
+         break;
+
+      case ASPECT_RATIO_CONFIG:
+         gfx_set_config_viewport();
+         break;
+
+      default:
+         break;
+   }
+
+   g_extern.system.aspect_ratio = aspectratio_lut[aspect_ratio_idx].value;
+   vid->keep_aspect = true;
+   vid->should_resize = true;
+}
+
+static void soft_gfx_apply_state_changes(void *data)
+{
+   soft_video_t *vid = (soft_video_t*)data;
+   vid->should_resize = true;
+}
+
+static const video_poke_interface_t soft_poke_interface = {
+   NULL,
+#ifdef HAVE_FBO
+   NULL,
+   NULL,
+#endif
+   soft_gfx_set_aspect_ratio,
+   soft_gfx_apply_state_changes,
+#ifdef HAVE_MENU
+   NULL,
+   NULL,
+#endif
+   NULL,
+   NULL,
+   NULL,
+#ifdef HAVE_MENU
+   NULL,
+#endif
+};
+
+static void soft_gfx_get_poke_interface(void *data, const video_poke_interface_t **iface)
+{
+   (void)data;
+   *iface = &soft_poke_interface;
+}
+
+const video_driver_t video_soft = {
+   soft_gfx_init,
+   soft_gfx_frame,
+   soft_gfx_set_nonblock_state,
+   soft_gfx_alive,
+   soft_gfx_focus,
+   NULL,
+   soft_gfx_free,
+   "soft",
+
+#ifdef HAVE_MENU
+   NULL,
+#endif
+
+   NULL,
+   soft_gfx_viewport_info,
+   soft_gfx_read_viewport,
+#ifdef HAVE_OVERLAY
+   soft_gfx_get_overlay_interface,
+#endif
+   soft_gfx_get_poke_interface,
+};
@@ -0,0 +1,697 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "soft_overlay.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../general.h"
+
+#ifdef HAVE_OVERLAY
+
+#ifdef SCALER_NO_SIMD
+#undef __SSE2__
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD) && \
+   !defined(__ARMEB__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define SOFT_OVERLAY_NEON
+#endif
+
+// Run of pixels in a row of a scaled image which are all opaque or all translucent.
+struct soft_overlay_span
+{
+   unsigned x;
+   unsigned width;
+   bool opaque;
+};
+
+struct soft_overlay_image
+{
+   uint32_t *pixels; // Premultiplied ARGB8888.
+   unsigned width, height;
+   float tex[4], vertex[4];
+   float alpha;
+
+   // Image scaled to the size it was last drawn at.
+   uint32_t *scaled;
+   unsigned scaled_width, scaled_height;
+   float scaled_tex[4];
+   struct soft_overlay_span *spans;
+   unsigned num_spans;
+   unsigned *row_spans; // Index of the first span of each row, scaled_height + 1 entries.
+};
+
+struct soft_overlay
+{
+   struct soft_overlay_image *images;
+   unsigned num_images;
+   bool enable;
+   bool full_screen;
+};
+
+soft_overlay_t *soft_overlay_new(void)
+{
+   return (soft_overlay_t*)calloc(1, sizeof(soft_overlay_t));
+}
+
+static void soft_overlay_free_scaled(struct soft_overlay_image *img)
+{
+   free(img->scaled);
+   free(img->spans);
+   free(img->row_spans);
+   img->scaled = NULL;
+   img->spans = NULL;
+   img->row_spans = NULL;
+   img->num_spans = 0;
+   img->scaled_width = img->scaled_height = 0;
+}
+
+static void soft_overlay_free_images(soft_overlay_t *ov)
+{
+   unsigned i;
+   for (i = 0; i < ov->num_images; i++)
+   {
+      free(ov->images[i].pixels);
+      soft_overlay_free_scaled(&ov->images[i]);
+   }
+   free(ov->images);
+   ov->images = NULL;
+   ov->num_images = 0;
+}
+
+void soft_overlay_free(soft_overlay_t *ov)
+{
+   if (!ov)
+      return;
+   soft_overlay_free_images(ov);
+   free(ov);
+}
+
+void soft_overlay_enable(soft_overlay_t *ov, bool state)
+{
+   ov->enable = state;
+}
+
+bool soft_overlay_enabled(const soft_overlay_t *ov)
+{
+   return ov && ov->enable && ov->num_images;
+}
+
+void soft_overlay_tex_geom(soft_overlay_t *ov, unsigned image, float x, float y, float w, float h)
+{
+   struct soft_overlay_image *img = &ov->images[image];
+   img->tex[0] = x;
+   img->tex[1] = y;
+   img->tex[2] = w;
+   img->tex[3] = h;
+}
+
+void soft_overlay_vertex_geom(soft_overlay_t *ov, unsigned image, float x, float y, float w, float h)
+{
+   struct soft_overlay_image *img = &ov->images[image];
+   img->vertex[0] = x;
+   img->vertex[1] = y;
+   img->vertex[2] = w;
+   img->vertex[3] = h;
+}
+
+void soft_overlay_full_screen(soft_overlay_t *ov, bool enable)
+{
+   ov->full_screen = enable;
+}
+
+void soft_overlay_set_alpha(soft_overlay_t *ov, unsigned image, float mod)
+{
+   ov->images[image].alpha = mod;
+}
+
+void soft_overlay_update(soft_overlay_t *ov, const struct video_overlay_update *updates, unsigned num_updates)
+{
+   unsigned i;
+   for (i = 0; i < num_updates; i++)
+   {
+      soft_overlay_vertex_geom(ov, updates[i].image, updates[i].x, updates[i].y, updates[i].w, updates[i].h);
+      soft_overlay_set_alpha(ov, updates[i].image, updates[i].alpha);
+   }
+}
+
+bool soft_overlay_load(soft_overlay_t *ov, const struct texture_image *images, unsigned num_images)
+{
+   unsigned i, j;
+
+   soft_overlay_free_images(ov);
+   ov->images = (struct soft_overlay_image*)calloc(num_images, sizeof(*ov->images));
+   if (!ov->images)
+      return false;
+   ov->num_images = num_images;
+
+   for (i = 0; i < num_images; i++)
+   {
+      struct soft_overlay_image *img = &ov->images[i];
+      unsigned size = images[i].width * images[i].height;
+
+      img->pixels = (uint32_t*)malloc(size * sizeof(uint32_t));
+      if (!img->pixels)
+      {
+         soft_overlay_free_images(ov);
+         return false;
+      }
+
+      for (j = 0; j < size; j++)
+      {
+         uint32_t col = images[i].pixels[j];
+         unsigned a = col >> 24;
+         unsigned m = a + (a >> 7);
+         unsigned r = (((col >> 16) & 0xff) * m) >> 8;
+         unsigned g = (((col >>  8) & 0xff) * m) >> 8;
+         unsigned b = (((col >>  0) & 0xff) * m) >> 8;
+         img->pixels[j] = (a << 24) | (r << 16) | (g << 8) | b;
+      }
+
+      img->width  = images[i].width;
+      img->height = images[i].height;
+      img->alpha  = 1.0f;
+      soft_overlay_tex_geom(ov, i, 0, 0, 1, 1); // Default. Stretch to whole screen.
+      soft_overlay_vertex_geom(ov, i, 0, 0, 1, 1);
+   }
+
+   return true;
+}
+
+// Bilinear filtering setup for one axis. For every output pixel, the two source texels
+// it is between and the 8-bit weight of the second one.
+static void soft_overlay_filter_coords(unsigned *index, unsigned *weight,
+      unsigned out_size, unsigned in_size, float tex_pos, float tex_size)
+{
+   unsigned i;
+   for (i = 0; i < out_size; i++)
+   {
+      // Texel position in 1/256ths, rounded so an unscaled image maps exactly onto texels.
+      float pos = (tex_pos + tex_size * (i + 0.5f) / out_size) * in_size - 0.5f;
+      int fixed = (int)floorf(pos * 256.0f + 0.5f);
+      int base = fixed >> 8;
+      unsigned w = fixed & 0xff;
+
+      if (fixed < 0)
+      {
+         base = 0;
+         w = 0;
+      }
+      else if (base >= (int)in_size - 1)
+      {
+         base = in_size - 1;
+         w = 0;
+      }
+
+      index[i]  = base;
+      weight[i] = w;
+   }
+}
+
+static inline uint32_t soft_overlay_lerp(uint32_t a, uint32_t b, unsigned w)
+{
+   // Per channel a + (b - a) * w, two channels at a time.
+   uint32_t rb = (((a & 0xff00ff) * (256 - w) + (b & 0xff00ff) * w) >> 8) & 0xff00ff;
+   uint32_t ag = ((((a >> 8) & 0xff00ff) * (256 - w) + ((b >> 8) & 0xff00ff) * w)) & 0xff00ff00;
+   return rb | ag;
+}
+
+static bool soft_overlay_add_span(struct soft_overlay_image *img, unsigned *cap,
+      unsigned x, unsigned width, bool opaque)
+{
+   if (img->num_spans == *cap)
+   {
+      unsigned new_cap = *cap ? *cap * 2 : 64;
+      struct soft_overlay_span *spans = (struct soft_overlay_span*)
+         realloc(img->spans, new_cap * sizeof(*spans));
+      if (!spans)
+         return false;
+      img->spans = spans;
+      *cap = new_cap;
+   }
+
+   img->spans[img->num_spans].x = x;
+   img->spans[img->num_spans].width = width;
+   img->spans[img->num_spans].opaque = opaque;
+   img->num_spans++;
+   return true;
+}
+
+static bool soft_overlay_scale(struct soft_overlay_image *img, unsigned width, unsigned height)
+{
+   unsigned x, y, cap = 0;
+   unsigned *x_index, *x_weight, *y_index, *y_weight;
+
+   soft_overlay_free_scaled(img);
+
+   img->scaled = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+   img->row_spans = (unsigned*)malloc((height + 1) * sizeof(unsigned));
+   x_index = (unsigned*)malloc(2 * (width + height) * sizeof(unsigned));
+   if (!img->scaled || !img->row_spans || !x_index)
+   {
+      free(x_index);
+      soft_overlay_free_scaled(img);
+      return false;
+   }
+
+   x_weight = x_index + width;
+   y_index = x_weight + width;
+   y_weight = y_index + height;
+   soft_overlay_filter_coords(x_index, x_weight, width, img->width, img->tex[0], img->tex[2]);
+   soft_overlay_filter_coords(y_index, y_weight, height, img->height, img->tex[1], img->tex[3]);
+
+   for (y = 0; y < height; y++)
+   {
+      uint32_t *out = img->scaled + y * width;
+      const uint32_t *top = img->pixels + y_index[y] * img->width;
+      const uint32_t *bottom = y_weight[y] ? top + img->width : top;
+      unsigned start = 0;
+
+      for (x = 0; x < width; x++)
+      {
+         unsigned i = x_index[x];
+         unsigned i1 = x_weight[x] ? i + 1 : i;
+         out[x] = soft_overlay_lerp(
+               soft_overlay_lerp(top[i], top[i1], x_weight[x]),
+               soft_overlay_lerp(bottom[i], bottom[i1], x_weight[x]),
+               y_weight[y]);
+      }
+
+      // Split the row into runs of transparent, translucent and opaque pixels.
+      img->row_spans[y] = img->num_spans;
+      while (start < width)
+      {
+         unsigned a = out[start] >> 24;
+         unsigned end = start + 1;
+         bool opaque = a == 0xff;
+
+         if (!a)
+         {
+            while (end < width && !(out[end] >> 24))
+               end++;
+         }
+         else
+         {
+            while (end < width && (out[end] >> 24) && (((out[end] >> 24) == 0xff) == opaque))
+               end++;
+            if (!soft_overlay_add_span(img, &cap, start, end - start, opaque))
+            {
+               free(x_index);
+               soft_overlay_free_scaled(img);
+               return false;
+            }
+         }
+
+         start = end;
+      }
+   }
+
+   free(x_index);
+   img->row_spans[height] = img->num_spans;
+   img->scaled_width  = width;
+   img->scaled_height = height;
+   memcpy(img->scaled_tex, img->tex, sizeof(img->tex));
+   return true;
+}
+
+// Blending is done on premultiplied colors: out = src * mod + dst * (1 - src_alpha * mod),
+// with mod (alpha modulation) and alpha in 0 - 256. The SIMD paths give the same results.
+
+static inline void soft_overlay_blend_8888_c(uint32_t *dst, const uint32_t *src,
+      unsigned width, unsigned mod)
+{
+   unsigned i;
+   for (i = 0; i < width; i++)
+   {
+      uint32_t s = src[i];
+      uint32_t d = dst[i];
+      unsigned a = s >> 24;
+      unsigned r = (s >> 16) & 0xff;
+      unsigned g = (s >>  8) & 0xff;
+      unsigned b = (s >>  0) & 0xff;
+      unsigned k;
+
+      if (mod < 256)
+      {
+         a = (a * mod) >> 8;
+         r = (r * mod) >> 8;
+         g = (g * mod) >> 8;
+         b = (b * mod) >> 8;
+      }
+
+      k = 256 - (a + (a >> 7));
+      r += (((d >> 16) & 0xff) * k) >> 8;
+      g += (((d >>  8) & 0xff) * k) >> 8;
+      b += (((d >>  0) & 0xff) * k) >> 8;
+
+      if (r > 255)
+         r = 255;
+      if (g > 255)
+         g = 255;
+      if (b > 255)
+         b = 255;
+
+      dst[i] = (0xffu << 24) | (r << 16) | (g << 8) | b;
+   }
+}
+
+static inline void soft_overlay_blend_565_c(uint16_t *dst, const uint32_t *src,
+      unsigned width, unsigned mod)
+{
+   unsigned i;
+   for (i = 0; i < width; i++)
+   {
+      uint32_t s = src[i];
+      unsigned d = dst[i];
+      unsigned a = s >> 24;
+      unsigned r = (s >> 16) & 0xff;
+      unsigned g = (s >>  8) & 0xff;
+      unsigned b = (s >>  0) & 0xff;
+      unsigned k;
+
+      if (mod < 256)
+      {
+         a = (a * mod) >> 8;
+         r = (r * mod) >> 8;
+         g = (g * mod) >> 8;
+         b = (b * mod) >> 8;
+      }
+
+      k = 256 - (a + (a >> 7));
+      r += ((((d >> 8) & 0xf8) | (d >> 13)) * k) >> 8;
+      g += ((((d >> 3) & 0xfc) | ((d >> 9) & 3)) * k) >> 8;
+      b += ((((d << 3) & 0xf8) | ((d >> 2) & 7)) * k) >> 8;
+
+      if (r > 255)
+         r = 255;
+      if (g > 255)
+         g = 255;
+      if (b > 255)
+         b = 255;
+
+      dst[i] = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+   }
+}
+
+static void soft_overlay_blend_8888(uint32_t *dst, const uint32_t *src,
+      unsigned width, unsigned mod)
+{
+   unsigned i = 0;
+#if defined(__SSE2__)
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i mod_vec = _mm_set1_epi16(mod);
+   const __m128i one = _mm_set1_epi16(256);
+   const __m128i opaque = _mm_set1_epi32(0xff000000);
+
+   for (; i + 4 <= width; i += 4)
+   {
+      __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+      __m128i s_lo = _mm_unpacklo_epi8(s, zero);
+      __m128i s_hi = _mm_unpackhi_epi8(s, zero);
+      __m128i d_lo = _mm_unpacklo_epi8(d, zero);
+      __m128i d_hi = _mm_unpackhi_epi8(d, zero);
+      __m128i a_lo, a_hi;
+
+      if (mod < 256)
+      {
+         s_lo = _mm_srli_epi16(_mm_mullo_epi16(s_lo, mod_vec), 8);
+         s_hi = _mm_srli_epi16(_mm_mullo_epi16(s_hi, mod_vec), 8);
+      }
+
+      // Broadcast alpha over the four channels of each pixel.
+      a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+      a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+      a_lo = _mm_sub_epi16(one, _mm_add_epi16(a_lo, _mm_srli_epi16(a_lo, 7)));
+      a_hi = _mm_sub_epi16(one, _mm_add_epi16(a_hi, _mm_srli_epi16(a_hi, 7)));
+
+      d_lo = _mm_add_epi16(s_lo, _mm_srli_epi16(_mm_mullo_epi16(d_lo, a_lo), 8));
+      d_hi = _mm_add_epi16(s_hi, _mm_srli_epi16(_mm_mullo_epi16(d_hi, a_hi), 8));
+
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_packus_epi16(d_lo, d_hi), opaque));
+   }
+#elif defined(SOFT_OVERLAY_NEON)
+   const uint16x8_t one = vdupq_n_u16(256);
+   const uint8x8_t mod_vec = vdup_n_u8(mod < 256 ? mod : 0);
+
+   for (; i + 8 <= width; i += 8)
+   {
+      uint8x8x4_t s = vld4_u8((const uint8_t*)(src + i));
+      uint8x8x4_t d = vld4_u8((const uint8_t*)(dst + i));
+      uint16x8_t a, k;
+      unsigned c;
+
+      if (mod < 256)
+      {
+         for (c = 0; c < 4; c++)
+            s.val[c] = vshrn_n_u16(vmull_u8(s.val[c], mod_vec), 8);
+      }
+
+      a = vmovl_u8(s.val[3]);
+      k = vsubq_u16(one, vaddq_u16(a, vshrq_n_u16(a, 7)));
+
+      for (c = 0; c < 3; c++)
+         d.val[c] = vqmovn_u16(vaddq_u16(vmovl_u8(s.val[c]),
+                  vshrq_n_u16(vmulq_u16(vmovl_u8(d.val[c]), k), 8)));
+      d.val[3] = vdup_n_u8(0xff);
+
+      vst4_u8((uint8_t*)(dst + i), d);
+   }
+#endif
+
+   soft_overlay_blend_8888_c(dst + i, src + i, width - i, mod);
+}
+
+static void soft_overlay_blend_565(uint16_t *dst, const uint32_t *src,
+      unsigned width, unsigned mod)
+{
+   unsigned i = 0;
+#if defined(__SSE2__)
+   const __m128i mod_vec = _mm_set1_epi16(mod);
+   const __m128i one = _mm_set1_epi16(256);
+   const __m128i max = _mm_set1_epi16(255);
+   const __m128i byte_mask = _mm_set1_epi32(0xff);
+   const __m128i mask_f8 = _mm_set1_epi16(0xf8);
+   const __m128i mask_fc = _mm_set1_epi16(0xfc);
+   const __m128i mask_3 = _mm_set1_epi16(3);
+   const __m128i mask_7 = _mm_set1_epi16(7);
+
+   for (; i + 8 <= width; i += 8)
+   {
+      __m128i s0 = _mm_loadu_si128((const __m128i*)(src + i + 0));
+      __m128i s1 = _mm_loadu_si128((const __m128i*)(src + i + 4));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+      __m128i sa = _mm_packs_epi32(_mm_srli_epi32(s0, 24), _mm_srli_epi32(s1, 24));
+      __m128i sr = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 16), byte_mask),
+            _mm_and_si128(_mm_srli_epi32(s1, 16), byte_mask));
+      __m128i sg = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, 8), byte_mask),
+            _mm_and_si128(_mm_srli_epi32(s1, 8), byte_mask));
+      __m128i sb = _mm_packs_epi32(_mm_and_si128(s0, byte_mask), _mm_and_si128(s1, byte_mask));
+
+      __m128i dr = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(d, 8), mask_f8), _mm_srli_epi16(d, 13));
+      __m128i dg = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(d, 3), mask_fc),
+            _mm_and_si128(_mm_srli_epi16(d, 9), mask_3));
+      __m128i db = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(d, 3), mask_f8),
+            _mm_and_si128(_mm_srli_epi16(d, 2), mask_7));
+      __m128i k;
+
+      if (mod < 256)
+      {
+         sa = _mm_srli_epi16(_mm_mullo_epi16(sa, mod_vec), 8);
+         sr = _mm_srli_epi16(_mm_mullo_epi16(sr, mod_vec), 8);
+         sg = _mm_srli_epi16(_mm_mullo_epi16(sg, mod_vec), 8);
+         sb = _mm_srli_epi16(_mm_mullo_epi16(sb, mod_vec), 8);
+      }
+
+      k = _mm_sub_epi16(one, _mm_add_epi16(sa, _mm_srli_epi16(sa, 7)));
+      dr = _mm_min_epi16(_mm_add_epi16(sr, _mm_srli_epi16(_mm_mullo_epi16(dr, k), 8)), max);
+      dg = _mm_min_epi16(_mm_add_epi16(sg, _mm_srli_epi16(_mm_mullo_epi16(dg, k), 8)), max);
+      db = _mm_min_epi16(_mm_add_epi16(sb, _mm_srli_epi16(_mm_mullo_epi16(db, k), 8)), max);
+
+      d = _mm_or_si128(_mm_or_si128(
+               _mm_slli_epi16(_mm_and_si128(dr, mask_f8), 8),
+               _mm_slli_epi16(_mm_and_si128(dg, mask_fc), 3)),
+            _mm_srli_epi16(db, 3));
+      _mm_storeu_si128((__m128i*)(dst + i), d);
+   }
+#elif defined(SOFT_OVERLAY_NEON)
+   const uint16x8_t one = vdupq_n_u16(256);
+   const uint16x8_t max = vdupq_n_u16(255);
+   const uint16x8_t mask_f8 = vdupq_n_u16(0xf8);
+   const uint16x8_t mask_fc = vdupq_n_u16(0xfc);
+   const uint16x8_t mask_3 = vdupq_n_u16(3);
+   const uint16x8_t mask_7 = vdupq_n_u16(7);
+   const uint8x8_t mod_vec = vdup_n_u8(mod < 256 ? mod : 0);
+
+   for (; i + 8 <= width; i += 8)
+   {
+      uint8x8x4_t s = vld4_u8((const uint8_t*)(src + i));
+      uint16x8_t d = vld1q_u16(dst + i);
+      uint16x8_t dr = vorrq_u16(vandq_u16(vshrq_n_u16(d, 8), mask_f8), vshrq_n_u16(d, 13));
+      uint16x8_t dg = vorrq_u16(vandq_u16(vshrq_n_u16(d, 3), mask_fc), vandq_u16(vshrq_n_u16(d, 9), mask_3));
+      uint16x8_t db = vorrq_u16(vandq_u16(vshlq_n_u16(d, 3), mask_f8), vandq_u16(vshrq_n_u16(d, 2), mask_7));
+      uint16x8_t a, k;
+      unsigned c;
+
+      if (mod < 256)
+      {
+         for (c = 0; c < 4; c++)
+            s.val[c] = vshrn_n_u16(vmull_u8(s.val[c], mod_vec), 8);
+      }
+
+      a = vmovl_u8(s.val[3]);
+      k = vsubq_u16(one, vaddq_u16(a, vshrq_n_u16(a, 7)));
+      dr = vminq_u16(vaddq_u16(vmovl_u8(s.val[2]), vshrq_n_u16(vmulq_u16(dr, k), 8)), max);
+      dg = vminq_u16(vaddq_u16(vmovl_u8(s.val[1]), vshrq_n_u16(vmulq_u16(dg, k), 8)), max);
+      db = vminq_u16(vaddq_u16(vmovl_u8(s.val[0]), vshrq_n_u16(vmulq_u16(db, k), 8)), max);
+
+      d = vorrq_u16(vorrq_u16(
+               vshlq_n_u16(vandq_u16(dr, mask_f8), 8),
+               vshlq_n_u16(vandq_u16(dg, mask_fc), 3)),
+            vshrq_n_u16(db, 3));
+      vst1q_u16(dst + i, d);
+   }
+#endif
+
+   soft_overlay_blend_565_c(dst + i, src + i, width - i, mod);
+}
+
+static void soft_overlay_copy_565(uint16_t *dst, const uint32_t *src, unsigned width)
+{
+   unsigned i;
+   for (i = 0; i < width; i++)
+   {
+      uint32_t s = src[i];
+      dst[i] = ((s >> 8) & 0xf800) | ((s >> 5) & 0x07e0) | ((s >> 3) & 0x001f);
+   }
+}
+
+bool soft_overlay_render(soft_overlay_t *ov, void *buffer, unsigned stride, unsigned bytes_per_pixel,
+      unsigned width, unsigned height, const struct rarch_viewport *vp)
+{
+   unsigned i;
+   int area_x = 0, area_y = 0;
+   int area_w = width, area_h = height;
+   bool outside = false;
+
+   if (!soft_overlay_enabled(ov))
+      return false;
+
+   if (vp && !ov->full_screen)
+   {
+      area_x = vp->x;
+      area_y = vp->y;
+      area_w = vp->width;
+      area_h = vp->height;
+   }
+
+   for (i = 0; i < ov->num_images; i++)
+   {
+      struct soft_overlay_image *img = &ov->images[i];
+      int x0 = area_x + (int)roundf(img->vertex[0] * area_w);
+      int y0 = area_y + (int)roundf(img->vertex[1] * area_h);
+      int x1 = area_x + (int)roundf((img->vertex[0] + img->vertex[2]) * area_w);
+      int y1 = area_y + (int)roundf((img->vertex[1] + img->vertex[3]) * area_h);
+      int clip_x0 = x0, clip_y0 = y0, clip_x1 = x1, clip_y1 = y1;
+      int y;
+      unsigned mod;
+
+      if (img->alpha <= 0.0f || x1 <= x0 || y1 <= y0 || !img->width || !img->height)
+         continue;
+      mod = img->alpha >= 1.0f ? 256 : (unsigned)(img->alpha * 256.0f);
+      if (!mod)
+         continue;
+
+      // Like the GL driver, overlays are clipped to the area they are placed in.
+      if (clip_x0 < area_x)
+         clip_x0 = area_x;
+      if (clip_y0 < area_y)
+         clip_y0 = area_y;
+      if (clip_x1 > area_x + area_w)
+         clip_x1 = area_x + area_w;
+      if (clip_y1 > area_y + area_h)
+         clip_y1 = area_y + area_h;
+      if (clip_x0 < 0)
+         clip_x0 = 0;
+      if (clip_y0 < 0)
+         clip_y0 = 0;
+      if (clip_x1 > (int)width)
+         clip_x1 = width;
+      if (clip_y1 > (int)height)
+         clip_y1 = height;
+      if (clip_x0 >= clip_x1 || clip_y0 >= clip_y1)
+         continue;
+
+      if (img->scaled_width != (unsigned)(x1 - x0) || img->scaled_height != (unsigned)(y1 - y0) ||
+            memcmp(img->scaled_tex, img->tex, sizeof(img->tex)))
+      {
+         if (!soft_overlay_scale(img, x1 - x0, y1 - y0))
+            continue;
+      }
+
+      for (y = clip_y0; y < clip_y1; y++)
+      {
+         unsigned row = y - y0;
+         const uint32_t *src = img->scaled + row * img->scaled_width;
+         uint8_t *line = (uint8_t*)buffer + y * stride;
+         unsigned s;
+
+         for (s = img->row_spans[row]; s < img->row_spans[row + 1]; s++)
+         {
+            const struct soft_overlay_span *span = &img->spans[s];
+            int start = x0 + (int)span->x;
+            int end = start + (int)span->width;
+
+            if (start < clip_x0)
+               start = clip_x0;
+            if (end > clip_x1)
+               end = clip_x1;
+            if (start >= end)
+               continue;
+
+            if (vp && (start < vp->x || end > vp->x + (int)vp->width ||
+                     y < vp->y || y >= vp->y + (int)vp->height))
+               outside = true;
+
+            if (bytes_per_pixel == 2)
+            {
+               uint16_t *out = (uint16_t*)line + start;
+               if (span->opaque && mod == 256)
+                  soft_overlay_copy_565(out, src + (start - x0), end - start);
+               else
+                  soft_overlay_blend_565(out, src + (start - x0), end - start, mod);
+            }
+            else
+            {
+               uint32_t *out = (uint32_t*)line + start;
+               if (span->opaque && mod == 256)
+                  memcpy(out, src + (start - x0), (end - start) * sizeof(uint32_t));
+               else
+                  soft_overlay_blend_8888(out, src + (start - x0), end - start, mod);
+            }
+         }
+      }
+   }
+
+   return outside;
+}
+
+#endif
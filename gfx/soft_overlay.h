@@ -0,0 +1,101 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFT_OVERLAY_H__
+#define SOFT_OVERLAY_H__
+
+#include "../driver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef HAVE_OVERLAY
+
+// Overlay compositor for video drivers which draw frames with the CPU.
+// Every image is scaled (bilinear, like the GL driver) once per size it is drawn at,
+// and kept premultiplied with a list of the spans which are not fully transparent.
+// Drawing is then only blending those spans, with SSE2 or NEON where available.
+
+typedef struct soft_overlay soft_overlay_t;
+
+soft_overlay_t *soft_overlay_new(void);
+void soft_overlay_free(soft_overlay_t *ov);
+
+// Same as in video_overlay_interface_t.
+void soft_overlay_enable(soft_overlay_t *ov, bool state);
+bool soft_overlay_load(soft_overlay_t *ov, const struct texture_image *images, unsigned num_images);
+void soft_overlay_tex_geom(soft_overlay_t *ov, unsigned image, float x, float y, float w, float h);
+void soft_overlay_vertex_geom(soft_overlay_t *ov, unsigned image, float x, float y, float w, float h);
+void soft_overlay_full_screen(soft_overlay_t *ov, bool enable);
+void soft_overlay_set_alpha(soft_overlay_t *ov, unsigned image, float mod);
+void soft_overlay_update(soft_overlay_t *ov, const struct video_overlay_update *updates, unsigned num_updates);
+
+bool soft_overlay_enabled(const soft_overlay_t *ov);
+
+// Blends the overlays over a width x height RGB565 (bytes_per_pixel 2) or XRGB8888 (4) image.
+// Overlays are placed in vp, or in the whole image when full screen or vp is NULL.
+// Returns true if anything was drawn outside of vp.
+bool soft_overlay_render(soft_overlay_t *ov, void *buffer, unsigned stride, unsigned bytes_per_pixel,
+      unsigned width, unsigned height, const struct rarch_viewport *vp);
+
+// Defines <prefix>_overlay_interface, a video_overlay_interface_t forwarding to the compositor.
+// get_overlay is an expression giving the driver's soft_overlay_t * from its void *data.
+#define SOFT_OVERLAY_INTERFACE(prefix, get_overlay) \
+static void prefix##_overlay_enable(void *data, bool state) \
+{ \
+   soft_overlay_enable(get_overlay, state); \
+} \
+static bool prefix##_overlay_load(void *data, const struct texture_image *images, unsigned num_images) \
+{ \
+   return soft_overlay_load(get_overlay, images, num_images); \
+} \
+static void prefix##_overlay_tex_geom(void *data, unsigned image, float x, float y, float w, float h) \
+{ \
+   soft_overlay_tex_geom(get_overlay, image, x, y, w, h); \
+} \
+static void prefix##_overlay_vertex_geom(void *data, unsigned image, float x, float y, float w, float h) \
+{ \
+   soft_overlay_vertex_geom(get_overlay, image, x, y, w, h); \
+} \
+static void prefix##_overlay_full_screen(void *data, bool enable) \
+{ \
+   soft_overlay_full_screen(get_overlay, enable); \
+} \
+static void prefix##_overlay_set_alpha(void *data, unsigned image, float mod) \
+{ \
+   soft_overlay_set_alpha(get_overlay, image, mod); \
+} \
+static void prefix##_overlay_update(void *data, const struct video_overlay_update *updates, unsigned num_updates) \
+{ \
+   soft_overlay_update(get_overlay, updates, num_updates); \
+} \
+static const video_overlay_interface_t prefix##_overlay_interface = { \
+   prefix##_overlay_enable, \
+   prefix##_overlay_load, \
+   prefix##_overlay_tex_geom, \
+   prefix##_overlay_vertex_geom, \
+   prefix##_overlay_full_screen, \
+   prefix##_overlay_set_alpha, \
+   prefix##_overlay_update, \
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
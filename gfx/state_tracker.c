@@ -24,36 +24,41 @@
 #include "py_state/py_state.h"
 #endif
 
-struct state_tracker_internal
+// Imports are compiled into ops, sorted so that every group of ops
+// has the same semantic and source, and is evaluated in one loop.
+struct state_tracker_op
 {
-   char id[64];
-
-   bool is_input;
-   const uint16_t *input_ptr;
-   const uint8_t *ptr;
-#ifdef HAVE_PYTHON
-   py_state_t *py;
-#endif
-
-   uint32_t addr;
+   const void *src; // RAM byte, or 16-bit input word.
    uint16_t mask;
-
    uint16_t equal;
 
-   enum state_tracker_type type;
-
    uint32_t prev[2];
    int frame_count;
    int frame_count_prev;
-   uint32_t old_value; 
+   uint32_t old_value;
    int transition_count;
+
+   unsigned index; // Uniform slot, in the order of the imports.
+};
+
+struct state_tracker_group
+{
+   enum state_tracker_type type;
+   bool is_input;
+   unsigned first;
+   unsigned count;
 };
 
 struct state_tracker
 {
-   struct state_tracker_internal *info;
+   struct state_tracker_op *ops;
+   char (*ids)[64]; // By uniform slot, kept out of the way of the ops.
    unsigned info_elem;
 
+   struct state_tracker_group groups[2 * (RARCH_STATE_PYTHON + 1)];
+   unsigned num_groups;
+
+   bool has_input;
    uint16_t input_state[2];
 
 #ifdef HAVE_PYTHON
@@ -61,9 +66,20 @@ struct state_tracker
 #endif
 };
 
+static unsigned op_group_key(const struct state_tracker_uniform_info *var)
+{
+   bool is_input = var->ram_type == RARCH_STATE_INPUT_SLOT1 ||
+      var->ram_type == RARCH_STATE_INPUT_SLOT2;
+   return var->type * 2 + is_input;
+}
+
 state_tracker_t* state_tracker_init(const struct state_tracker_info *info)
 {
-   unsigned i;
+   unsigned i, key, group_size[2 * (RARCH_STATE_PYTHON + 1)] = {0};
+   unsigned group_first[2 * (RARCH_STATE_PYTHON + 1)];
+   // If we don't have a valid pointer.
+   static const uint8_t empty = 0;
+
    state_tracker_t *tracker = (state_tracker_t*)calloc(1, sizeof(*tracker));
    if (!tracker)
       return NULL;
@@ -81,146 +97,181 @@ state_tracker_t* state_tracker_init(const struct state_tracker_info *info)
    }
 #endif
 
-   tracker->info = (struct state_tracker_internal*)calloc(info->info_elem, sizeof(struct state_tracker_internal));
-   tracker->info_elem = info->info_elem;
-
    for (i = 0; i < info->info_elem; i++)
    {
-      strlcpy(tracker->info[i].id, info->info[i].id, sizeof(tracker->info[i].id));
-      tracker->info[i].addr  = info->info[i].addr;
-      tracker->info[i].type  = info->info[i].type;
-      tracker->info[i].mask  = (info->info[i].mask == 0) ? 0xffff : info->info[i].mask;
-      tracker->info[i].equal = info->info[i].equal;
-
 #ifdef HAVE_PYTHON
-      if (info->info[i].type == RARCH_STATE_PYTHON)
+      if (info->info[i].type == RARCH_STATE_PYTHON && !tracker->py)
       {
-         if (!tracker->py)
-         {
-            free(tracker->info);
-            free(tracker);
-            RARCH_ERR("Python semantic was requested, but Python tracker is not loaded.\n");
-            return NULL;
-         }
-         tracker->info[i].py = tracker->py;
+         RARCH_ERR("Python semantic was requested, but Python tracker is not loaded.\n");
+         state_tracker_free(tracker);
+         return NULL;
       }
 #endif
 
-      // If we don't have a valid pointer.
-      static const uint8_t empty = 0;
+      group_size[op_group_key(&info->info[i])]++;
+   }
 
-      switch (info->info[i].ram_type)
+   tracker->ops = (struct state_tracker_op*)calloc(info->info_elem ? info->info_elem : 1, sizeof(*tracker->ops));
+   tracker->ids = (char (*)[64])calloc(info->info_elem ? info->info_elem : 1, sizeof(*tracker->ids));
+   if (!tracker->ops || !tracker->ids)
+   {
+      state_tracker_free(tracker);
+      return NULL;
+   }
+
+   // Lay the groups out back to back, imports keep their order within a group.
+   for (key = 0, i = 0; key < 2 * (RARCH_STATE_PYTHON + 1); key++)
+   {
+      struct state_tracker_group *group;
+
+      group_first[key] = i;
+      if (!group_size[key])
+         continue;
+
+      group = &tracker->groups[tracker->num_groups++];
+      group->type = (enum state_tracker_type)(key / 2);
+      group->is_input = key & 1;
+      group->first = i;
+      group->count = group_size[key];
+      i += group_size[key];
+   }
+
+   for (i = 0; i < info->info_elem; i++)
+   {
+      const struct state_tracker_uniform_info *var = &info->info[i];
+      struct state_tracker_op *op = &tracker->ops[group_first[op_group_key(var)]++];
+
+      strlcpy(tracker->ids[i], var->id, sizeof(tracker->ids[i]));
+      op->index = i;
+      op->mask  = (var->mask == 0) ? 0xffff : var->mask;
+      op->equal = var->equal;
+
+      switch (var->ram_type)
       {
          case RARCH_STATE_WRAM:
-            tracker->info[i].ptr = info->wram ? info->wram : &empty;
+            op->src = info->wram ? info->wram + var->addr : &empty;
             break;
          case RARCH_STATE_INPUT_SLOT1:
-            tracker->info[i].input_ptr = &tracker->input_state[0];
-            tracker->info[i].is_input = true;
+            op->src = &tracker->input_state[0];
+            tracker->has_input = true;
             break;
          case RARCH_STATE_INPUT_SLOT2:
-            tracker->info[i].input_ptr = &tracker->input_state[1];
-            tracker->info[i].is_input = true;
+            op->src = &tracker->input_state[1];
+            tracker->has_input = true;
             break;
 
          default:
-            tracker->info[i].ptr = &empty;
+            op->src = &empty;
       }
    }
 
+   tracker->info_elem = info->info_elem;
    return tracker;
 }
 
 void state_tracker_free(state_tracker_t *tracker)
 {
-   free(tracker->info);
+   if (!tracker)
+      return;
+
+   free(tracker->ops);
+   free(tracker->ids);
 #ifdef HAVE_PYTHON
    py_state_free(tracker->py);
 #endif
    free(tracker);
 }
 
-static inline uint16_t fetch(const struct state_tracker_internal *info)
+static inline uint16_t fetch_ram(const struct state_tracker_op *op)
 {
-   uint16_t val = 0;
-   if (info->is_input)
-      val = *info->input_ptr;
-   else
-      val = info->ptr[info->addr];
-
-   val &= info->mask;
-
-   if (info->equal && val != info->equal)
-      val = 0;
-
-   return val;
+   uint16_t val = *(const uint8_t*)op->src & op->mask;
+   return (op->equal && val != op->equal) ? 0 : val;
 }
 
-static void update_element(
-      struct state_tracker_uniform *uniform,
-      struct state_tracker_internal *info,
-      unsigned frame_count)
+static inline uint16_t fetch_input(const struct state_tracker_op *op)
 {
-   uniform->id = info->id;
+   uint16_t val = *(const uint16_t*)op->src & op->mask;
+   return (op->equal && val != op->equal) ? 0 : val;
+}
 
-   switch (info->type)
-   {
-      case RARCH_STATE_CAPTURE:
-         uniform->value = fetch(info);
-         break;
-
-      case RARCH_STATE_CAPTURE_PREV:
-         if (info->prev[0] != fetch(info))
-         {
-            info->prev[1] = info->prev[0];
-            info->prev[0] = fetch(info);
-         }
-         uniform->value = info->prev[1];
-         break;
-
-      case RARCH_STATE_TRANSITION:
-         if (info->old_value != fetch(info))
-         {
-            info->old_value = fetch(info);
-            info->frame_count = frame_count;
-         }
-         uniform->value = info->frame_count;
-         break;
-
-      case RARCH_STATE_TRANSITION_COUNT:
-         if (info->old_value != fetch(info))
-         {
-            info->old_value = fetch(info);
-            info->transition_count++;
-         }
-         uniform->value = info->transition_count;
-         break;
-
-      case RARCH_STATE_TRANSITION_PREV:
-         if (info->old_value != fetch(info))
-         {
-            info->old_value = fetch(info);
-            info->frame_count_prev = info->frame_count;
-            info->frame_count = frame_count;
-         }
-         uniform->value = info->frame_count_prev;
-         break;
-      
-#ifdef HAVE_PYTHON
-      case RARCH_STATE_PYTHON:
-         uniform->value = py_state_get(info->py, info->id, frame_count);
-         break;
-#endif
-      
-      default:
-         break;
+// Slots past what the caller has room for are still tracked, but not returned.
+#define STATE_TRACKER_STORE(op, val) do { \
+   if ((op)->index < elem) \
+   { \
+      uniforms[(op)->index].id = tracker->ids[(op)->index]; \
+      uniforms[(op)->index].value = (val); \
+   } \
+} while (0)
+
+// One loop per semantic, for ops that read the same kind of source.
+#define STATE_TRACKER_EVAL(fetch) \
+   switch (group->type) \
+   { \
+      case RARCH_STATE_CAPTURE: \
+         for (op = ops; op < end; op++) \
+            STATE_TRACKER_STORE(op, fetch(op)); \
+         break; \
+      case RARCH_STATE_CAPTURE_PREV: \
+         for (op = ops; op < end; op++) \
+         { \
+            uint32_t val = fetch(op); \
+            if (op->prev[0] != val) \
+            { \
+               op->prev[1] = op->prev[0]; \
+               op->prev[0] = val; \
+            } \
+            STATE_TRACKER_STORE(op, op->prev[1]); \
+         } \
+         break; \
+      case RARCH_STATE_TRANSITION: \
+         for (op = ops; op < end; op++) \
+         { \
+            uint32_t val = fetch(op); \
+            if (op->old_value != val) \
+            { \
+               op->old_value = val; \
+               op->frame_count = frame_count; \
+            } \
+            STATE_TRACKER_STORE(op, op->frame_count); \
+         } \
+         break; \
+      case RARCH_STATE_TRANSITION_COUNT: \
+         for (op = ops; op < end; op++) \
+         { \
+            uint32_t val = fetch(op); \
+            if (op->old_value != val) \
+            { \
+               op->old_value = val; \
+               op->transition_count++; \
+            } \
+            STATE_TRACKER_STORE(op, op->transition_count); \
+         } \
+         break; \
+      case RARCH_STATE_TRANSITION_PREV: \
+         for (op = ops; op < end; op++) \
+         { \
+            uint32_t val = fetch(op); \
+            if (op->old_value != val) \
+            { \
+               op->old_value = val; \
+               op->frame_count_prev = op->frame_count; \
+               op->frame_count = frame_count; \
+            } \
+            STATE_TRACKER_STORE(op, op->frame_count_prev); \
+         } \
+         break; \
+      default: \
+         for (op = ops; op < end; op++) \
+            if (op->index < elem) \
+               uniforms[op->index].id = tracker->ids[op->index]; \
+         break; \
    }
-}
 
 // Updates 16-bit input in same format as SNES itself.
 static void update_input(state_tracker_t *tracker)
 {
    unsigned i;
+   int joy_index[2];
    if (driver.input == NULL)
       return;
 
@@ -245,10 +296,17 @@ static void update_input(state_tracker_t *tracker)
       g_settings.input.binds[1],
    };
 
+   // Only the two players, and the joypads they are mapped to, need analog dpad binds.
    for (i = 0; i < 2; i++)
+   {
+      joy_index[i] = g_settings.input.joypad_map[i];
+      if (joy_index[i] < 0 || joy_index[i] >= MAX_PLAYERS || (i && joy_index[1] == joy_index[0]))
+         joy_index[i] = -1;
+
       input_push_analog_dpad(g_settings.input.binds[i], g_settings.input.analog_dpad_mode[i]);
-   for (i = 0; i < MAX_PLAYERS; i++)
-      input_push_analog_dpad(g_settings.input.autoconf_binds[i], g_settings.input.analog_dpad_mode[i]);
+      if (joy_index[i] >= 0)
+         input_push_analog_dpad(g_settings.input.autoconf_binds[joy_index[i]], g_settings.input.analog_dpad_mode[i]);
+   }
 
    uint16_t state[2] = {0};
    for (i = 4; i < 16; i++)
@@ -258,9 +316,11 @@ static void update_input(state_tracker_t *tracker)
    }
 
    for (i = 0; i < 2; i++)
+   {
       input_pop_analog_dpad(g_settings.input.binds[i]);
-   for (i = 0; i < MAX_PLAYERS; i++)
-      input_pop_analog_dpad(g_settings.input.autoconf_binds[i]);
+      if (joy_index[i] >= 0)
+         input_pop_analog_dpad(g_settings.input.autoconf_binds[joy_index[i]]);
+   }
 
    for (i = 0; i < 2; i++)
       tracker->input_state[i] = state[i];
@@ -268,14 +328,38 @@ static void update_input(state_tracker_t *tracker)
 
 unsigned state_get_uniform(state_tracker_t *tracker, struct state_tracker_uniform *uniforms, unsigned elem, unsigned frame_count)
 {
-   unsigned i, elems;
-   elems = tracker->info_elem < elem ? tracker->info_elem : elem;
+   unsigned g;
+   const struct state_tracker_op *end;
+   struct state_tracker_op *op, *ops;
 
-   update_input(tracker);
+   // Callers query once per frame. Input is only sampled if an import reads it.
+   if (tracker->has_input)
+      update_input(tracker);
 
-   for (i = 0; i < elems; i++)
-      update_element(&uniforms[i], &tracker->info[i], frame_count);
+   for (g = 0; g < tracker->num_groups; g++)
+   {
+      const struct state_tracker_group *group = &tracker->groups[g];
+      ops = tracker->ops + group->first;
+      end = ops + group->count;
 
-   return elems;
-}
+#ifdef HAVE_PYTHON
+      if (group->type == RARCH_STATE_PYTHON)
+      {
+         for (op = ops; op < end; op++)
+            STATE_TRACKER_STORE(op, py_state_get(tracker->py, tracker->ids[op->index], frame_count));
+         continue;
+      }
+#endif
+
+      if (group->is_input)
+      {
+         STATE_TRACKER_EVAL(fetch_input)
+      }
+      else
+      {
+         STATE_TRACKER_EVAL(fetch_ram)
+      }
+   }
 
+   return tracker->info_elem < elem ? tracker->info_elem : elem;
+}
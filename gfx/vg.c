@@ -212,12 +212,12 @@ static void vg_render_message(vg_t *vg, const char *msg)
       vgClearGlyph(vg->mFont, 0);
    }
 
-   struct font_output_list out;
-   vg->font_driver->render_msg(vg->mFontRenderer, msg, &out);
-   struct font_output *head = out.head;
+   struct font_output glyphs[FONT_MAX_GLYPHS];
+   unsigned num_glyphs = vg->font_driver->render_msg(vg->mFontRenderer, msg, glyphs, FONT_MAX_GLYPHS);
 
-   while (head)
+   for (unsigned g = 0; g < num_glyphs; g++)
    {
+      const struct font_output *head = &glyphs[g];
       if (vg->mMsgLength >= 1024)
          break;
 
@@ -239,11 +239,8 @@ static void vg_render_message(vg_t *vg, const char *msg)
       vgDestroyImage(img);
 
       vg->mMsgLength++;
-      head = head->next;
    }
 
-   vg->font_driver->free_output(vg->mFontRenderer, &out);
-
    for (unsigned i = 0; i < vg->mMsgLength; i++)
       vg->mGlyphIndices[i] = i;
 }
@@ -17,6 +17,7 @@
 #include "../thread.h"
 #include "../general.h"
 #include "../performance.h"
+#include "../frame_trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
@@ -98,6 +99,13 @@ typedef struct thread_video
    bool alpha_update;
    slock_t *alpha_lock;
 
+#ifdef HAVE_OVERLAY
+   // Vertex geometry from overlay update(), applied before the next frame like alpha_mod.
+   struct video_overlay_update *overlay_geom;
+   bool *overlay_geom_dirty;
+   bool overlay_geom_update;
+#endif
+
    enum thread_cmd send_cmd;
    enum thread_cmd reply_cmd;
    union
@@ -196,6 +204,21 @@ static void thread_update_driver_state(thread_video_t *thr)
          thr->overlay->set_alpha(thr->driver_data, i, thr->alpha_mod[i]);
       thr->alpha_update = false;
    }
+
+   if (thr->overlay_geom_update)
+   {
+      unsigned i;
+      for (i = 0; i < thr->alpha_mods; i++)
+      {
+         const struct video_overlay_update *geom = &thr->overlay_geom[i];
+         if (!thr->overlay_geom_dirty[i])
+            continue;
+
+         thr->overlay->vertex_geom(thr->driver_data, i, geom->x, geom->y, geom->w, geom->h);
+         thr->overlay_geom_dirty[i] = false;
+      }
+      thr->overlay_geom_update = false;
+   }
    slock_unlock(thr->alpha_lock);
 #endif
 
@@ -291,10 +314,19 @@ static void thread_loop(void *data)
             thr->cmd_data.b = thr->overlay->load(thr->driver_data,
                   thr->cmd_data.image.data,
                   thr->cmd_data.image.num);
+            slock_lock(thr->alpha_lock);
             thr->alpha_mods = thr->cmd_data.image.num;
             thr->alpha_mod = (float*)realloc(thr->alpha_mod, thr->alpha_mods * sizeof(float));
             for (i = 0; i < thr->alpha_mods; i++) // Avoid temporary garbage data.
                thr->alpha_mod[i] = 1.0f;
+
+            // Pending geometry belongs to the previous images.
+            thr->overlay_geom = (struct video_overlay_update*)realloc(thr->overlay_geom,
+                  thr->alpha_mods * sizeof(*thr->overlay_geom));
+            free(thr->overlay_geom_dirty);
+            thr->overlay_geom_dirty = (bool*)calloc(thr->alpha_mods, sizeof(bool));
+            thr->overlay_geom_update = false;
+            slock_unlock(thr->alpha_lock);
             thread_reply(thr, CMD_OVERLAY_LOAD);
             break;
 
@@ -351,9 +383,11 @@ static void thread_loop(void *data)
          slock_lock(thr->frame.lock);
 
          thread_update_driver_state(thr);
+         FRAME_TRACE_BEGIN(FRAME_TRACE_VIDEO_THREAD);
          bool ret = thr->driver->frame(thr->driver_data,
                thr->frame.buffer, thr->frame.width, thr->frame.height,
                thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL);
+         FRAME_TRACE_END(FRAME_TRACE_VIDEO_THREAD);
 
          slock_unlock(thr->frame.lock);
 
@@ -603,6 +637,10 @@ static void thread_free(void *data)
    scond_free(thr->cond_thread);
 
    free(thr->alpha_mod);
+#ifdef HAVE_OVERLAY
+   free(thr->overlay_geom);
+   free(thr->overlay_geom_dirty);
+#endif
    slock_free(thr->alpha_lock);
 
    RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
@@ -672,6 +710,28 @@ static void thread_overlay_set_alpha(void *data, unsigned index, float mod)
    slock_unlock(thr->alpha_lock);
 }
 
+// Like set_alpha, only hands the updates over to be applied before the next frame.
+static void thread_overlay_update(void *data, const struct video_overlay_update *updates, unsigned num_updates)
+{
+   unsigned i;
+   thread_video_t *thr = (thread_video_t*)data;
+
+   slock_lock(thr->alpha_lock);
+   for (i = 0; i < num_updates; i++)
+   {
+      unsigned image = updates[i].image;
+      if (image >= thr->alpha_mods || !thr->overlay_geom_dirty)
+         continue;
+
+      thr->overlay_geom[image]       = updates[i];
+      thr->overlay_geom_dirty[image] = true;
+      thr->alpha_mod[image]          = updates[i].alpha;
+   }
+   thr->overlay_geom_update = true;
+   thr->alpha_update = true;
+   slock_unlock(thr->alpha_lock);
+}
+
 static const video_overlay_interface_t thread_overlay = {
    thread_overlay_enable,
    thread_overlay_load,
@@ -679,6 +739,7 @@ static const video_overlay_interface_t thread_overlay = {
    thread_overlay_vertex_geom,
    thread_overlay_full_screen,
    thread_overlay_set_alpha,
+   thread_overlay_update,
 };
 
 static void thread_get_overlay_interface(void *data, const video_overlay_interface_t **iface)
@@ -21,6 +21,9 @@
 #include <math.h>
 #include "gfx_common.h"
 #include "fonts/fonts.h"
+#include "soft_overlay.h"
+#include "xvideo_conv.h"
+#include "../performance.h"
 
 #include "context/x11_common.h"
 
@@ -41,7 +44,6 @@ typedef struct xv
    GC gc;
    Window window;
    Colormap colormap;
-   XShmSegmentInfo shminfo;
    XIM xim;
    XIC xic;
 
@@ -52,18 +54,23 @@ typedef struct xv
    int depth;
    int visualid;
 
+   // Frames are double buffered, so one image can be converted into while the server reads the other.
+   XvImage *images[2];
+   XShmSegmentInfo shminfo[2];
+   bool busy[2];
+   unsigned image_index;
    XvImage *image;
+   int completion_event;
+
    uint32_t fourcc;
+   enum xv_conv_format conv_format;
+   xv_conv_t *conv;
 
    unsigned width;
    unsigned height;
    bool keep_aspect;
    struct rarch_viewport vp;
 
-   uint8_t *ytable;
-   uint8_t *utable;
-   uint8_t *vtable;
-
    void *font;
    const font_renderer_driver_t *font_driver;
 
@@ -75,7 +82,13 @@ typedef struct xv
    uint8_t font_u;
    uint8_t font_v;
 
-   void (*render_func)(struct xv*, const void *frame, unsigned width, unsigned height, unsigned pitch);
+   unsigned bytes_per_pixel;
+
+#ifdef HAVE_OVERLAY
+   soft_overlay_t *overlay;
+   uint8_t *overlay_frame;
+   size_t overlay_frame_size;
+#endif
 } xv_t;
 
 static void xv_set_nonblock_state(void *data, bool state)
@@ -105,25 +118,6 @@ static inline void calculate_yuv(uint8_t *y, uint8_t *u, uint8_t *v, unsigned r,
    *v = v_ < 0 ? 0 : (v_ > 255 ? 255 : v_);
 }
 
-static void init_yuv_tables(xv_t *xv)
-{
-   unsigned i;
-   xv->ytable = (uint8_t*)malloc(0x10000);
-   xv->utable = (uint8_t*)malloc(0x10000);
-   xv->vtable = (uint8_t*)malloc(0x10000);
-
-   for (i = 0; i < 0x10000; i++)
-   {
-      // Extract RGB565 color data from i
-      unsigned r = (i >> 11) & 0x1f, g = (i >> 5) & 0x3f, b = (i >> 0) & 0x1f;
-      r = (r << 3) | (r >> 2);  // R5->R8
-      g = (g << 2) | (g >> 4);  // G6->G8
-      b = (b << 3) | (b >> 2);  // B5->B8
-
-      calculate_yuv(&xv->ytable[i], &xv->utable[i], &xv->vtable[i], r, g, b);
-   }
-}
-
 static void xv_init_font(xv_t *xv, const char *font_path, unsigned font_size)
 {
    if (!g_settings.video.font_enable)
@@ -145,131 +139,9 @@ static void xv_init_font(xv_t *xv, const char *font_path, unsigned font_size)
       RARCH_LOG("Could not initialize fonts.\n");
 }
 
-// We render @ 2x scale to combat chroma downsampling. Also makes fonts more bearable :)
-static void render16_yuy2(xv_t *xv, const void *input_, unsigned width, unsigned height, unsigned pitch)
-{
-   unsigned x, y;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output = (uint8_t*)xv->image->data;
-
-   for (y = 0; y < height; y++)
-   {
-      for (x = 0; x < width; x++)
-      {
-         uint16_t p = *input++;
-
-         uint8_t y0 = xv->ytable[p];
-         uint8_t u = xv->utable[p];
-         uint8_t v = xv->vtable[p];
-
-         unsigned img_width = xv->width << 1;
-         output[0] = output[img_width] = y0;
-         output[1] = output[img_width + 1] = u;
-         output[2] = output[img_width + 2] = y0;
-         output[3] = output[img_width + 3] = v;
-         output += 4;
-      }
-
-      input  += (pitch >> 1) - width;
-      output += (xv->width - width) << 2;
-   }
-}
-
-static void render16_uyvy(xv_t *xv, const void *input_, unsigned width, unsigned height, unsigned pitch)
-{
-   unsigned x, y;
-   const uint16_t *input = (const uint16_t*)input_;
-   uint8_t *output = (uint8_t*)xv->image->data;
-
-   for (y = 0; y < height; y++)
-   {
-      for (x = 0; x < width; x++)
-      {
-         uint16_t p = *input++;
-
-         uint8_t y0 = xv->ytable[p];
-         uint8_t u = xv->utable[p];
-         uint8_t v = xv->vtable[p];
-
-         unsigned img_width = xv->width << 1;
-         output[0] = output[img_width] = u;
-         output[1] = output[img_width + 1] = y0;
-         output[2] = output[img_width + 2] = v;
-         output[3] = output[img_width + 3] = y0;
-         output += 4;
-      }
-
-      input  += (pitch >> 1) - width;
-      output += (xv->width - width) << 2;
-   }
-}
-
-static void render32_yuy2(xv_t *xv, const void *input_, unsigned width, unsigned height, unsigned pitch)
-{
-   unsigned x, y;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint8_t *output = (uint8_t*)xv->image->data;
-
-   for (y = 0; y < height; y++)
-   {
-      for (x = 0; x < width; x++)
-      {
-         uint32_t p = *input++;
-         p = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x1f); // ARGB -> RGB16
-
-         uint8_t y0 = xv->ytable[p];
-         uint8_t u = xv->utable[p];
-         uint8_t v = xv->vtable[p];
-
-         unsigned img_width = xv->width << 1;
-         output[0] = output[img_width] = y0;
-         output[1] = output[img_width + 1] = u;
-         output[2] = output[img_width + 2] = y0;
-         output[3] = output[img_width + 3] = v;
-         output += 4;
-      }
-
-      input  += (pitch >> 2) - width;
-      output += (xv->width - width) << 2;
-   }
-}
-
-static void render32_uyvy(xv_t *xv, const void *input_, unsigned width, unsigned height, unsigned pitch)
-{
-   unsigned x, y;
-   const uint32_t *input = (const uint32_t*)input_;
-   uint16_t *output = (uint16_t*)xv->image->data;
-
-   for (y = 0; y < height; y++)
-   {
-      for (x = 0; x < width; x++)
-      {
-         uint32_t p = *input++;
-         p = ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x1f); // ARGB -> RGB16
-
-         uint8_t y0 = xv->ytable[p];
-         uint8_t u = xv->utable[p];
-         uint8_t v = xv->vtable[p];
-
-         unsigned img_width = xv->width << 1;
-         output[0] = output[img_width] = u;
-         output[1] = output[img_width + 1] = y0;
-         output[2] = output[img_width + 2] = v;
-         output[3] = output[img_width + 3] = y0;
-         output += 4;
-      }
-
-      input  += (pitch >> 2) - width;
-      output += (xv->width - width) << 2;
-   }
-}
-
 struct format_desc
 {
-   void (*render_16)(xv_t *xv, const void *input,
-         unsigned width, unsigned height, unsigned pitch);
-   void (*render_32)(xv_t *xv, const void *input,
-         unsigned width, unsigned height, unsigned pitch);
+   enum xv_conv_format conv_format;
    char components[4];
    unsigned luma_index[2];
    unsigned u_index;
@@ -278,16 +150,14 @@ struct format_desc
 
 static const struct format_desc formats[] = {
    {
-      render16_yuy2,
-      render32_yuy2,
+      XV_CONV_YUY2,
       { 'Y', 'U', 'Y', 'V' },
       { 0, 2 },
       1,
       3,
    },
    {
-      render16_uyvy,
-      render32_uyvy,
+      XV_CONV_UYVY,
       { 'U', 'Y', 'V', 'Y' },
       { 1, 3 },
       0,
@@ -316,7 +186,7 @@ static bool adaptor_set_format(xv_t *xv, Display *dpy, XvPortID port, const vide
                   format[i].component_order[3] == formats[j].components[3])
             {
                xv->fourcc = format[i].id;
-               xv->render_func = video->rgb32 ? formats[j].render_32 : formats[j].render_16;
+               xv->conv_format = formats[j].conv_format;
 
                xv->luma_index[0] = formats[j].luma_index[0];
                xv->luma_index[1] = formats[j].luma_index[1];
@@ -380,6 +250,108 @@ static void calc_out_rect(bool keep_aspect, struct rarch_viewport *vp, unsigned
    }
 }
 
+static Bool xv_is_completion(Display *dpy, XEvent *event, XPointer arg)
+{
+   (void)dpy;
+   return event->type == *(const int*)arg;
+}
+
+// The server is done reading an image once it sends the completion event for it.
+static void xv_handle_completion(xv_t *xv, const XEvent *event)
+{
+   unsigned i;
+   for (i = 0; i < 2; i++)
+      if (xv->images[i] && ((const XShmCompletionEvent*)event)->shmseg == xv->shminfo[i].shmseg)
+         xv->busy[i] = false;
+}
+
+static void xv_wait_image(xv_t *xv, unsigned index)
+{
+   while (xv->busy[index])
+   {
+      XEvent event;
+      XIfEvent(xv->display, &event, xv_is_completion, (XPointer)&xv->completion_event);
+      xv_handle_completion(xv, &event);
+   }
+}
+
+static void xv_free_image(xv_t *xv, unsigned index)
+{
+   XShmSegmentInfo *shminfo = &xv->shminfo[index];
+
+   if (xv->images[index] && shminfo->shmaddr)
+   {
+      xv_wait_image(xv, index);
+      XShmDetach(xv->display, shminfo);
+   }
+   if (shminfo->shmaddr)
+      shmdt(shminfo->shmaddr);
+   if (shminfo->shmid > 0)
+      shmctl(shminfo->shmid, IPC_RMID, NULL);
+   if (xv->images[index])
+      XFree(xv->images[index]);
+
+   memset(shminfo, 0, sizeof(*shminfo));
+   xv->images[index] = NULL;
+   xv->busy[index] = false;
+}
+
+static void xv_free_images(xv_t *xv)
+{
+   xv_free_image(xv, 0);
+   xv_free_image(xv, 1);
+   xv->image = NULL;
+}
+
+static bool xv_alloc_images(xv_t *xv, unsigned width, unsigned height)
+{
+   unsigned i;
+
+   for (i = 0; i < 2; i++)
+   {
+      XShmSegmentInfo *shminfo = &xv->shminfo[i];
+
+      xv->images[i] = XvShmCreateImage(xv->display, xv->port, xv->fourcc, NULL, width, height, shminfo);
+      if (!xv->images[i])
+      {
+         RARCH_ERR("XVideo: XShmCreateImage failed.\n");
+         return false;
+      }
+
+      shminfo->shmid = shmget(IPC_PRIVATE, xv->images[i]->data_size, IPC_CREAT | 0777);
+      if (shminfo->shmid < 0)
+      {
+         RARCH_ERR("XVideo: Failed to init SHM.\n");
+         return false;
+      }
+
+      shminfo->shmaddr = xv->images[i]->data = (char*)shmat(shminfo->shmid, NULL, 0);
+      shminfo->readOnly = false;
+      if (shminfo->shmaddr == (char*)-1)
+      {
+         shminfo->shmaddr = NULL;
+         RARCH_ERR("XVideo: Failed to map SHM.\n");
+         return false;
+      }
+
+      if (!XShmAttach(xv->display, shminfo))
+      {
+         RARCH_ERR("XVideo: XShmAttach failed.\n");
+         return false;
+      }
+   }
+
+   XSync(xv->display, False);
+   for (i = 0; i < 2; i++)
+      memset(xv->images[i]->data, 128, xv->images[i]->data_size);
+
+   xv->image_index = 0;
+   xv->image = xv->images[0];
+   xv->width = xv->image->width;
+   xv->height = xv->image->height;
+   return true;
+}
+
 static void *xv_init(const video_info_t *video, const input_driver_t **input, void **input_data)
 {
    xv_t *xv = (xv_t*)calloc(1, sizeof(*xv));
@@ -407,8 +379,10 @@ static void *xv_init(const video_info_t *video, const input_driver_t **input, vo
       RARCH_ERR("XVideo: XShm extension not found.\n");
       goto error;
    }
+   xv->completion_event = XShmGetEventBase(xv->display) + ShmCompletion;
 
    xv->keep_aspect = video->force_aspect;
+   xv->bytes_per_pixel = video->rgb32 ? 4 : 2;
 
    // Find an appropriate Xv port.
    xv->port = 0;
@@ -483,28 +457,13 @@ static void *xv_init(const video_info_t *video, const input_driver_t **input, vo
    atom = XInternAtom(xv->display, "XV_AUTOPAINT_COLORKEY", true);
    if (atom != None) XvSetPortAttribute(xv->display, xv->port, atom, 1);
 
-   xv->width = geom->max_width;
-   xv->height = geom->max_height;
-
-   xv->image = XvShmCreateImage(xv->display, xv->port, xv->fourcc, NULL, xv->width, xv->height, &xv->shminfo);
-   if (!xv->image)
-   {
-      RARCH_ERR("XVideo: XShmCreateImage failed.\n");
+   if (!xv_alloc_images(xv, geom->max_width, geom->max_height))
       goto error;
-   }
-   xv->width = xv->image->width;
-   xv->height = xv->image->height;
 
-   xv->shminfo.shmid = shmget(IPC_PRIVATE, xv->image->data_size, IPC_CREAT | 0777);
-   xv->shminfo.shmaddr = xv->image->data = (char*)shmat(xv->shminfo.shmid, NULL, 0);
-   xv->shminfo.readOnly = false;
-   if (!XShmAttach(xv->display, &xv->shminfo))
-   {
-      RARCH_ERR("XVideo: XShmAttach failed.\n");
+   xv->conv = xv_conv_new(xv->conv_format, video->rgb32, rarch_get_cpu_cores());
+   if (!xv->conv)
       goto error;
-   }
-   XSync(xv->display, False);
-   memset(xv->image->data, 128, xv->image->data_size);
+   RARCH_LOG("XVideo: Converting frames with %u thread(s).\n", xv_conv_threads(xv->conv));
 
    xv->quit_atom = XInternAtom(xv->display, "WM_DELETE_WINDOW", False);
    if (xv->quit_atom)
@@ -535,9 +494,14 @@ static void *xv_init(const video_info_t *video, const input_driver_t **input, vo
          *input = NULL;
    }
 
-   init_yuv_tables(xv);
    xv_init_font(xv, g_settings.video.font_path, g_settings.video.font_size);
 
+#ifdef HAVE_OVERLAY
+   xv->overlay = soft_overlay_new();
+   if (!xv->overlay)
+      goto error;
+#endif
+
    if (!x11_create_input_context(xv->display, xv->window, &xv->xim, &xv->xic))
       goto error;
 
@@ -559,42 +523,12 @@ static bool check_resize(xv_t *xv, unsigned width, unsigned height)
    // We render @ 2x scale to combat chroma downsampling.
    if (xv->width != (width << 1) || xv->height != (height << 1))
    {
-      xv->width = width << 1;
-      xv->height = height << 1;
-
-      XShmDetach(xv->display, &xv->shminfo);
-      shmdt(xv->shminfo.shmaddr);
-      shmctl(xv->shminfo.shmid, IPC_RMID, NULL);
-      XFree(xv->image);
-
-      memset(&xv->shminfo, 0, sizeof(xv->shminfo));
-      xv->image = XvShmCreateImage(xv->display, xv->port, xv->fourcc, NULL, xv->width, xv->height, &xv->shminfo);
-      if (xv->image == None)
+      xv_free_images(xv);
+      if (!xv_alloc_images(xv, width << 1, height << 1))
       {
-         RARCH_ERR("Failed to create image.\n");
+         xv_free_images(xv);
          return false;
       }
-
-      xv->width = xv->image->width;
-      xv->height = xv->image->height;
-
-      xv->shminfo.shmid = shmget(IPC_PRIVATE, xv->image->data_size, IPC_CREAT | 0777);
-      if (xv->shminfo.shmid < 0)
-      {
-         RARCH_ERR("Failed to init SHM.\n");
-         return false;
-      }
-
-      xv->shminfo.shmaddr = xv->image->data = (char*)shmat(xv->shminfo.shmid, NULL, 0);
-      xv->shminfo.readOnly = false;
-
-      if (!XShmAttach(xv->display, &xv->shminfo))
-      {
-         RARCH_ERR("Failed to reattch XvShm image.\n");
-         return false;
-      }
-      XSync(xv->display, False);
-      memset(xv->image->data, 128, xv->image->data_size);
    }
    return true;
 }
@@ -607,10 +541,9 @@ static void xv_render_msg(xv_t *xv, const char *msg, unsigned width, unsigned he
       return;
 
    int x, y;
-   unsigned i;
-   struct font_output_list out;
-   xv->font_driver->render_msg(xv->font, msg, &out);
-   struct font_output *head = out.head;
+   unsigned i, g;
+   struct font_output glyphs[FONT_MAX_GLYPHS];
+   unsigned num_glyphs = xv->font_driver->render_msg(xv->font, msg, glyphs, FONT_MAX_GLYPHS);
 
    int msg_base_x = g_settings.video.msg_pos_x * width;
    int msg_base_y = height * (1.0 - g_settings.video.msg_pos_y);
@@ -621,8 +554,9 @@ static void xv_render_msg(xv_t *xv, const char *msg, unsigned width, unsigned he
 
    unsigned pitch = width << 1; // YUV formats used are 16 bpp.
 
-   for (; head; head = head->next)
+   for (g = 0; g < num_glyphs; g++)
    {
+      const struct font_output *head = &glyphs[g];
       int base_x = (msg_base_x + head->off_x) & ~1; // Make sure we always start on the correct boundary so the indices are correct.
       int base_y = msg_base_y - head->off_y - head->height;
 
@@ -690,9 +624,32 @@ static void xv_render_msg(xv_t *xv, const char *msg, unsigned width, unsigned he
          }
       }
    }
+}
+
+#ifdef HAVE_OVERLAY
+// Overlays are blended into a copy of the frame, at the resolution of the core, before it is converted to YUV.
+static const void *xv_blend_overlay(xv_t *xv, const void *frame, unsigned width, unsigned height, unsigned *pitch)
+{
+   unsigned y;
+   unsigned line = width * xv->bytes_per_pixel;
+
+   if (line * height > xv->overlay_frame_size)
+   {
+      uint8_t *buf = (uint8_t*)realloc(xv->overlay_frame, line * height);
+      if (!buf)
+         return NULL;
+      xv->overlay_frame = buf;
+      xv->overlay_frame_size = line * height;
+   }
+
+   for (y = 0; y < height; y++)
+      memcpy(xv->overlay_frame + y * line, (const uint8_t*)frame + y * *pitch, line);
 
-   xv->font_driver->free_output(xv->font, &out);
+   soft_overlay_render(xv->overlay, xv->overlay_frame, line, xv->bytes_per_pixel, width, height, NULL);
+   *pitch = line;
+   return xv->overlay_frame;
 }
+#endif
 
 static bool xv_frame(void *data, const void *frame, unsigned width, unsigned height, unsigned pitch, const char *msg)
 {
@@ -704,9 +661,27 @@ static bool xv_frame(void *data, const void *frame, unsigned width, unsigned hei
    if (!check_resize(xv, width, height))
       return false;
 
+#ifdef HAVE_OVERLAY
+   if (soft_overlay_enabled(xv->overlay))
+   {
+      frame = xv_blend_overlay(xv, frame, width, height, &pitch);
+      if (!frame)
+         return false;
+   }
+#endif
+
+   // Convert into the image the server is not reading from.
+   xv->image_index ^= 1;
+   xv_wait_image(xv, xv->image_index);
+   xv->image = xv->images[xv->image_index];
+
+   RARCH_PERFORMANCE_INIT(xv_convert);
+   RARCH_PERFORMANCE_START(xv_convert);
+   xv_conv_frame(xv->conv, (uint8_t*)xv->image->data, xv->image->pitches[0], frame, width, height, pitch);
+   RARCH_PERFORMANCE_STOP(xv_convert);
+
    XWindowAttributes target;
    XGetWindowAttributes(xv->display, xv->window, &target);
-   xv->render_func(xv, frame, width, height, pitch);
 
    calc_out_rect(xv->keep_aspect, &xv->vp, target.width, target.height);
    xv->vp.full_width = target.width;
@@ -715,11 +690,13 @@ static bool xv_frame(void *data, const void *frame, unsigned width, unsigned hei
    if (msg)
       xv_render_msg(xv, msg, width << 1, height << 1);
 
+   // No round trip here. The server reports when it is done with the image.
    XvShmPutImage(xv->display, xv->port, xv->window, xv->gc, xv->image,
          0, 0, width << 1, height << 1,
          xv->vp.x, xv->vp.y, xv->vp.width, xv->vp.height,
          true);
-   XSync(xv->display, False);
+   xv->busy[xv->image_index] = true;
+   XFlush(xv->display);
 
    char buf[128];
    if (gfx_get_fps(buf, sizeof(buf), NULL, 0))
@@ -760,6 +737,8 @@ static bool xv_alive(void *data)
             break;
 
          default:
+            if (event.type == xv->completion_event)
+               xv_handle_completion(xv, &event);
             break;
       }
    }
@@ -777,10 +756,8 @@ static void xv_free(void *data)
 {
    xv_t *xv = (xv_t*)data;
    x11_destroy_input_context(&xv->xim, &xv->xic);
-   XShmDetach(xv->display, &xv->shminfo);
-   shmdt(xv->shminfo.shmaddr);
-   shmctl(xv->shminfo.shmid, IPC_RMID, NULL);
-   XFree(xv->image);
+   xv_free_images(xv);
+   xv_conv_free(xv->conv);
 
    if (xv->window)
       XUnmapWindow(xv->display, xv->window);
@@ -789,13 +766,14 @@ static void xv_free(void *data)
 
    XCloseDisplay(xv->display);
 
-   free(xv->ytable);
-   free(xv->utable);
-   free(xv->vtable);
-
    if (xv->font)
       xv->font_driver->free(xv->font);
 
+#ifdef HAVE_OVERLAY
+   soft_overlay_free(xv->overlay);
+   free(xv->overlay_frame);
+#endif
+
    free(xv);
 }
 
@@ -805,6 +783,16 @@ static void xv_viewport_info(void *data, struct rarch_viewport *vp)
    *vp = xv->vp;
 }
 
+#ifdef HAVE_OVERLAY
+SOFT_OVERLAY_INTERFACE(xv, ((xv_t*)data)->overlay);
+
+static void xv_get_overlay_interface(void *data, const video_overlay_interface_t **iface)
+{
+   (void)data;
+   *iface = &xv_overlay_interface;
+}
+#endif
+
 const video_driver_t video_xvideo = {
    xv_init,
    xv_frame,
@@ -820,5 +808,9 @@ const video_driver_t video_xvideo = {
 
    NULL,
    xv_viewport_info,
+   NULL,
+#ifdef HAVE_OVERLAY
+   xv_get_overlay_interface,
+#endif
 };
 
@@ -0,0 +1,432 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "xvideo_conv.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_THREADS
+#include "../thread.h"
+#endif
+
+#ifdef SCALER_NO_SIMD
+#undef __SSE2__
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(SCALER_NO_SIMD) && \
+   !defined(__ARMEB__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define XV_CONV_NEON
+#endif
+
+// Y  = ( 66 R + 129 G +  25 B + 128) / 256 +  16
+// Cb = (-38 R -  74 G + 112 B + 128) / 256 + 128
+// Cr = (112 R -  94 G -  18 B + 128) / 256 + 128
+// The offsets are folded into the sums, which then never leave 0 - 65535,
+// so 16-bit SIMD lanes give the same results as this.
+#define XV_CONV_Y_BIAS  (128 + (16 << 8))
+#define XV_CONV_UV_BIAS (128 + (128 << 8))
+
+static inline void xv_conv_pixel(uint8_t *out0, uint8_t *out1, bool uyvy,
+      unsigned r, unsigned g, unsigned b)
+{
+   unsigned y = (XV_CONV_Y_BIAS  +  66 * r + 129 * g +  25 * b) >> 8;
+   unsigned u = (XV_CONV_UV_BIAS + 112 * b -  38 * r -  74 * g) >> 8;
+   unsigned v = (XV_CONV_UV_BIAS + 112 * r -  94 * g -  18 * b) >> 8;
+
+   if (uyvy)
+   {
+      out0[0] = out1[0] = u;
+      out0[1] = out1[1] = y;
+      out0[2] = out1[2] = v;
+      out0[3] = out1[3] = y;
+   }
+   else
+   {
+      out0[0] = out1[0] = y;
+      out0[1] = out1[1] = u;
+      out0[2] = out1[2] = y;
+      out0[3] = out1[3] = v;
+   }
+}
+
+#if defined(__SSE2__)
+// Converts 8 pixels, given as 16-bit R, G and B.
+static inline void xv_conv_store_sse2(uint8_t *out0, uint8_t *out1, bool uyvy,
+      __m128i r, __m128i g, __m128i b)
+{
+   __m128i y = _mm_add_epi16(_mm_set1_epi16(XV_CONV_Y_BIAS), _mm_mullo_epi16(r, _mm_set1_epi16(66)));
+   __m128i u = _mm_add_epi16(_mm_set1_epi16(XV_CONV_UV_BIAS), _mm_mullo_epi16(b, _mm_set1_epi16(112)));
+   __m128i v = _mm_add_epi16(_mm_set1_epi16(XV_CONV_UV_BIAS), _mm_mullo_epi16(r, _mm_set1_epi16(112)));
+   __m128i lo, hi, first, second;
+
+   y = _mm_add_epi16(y, _mm_mullo_epi16(g, _mm_set1_epi16(129)));
+   y = _mm_srli_epi16(_mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(25))), 8);
+   u = _mm_sub_epi16(u, _mm_mullo_epi16(r, _mm_set1_epi16(38)));
+   u = _mm_srli_epi16(_mm_sub_epi16(u, _mm_mullo_epi16(g, _mm_set1_epi16(74))), 8);
+   v = _mm_sub_epi16(v, _mm_mullo_epi16(g, _mm_set1_epi16(94)));
+   v = _mm_srli_epi16(_mm_sub_epi16(v, _mm_mullo_epi16(b, _mm_set1_epi16(18))), 8);
+
+   // Each pixel is two 16-bit words, Y U | Y V or U Y | V Y.
+   if (uyvy)
+   {
+      first  = _mm_or_si128(u, _mm_slli_epi16(y, 8));
+      second = _mm_or_si128(v, _mm_slli_epi16(y, 8));
+   }
+   else
+   {
+      first  = _mm_or_si128(y, _mm_slli_epi16(u, 8));
+      second = _mm_or_si128(y, _mm_slli_epi16(v, 8));
+   }
+
+   lo = _mm_unpacklo_epi16(first, second);
+   hi = _mm_unpackhi_epi16(first, second);
+   _mm_storeu_si128((__m128i*)out0 + 0, lo);
+   _mm_storeu_si128((__m128i*)out0 + 1, hi);
+   _mm_storeu_si128((__m128i*)out1 + 0, lo);
+   _mm_storeu_si128((__m128i*)out1 + 1, hi);
+}
+#elif defined(XV_CONV_NEON)
+// Converts 8 pixels.
+static inline void xv_conv_store_neon(uint8_t *out0, uint8_t *out1, bool uyvy,
+      uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+   uint16x8_t y = vmlal_u8(vmlal_u8(vmlal_u8(vdupq_n_u16(XV_CONV_Y_BIAS),
+               r, vdup_n_u8(66)), g, vdup_n_u8(129)), b, vdup_n_u8(25));
+   uint16x8_t u = vmlsl_u8(vmlsl_u8(vmlal_u8(vdupq_n_u16(XV_CONV_UV_BIAS),
+               b, vdup_n_u8(112)), r, vdup_n_u8(38)), g, vdup_n_u8(74));
+   uint16x8_t v = vmlsl_u8(vmlsl_u8(vmlal_u8(vdupq_n_u16(XV_CONV_UV_BIAS),
+               r, vdup_n_u8(112)), g, vdup_n_u8(94)), b, vdup_n_u8(18));
+   uint8x8x4_t out;
+
+   if (uyvy)
+   {
+      out.val[0] = vshrn_n_u16(u, 8);
+      out.val[1] = vshrn_n_u16(y, 8);
+      out.val[2] = vshrn_n_u16(v, 8);
+      out.val[3] = out.val[1];
+   }
+   else
+   {
+      out.val[0] = vshrn_n_u16(y, 8);
+      out.val[1] = vshrn_n_u16(u, 8);
+      out.val[2] = out.val[0];
+      out.val[3] = vshrn_n_u16(v, 8);
+   }
+
+   vst4_u8(out0, out);
+   vst4_u8(out1, out);
+}
+#endif
+
+static void xv_conv_row_rgb565(uint8_t *out0, uint8_t *out1, bool uyvy,
+      const uint16_t *input, unsigned width)
+{
+   unsigned x = 0;
+
+#if defined(__SSE2__)
+   const __m128i mask_f8 = _mm_set1_epi16(0xf8);
+   const __m128i mask_fc = _mm_set1_epi16(0xfc);
+   const __m128i mask_3  = _mm_set1_epi16(3);
+   const __m128i mask_7  = _mm_set1_epi16(7);
+
+   for (; x + 8 <= width; x += 8)
+   {
+      __m128i p = _mm_loadu_si128((const __m128i*)(input + x));
+      __m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 8), mask_f8), _mm_srli_epi16(p, 13));
+      __m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 3), mask_fc),
+            _mm_and_si128(_mm_srli_epi16(p, 9), mask_3));
+      __m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(p, 3), mask_f8),
+            _mm_and_si128(_mm_srli_epi16(p, 2), mask_7));
+      xv_conv_store_sse2(out0 + x * 4, out1 + x * 4, uyvy, r, g, b);
+   }
+#elif defined(XV_CONV_NEON)
+   const uint16x8_t mask_f8 = vdupq_n_u16(0xf8);
+   const uint16x8_t mask_fc = vdupq_n_u16(0xfc);
+   const uint16x8_t mask_3  = vdupq_n_u16(3);
+   const uint16x8_t mask_7  = vdupq_n_u16(7);
+
+   for (; x + 8 <= width; x += 8)
+   {
+      uint16x8_t p = vld1q_u16(input + x);
+      uint16x8_t r = vorrq_u16(vandq_u16(vshrq_n_u16(p, 8), mask_f8), vshrq_n_u16(p, 13));
+      uint16x8_t g = vorrq_u16(vandq_u16(vshrq_n_u16(p, 3), mask_fc), vandq_u16(vshrq_n_u16(p, 9), mask_3));
+      uint16x8_t b = vorrq_u16(vandq_u16(vshlq_n_u16(p, 3), mask_f8), vandq_u16(vshrq_n_u16(p, 2), mask_7));
+      xv_conv_store_neon(out0 + x * 4, out1 + x * 4, uyvy, vmovn_u16(r), vmovn_u16(g), vmovn_u16(b));
+   }
+#endif
+
+   for (; x < width; x++)
+   {
+      unsigned p = input[x];
+      unsigned r = (p >> 11) & 0x1f, g = (p >> 5) & 0x3f, b = p & 0x1f;
+      xv_conv_pixel(out0 + x * 4, out1 + x * 4, uyvy,
+            (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+   }
+}
+
+static void xv_conv_row_argb8888(uint8_t *out0, uint8_t *out1, bool uyvy,
+      const uint32_t *input, unsigned width)
+{
+   unsigned x = 0;
+
+#if defined(__SSE2__)
+   const __m128i mask = _mm_set1_epi32(0xff);
+
+   for (; x + 8 <= width; x += 8)
+   {
+      __m128i p0 = _mm_loadu_si128((const __m128i*)(input + x + 0));
+      __m128i p1 = _mm_loadu_si128((const __m128i*)(input + x + 4));
+      __m128i r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+            _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+      __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+            _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+      __m128i b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+      xv_conv_store_sse2(out0 + x * 4, out1 + x * 4, uyvy, r, g, b);
+   }
+#elif defined(XV_CONV_NEON)
+   for (; x + 8 <= width; x += 8)
+   {
+      uint8x8x4_t p = vld4_u8((const uint8_t*)(input + x));
+      xv_conv_store_neon(out0 + x * 4, out1 + x * 4, uyvy, p.val[2], p.val[1], p.val[0]);
+   }
+#endif
+
+   for (; x < width; x++)
+   {
+      uint32_t p = input[x];
+      xv_conv_pixel(out0 + x * 4, out1 + x * 4, uyvy, (p >> 16) & 0xff, (p >> 8) & 0xff, p & 0xff);
+   }
+}
+
+void xv_conv_rows(enum xv_conv_format format, bool rgb32, uint8_t *output, unsigned out_pitch,
+      const void *input, unsigned width, unsigned height, unsigned in_pitch)
+{
+   unsigned y;
+   bool uyvy = format == XV_CONV_UYVY;
+   const uint8_t *in = (const uint8_t*)input;
+
+   for (y = 0; y < height; y++, in += in_pitch, output += 2 * out_pitch)
+   {
+      if (rgb32)
+         xv_conv_row_argb8888(output, output + out_pitch, uyvy, (const uint32_t*)in, width);
+      else
+         xv_conv_row_rgb565(output, output + out_pitch, uyvy, (const uint16_t*)in, width);
+   }
+}
+
+struct xv_conv_band
+{
+   uint8_t *output;
+   const uint8_t *input;
+   unsigned out_pitch;
+   unsigned in_pitch;
+   unsigned width;
+   unsigned height;
+};
+
+#ifdef HAVE_THREADS
+// Thread 0 is the caller of xv_conv_frame(), the others wait for one band per frame.
+struct xv_conv_thread
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   xv_conv_t *conv;
+   const struct xv_conv_band *band;
+   bool done;
+   bool die;
+};
+#endif
+
+struct xv_conv
+{
+   enum xv_conv_format format;
+   bool rgb32;
+   unsigned threads;
+
+   struct xv_conv_band bands[XV_CONV_MAX_THREADS];
+#ifdef HAVE_THREADS
+   struct xv_conv_thread thread_data[XV_CONV_MAX_THREADS];
+#endif
+};
+
+static void xv_conv_band(const xv_conv_t *conv, const struct xv_conv_band *band)
+{
+   xv_conv_rows(conv->format, conv->rgb32, band->output, band->out_pitch,
+         band->input, band->width, band->height, band->in_pitch);
+}
+
+#ifdef HAVE_THREADS
+static void xv_conv_thread_loop(void *data)
+{
+   struct xv_conv_thread *thr = (struct xv_conv_thread*)data;
+
+   for (;;)
+   {
+      const struct xv_conv_band *band;
+
+      slock_lock(thr->lock);
+      while (!thr->band && !thr->die)
+         scond_wait(thr->cond, thr->lock);
+      band = thr->band;
+      slock_unlock(thr->lock);
+
+      if (!band)
+         break;
+
+      xv_conv_band(thr->conv, band);
+
+      slock_lock(thr->lock);
+      thr->band = NULL;
+      thr->done = true;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+}
+#endif
+
+void xv_conv_free(xv_conv_t *conv)
+{
+#ifdef HAVE_THREADS
+   unsigned i;
+#endif
+   if (!conv)
+      return;
+
+#ifdef HAVE_THREADS
+   for (i = 1; i < XV_CONV_MAX_THREADS; i++)
+   {
+      struct xv_conv_thread *thr = &conv->thread_data[i];
+      if (thr->thread)
+      {
+         slock_lock(thr->lock);
+         thr->die = true;
+         scond_signal(thr->cond);
+         slock_unlock(thr->lock);
+         sthread_join(thr->thread);
+      }
+      if (thr->lock)
+         slock_free(thr->lock);
+      if (thr->cond)
+         scond_free(thr->cond);
+   }
+#endif
+
+   free(conv);
+}
+
+xv_conv_t *xv_conv_new(enum xv_conv_format format, bool rgb32, unsigned threads)
+{
+#ifdef HAVE_THREADS
+   unsigned i;
+#endif
+   xv_conv_t *conv = (xv_conv_t*)calloc(1, sizeof(*conv));
+   if (!conv)
+      return NULL;
+
+   conv->format = format;
+   conv->rgb32  = rgb32;
+
+#ifdef HAVE_THREADS
+   if (!threads)
+      threads = 1;
+   if (threads > XV_CONV_MAX_THREADS)
+      threads = XV_CONV_MAX_THREADS;
+   conv->threads = threads;
+
+   for (i = 1; i < conv->threads; i++)
+   {
+      struct xv_conv_thread *thr = &conv->thread_data[i];
+      thr->conv = conv;
+      thr->lock = slock_new();
+      thr->cond = scond_new();
+      if (!thr->lock || !thr->cond)
+         goto error;
+
+      thr->thread = sthread_create(xv_conv_thread_loop, thr);
+      if (!thr->thread)
+         goto error;
+   }
+#else
+   (void)threads;
+   conv->threads = 1;
+#endif
+
+   return conv;
+
+#ifdef HAVE_THREADS
+error:
+   xv_conv_free(conv);
+   return NULL;
+#endif
+}
+
+unsigned xv_conv_threads(const xv_conv_t *conv)
+{
+   return conv->threads;
+}
+
+void xv_conv_frame(xv_conv_t *conv, uint8_t *output, unsigned out_pitch,
+      const void *input, unsigned width, unsigned height, unsigned in_pitch)
+{
+   unsigned i, bands = conv->threads;
+
+   // Small frames are not worth waking threads for.
+   if (bands > 1 && height < bands * 16)
+      bands = 1;
+
+   for (i = 0; i < bands; i++)
+   {
+      struct xv_conv_band *band = &conv->bands[i];
+      unsigned start = height * i / bands;
+      unsigned end   = height * (i + 1) / bands;
+
+      band->output    = output + 2 * start * out_pitch;
+      band->input     = (const uint8_t*)input + start * in_pitch;
+      band->out_pitch = out_pitch;
+      band->in_pitch  = in_pitch;
+      band->width     = width;
+      band->height    = end - start;
+   }
+
+#ifdef HAVE_THREADS
+   for (i = 1; i < bands; i++)
+   {
+      struct xv_conv_thread *thr = &conv->thread_data[i];
+      slock_lock(thr->lock);
+      thr->band = &conv->bands[i];
+      thr->done = false;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+
+   xv_conv_band(conv, &conv->bands[0]);
+
+   for (i = 1; i < bands; i++)
+   {
+      struct xv_conv_thread *thr = &conv->thread_data[i];
+      slock_lock(thr->lock);
+      while (!thr->done)
+         scond_wait(thr->cond, thr->lock);
+      slock_unlock(thr->lock);
+   }
+#else
+   for (i = 0; i < bands; i++)
+      xv_conv_band(conv, &conv->bands[i]);
+#endif
+}
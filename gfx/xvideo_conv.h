@@ -0,0 +1,56 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XVIDEO_CONV_H__
+#define XVIDEO_CONV_H__
+
+#include <stdint.h>
+#include "../boolean.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RGB to packed YUV 4:2:2 conversion for the XVideo driver.
+// Every pixel becomes 2x2 pixels, so chroma is not subsampled.
+// BT.601 limited range, with SSE2 or NEON where available.
+
+#define XV_CONV_MAX_THREADS 8
+
+enum xv_conv_format
+{
+   XV_CONV_YUY2 = 0,
+   XV_CONV_UYVY
+};
+
+// Converts a width x height RGB565 (or XRGB8888 when rgb32) frame into a 2 * width x 2 * height image.
+void xv_conv_rows(enum xv_conv_format format, bool rgb32, uint8_t *output, unsigned out_pitch,
+      const void *input, unsigned width, unsigned height, unsigned in_pitch);
+
+// Same, with the frame split into bands of rows converted by up to threads threads.
+typedef struct xv_conv xv_conv_t;
+
+xv_conv_t *xv_conv_new(enum xv_conv_format format, bool rgb32, unsigned threads);
+void xv_conv_free(xv_conv_t *conv);
+unsigned xv_conv_threads(const xv_conv_t *conv);
+
+void xv_conv_frame(xv_conv_t *conv, uint8_t *output, unsigned out_pitch,
+      const void *input, unsigned width, unsigned height, unsigned in_pitch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -89,6 +89,7 @@ CONFIG FILE
 CHEATS
 ============================================================ */
 #include "../cheats.c"
+#include "../cheat_search.c"
 #include "../hash.c"
 
 /*============================================================
@@ -139,6 +140,7 @@ VIDEO SHADERS
 ============================================================ */
 #if defined(HAVE_CG) || defined(HAVE_HLSL) || defined(HAVE_GLSL)
 #include "../gfx/shader_parse.c"
+#include "../gfx/shader_cache.c"
 #endif
 
 #ifdef HAVE_CG
@@ -189,9 +191,29 @@ VIDEO DRIVER
 
 #ifdef HAVE_OMAP
 #include "../gfx/omap_gfx.c"
+#endif
+
+#ifdef HAVE_FBDEV
+#include "../gfx/fbdev_gfx.c"
+#endif
+
+#if defined(HAVE_OMAP) || defined(HAVE_FBDEV)
 #include "../gfx/fbdev.c"
 #endif
 
+#ifdef HAVE_SOFTVIDEO
+#include "../gfx/soft_gfx.c"
+#endif
+
+#if defined(HAVE_FBDEV) || defined(HAVE_SOFTVIDEO)
+#include "../gfx/soft_common.c"
+#endif
+
+#if defined(HAVE_OVERLAY) && (defined(HAVE_FBDEV) || defined(HAVE_SOFTVIDEO) || defined(HAVE_OMAP) || \
+      defined(HAVE_SDL) || defined(HAVE_XVIDEO))
+#include "../gfx/soft_overlay.c"
+#endif
+
 #ifdef HAVE_DYLIB
 #include "../gfx/ext_gfx.c"
 #endif
@@ -217,6 +239,7 @@ VIDEO DRIVER
 #endif
 
 #ifdef HAVE_XVIDEO
+#include "../gfx/xvideo_conv.c"
 #include "../gfx/xvideo.c"
 #endif
 
@@ -468,6 +491,14 @@ SCALERS
 #include "../gfx/scaler/scaler.c"
 #include "../gfx/scaler/scaler_int.c"
 
+/*============================================================
+CPU FILTERS
+============================================================ */
+#include "../gfx/filter.c"
+#include "../gfx/filters/scale2x.c"
+#include "../gfx/filters/twoxsai.c"
+#include "../gfx/filters/ntsc.c"
+
 /*============================================================
 DYNAMIC
 ============================================================ */
@@ -499,6 +530,8 @@ SETTINGS
 REWIND
 ============================================================ */
 #include "../rewind.c"
+#include "../frame_trace.c"
+#include "../fastforward.c"
 
 /*============================================================
 FRONTEND
@@ -586,6 +619,7 @@ MENU
 #endif
 
 #ifdef HAVE_RGUI
+#include "../frontend/menu/disp/rgui_draw.c"
 #include "../frontend/menu/disp/rgui.c"
 #endif
 
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include "hash.h"
 #include "miscellaneous.h"
+#include "performance.h"
 
 #define SWAP32(x) ((uint32_t)(           \
          (((uint32_t)(x) & 0x000000ff) << 24) | \
@@ -33,11 +34,6 @@ static inline void store32be(uint32_t *addr, uint32_t data)
    *addr = is_little_endian() ? SWAP32(data) : data;
 }
 
-static inline uint32_t load32be(const uint32_t *addr)
-{
-   return is_little_endian() ? SWAP32(*addr) : *addr;
-}
-
 #define LSL32(x, n) ((uint32_t)(x) << (n))
 #define LSR32(x, n) ((uint32_t)(x) >> (n))
 #define ROR32(x, n) (LSR32(x, n) | LSL32(x, 32 - (n)))
@@ -59,134 +55,255 @@ static const uint32_t T_K[64] = {
    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
 };
 
-struct sha256_ctx 
-{
-   union
-   {
-      uint8_t u8[64];
-      uint32_t u32[16];
-   } in;
-   unsigned inlen;
+// Processes a number of consecutive 64-byte blocks.
+typedef void (*sha256_blocks_t)(uint32_t *h, const uint8_t *data, size_t blocks);
 
+static void sha256_blocks_c(uint32_t *state, const uint8_t *data, size_t blocks)
+{
+   unsigned i;
    uint32_t w[64];
-   uint32_t h[8];
-   uint64_t len;
-};
+   uint32_t s0, s1;
+   uint32_t a, b, c, d, e, f, g, h;
+   uint32_t t1, t2, maj, ch;
 
-static void sha256_init(struct sha256_ctx *p) 
-{
-   memset(p, 0, sizeof(struct sha256_ctx));
-   memcpy(p->h, T_H, sizeof(T_H));
+   for (; blocks; blocks--, data += 64)
+   {
+      for (i = 0; i < 16; i++) 
+         w[i] = ((uint32_t)data[4 * i + 0] << 24) | ((uint32_t)data[4 * i + 1] << 16) |
+            ((uint32_t)data[4 * i + 2] << 8) | ((uint32_t)data[4 * i + 3] << 0);
+
+      for (i = 16; i < 64; i++) 
+      {
+         s0 = ROR32(w[i - 15],  7) ^ ROR32(w[i - 15], 18) ^ LSR32(w[i - 15],  3);
+         s1 = ROR32(w[i -  2], 17) ^ ROR32(w[i -  2], 19) ^ LSR32(w[i -  2], 10);
+         w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+      }
+
+      a = state[0]; b = state[1]; c = state[2]; d = state[3];
+      e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+      for (i = 0; i < 64; i++) 
+      {
+         s0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
+         maj = (a & b) ^ (a & c) ^ (b & c);
+         t2 = s0 + maj;
+         s1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
+         ch = (e & f) ^ (~e & g);
+         t1 = h + s1 + ch + T_K[i] + w[i];
+
+         h = g; g = f; f = e; e = d + t1;
+         d = c; c = b; b = a; a = t1 + t2;
+      }
+
+      state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+      state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+   }
 }
 
-static void sha256_block(struct sha256_ctx *p) 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+   (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#include <immintrin.h>
+#define HAVE_SHA256_SHANI
+
+// Intel SHA extensions. The state is kept as ABEF/CDGH pairs as sha256rnds2 expects.
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha256_blocks_shani(uint32_t *state, const uint8_t *data, size_t blocks)
 {
    unsigned i;
-   uint32_t s0, s1;
-   uint32_t a, b, c, d, e, f, g, h;
-   uint32_t t1, t2, maj, ch;
+   __m128i state0, state1, abef, cdgh, tmp, wk;
+   __m128i msg[4];
+   const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
 
-   for (i = 0; i < 16; i++) 
-      p->w[i] = load32be(p->in.u32 + i);
+   tmp    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1); // CDAB
+   state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b); // EFGH
+   state0 = _mm_alignr_epi8(tmp, state1, 8);    // ABEF
+   state1 = _mm_blend_epi16(state1, tmp, 0xf0); // CDGH
 
-   for (i = 16; i < 64; i++) 
+   for (; blocks; blocks--, data += 64)
    {
-      s0 = ROR32(p->w[i - 15],  7) ^ ROR32(p->w[i - 15], 18) ^ LSR32(p->w[i - 15],  3);
-      s1 = ROR32(p->w[i -  2], 17) ^ ROR32(p->w[i -  2], 19) ^ LSR32(p->w[i -  2], 10);
-      p->w[i] = p->w[i - 16] + s0 + p->w[i - 7] + s1;
+      abef = state0;
+      cdgh = state1;
+
+      for (i = 0; i < 16; i++)
+      {
+         if (i < 4)
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), bswap);
+         else
+         {
+            // W[4i..4i+3] from the four previous message groups.
+            tmp = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+            tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+            msg[i & 3] = _mm_sha256msg2_epu32(tmp, msg[(i + 3) & 3]);
+         }
+
+         wk = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i*)&T_K[4 * i]));
+         state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+         state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0e));
+      }
+
+      state0 = _mm_add_epi32(state0, abef);
+      state1 = _mm_add_epi32(state1, cdgh);
    }
 
-   a = p->h[0]; b = p->h[1]; c = p->h[2]; d = p->h[3];
-   e = p->h[4]; f = p->h[5]; g = p->h[6]; h = p->h[7];
+   tmp    = _mm_shuffle_epi32(state0, 0x1b);    // FEBA
+   state1 = _mm_shuffle_epi32(state1, 0xb1);    // DCHG
+   state0 = _mm_blend_epi16(tmp, state1, 0xf0); // DCBA
+   state1 = _mm_alignr_epi8(state1, tmp, 8);    // HGFE
+   _mm_storeu_si128((__m128i*)&state[0], state0);
+   _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+#endif
 
-   for (i = 0; i < 64; i++) 
+#if (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)) && !defined(__ARMEB__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define HAVE_SHA256_ARMV8
+
+// ARMv8 cryptography extensions.
+static void sha256_blocks_armv8(uint32_t *state, const uint8_t *data, size_t blocks)
+{
+   unsigned i;
+   uint32x4_t state0 = vld1q_u32(&state[0]);
+   uint32x4_t state1 = vld1q_u32(&state[4]);
+   uint32x4_t abcd, efgh, tmp, wk;
+   uint32x4_t msg[4];
+
+   for (; blocks; blocks--, data += 64)
    {
-      s0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
-      maj = (a & b) ^ (a & c) ^ (b & c);
-      t2 = s0 + maj;
-      s1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
-      ch = (e & f) ^ (~e & g);
-      t1 = h + s1 + ch + T_K[i] + p->w[i];
-
-      h = g; g = f; f = e; e = d + t1;
-      d = c; c = b; b = a; a = t1 + t2;
+      abcd = state0;
+      efgh = state1;
+
+      for (i = 0; i < 4; i++)
+         msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+
+      for (i = 0; i < 16; i++)
+      {
+         wk = vaddq_u32(msg[i & 3], vld1q_u32(&T_K[4 * i]));
+
+         // Schedule the group used four iterations from now.
+         if (i < 12)
+            msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]),
+                  msg[(i + 2) & 3], msg[(i + 3) & 3]);
+
+         tmp    = state0;
+         state0 = vsha256hq_u32(state0, state1, wk);
+         state1 = vsha256h2q_u32(state1, tmp, wk);
+      }
+
+      state0 = vaddq_u32(state0, abcd);
+      state1 = vaddq_u32(state1, efgh);
    }
 
-   p->h[0] += a; p->h[1] += b; p->h[2] += c; p->h[3] += d;
-   p->h[4] += e; p->h[5] += f; p->h[6] += g; p->h[7] += h;
+   vst1q_u32(&state[0], state0);
+   vst1q_u32(&state[4], state1);
+}
+#endif
+
+static sha256_blocks_t sha256_find_impl(uint64_t features)
+{
+   (void)features;
 
-   // Next block
-   p->inlen = 0;
+#ifdef HAVE_SHA256_ARMV8
+   if (features & RARCH_CPU_SHA)
+      return sha256_blocks_armv8;
+#endif
+#ifdef HAVE_SHA256_SHANI
+   if ((features & RARCH_CPU_SHA) && (features & RETRO_SIMD_SSE4))
+      return sha256_blocks_shani;
+#endif
+   return sha256_blocks_c;
 }
 
-static void sha256_chunk(struct sha256_ctx *p, const uint8_t *s, unsigned len) 
+// Portable until hash_init() picks the fastest implementation.
+static sha256_blocks_t sha256_blocks_impl = sha256_blocks_c;
+
+void sha256_init(struct sha256_ctx *p) 
 {
-   unsigned l;
-   p->len += len;
+   memset(p, 0, sizeof(*p));
+   memcpy(p->h, T_H, sizeof(T_H));
+}
+
+void sha256_update(struct sha256_ctx *p, const uint8_t *data, size_t size) 
+{
+   size_t blocks;
+   p->len += size;
 
-   while (len) 
+   if (p->inlen)
    {
-      l = 64 - p->inlen;
-      l = (len < l) ? len : l;
+      size_t l = 64 - p->inlen;
+      l = (size < l) ? size : l;
 
-      memcpy(p->in.u8 + p->inlen, s, l);
-      s += l;
+      memcpy(p->in.u8 + p->inlen, data, l);
+      data += l;
       p->inlen += l;
-      len -= l;
+      size -= l;
+
+      if (p->inlen < 64)
+         return;
 
-      if (p->inlen == 64) 
-         sha256_block(p);
+      sha256_blocks_impl(p->h, p->in.u8, 1);
+      p->inlen = 0;
+   }
+
+   // Whole blocks are hashed straight from the input.
+   blocks = size / 64;
+   if (blocks)
+   {
+      sha256_blocks_impl(p->h, data, blocks);
+      data += blocks * 64;
+      size -= blocks * 64;
    }
+
+   memcpy(p->in.u8, data, size);
+   p->inlen = size;
 }
 
-static void sha256_final(struct sha256_ctx *p) 
+void sha256_final(struct sha256_ctx *p, uint8_t *digest) 
 {
-   uint64_t len;
+   unsigned i;
+   uint64_t len = p->len << 3;
    p->in.u8[p->inlen++] = 0x80;
 
    if (p->inlen > 56) 
    {
       memset(p->in.u8 + p->inlen, 0, 64 - p->inlen);
-      sha256_block(p);
+      sha256_blocks_impl(p->h, p->in.u8, 1);
+      p->inlen = 0;
    }
 
    memset(p->in.u8 + p->inlen, 0, 56 - p->inlen);
 
-   len = p->len << 3;
    store32be(p->in.u32 + 14, (uint32_t)(len >> 32));
    store32be(p->in.u32 + 15, (uint32_t)len);
-   sha256_block(p);
+   sha256_blocks_impl(p->h, p->in.u8, 1);
+
+   for (i = 0; i < 8; i++)
+   {
+      digest[4 * i + 0] = (uint8_t)(p->h[i] >> 24);
+      digest[4 * i + 1] = (uint8_t)(p->h[i] >> 16);
+      digest[4 * i + 2] = (uint8_t)(p->h[i] >>  8);
+      digest[4 * i + 3] = (uint8_t)(p->h[i] >>  0);
+   }
 }
 
-static void sha256_subhash(struct sha256_ctx *p, uint32_t *t) 
+void sha256_digest_string(char *out, const uint8_t *digest)
 {
    unsigned i;
-   for (i = 0; i < 8; i++) 
-      store32be(t++, p->h[i]);
+   for (i = 0; i < 32; i++)
+      snprintf(out + 2 * i, 3, "%02x", (unsigned)digest[i]);
 }
 
 void sha256_hash(char *out, const uint8_t *in, size_t size)
 {
-   unsigned i;
    struct sha256_ctx sha;
-
-   union
-   {
-      uint32_t u32[8];
-      uint8_t u8[32];
-   } shahash;
+   uint8_t digest[32];
 
    sha256_init(&sha);
-   sha256_chunk(&sha, in, size);
-   sha256_final(&sha);
-   sha256_subhash(&sha, shahash.u32);
-
-   for (i = 0; i < 32; i++)
-      snprintf(out + 2 * i, 3, "%02x", (unsigned)shahash.u8[i]);
+   sha256_update(&sha, in, size);
+   sha256_final(&sha, digest);
+   sha256_digest_string(out, digest);
 }
 
-#ifndef HAVE_ZLIB
-// Zlib crc32.
+// Zlib crc32. Also serves as the first slice-by-8 table.
 static const uint32_t crc32_table[256] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
@@ -233,18 +350,241 @@ static const uint32_t crc32_table[256] = {
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+// Remaining slice-by-8 tables, derived from crc32_table by hash_init().
+static uint32_t crc32_slice_table[7][256];
+
+static void crc32_init_slice_tables(void)
+{
+   unsigned i, j;
+   for (i = 0; i < 256; i++)
+   {
+      uint32_t crc = crc32_table[i];
+      for (j = 0; j < 7; j++)
+      {
+         crc = (crc >> 8) ^ crc32_table[crc & 0xff];
+         crc32_slice_table[j][i] = crc;
+      }
+   }
+}
+
+static inline uint32_t load32le(const uint8_t *data)
+{
+   return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+      ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
 uint32_t crc32_adjust(uint32_t crc32, uint8_t input)
 {
    return ((crc32 >> 8) & 0x00ffffff) ^ crc32_table[(crc32 ^ input) & 0xff];
 }
 
-uint32_t crc32_calculate(const uint8_t *data, size_t length)
+// All CRC32 backends below operate on the raw (inverted) CRC state.
+static uint32_t crc32_bytewise(uint32_t crc, const uint8_t *data, size_t length)
+{
+   while (length--)
+      crc = crc32_adjust(crc, *data++);
+   return crc;
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t *data, size_t length)
+{
+   const uint32_t (*t)[256] = crc32_slice_table;
+
+   for (; length && ((uintptr_t)data & 7); length--)
+      crc = crc32_adjust(crc, *data++);
+
+   for (; length >= 8; length -= 8, data += 8)
+   {
+      uint32_t lo = load32le(data) ^ crc;
+      uint32_t hi = load32le(data + 4);
+
+      crc = t[6][lo & 0xff] ^ t[5][(lo >> 8) & 0xff] ^
+         t[4][(lo >> 16) & 0xff] ^ t[3][lo >> 24] ^
+         t[2][hi & 0xff] ^ t[1][(hi >> 8) & 0xff] ^
+         t[0][(hi >> 16) & 0xff] ^ crc32_table[hi >> 24];
+   }
+
+   while (length--)
+      crc = crc32_adjust(crc, *data++);
+
+   return crc;
+}
+
+#if defined(__ARM_FEATURE_CRC32) && !defined(__ARMEB__) && !defined(__AARCH64EB__)
+#include <arm_acle.h>
+#define HAVE_CRC32_ARMV8
+
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t *data, size_t length)
+{
+   for (; length && ((uintptr_t)data & 7); length--)
+      crc = __crc32b(crc, *data++);
+
+   for (; length >= 8; length -= 8, data += 8)
+   {
+      uint64_t v;
+      memcpy(&v, data, sizeof(v));
+      crc = __crc32d(crc, v);
+   }
+
+   while (length--)
+      crc = __crc32b(crc, *data++);
+
+   return crc;
+}
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+   (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#define HAVE_CRC32_PCLMUL
+
+// Folding CRC32 with carry-less multiplication, after Intel's
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+// length must be a multiple of 16 and at least 64.
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul_fold(uint32_t crc, const uint8_t *data, size_t length)
+{
+   static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+   static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+   static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+   static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+
+   __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+   __m128i y5, y6, y7, y8;
+
+   x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+   x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+   x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+   x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+   x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+   x0 = _mm_load_si128((const __m128i*)k1k2);
+
+   data += 64;
+   length -= 64;
+
+   // Fold four 128-bit lanes in parallel.
+   for (; length >= 64; length -= 64, data += 64)
+   {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+      y5 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+      y6 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+      y7 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+      y8 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+   }
+
+   // Fold the four lanes into one.
+   x0 = _mm_load_si128((const __m128i*)k3k4);
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+   // Remaining 16 byte blocks.
+   for (; length >= 16; length -= 16, data += 16)
+   {
+      x2 = _mm_loadu_si128((const __m128i*)data);
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+   }
+
+   // 128 -> 64 bits.
+   x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+   x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+   x1 = _mm_srli_si128(x1, 8);
+   x1 = _mm_xor_si128(x1, x2);
+
+   x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+   x2 = _mm_srli_si128(x1, 4);
+   x1 = _mm_and_si128(x1, x3);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+
+   // Barrett reduction to 32 bits.
+   x0 = _mm_load_si128((const __m128i*)poly);
+   x2 = _mm_and_si128(x1, x3);
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+   x2 = _mm_and_si128(x2, x3);
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+
+   return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t *data, size_t length)
 {
-   size_t i;
-   uint32_t crc32 = ~0;
-   for (i = 0; i < length; i++)
-      crc32 = crc32_adjust(crc32, data[i]);
-   return ~crc32;
+   if (length >= 64)
+   {
+      size_t chunk = length & ~(size_t)15;
+      crc = crc32_pclmul_fold(crc, data, chunk);
+      data += chunk;
+      length -= chunk;
+   }
+
+   return crc32_slice8(crc, data, length);
 }
 #endif
 
+typedef uint32_t (*crc32_update_t)(uint32_t, const uint8_t*, size_t);
+
+// Table-driven bytewise until hash_init() has built the slice tables.
+static crc32_update_t crc32_update_impl = crc32_bytewise;
+
+static crc32_update_t crc32_find_impl(uint64_t features)
+{
+   (void)features;
+
+   crc32_init_slice_tables();
+
+#ifdef HAVE_CRC32_ARMV8
+   if (features & RARCH_CPU_CRC32)
+      return crc32_armv8;
+#endif
+#ifdef HAVE_CRC32_PCLMUL
+   if ((features & RARCH_CPU_PCLMUL) && (features & RETRO_SIMD_SSE4))
+      return crc32_pclmul;
+#endif
+   return crc32_slice8;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length)
+{
+   return ~crc32_update_impl(~crc, data, length);
+}
+
+void hash_init(void)
+{
+   static bool initialized;
+   uint64_t features;
+
+   if (initialized)
+      return;
+   initialized = true;
+
+   features           = rarch_get_cpu_features();
+   sha256_blocks_impl = sha256_find_impl(features);
+   crc32_update_impl  = crc32_find_impl(features);
+}
@@ -24,26 +24,47 @@
 #include "config.h"
 #endif
 
+struct sha256_ctx
+{
+   union
+   {
+      uint8_t u8[64];
+      uint32_t u32[16];
+   } in;
+   unsigned inlen;
+
+   uint32_t h[8];
+   uint64_t len;
+};
+
+// Picks the fastest SHA256 and CRC32 implementations for this CPU.
+// Call once at startup, before any other thread hashes. Until then, portable fallbacks are used.
+void hash_init(void);
+
+// Incremental SHA256. sha256_final() writes the 32 byte binary digest.
+// After hash_init(), block processing uses SHA extensions (x86 SHA-NI or ARMv8 crypto) when the CPU has them.
+void sha256_init(struct sha256_ctx *p);
+void sha256_update(struct sha256_ctx *p, const uint8_t *data, size_t size);
+void sha256_final(struct sha256_ctx *p, uint8_t *digest);
+
+// Formats a binary digest as 64 hex characters plus terminator.
+void sha256_digest_string(char *out, const uint8_t *digest);
+
 // Hashes sha256 and outputs a human readable string for comparing with the cheat XML values.
 void sha256_hash(char *out, const uint8_t *in, size_t size);
 
-#ifdef HAVE_ZLIB
-#include <zlib.h>
+// Zlib-compatible CRC32. crc32_update() continues a running checksum,
+// starting from 0, so data can be checksummed in arbitrarily sized chunks.
+// The fastest implementation available (slice-by-8, ARMv8 CRC32 or x86 PCLMUL) is picked by hash_init().
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length);
 
 static inline uint32_t crc32_calculate(const uint8_t *data, size_t length)
 {
-   return crc32(0, data, length);
+   return crc32_update(0, data, length);
 }
 
-static inline uint32_t crc32_adjust(uint32_t crc, uint8_t data)
-{
-   // zlib and nall have different assumptions on "sign" for this function.
-   return ~crc32(~crc, &data, 1);
-}
-#else
-uint32_t crc32_calculate(const uint8_t *data, size_t length);
+// Advances a raw (non-inverted) CRC32 state by one byte, nall style.
 uint32_t crc32_adjust(uint32_t crc, uint8_t data);
-#endif
 
 #endif
 
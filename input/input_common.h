@@ -103,6 +103,22 @@ const char *input_joypad_name(const rarch_joypad_driver_t *driver, unsigned joyp
 extern const rarch_joypad_driver_t dinput_joypad;
 extern const rarch_joypad_driver_t linuxraw_joypad;
 extern const rarch_joypad_driver_t udev_joypad;
+
+#if defined(HAVE_UDEV) && defined(HAVE_THREADS)
+// Time from the kernel seeing a joypad event until the frontend applied it, in microseconds.
+struct udev_joypad_latency
+{
+   uint64_t events;
+   unsigned dropped; // Events lost to a full queue.
+   retro_time_t avg;
+   retro_time_t p50;
+   retro_time_t p99;
+   retro_time_t max;
+};
+
+void udev_joypad_get_latency(struct udev_joypad_latency *latency);
+void udev_joypad_reset_latency(void);
+#endif
 extern const rarch_joypad_driver_t winxinput_joypad; // Named as such to avoid confusion with xb1/360 port code
 extern const rarch_joypad_driver_t sdl_joypad;
 
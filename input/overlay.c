@@ -67,10 +67,21 @@ struct overlay_desc
    bool movable;
 };
 
+// Uniform grid over the overlay's normalized [0, 1] space, built at load time.
+// Every cell lists, in desc order, the descs whose largest hitbox (range_mod applied) touches it,
+// so polling only has to test the descs of the touched cell.
+struct overlay_grid
+{
+   unsigned dim;
+   unsigned *cell_start; // dim * dim + 1 offsets into descs.
+   unsigned *descs;
+};
+
 struct overlay
 {
    struct overlay_desc *descs;
    size_t size;
+   struct overlay_grid grid;
 
    struct texture_image image;
 
@@ -88,12 +99,27 @@ struct overlay
    unsigned load_images_size;
 };
 
+// Vertex geometry and alpha of an image of the active overlay.
+// Changes are queued during the frame and sent to the video driver together in input_overlay_flush().
+struct overlay_image_state
+{
+   struct video_overlay_update queued;
+   struct video_overlay_update sent;
+   bool geom_queued, alpha_queued;
+   bool geom_sent, alpha_sent;
+};
+
 struct input_overlay
 {
    void *iface_data;
    const video_overlay_interface_t *iface;
    bool enable;
 
+   struct overlay_image_state *images;
+   struct video_overlay_update *updates;
+   unsigned num_images;
+   unsigned max_images;
+
    bool blocked;
 
    struct overlay *overlays;
@@ -134,18 +160,83 @@ static void input_overlay_scale(struct overlay *overlay, float scale)
    }
 }
 
+static void input_overlay_queue_geom(input_overlay_t *ol, unsigned image, float x, float y, float w, float h)
+{
+   struct overlay_image_state *img = &ol->images[image];
+   img->queued.x = x;
+   img->queued.y = y;
+   img->queued.w = w;
+   img->queued.h = h;
+   img->geom_queued = true;
+}
+
+static void input_overlay_queue_alpha(input_overlay_t *ol, unsigned image, float alpha)
+{
+   struct overlay_image_state *img = &ol->images[image];
+   img->queued.alpha = alpha;
+   img->alpha_queued = true;
+}
+
+// Sends what changed since the last flush to the video driver, in a single update() if supported.
+static void input_overlay_flush(input_overlay_t *ol)
+{
+   unsigned i, count = 0;
+   for (i = 0; i < ol->num_images; i++)
+   {
+      struct overlay_image_state *img = &ol->images[i];
+      bool geom = img->geom_queued && (!img->geom_sent ||
+            img->queued.x != img->sent.x || img->queued.y != img->sent.y ||
+            img->queued.w != img->sent.w || img->queued.h != img->sent.h);
+      bool alpha = img->alpha_queued && (!img->alpha_sent || img->queued.alpha != img->sent.alpha);
+
+      img->geom_queued = img->alpha_queued = false;
+      if (!geom && !alpha)
+         continue;
+
+      if (geom)
+      {
+         img->sent.x = img->queued.x;
+         img->sent.y = img->queued.y;
+         img->sent.w = img->queued.w;
+         img->sent.h = img->queued.h;
+         img->geom_sent = true;
+      }
+      if (alpha)
+      {
+         img->sent.alpha = img->queued.alpha;
+         img->alpha_sent = true;
+      }
+
+      if (ol->iface->update && img->geom_sent && img->alpha_sent)
+      {
+         ol->updates[count] = img->sent;
+         ol->updates[count++].image = i;
+      }
+      else
+      {
+         if (geom)
+            ol->iface->vertex_geom(ol->iface_data, i, img->sent.x, img->sent.y, img->sent.w, img->sent.h);
+         if (alpha)
+            ol->iface->set_alpha(ol->iface_data, i, img->sent.alpha);
+      }
+   }
+
+   if (count)
+      ol->iface->update(ol->iface_data, ol->updates, count);
+}
+
 static void input_overlay_set_vertex_geom(input_overlay_t *ol)
 {
    size_t i;
    if (ol->active->image.pixels)
-      ol->iface->vertex_geom(ol->iface_data, 0,
+      input_overlay_queue_geom(ol, 0,
             ol->active->mod_x, ol->active->mod_y, ol->active->mod_w, ol->active->mod_h);
 
    for (i = 0; i < ol->active->size; i++)
    {
       struct overlay_desc *desc = &ol->active->descs[i];
       if (desc->image.pixels)
-         ol->iface->vertex_geom(ol->iface_data, desc->image_index,
+         input_overlay_queue_geom(ol, desc->image_index,
                desc->mod_x, desc->mod_y, desc->mod_w, desc->mod_h);
    }
 }
@@ -157,6 +248,7 @@ void input_overlay_set_scale_factor(input_overlay_t *ol, float scale)
       input_overlay_scale(&ol->overlays[i], scale);
 
    input_overlay_set_vertex_geom(ol);
+   input_overlay_flush(ol);
 }
 
 static void input_overlay_free_overlay(struct overlay *overlay)
@@ -166,6 +258,8 @@ static void input_overlay_free_overlay(struct overlay *overlay)
       texture_image_free(&overlay->descs[i].image);
    free(overlay->load_images);
    free(overlay->descs);
+   free(overlay->grid.cell_start);
+   free(overlay->grid.descs);
    texture_image_free(&overlay->image);
 }
 
@@ -333,6 +427,90 @@ end:
    return ret;
 }
 
+#define OVERLAY_GRID_MAX_DIM 16
+
+static unsigned overlay_grid_cell(unsigned dim, float pos)
+{
+   unsigned cell;
+   if (!(pos > 0.0f)) // Also catches NaN.
+      return 0;
+   if (pos >= 1.0f)
+      return dim - 1;
+
+   cell = (unsigned)(pos * dim);
+   return cell < dim ? cell : dim - 1;
+}
+
+static void overlay_grid_desc_cells(const struct overlay_grid *grid, const struct overlay_desc *desc,
+      unsigned *x0, unsigned *y0, unsigned *x1, unsigned *y1)
+{
+   // Pressed descs grow their hitbox by range_mod.
+   float range_mod = desc->range_mod > 1.0f ? desc->range_mod : 1.0f;
+   float range_x = desc->range_x * range_mod;
+   float range_y = desc->range_y * range_mod;
+
+   *x0 = overlay_grid_cell(grid->dim, desc->x - range_x);
+   *x1 = overlay_grid_cell(grid->dim, desc->x + range_x);
+   *y0 = overlay_grid_cell(grid->dim, desc->y - range_y);
+   *y1 = overlay_grid_cell(grid->dim, desc->y + range_y);
+}
+
+static bool input_overlay_build_grid(struct overlay *overlay)
+{
+   size_t i;
+   unsigned x, y, x0, y0, x1, y1, cells;
+   unsigned *fill = NULL;
+   struct overlay_grid *grid = &overlay->grid;
+
+   // Around one desc per cell.
+   grid->dim = (unsigned)ceil(sqrt((double)overlay->size));
+   if (grid->dim < 1)
+      grid->dim = 1;
+   else if (grid->dim > OVERLAY_GRID_MAX_DIM)
+      grid->dim = OVERLAY_GRID_MAX_DIM;
+   cells = grid->dim * grid->dim;
+
+   grid->cell_start = (unsigned*)calloc(cells + 1, sizeof(unsigned));
+   fill = (unsigned*)calloc(cells, sizeof(unsigned));
+   if (!grid->cell_start || !fill)
+      goto error;
+
+   for (i = 0; i < overlay->size; i++)
+   {
+      overlay_grid_desc_cells(grid, &overlay->descs[i], &x0, &y0, &x1, &y1);
+      for (y = y0; y <= y1; y++)
+         for (x = x0; x <= x1; x++)
+            grid->cell_start[y * grid->dim + x + 1]++;
+   }
+
+   for (i = 0; i < cells; i++)
+      grid->cell_start[i + 1] += grid->cell_start[i];
+
+   grid->descs = (unsigned*)malloc((grid->cell_start[cells] + 1) * sizeof(unsigned));
+   if (!grid->descs)
+      goto error;
+
+   for (i = 0; i < overlay->size; i++)
+   {
+      overlay_grid_desc_cells(grid, &overlay->descs[i], &x0, &y0, &x1, &y1);
+      for (y = y0; y <= y1; y++)
+      {
+         for (x = x0; x <= x1; x++)
+         {
+            unsigned cell = y * grid->dim + x;
+            grid->descs[grid->cell_start[cell] + fill[cell]++] = i;
+         }
+      }
+   }
+
+   free(fill);
+   return true;
+
+error:
+   free(fill);
+   return false;
+}
+
 static bool input_overlay_load_overlay(input_overlay_t *ol, config_file_t *conf, const char *config_path,
       struct overlay *overlay, unsigned index)
 {
@@ -460,6 +638,12 @@ static bool input_overlay_load_overlay(input_overlay_t *ol, config_file_t *conf,
    overlay->center_x = overlay->x + 0.5f * overlay->w;
    overlay->center_y = overlay->y + 0.5f * overlay->h;
 
+   if (!input_overlay_build_grid(overlay))
+   {
+      RARCH_ERR("[Overlay]: Failed to allocate hitbox grid.\n");
+      return false;
+   }
+
    return true;
 }
 
@@ -560,17 +744,30 @@ end:
    return ret;
 }
 
+static void input_overlay_queue_alpha_mod(input_overlay_t *ol)
+{
+   unsigned i;
+   for (i = 0; i < ol->num_images; i++)
+      input_overlay_queue_alpha(ol, i, g_settings.input.overlay_opacity);
+}
+
 static void input_overlay_load_active(input_overlay_t *ol)
 {
    ol->iface->load(ol->iface_data, ol->active->load_images, ol->active->load_images_size);
 
-   input_overlay_set_alpha_mod(ol, g_settings.input.overlay_opacity);
+   // The driver has fresh images, nothing it was told before applies.
+   ol->num_images = ol->active->load_images_size;
+   memset(ol->images, 0, ol->num_images * sizeof(*ol->images));
+
+   input_overlay_queue_alpha_mod(ol);
    input_overlay_set_vertex_geom(ol);
+   input_overlay_flush(ol);
    ol->iface->full_screen(ol->iface_data, ol->active->full_screen);
 }
 
 input_overlay_t *input_overlay_new(const char *overlay)
 {
+   size_t i;
    input_overlay_t *ol = (input_overlay_t*)calloc(1, sizeof(*ol));
 
    if (!ol)
@@ -598,6 +795,15 @@ input_overlay_t *input_overlay_new(const char *overlay)
    if (!input_overlay_load_overlays(ol, overlay))
       goto error;
 
+   for (i = 0; i < ol->size; i++)
+      if (ol->overlays[i].load_images_size > ol->max_images)
+         ol->max_images = ol->overlays[i].load_images_size;
+
+   ol->images = (struct overlay_image_state*)calloc(ol->max_images + 1, sizeof(*ol->images));
+   ol->updates = (struct video_overlay_update*)calloc(ol->max_images + 1, sizeof(*ol->updates));
+   if (!ol->images || !ol->updates)
+      goto error;
+
    ol->active = &ol->overlays[0];
 
    input_overlay_load_active(ol);
@@ -655,7 +861,8 @@ static inline float clamp(float val, float lower, float upper)
 
 void input_overlay_poll(input_overlay_t *ol, input_overlay_state_t *out, int16_t norm_x, int16_t norm_y)
 {
-   size_t i;
+   unsigned i, cell;
+   const struct overlay_grid *grid;
    memset(out, 0, sizeof(*out));
 
    if (!ol->enable)
@@ -673,9 +880,12 @@ void input_overlay_poll(input_overlay_t *ol, input_overlay_state_t *out, int16_t
    x /= ol->active->mod_w;
    y /= ol->active->mod_h;
 
-   for (i = 0; i < ol->active->size; i++)
+   grid = &ol->active->grid;
+   cell = overlay_grid_cell(grid->dim, y) * grid->dim + overlay_grid_cell(grid->dim, x);
+
+   for (i = grid->cell_start[cell]; i < grid->cell_start[cell + 1]; i++)
    {
-      struct overlay_desc *desc = &ol->active->descs[i];
+      struct overlay_desc *desc = &ol->active->descs[grid->descs[i]];
       if (!inside_hitbox(desc, x, y))
          continue;
 
@@ -727,7 +937,7 @@ static void input_overlay_update_desc_geom(input_overlay_t *ol, struct overlay_d
 {
    if (desc->image.pixels && desc->movable)
    {
-      ol->iface->vertex_geom(ol->iface_data, desc->image_index,
+      input_overlay_queue_geom(ol, desc->image_index,
             desc->mod_x + desc->delta_x, desc->mod_y + desc->delta_y,
             desc->mod_w, desc->mod_h);
 
@@ -740,7 +950,7 @@ void input_overlay_post_poll(input_overlay_t *ol)
 {
    size_t i;
 
-   input_overlay_set_alpha_mod(ol, g_settings.input.overlay_opacity);
+   input_overlay_queue_alpha_mod(ol);
 
    for (i = 0; i < ol->active->size; i++)
    {
@@ -753,7 +963,7 @@ void input_overlay_post_poll(input_overlay_t *ol)
          desc->range_y_mod = desc->range_y * desc->range_mod;
 
          if (desc->image.pixels)
-            ol->iface->set_alpha(ol->iface_data, desc->image_index,
+            input_overlay_queue_alpha(ol, desc->image_index,
                   desc->alpha_mod * g_settings.input.overlay_opacity);
       }
       else
@@ -765,13 +975,15 @@ void input_overlay_post_poll(input_overlay_t *ol)
       input_overlay_update_desc_geom(ol, desc);
       desc->updated = false;
    }
+
+   input_overlay_flush(ol);
 }
 
 void input_overlay_poll_clear(input_overlay_t *ol)
 {
    size_t i;
    ol->blocked = false;
-   input_overlay_set_alpha_mod(ol, g_settings.input.overlay_opacity);
+   input_overlay_queue_alpha_mod(ol);
 
    for (i = 0; i < ol->active->size; i++)
    {
@@ -784,6 +996,35 @@ void input_overlay_poll_clear(input_overlay_t *ol)
       desc->delta_y = 0.0f;
       input_overlay_update_desc_geom(ol, desc);
    }
+
+   input_overlay_flush(ol);
+}
+
+void input_overlay_poll_touches(input_overlay_t *ol, input_overlay_state_t *out,
+      const int16_t *norm_x, const int16_t *norm_y, unsigned touches)
+{
+   unsigned i, j;
+   input_overlay_state_t polled;
+
+   memset(out, 0, sizeof(*out));
+   for (i = 0; i < touches; i++)
+   {
+      input_overlay_poll(ol, &polled, norm_x[i], norm_y[i]);
+
+      out->buttons |= polled.buttons;
+      for (j = 0; j < ARRAY_SIZE(out->keys); j++)
+         out->keys[j] |= polled.keys[j];
+
+      // Touches later in the list take priority for analogs.
+      for (j = 0; j < ARRAY_SIZE(out->analog); j++)
+         if (polled.analog[j])
+            out->analog[j] = polled.analog[j];
+   }
+
+   if (touches)
+      input_overlay_post_poll(ol);
+   else
+      input_overlay_poll_clear(ol);
 }
 
 void input_overlay_next(input_overlay_t *ol)
@@ -812,14 +1053,17 @@ void input_overlay_free(input_overlay_t *ol)
    if (ol->iface)
       ol->iface->enable(ol->iface_data, false);
 
+   free(ol->images);
+   free(ol->updates);
+
    free(ol->overlay_path);
    free(ol);
 }
 
 void input_overlay_set_alpha_mod(input_overlay_t *ol, float mod)
 {
-   unsigned i;
-   for (i = 0; i < ol->active->load_images_size; i++)
-      ol->iface->set_alpha(ol->iface_data, i, g_settings.input.overlay_opacity);
+   (void)mod;
+   input_overlay_queue_alpha_mod(ol);
+   input_overlay_flush(ol);
 }
 
@@ -58,6 +58,12 @@ void input_overlay_post_poll(input_overlay_t *ol);
 // Call when there is nothing to poll. Allows overlay to clear certain state.
 void input_overlay_poll_clear(input_overlay_t *ol);
 
+// Polls every touch of a frame at once and merges the results into out,
+// then does input_overlay_post_poll(), or input_overlay_poll_clear() if there are no touches.
+// Buttons and keys of all touches are combined, touches later in the list take priority for analogs.
+void input_overlay_poll_touches(input_overlay_t *ol, input_overlay_state_t *out,
+      const int16_t *norm_x, const int16_t *norm_y, unsigned touches);
+
 // Sets a modulating factor for alpha channel. Default is 1.0.
 // The alpha factor is applied for all overlays.
 void input_overlay_set_alpha_mod(input_overlay_t *ol, float mod);
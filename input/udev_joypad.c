@@ -28,11 +28,22 @@
 #include <linux/types.h>
 #include <linux/input.h>
 
+#if defined(HAVE_THREADS) && !defined(IS_JOYCONFIG)
+#define UDEV_JOYPAD_THREAD
+#include <sys/epoll.h>
+#include "../thread.h"
+#include "../performance.h"
+#endif
+
 // Udev/evdev Linux joypad driver.
 // More complex and extremely low level,
 // but only Linux driver which can support joypad rumble.
 // Uses udev for device detection + hotplug.
 //
+// With threads, an input thread blocks in epoll on every pad and the udev monitor.
+// It queues timestamped events in a lock-free ring which the main thread drains in poll(),
+// and with input_joypad_poll_on_state also right before every button/axis query.
+//
 // Code adapted from SDL 2.0's implementation.
 
 #define NUM_BUTTONS 32
@@ -62,6 +73,10 @@ struct udev_joypad
 
    char *ident;
    char *path;
+
+   unsigned generation; // Tells queued events apart from those of a pad later plugged into the same port.
+   volatile bool unplugged; // Set by the input thread once the device is gone. The main thread frees the pad.
+   bool monotonic; // Kernel event timestamps use CLOCK_MONOTONIC, like rarch_get_time_usec().
 };
 
 static struct udev *g_udev;
@@ -80,6 +95,49 @@ static inline int16_t compute_axis(const struct input_absinfo *info, int value)
       return axis;
 }
 
+static void apply_event(struct udev_joypad *pad, unsigned type, int code, int value)
+{
+   switch (type)
+   {
+      case EV_KEY:
+         if (code >= BTN_MISC || (code >= KEY_UP && code <= KEY_DOWN))
+            pad->buttons[pad->button_bind[code]] = value;
+         break;
+
+      case EV_ABS:
+         if (code >= ABS_MISC)
+            break;
+
+         switch (code)
+         {
+            case ABS_HAT0X:
+            case ABS_HAT0Y:
+            case ABS_HAT1X:
+            case ABS_HAT1Y:
+            case ABS_HAT2X:
+            case ABS_HAT2Y:
+            case ABS_HAT3X:
+            case ABS_HAT3Y:
+            {
+               code -= ABS_HAT0X;
+               pad->hats[code >> 1][code & 1] = value;
+               break;
+            }
+
+            default:
+            {
+               unsigned axis = pad->axes_bind[code];
+               pad->axes[axis] = compute_axis(&pad->absinfo[axis], value);
+               break;
+            }
+         }
+         break;
+
+      default:
+         break;
+   }
+}
+
 static void poll_pad(unsigned p)
 {
    struct udev_joypad *pad = &g_pads[p];
@@ -92,52 +150,335 @@ static void poll_pad(unsigned p)
    while ((len = read(pad->fd, events, sizeof(events))) > 0)
    {
       len /= sizeof(*events);
+      for (i = 0; i < len; i++)
+         apply_event(pad, events[i].type, events[i].code, events[i].value);
+   }
+}
+
+#ifdef UDEV_JOYPAD_THREAD
+// Must be a power of two. Roughly a second of events from every pad moving every axis at 1 kHz.
+#define EVENT_QUEUE_SIZE 4096
+// Latency histogram, 50 us buckets up to 50 ms.
+#define LATENCY_BUCKET_USEC 50
+#define LATENCY_BUCKETS 1000
+
+#define EPOLL_ID_HOTPLUG (MAX_PLAYERS + 0)
+#define EPOLL_ID_WAKE    (MAX_PLAYERS + 1)
+// Pads are watched with their generation in the upper half, so events of a replaced pad are ignored.
+#define EPOLL_PAD_DATA(p) ((uint64_t)(p) | ((uint64_t)g_pads[p].generation << 32))
+
+#define udev_barrier() __sync_synchronize()
+
+struct queued_event
+{
+   retro_time_t time;
+   unsigned generation;
+   uint16_t pad;
+   uint16_t type;
+   uint16_t code;
+   int32_t value;
+};
+
+static struct
+{
+   sthread_t *thread;
+   slock_t *lock; // Keeps pad fds alive while the thread reads them.
+   int epoll_fd;
+   int wake_fd[2];
+   volatile bool quit;
+   volatile bool hotplug;
+   unsigned generation;
+
+   // Single producer (input thread), single consumer (main thread).
+   volatile uint32_t head;
+   volatile uint32_t tail;
+   volatile uint32_t dropped;
+   struct queued_event events[EVENT_QUEUE_SIZE];
+
+   uint64_t latency_count;
+   retro_time_t latency_total;
+   retro_time_t latency_max;
+   uint32_t latency_hist[LATENCY_BUCKETS + 1];
+} g_input = { NULL, NULL, -1, { -1, -1 } };
+
+// Reads every pending event of a pad and queues it. Called on the input thread with the lock held.
+// Returns false if the device can't be read anymore, e.g. because it was unplugged.
+static bool queue_pad_events(unsigned p)
+{
+   int i, len;
+   struct input_event events[32];
+   struct udev_joypad *pad = &g_pads[p];
+
+   while ((len = read(pad->fd, events, sizeof(events))) > 0)
+   {
+      retro_time_t now = rarch_get_time_usec();
+      len /= sizeof(*events);
+
       for (i = 0; i < len; i++)
       {
-         int code = events[i].code;
-         switch (events[i].type)
+         uint32_t head = g_input.head;
+         struct queued_event *ev;
+
+         if (events[i].type != EV_KEY && events[i].type != EV_ABS)
+            continue;
+
+         if (head - g_input.tail >= EVENT_QUEUE_SIZE)
          {
-            case EV_KEY:
-               if (code >= BTN_MISC || (code >= KEY_UP && code <= KEY_DOWN))
-                  pad->buttons[pad->button_bind[code]] = events[i].value;
-               break;
+            g_input.dropped++;
+            continue;
+         }
+         // The slot must not be written before the consumer is seen to be done with it.
+         udev_barrier();
+
+         ev = &g_input.events[head & (EVENT_QUEUE_SIZE - 1)];
+         ev->time       = pad->monotonic ?
+            events[i].time.tv_sec * (retro_time_t)1000000 + events[i].time.tv_usec : now;
+         ev->generation = pad->generation;
+         ev->pad        = p;
+         ev->type       = events[i].type;
+         ev->code       = events[i].code;
+         ev->value      = events[i].value;
+
+         udev_barrier();
+         g_input.head = head + 1;
+      }
+   }
+
+   return len >= 0 || errno == EAGAIN || errno == EINTR;
+}
+
+static void input_thread(void *data)
+{
+   (void)data;
+   struct epoll_event events[MAX_PLAYERS + 2];
 
-            case EV_ABS:
-               if (code >= ABS_MISC)
-                  break;
+   while (!g_input.quit)
+   {
+      int i, ret = epoll_wait(g_input.epoll_fd, events, MAX_PLAYERS + 2, -1);
+      if (ret < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         RARCH_ERR("[udev]: epoll_wait() failed, stopping input thread.\n");
+         break;
+      }
 
-               switch (code)
+      for (i = 0; i < ret; i++)
+      {
+         unsigned id = (uint32_t)events[i].data.u64;
+         unsigned generation = (unsigned)(events[i].data.u64 >> 32);
+         if (id == EPOLL_ID_HOTPLUG)
+            g_input.hotplug = true;
+         else if (id < MAX_PLAYERS)
+         {
+            struct udev_joypad *pad = &g_pads[id];
+
+            slock_lock(g_input.lock);
+            // The pad might have been freed or replaced since epoll_wait() returned.
+            if (pad->fd >= 0 && pad->generation == generation && !pad->unplugged)
+            {
+               bool ok = queue_pad_events(id);
+
+               // Pads are level triggered, so a gone device would wake us up over and over.
+               if (!ok || (events[i].events & (EPOLLERR | EPOLLHUP)))
                {
-                  case ABS_HAT0X:
-                  case ABS_HAT0Y:
-                  case ABS_HAT1X:
-                  case ABS_HAT1Y:
-                  case ABS_HAT2X:
-                  case ABS_HAT2Y:
-                  case ABS_HAT3X:
-                  case ABS_HAT3Y:
-                  {
-                     code -= ABS_HAT0X;
-                     pad->hats[code >> 1][code & 1] = events[i].value;
-                     break;
-                  }
-
-                  default:
-                  {
-                     unsigned axis = pad->axes_bind[code];
-                     pad->axes[axis] = compute_axis(&pad->absinfo[axis], events[i].value);
-                     break;
-                  }
+                  epoll_ctl(g_input.epoll_fd, EPOLL_CTL_DEL, pad->fd, NULL);
+                  pad->unplugged  = true;
+                  g_input.hotplug = true;
                }
-               break;
-
-            default:
-               break;
+            }
+            slock_unlock(g_input.lock);
          }
       }
    }
 }
 
+static bool epoll_add(int fd, uint64_t data, uint32_t flags)
+{
+   struct epoll_event event = {0};
+   event.events   = EPOLLIN | flags;
+   event.data.u64 = data;
+   return epoll_ctl(g_input.epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static void latency_add(retro_time_t latency)
+{
+   if (latency < 0)
+      latency = 0;
+
+   g_input.latency_count++;
+   g_input.latency_total += latency;
+   if (latency > g_input.latency_max)
+      g_input.latency_max = latency;
+
+   if (latency / LATENCY_BUCKET_USEC < LATENCY_BUCKETS)
+      g_input.latency_hist[latency / LATENCY_BUCKET_USEC]++;
+   else
+      g_input.latency_hist[LATENCY_BUCKETS]++;
+}
+
+static retro_time_t latency_percentile(unsigned percent)
+{
+   unsigned i;
+   uint64_t seen = 0;
+   uint64_t target = (g_input.latency_count * percent + 99) / 100;
+
+   for (i = 0; i <= LATENCY_BUCKETS; i++)
+   {
+      seen += g_input.latency_hist[i];
+      if (seen >= target && seen)
+         return i < LATENCY_BUCKETS ? (i + 1) * LATENCY_BUCKET_USEC : g_input.latency_max;
+   }
+   return 0;
+}
+
+// Applies queued events to the pad state. Main thread only.
+static void drain_events(void)
+{
+   uint32_t tail = g_input.tail;
+   uint32_t head = g_input.head;
+   retro_time_t now;
+
+   if (tail == head)
+      return;
+
+   udev_barrier();
+   now = rarch_get_time_usec();
+
+   for (; tail != head; tail++)
+   {
+      const struct queued_event *ev = &g_input.events[tail & (EVENT_QUEUE_SIZE - 1)];
+      struct udev_joypad *pad = &g_pads[ev->pad];
+
+      if (pad->fd >= 0 && pad->generation == ev->generation)
+         apply_event(pad, ev->type, ev->code, ev->value);
+      latency_add(now - ev->time);
+   }
+
+   udev_barrier();
+   g_input.tail = tail;
+}
+
+static bool thread_pad_add(unsigned p)
+{
+   struct udev_joypad *pad = &g_pads[p];
+   pad->generation = ++g_input.generation;
+
+#ifdef EVIOCSCLOCKID
+   int clock_id = CLOCK_MONOTONIC;
+   pad->monotonic = ioctl(pad->fd, EVIOCSCLOCKID, &clock_id) == 0;
+#endif
+
+   if (g_input.thread && !epoll_add(pad->fd, EPOLL_PAD_DATA(p), 0))
+   {
+      RARCH_ERR("[udev]: Failed to watch pad #%u for input.\n", p);
+      return false;
+   }
+   return true;
+}
+
+static void thread_pad_remove(unsigned p)
+{
+   if (!g_input.thread || g_pads[p].fd < 0)
+      return;
+   epoll_ctl(g_input.epoll_fd, EPOLL_CTL_DEL, g_pads[p].fd, NULL);
+}
+
+void udev_joypad_get_latency(struct udev_joypad_latency *latency)
+{
+   memset(latency, 0, sizeof(*latency));
+   latency->events  = g_input.latency_count;
+   latency->dropped = g_input.dropped;
+   if (!g_input.latency_count)
+      return;
+
+   latency->avg = g_input.latency_total / (retro_time_t)g_input.latency_count;
+   latency->p50 = latency_percentile(50);
+   latency->p99 = latency_percentile(99);
+   latency->max = g_input.latency_max;
+}
+
+void udev_joypad_reset_latency(void)
+{
+   g_input.latency_count = 0;
+   g_input.latency_total = 0;
+   g_input.latency_max   = 0;
+   g_input.dropped       = 0;
+   memset(g_input.latency_hist, 0, sizeof(g_input.latency_hist));
+}
+
+static void thread_deinit(void)
+{
+   if (g_input.thread)
+   {
+      char c = 0;
+      g_input.quit = true;
+      if (write(g_input.wake_fd[1], &c, 1) != 1)
+         RARCH_WARN("[udev]: Failed to wake up input thread.\n");
+      sthread_join(g_input.thread);
+      g_input.thread = NULL;
+   }
+
+   if (g_input.lock)
+      slock_free(g_input.lock);
+   g_input.lock = NULL;
+
+   if (g_input.epoll_fd >= 0)
+      close(g_input.epoll_fd);
+   if (g_input.wake_fd[0] >= 0)
+      close(g_input.wake_fd[0]);
+   if (g_input.wake_fd[1] >= 0)
+      close(g_input.wake_fd[1]);
+   g_input.epoll_fd = g_input.wake_fd[0] = g_input.wake_fd[1] = -1;
+
+   if (g_input.latency_count)
+   {
+      struct udev_joypad_latency latency;
+      udev_joypad_get_latency(&latency);
+      RARCH_LOG("[udev]: Input latency over %llu events: avg %lld us, p50 %lld us, p99 %lld us, max %lld us, %u dropped.\n",
+            (unsigned long long)latency.events, (long long)latency.avg, (long long)latency.p50,
+            (long long)latency.p99, (long long)latency.max, latency.dropped);
+      udev_joypad_reset_latency();
+   }
+}
+
+static bool thread_init(void)
+{
+   unsigned i;
+
+   g_input.quit    = false;
+   g_input.hotplug = false;
+   g_input.head    = g_input.tail = g_input.dropped = 0;
+
+   g_input.epoll_fd = epoll_create(MAX_PLAYERS + 2);
+   if (g_input.epoll_fd < 0 || pipe(g_input.wake_fd) < 0)
+      goto error;
+
+   if (!epoll_add(g_input.wake_fd[0], EPOLL_ID_WAKE, 0))
+      goto error;
+   // Edge triggered, the main thread receives the devices.
+   if (g_udev_mon && !epoll_add(udev_monitor_get_fd(g_udev_mon), EPOLL_ID_HOTPLUG, EPOLLET))
+      goto error;
+
+   for (i = 0; i < MAX_PLAYERS; i++)
+      if (g_pads[i].fd >= 0 && !epoll_add(g_pads[i].fd, EPOLL_PAD_DATA(i), 0))
+         goto error;
+
+   if (!(g_input.lock = slock_new()))
+      goto error;
+   if (!(g_input.thread = sthread_create(input_thread, NULL)))
+      goto error;
+
+   RARCH_LOG("[udev]: Started input thread.\n");
+   return true;
+
+error:
+   RARCH_WARN("[udev]: Failed to start input thread, polling pads every frame instead.\n");
+   thread_deinit();
+   return false;
+}
+#endif
+
 static bool hotplug_available(void)
 {
    if (!g_udev_mon)
@@ -150,6 +491,7 @@ static bool hotplug_available(void)
 
 static void check_device(const char *path, bool hotplugged);
 static void remove_device(const char *path);
+static void disconnect_pad(unsigned pad);
 
 static void handle_hotplug(void)
 {
@@ -242,6 +584,28 @@ static bool udev_set_rumble(unsigned i, enum retro_rumble_effect effect, uint16_
 static void udev_joypad_poll(void)
 {
    unsigned i;
+
+#ifdef UDEV_JOYPAD_THREAD
+   if (g_input.thread)
+   {
+      if (g_input.hotplug)
+      {
+         g_input.hotplug = false;
+         udev_barrier();
+         while (hotplug_available())
+            handle_hotplug();
+
+         // Pads the input thread found gone, if udev has not reported them yet.
+         for (i = 0; i < MAX_PLAYERS; i++)
+            if (g_pads[i].fd >= 0 && g_pads[i].unplugged)
+               disconnect_pad(i);
+      }
+
+      drain_events();
+      return;
+   }
+#endif
+
    while (hotplug_available())
       handle_hotplug();
 
@@ -290,6 +654,12 @@ static int find_vacant_pad(void)
 
 static void free_pad(unsigned pad, bool hotplug)
 {
+#ifdef UDEV_JOYPAD_THREAD
+   if (g_input.lock)
+      slock_lock(g_input.lock);
+   thread_pad_remove(pad);
+#endif
+
    if (g_pads[pad].fd >= 0)
       close(g_pads[pad].fd);
 
@@ -301,6 +671,11 @@ static void free_pad(unsigned pad, bool hotplug)
    g_pads[pad].fd = -1;
    g_pads[pad].ident = g_settings.input.device_names[pad];
 
+#ifdef UDEV_JOYPAD_THREAD
+   if (g_input.lock)
+      slock_unlock(g_input.lock);
+#endif
+
    // Avoid autoconfig spam if we're reiniting driver.
    if (hotplug)
       input_config_autoconfigure_joypad(pad, NULL, NULL);
@@ -408,6 +783,13 @@ static void check_device(const char *path, bool hotplugged)
 
    if (add_pad(pad, fd, path))
    {
+#ifdef UDEV_JOYPAD_THREAD
+      if (!thread_pad_add(pad))
+      {
+         free_pad(pad, hotplugged);
+         return;
+      }
+#endif
 #ifndef IS_JOYCONFIG
       if (hotplugged)
       {
@@ -427,6 +809,17 @@ static void check_device(const char *path, bool hotplugged)
    }
 }
 
+static void disconnect_pad(unsigned pad)
+{
+#ifndef IS_JOYCONFIG
+   char msg[512];
+   snprintf(msg, sizeof(msg), "Joypad #%u (%s) disconnected.", pad, g_pads[pad].ident);
+   msg_queue_push(g_extern.msg_queue, msg, 0, 60);
+   RARCH_LOG("[udev]: %s\n", msg);
+#endif
+   free_pad(pad, true);
+}
+
 static void remove_device(const char *path)
 {
    unsigned i;
@@ -434,13 +827,7 @@ static void remove_device(const char *path)
    {
       if (g_pads[i].path && !strcmp(g_pads[i].path, path))
       {
-#ifndef IS_JOYCONFIG
-         char msg[512];
-         snprintf(msg, sizeof(msg), "Joypad #%u (%s) disconnected.", i, g_pads[i].ident);
-         msg_queue_push(g_extern.msg_queue, msg, 0, 60);
-         RARCH_LOG("[udev]: %s\n", msg);
-#endif
-         free_pad(i, true);
+         disconnect_pad(i);
          break;
       }
    }
@@ -449,6 +836,10 @@ static void remove_device(const char *path)
 static void udev_joypad_destroy(void)
 {
    unsigned i;
+#ifdef UDEV_JOYPAD_THREAD
+   thread_deinit();
+#endif
+
    for (i = 0; i < MAX_PLAYERS; i++)
       free_pad(i, false);
 
@@ -501,6 +892,10 @@ static bool udev_joypad_init(void)
    }
 
    udev_enumerate_unref(enumerate);
+
+#ifdef UDEV_JOYPAD_THREAD
+   thread_init();
+#endif
    return true;
 
 error:
@@ -528,6 +923,11 @@ static bool udev_joypad_hat(const struct udev_joypad *pad, uint16_t hat)
 
 static bool udev_joypad_button(unsigned port, uint16_t joykey)
 {
+#ifdef UDEV_JOYPAD_THREAD
+   if (g_settings.input.joypad_poll_on_state && g_input.thread)
+      drain_events();
+#endif
+
    const struct udev_joypad *pad = &g_pads[port];
 
    if (GET_HAT_DIR(joykey))
@@ -541,6 +941,11 @@ static int16_t udev_joypad_axis(unsigned port, uint32_t joyaxis)
    if (joyaxis == AXIS_NONE)
       return 0;
 
+#ifdef UDEV_JOYPAD_THREAD
+   if (g_settings.input.joypad_poll_on_state && g_input.thread)
+      drain_events();
+#endif
+
    const struct udev_joypad *pad = &g_pads[port];
 
    int16_t val = 0;
@@ -847,6 +847,7 @@ enum retro_camera_buffer
 {
    RETRO_CAMERA_BUFFER_OPENGL_TEXTURE = 0,
    RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER,
+   RETRO_CAMERA_BUFFER_RAW_YUYV_FRAMEBUFFER, // Set instead of RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER for packed YUYV raw framebuffers.
 
    RETRO_CAMERA_BUFFER_DUMMY = INT_MAX
 };
@@ -861,6 +862,10 @@ typedef void (*retro_camera_lifetime_status_t)(void);
 // A callback for raw framebuffer data. buffer points to an XRGB8888 buffer.
 // Width, height and pitch are similar to retro_video_refresh_t.
 // First pixel is top-left origin.
+// If RETRO_CAMERA_BUFFER_RAW_YUYV_FRAMEBUFFER is set in caps instead of RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER,
+// buffer is YUYV: every uint32_t holds two pixels, as bytes Y0, U, Y1, V in memory order.
+// If both are set, buffer is XRGB8888. Camera drivers which can't deliver YUYV fail to initialize
+// when it is the only raw format requested and no OpenGL texture is requested either.
 typedef void (*retro_camera_frame_raw_framebuffer_t)(const uint32_t *buffer, unsigned width, unsigned height, size_t pitch);
 // A callback for when OpenGL textures are used.
 //
@@ -1,6 +1,6 @@
 /*  RetroArch - A frontend for libretro.
  *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
- * 
+ *
  *  RetroArch is free software: you can redistribute it and/or modify it under the terms
  *  of the GNU General Public License as published by the Free Software Found-
  *  ation, either version 3 of the License, or (at your option) any later version.
@@ -18,142 +18,243 @@
 #include <stddef.h>
 #include "message_queue.h"
 #include "boolean.h"
-#include "compat/posix_string.h"
+#include "compat/strl.h"
+
+#if defined(_MSC_VER) && !defined(_XBOX)
+#include <windows.h>
+#define msg_cas(ptr, old, val) ((unsigned)InterlockedCompareExchange((volatile LONG*)(ptr), (LONG)(val), (LONG)(old)))
+#define msg_atomic_inc(ptr) InterlockedIncrement((volatile LONG*)(ptr))
+#define msg_barrier() MemoryBarrier()
+#elif defined(__GNUC__)
+#define msg_cas(ptr, old, val) __sync_val_compare_and_swap((ptr), (old), (val))
+#define msg_atomic_inc(ptr) __sync_fetch_and_add((ptr), 1)
+#define msg_barrier() __sync_synchronize()
+#else
+// No atomics, pushing is only safe from one thread at a time.
+static inline unsigned msg_cas(volatile unsigned *ptr, unsigned old, unsigned new_val)
+{
+   unsigned cur = *ptr;
+   if (cur == old)
+      *ptr = new_val;
+   return cur;
+}
+#define msg_atomic_inc(ptr) ((*(ptr))++)
+#define msg_barrier()
+#endif
 
-struct queue_elem
+// Pushed messages wait here until the next pull. A bounded multi-producer ring,
+// each cell's sequence number tells whether it is free for the push at that position
+// (seq == pos) or holds a message for the pull (seq == pos + 1).
+struct msg_cell
 {
+   volatile unsigned seq;
+   unsigned generation;
+   unsigned prio;
    unsigned duration;
+   char msg[MSG_QUEUE_TEXT_SIZE];
+};
+
+// A message being shown, only touched by the pulling thread.
+struct msg_active
+{
    unsigned prio;
-   char *msg;
+   unsigned duration;
+   unsigned order;
+   char msg[MSG_QUEUE_TEXT_SIZE];
 };
 
 struct msg_queue
 {
-   struct queue_elem **elems;
-   size_t ptr;
+   struct msg_cell *cells;
+   unsigned mask;
+   volatile unsigned push_pos;
+   unsigned pull_pos;
+
+   // Bumped by msg_queue_clear(). Messages pushed before a clear are dropped by the next pull.
+   volatile unsigned generation;
+   unsigned pull_generation;
+
+   struct msg_active *active;
+   size_t num_active;
    size_t size;
-   char *tmp_msg;
+   unsigned order;
+
+   char expired_msg[MSG_QUEUE_TEXT_SIZE];
 };
 
 msg_queue_t *msg_queue_new(size_t size)
 {
-   msg_queue_t *queue = (msg_queue_t*)calloc(1, sizeof(*queue));
-   if (!queue)
+   unsigned i, cells = 4;
+   msg_queue_t *queue;
+
+   if (!size)
       return NULL;
 
-   queue->size = size + 1;
-   queue->elems = (struct queue_elem**)calloc(queue->size, sizeof(struct queue_elem*)); 
+   while (cells < size)
+      cells <<= 1;
 
-   if (!queue->elems)
+   queue = (msg_queue_t*)calloc(1, sizeof(*queue));
+   if (!queue)
+      return NULL;
+
+   queue->cells  = (struct msg_cell*)calloc(cells, sizeof(*queue->cells));
+   queue->active = (struct msg_active*)calloc(size, sizeof(*queue->active));
+   if (!queue->cells || !queue->active)
    {
-      free(queue);
+      msg_queue_free(queue);
       return NULL;
    }
-   queue->ptr = 1;
+
+   for (i = 0; i < cells; i++)
+      queue->cells[i].seq = i;
+   queue->mask = cells - 1;
+   queue->size = size;
    return queue;
 }
 
 void msg_queue_free(msg_queue_t *queue)
 {
-   msg_queue_clear(queue);
-   free(queue->elems);
+   if (!queue)
+      return;
+
+   free(queue->cells);
+   free(queue->active);
    free(queue);
 }
 
 void msg_queue_push(msg_queue_t *queue, const char *msg, unsigned prio, unsigned duration)
 {
-   if (queue->ptr >= queue->size)
+   struct msg_cell *cell;
+   unsigned pos;
+
+   if (!msg || !duration)
       return;
 
-   struct queue_elem *new_elem = (struct queue_elem*)calloc(1, sizeof(struct queue_elem));
-   new_elem->prio = prio;
-   new_elem->duration = duration;
-   new_elem->msg = msg ? strdup(msg) : NULL;
+   pos = queue->push_pos;
+   for (;;)
+   {
+      int diff;
+      unsigned cur;
 
-   queue->elems[queue->ptr] = new_elem;
-   size_t tmp_ptr = queue->ptr++;
+      cell = &queue->cells[pos & queue->mask];
+      diff = (int)(cell->seq - pos);
+      msg_barrier();
 
-   while (tmp_ptr > 1)
-   {
-      struct queue_elem *parent = queue->elems[tmp_ptr >> 1];
-      struct queue_elem *child = queue->elems[tmp_ptr];
+      // Full until the next pull, drop the message.
+      if (diff < 0)
+         return;
 
-      if (child->prio <= parent->prio)
-         break;
-      else
+      if (diff == 0)
       {
-         queue->elems[tmp_ptr >> 1] = child;
-         queue->elems[tmp_ptr] = parent;
+         cur = msg_cas(&queue->push_pos, pos, pos + 1);
+         if (cur == pos)
+            break;
+         pos = cur;
       }
-      tmp_ptr >>= 1;
+      else
+         pos = queue->push_pos;
    }
+
+   cell->generation = queue->generation;
+   cell->prio       = prio;
+   cell->duration   = duration;
+   strlcpy(cell->msg, msg, sizeof(cell->msg));
+
+   msg_barrier();
+   cell->seq = pos + 1;
 }
 
 void msg_queue_clear(msg_queue_t *queue)
 {
-   size_t i;
-   for (i = 1; i < queue->ptr; i++)
+   msg_atomic_inc(&queue->generation);
+}
+
+// Merges a pushed message into the shown ones. A message which is already shown only
+// gets its duration and priority raised, instead of being queued behind itself.
+static void msg_queue_add_active(msg_queue_t *queue, const struct msg_cell *cell)
+{
+   size_t i, lowest = 0;
+   struct msg_active *active;
+
+   for (i = 0; i < queue->num_active; i++)
    {
-      if (queue->elems[i])
+      active = &queue->active[i];
+      if (strcmp(active->msg, cell->msg) == 0)
       {
-         free(queue->elems[i]->msg);
-         free(queue->elems[i]);
-         queue->elems[i] = NULL;
+         if (cell->duration > active->duration)
+            active->duration = cell->duration;
+         if (cell->prio > active->prio)
+            active->prio = cell->prio;
+         return;
       }
+
+      if (active->prio < queue->active[lowest].prio)
+         lowest = i;
    }
-   queue->ptr = 1;
-   free(queue->tmp_msg);
-   queue->tmp_msg = NULL;
+
+   if (queue->num_active < queue->size)
+      active = &queue->active[queue->num_active++];
+   else if (cell->prio > queue->active[lowest].prio)
+      active = &queue->active[lowest];
+   else
+      return;
+
+   active->prio     = cell->prio;
+   active->duration = cell->duration;
+   active->order    = queue->order++;
+   memcpy(active->msg, cell->msg, sizeof(active->msg));
 }
 
-const char *msg_queue_pull(msg_queue_t *queue)
+static void msg_queue_drain(msg_queue_t *queue)
 {
-   if (queue->ptr == 1) // Nothing in queue. :(
-      return NULL;
+   unsigned generation = queue->generation;
+   if (generation != queue->pull_generation)
+   {
+      queue->pull_generation = generation;
+      queue->num_active = 0;
+   }
 
-   struct queue_elem *front = queue->elems[1];
-   front->duration--;
-   if (front->duration > 0)
-      return front->msg;
-   else
+   for (;;)
    {
-      free(queue->tmp_msg);
-      queue->tmp_msg = front->msg;
-      front->msg = NULL;
+      struct msg_cell *cell = &queue->cells[queue->pull_pos & queue->mask];
+      if (cell->seq != queue->pull_pos + 1)
+         break;
+      msg_barrier();
 
-      struct queue_elem *front = queue->elems[1];
-      struct queue_elem *last = queue->elems[--queue->ptr];
-      queue->elems[1] = last;
-      free(front);
+      if (cell->generation == generation)
+         msg_queue_add_active(queue, cell);
 
-      size_t tmp_ptr = 1;
-      for (;;)
-      {
-         bool left = (tmp_ptr * 2 <= queue->ptr) && (queue->elems[tmp_ptr] < queue->elems[tmp_ptr * 2]);
-         bool right = (tmp_ptr * 2 + 1 <= queue->ptr) && (queue->elems[tmp_ptr] < queue->elems[tmp_ptr * 2 + 1]);
+      msg_barrier();
+      cell->seq = queue->pull_pos + queue->mask + 1;
+      queue->pull_pos++;
+   }
+}
 
-         if (!left && !right)
-            break;
+const char *msg_queue_pull(msg_queue_t *queue)
+{
+   size_t i, best = 0;
+   struct msg_active *front;
 
-         size_t switch_index = tmp_ptr;
-         if (left && !right)
-            switch_index <<= 1;
-         else if (right && !left)
-            switch_index += switch_index + 1;
-         else
-         {
-            if (queue->elems[tmp_ptr * 2] >= queue->elems[tmp_ptr * 2 + 1])
-               switch_index <<= 1;
-            else
-               switch_index += switch_index + 1;
-         }
-         struct queue_elem *parent = queue->elems[tmp_ptr];
-         struct queue_elem *child = queue->elems[switch_index];
-         queue->elems[tmp_ptr] = child;
-         queue->elems[switch_index] = parent;
-         tmp_ptr = switch_index;
-      }
+   msg_queue_drain(queue);
+   if (!queue->num_active) // Nothing in queue. :(
+      return NULL;
 
-      return queue->tmp_msg;
+   // Highest priority first, oldest first among equals.
+   for (i = 1; i < queue->num_active; i++)
+   {
+      const struct msg_active *active = &queue->active[i];
+      if (active->prio > queue->active[best].prio ||
+            (active->prio == queue->active[best].prio &&
+             (int)(active->order - queue->active[best].order) < 0))
+         best = i;
    }
+
+   front = &queue->active[best];
+   if (--front->duration > 0)
+      return front->msg;
+
+   // Last time this message is shown, it stays valid until the next pull.
+   memcpy(queue->expired_msg, front->msg, sizeof(queue->expired_msg));
+   *front = queue->active[--queue->num_active];
+   return queue->expired_msg;
 }
@@ -17,22 +17,31 @@
 #ifndef __RARCH_MSG_QUEUE_H
 #define __RARCH_MSG_QUEUE_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct msg_queue msg_queue_t;
 
+// Longer messages are truncated.
+#define MSG_QUEUE_TEXT_SIZE 256
+
 // Creates a message queue with maximum size different messages. Returns NULL if allocation error.
+// All memory is allocated up front.
 msg_queue_t *msg_queue_new(size_t size);
 
 // Higher prio is... higher prio :) Duration is how many times a message can be pulled from queue before it vanishes. (E.g. show a message for 3 seconds @ 60fps = 180 duration). 
+// Lock-free, can be called from any thread. Messages pushed between two pulls beyond the queue size are dropped.
 void msg_queue_push(msg_queue_t *queue, const char *msg, unsigned prio, unsigned duration);
 
 // Pulls highest prio message in queue. Returns NULL if no message in queue.
+// Must only be called from one thread. Pushing a message which is already shown
+// extends it instead of queueing a duplicate. The returned string is valid until the next pull.
 const char *msg_queue_pull(msg_queue_t *queue);
 
-// Clear out everything in queue.
+// Clear out everything in queue. Can be called from any thread, takes effect on the next pull.
 void msg_queue_clear(msg_queue_t *queue);
 
 void msg_queue_free(msg_queue_t *queue);
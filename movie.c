@@ -1,6 +1,6 @@
 /*  RetroArch - A frontend for libretro.
  *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
- * 
+ *
  *  RetroArch is free software: you can redistribute it and/or modify it under the terms
  *  of the GNU General Public License as published by the Free Software Found-
  *  ation, either version 3 of the License, or (at your option) any later version.
@@ -21,10 +21,52 @@
 #include "general.h"
 #include "dynamic.h"
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if !defined(_WIN32) && !defined(RARCH_CONSOLE)
+#include <sys/types.h>
+#include <unistd.h>
+#define MOVIE_POSIX_IO
+#elif defined(_WIN32) && !defined(RARCH_CONSOLE)
+#include <io.h>
+#endif
+
+// BSV2 layout, all values little-endian except the magic:
+// Header: u32 magic (big-endian, reads BSV2 in a hex editor), u32 ROM CRC32,
+//         u32 state size, u32 keyframe interval, u64 offset of the index (0 if the movie was not closed).
+// Records follow the header:
+//    Frame:    u8 BSV2_FRAME, u16 input count, input count * s16.
+//    Keyframe: u8 BSV2_KEYFRAME, u32 frame, u32 flags, u32 data size, data.
+//              A keyframe holds the state at the start of its frame, zlib compressed if BSV2_KEYFRAME_ZLIB is set.
+// Index: u32 frame count, u64 offset of every frame record,
+//        u32 keyframe count, u32 frame and u64 offset of every keyframe record.
+#define BSV2_HEADER_SIZE 24
+#define BSV2_FRAME 1
+#define BSV2_KEYFRAME 2
+#define BSV2_KEYFRAME_ZLIB (1 << 0)
+#define BSV2_FRAME_HEADER_SIZE 3
+#define BSV2_KEYFRAME_HEADER_SIZE 13
+#define BSV2_MAX_INPUTS 0xffff
+
+// Records are collected in memory and written once a block is full.
+#define BSV2_BLOCK_SIZE (64 * 1024)
+
+#define BSV2_POS_UNKNOWN ((uint64_t)-1)
+
+struct bsv_keyframe
+{
+   unsigned frame;
+   uint64_t offset;
+};
+
 struct bsv_movie
 {
    FILE *file;
+   unsigned version;
 
+   // BSV1 playback.
    size_t *frame_pos; // A ring buffer keeping track of positions in the file for each frame.
    size_t frame_mask;
    size_t frame_ptr;
@@ -37,32 +79,115 @@ struct bsv_movie
    bool playback;
    bool first_rewind;
    bool did_rewind;
+
+   // BSV2.
+   unsigned keyframe_interval;
+   unsigned frame; // Frame about to be played or recorded.
+
+   uint64_t *frame_offset;
+   unsigned frame_count;
+   unsigned frame_cap;
+
+   struct bsv_keyframe *keyframes;
+   unsigned keyframe_count;
+   unsigned keyframe_cap;
+
+   // Inputs of the current frame.
+   int16_t *inputs;
+   size_t input_count;
+   size_t input_cap;
+   size_t input_ptr;
+   bool frame_loaded;
+
+   // Playback only. File position, so records which follow each other are read without seeking.
+   uint64_t read_pos;
+
+   // Recording only. The file position is always block_offset.
+   uint8_t *block;
+   size_t block_size;
+   size_t block_cap;
+   uint64_t block_offset;
+   uint8_t *packed;
+   size_t packed_cap;
 };
 
-static bool init_playback(bsv_movie_t *handle, const char *path)
+static inline void put16(uint8_t *out, uint16_t val)
 {
-   handle->playback = true;
-   handle->file = fopen(path, "rb");
-   if (!handle->file)
-   {
-      RARCH_ERR("Couldn't open BSV file \"%s\" for playback.\n", path);
-      return false;
-   }
+   out[0] = (uint8_t)(val >> 0);
+   out[1] = (uint8_t)(val >> 8);
+}
 
-   uint32_t header[4] = {0};
-   if (fread(header, sizeof(uint32_t), 4, handle->file) != 4)
-   {
-      RARCH_ERR("Couldn't read movie header.\n");
+static inline void put32(uint8_t *out, uint32_t val)
+{
+   out[0] = (uint8_t)(val >>  0);
+   out[1] = (uint8_t)(val >>  8);
+   out[2] = (uint8_t)(val >> 16);
+   out[3] = (uint8_t)(val >> 24);
+}
+
+static inline void put64(uint8_t *out, uint64_t val)
+{
+   put32(out, (uint32_t)val);
+   put32(out + 4, (uint32_t)(val >> 32));
+}
+
+static inline uint16_t get16(const uint8_t *in)
+{
+   return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static inline uint32_t get32(const uint8_t *in)
+{
+   return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static inline uint64_t get64(const uint8_t *in)
+{
+   return (uint64_t)get32(in) | ((uint64_t)get32(in + 4) << 32);
+}
+
+static bool grow(void **buf, unsigned *cap, unsigned needed, size_t elem_size)
+{
+   unsigned new_cap = *cap ? *cap : 1024;
+   void *new_buf;
+
+   if (needed <= *cap)
+      return true;
+
+   while (new_cap < needed)
+      new_cap *= 2;
+
+   new_buf = realloc(*buf, new_cap * elem_size);
+   if (!new_buf)
       return false;
-   }
 
-   // Compatibility with old implementation that used incorrect documentation.
-   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
-   {
-      RARCH_ERR("Movie file is not a valid BSV1 file.\n");
+   *buf = new_buf;
+   *cap = new_cap;
+   return true;
+}
+
+static bool grow_bytes(uint8_t **buf, size_t *cap, size_t needed)
+{
+   size_t new_cap = *cap ? *cap : BSV2_BLOCK_SIZE;
+   uint8_t *new_buf;
+
+   if (needed <= *cap)
+      return true;
+
+   while (new_cap < needed)
+      new_cap *= 2;
+
+   new_buf = (uint8_t*)realloc(*buf, new_cap);
+   if (!new_buf)
       return false;
-   }
 
+   *buf = new_buf;
+   *cap = new_cap;
+   return true;
+}
+
+static bool init_playback_bsv1(bsv_movie_t *handle, const uint32_t *header)
+{
    if (swap_if_big32(header[CRC_INDEX]) != g_extern.cart_crc)
       RARCH_WARN("CRC32 checksum mismatch between ROM file and saved ROM checksum in replay file header; replay highly likely to desync on playback.\n");
 
@@ -87,11 +212,387 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
          RARCH_WARN("Movie format seems to have a different serializer version. Will most likely fail.\n");
    }
 
-   handle->min_file_pos = sizeof(header) + state_size;
+   handle->min_file_pos = 4 * sizeof(uint32_t) + state_size;
+
+   // Just pick something really large :D ~1 million frames rewind should do the trick.
+   if (!(handle->frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
+      return false;
+
+   handle->frame_pos[0] = handle->min_file_pos;
+   handle->frame_mask = (1 << 20) - 1;
+   return true;
+}
+
+static bool bsv2_add_frame(bsv_movie_t *handle, uint64_t offset)
+{
+   if (!grow((void**)&handle->frame_offset, &handle->frame_cap, handle->frame_count + 1, sizeof(uint64_t)))
+      return false;
+   handle->frame_offset[handle->frame_count++] = offset;
+   return true;
+}
+
+static bool bsv2_add_keyframe(bsv_movie_t *handle, unsigned frame, uint64_t offset)
+{
+   if (!grow((void**)&handle->keyframes, &handle->keyframe_cap, handle->keyframe_count + 1, sizeof(*handle->keyframes)))
+      return false;
+   handle->keyframes[handle->keyframe_count].frame  = frame;
+   handle->keyframes[handle->keyframe_count].offset = offset;
+   handle->keyframe_count++;
+   return true;
+}
+
+static bool bsv2_read_index(bsv_movie_t *handle, uint64_t index_offset)
+{
+   unsigned i;
+   uint8_t buf[12];
+
+   if (fseek(handle->file, (long)index_offset, SEEK_SET) != 0 || fread(buf, 1, 4, handle->file) != 4)
+      return false;
+
+   unsigned frames = get32(buf);
+   for (i = 0; i < frames; i++)
+   {
+      if (fread(buf, 1, 8, handle->file) != 8 || !bsv2_add_frame(handle, get64(buf)))
+         return false;
+   }
+
+   if (fread(buf, 1, 4, handle->file) != 4)
+      return false;
+
+   unsigned keyframes = get32(buf);
+   for (i = 0; i < keyframes; i++)
+   {
+      if (fread(buf, 1, 12, handle->file) != 12 || !bsv2_add_keyframe(handle, get32(buf), get64(buf + 4)))
+         return false;
+   }
+
+   return true;
+}
+
+// Rebuilds the index of a movie which was not closed properly, e.g. after a crash.
+static bool bsv2_scan_records(bsv_movie_t *handle)
+{
+   uint8_t buf[BSV2_KEYFRAME_HEADER_SIZE];
+   uint64_t offset = BSV2_HEADER_SIZE;
+
+   RARCH_WARN("Movie has no index, rebuilding it.\n");
+   fseek(handle->file, (long)offset, SEEK_SET);
+
+   for (;;)
+   {
+      uint64_t size;
+      if (fread(buf, 1, 1, handle->file) != 1)
+         break;
+
+      if (buf[0] == BSV2_FRAME && fread(buf + 1, 1, BSV2_FRAME_HEADER_SIZE - 1, handle->file) == BSV2_FRAME_HEADER_SIZE - 1)
+      {
+         size = BSV2_FRAME_HEADER_SIZE + get16(buf + 1) * sizeof(int16_t);
+         if (!bsv2_add_frame(handle, offset))
+            return false;
+      }
+      else if (buf[0] == BSV2_KEYFRAME &&
+            fread(buf + 1, 1, BSV2_KEYFRAME_HEADER_SIZE - 1, handle->file) == BSV2_KEYFRAME_HEADER_SIZE - 1)
+      {
+         // A keyframe always precedes its own frame.
+         if (get32(buf + 1) != handle->frame_count)
+            break;
+         size = BSV2_KEYFRAME_HEADER_SIZE + get32(buf + 9);
+         if (!bsv2_add_keyframe(handle, get32(buf + 1), offset))
+            return false;
+      }
+      else
+         break;
+
+      offset += size;
+      if (fseek(handle->file, (long)offset, SEEK_SET) != 0)
+         break;
+   }
+
+   // The last record might be truncated.
+   if (handle->frame_count)
+   {
+      fseek(handle->file, 0, SEEK_END);
+      if ((uint64_t)ftell(handle->file) < offset)
+         handle->frame_count--;
+   }
+
+   return true;
+}
 
+static bool bsv2_read_at(bsv_movie_t *handle, uint64_t offset, void *data, size_t size)
+{
+   if (offset != handle->read_pos && fseek(handle->file, (long)offset, SEEK_SET) != 0)
+   {
+      handle->read_pos = BSV2_POS_UNKNOWN;
+      return false;
+   }
+
+   if (fread(data, 1, size, handle->file) != size)
+   {
+      handle->read_pos = BSV2_POS_UNKNOWN;
+      return false;
+   }
+
+   handle->read_pos = offset + size;
    return true;
 }
 
+static bool bsv2_load_keyframe(bsv_movie_t *handle, unsigned index)
+{
+   uint8_t header[BSV2_KEYFRAME_HEADER_SIZE];
+   bool ret = false;
+
+   if (!bsv2_read_at(handle, handle->keyframes[index].offset, header, sizeof(header)) ||
+         header[0] != BSV2_KEYFRAME)
+   {
+      RARCH_ERR("Couldn't read keyframe from movie.\n");
+      return false;
+   }
+
+   uint32_t flags = get32(header + 5);
+   uint32_t size  = get32(header + 9);
+   uint8_t *data  = (uint8_t*)malloc(size ? size : 1);
+   if (!data || !bsv2_read_at(handle, handle->read_pos, data, size))
+   {
+      RARCH_ERR("Couldn't read keyframe from movie.\n");
+      free(data);
+      return false;
+   }
+
+   if (flags & BSV2_KEYFRAME_ZLIB)
+   {
+#ifdef HAVE_ZLIB
+      uLongf state_size = handle->state_size;
+      ret = uncompress(handle->state, &state_size, data, size) == Z_OK && state_size == handle->state_size;
+#else
+      RARCH_ERR("Movie keyframe is compressed, but this build has no zlib support.\n");
+#endif
+   }
+   else if (size == handle->state_size)
+   {
+      memcpy(handle->state, data, size);
+      ret = true;
+   }
+   free(data);
+
+   if (!ret)
+   {
+      RARCH_ERR("Movie keyframe is corrupt.\n");
+      return false;
+   }
+
+   if (pretro_serialize_size() == handle->state_size)
+      pretro_unserialize(handle->state, handle->state_size);
+   else
+      RARCH_WARN("Movie format seems to have a different serializer version. Will most likely fail.\n");
+
+   handle->frame = handle->keyframes[index].frame;
+   handle->frame_loaded = false;
+   return true;
+}
+
+static bool init_playback_bsv2(bsv_movie_t *handle)
+{
+   uint8_t header[BSV2_HEADER_SIZE];
+
+   fseek(handle->file, 0, SEEK_SET);
+   if (fread(header, 1, sizeof(header), handle->file) != sizeof(header))
+   {
+      RARCH_ERR("Couldn't read movie header.\n");
+      return false;
+   }
+
+   if (get32(header + 4) != g_extern.cart_crc)
+      RARCH_WARN("CRC32 checksum mismatch between ROM file and saved ROM checksum in replay file header; replay highly likely to desync on playback.\n");
+
+   handle->state_size        = get32(header + 8);
+   handle->keyframe_interval = get32(header + 12);
+   uint64_t index_offset     = get64(header + 16);
+
+   if (handle->state_size && !(handle->state = (uint8_t*)malloc(handle->state_size)))
+      return false;
+
+   // Reading the index moves the file position around.
+   handle->read_pos = BSV2_POS_UNKNOWN;
+
+   if (!index_offset || !bsv2_read_index(handle, index_offset))
+   {
+      handle->frame_count    = 0;
+      handle->keyframe_count = 0;
+      if (!bsv2_scan_records(handle))
+         return false;
+   }
+
+   RARCH_LOG("BSV2 movie: %u frames, %u keyframes.\n", handle->frame_count, handle->keyframe_count);
+
+   if (handle->state_size && handle->keyframe_count && handle->keyframes[0].frame == 0)
+      return bsv2_load_keyframe(handle, 0);
+   return true;
+}
+
+static bool init_playback(bsv_movie_t *handle, const char *path)
+{
+   handle->playback = true;
+   handle->file = fopen(path, "rb");
+   if (!handle->file)
+   {
+      RARCH_ERR("Couldn't open BSV file \"%s\" for playback.\n", path);
+      return false;
+   }
+
+   uint32_t header[4] = {0};
+   if (fread(header, sizeof(uint32_t), 4, handle->file) != 4)
+   {
+      RARCH_ERR("Couldn't read movie header.\n");
+      return false;
+   }
+
+   if (swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC)
+   {
+      handle->version = 2;
+      return init_playback_bsv2(handle);
+   }
+
+   // Compatibility with old implementation that used incorrect documentation.
+   if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC && swap_if_big32(header[MAGIC_INDEX]) != BSV_MAGIC)
+   {
+      RARCH_ERR("Movie file is not a valid BSV1 or BSV2 file.\n");
+      return false;
+   }
+
+   handle->version = 1;
+   return init_playback_bsv1(handle, header);
+}
+
+static bool bsv2_flush(bsv_movie_t *handle)
+{
+   if (!handle->block_size)
+      return true;
+
+   bool ret = fwrite(handle->block, 1, handle->block_size, handle->file) == handle->block_size;
+   handle->block_offset += handle->block_size;
+   handle->block_size = 0;
+   return ret;
+}
+
+static uint8_t *bsv2_reserve(bsv_movie_t *handle, size_t size)
+{
+   if (!grow_bytes(&handle->block, &handle->block_cap, handle->block_size + size))
+      return NULL;
+
+   uint8_t *ptr = handle->block + handle->block_size;
+   handle->block_size += size;
+   return ptr;
+}
+
+static bool bsv2_write_keyframe(bsv_movie_t *handle)
+{
+   const uint8_t *data = handle->state;
+   uint32_t size = handle->state_size;
+   uint32_t flags = 0;
+   uint8_t *ptr;
+
+   if (!handle->state_size)
+      return true;
+
+   pretro_serialize(handle->state, handle->state_size);
+
+#ifdef HAVE_ZLIB_DEFLATE
+   uLongf packed_size = compressBound(handle->state_size);
+   if (grow_bytes(&handle->packed, &handle->packed_cap, packed_size) &&
+         compress2(handle->packed, &packed_size, handle->state, handle->state_size, Z_BEST_SPEED) == Z_OK)
+   {
+      data   = handle->packed;
+      size   = packed_size;
+      flags |= BSV2_KEYFRAME_ZLIB;
+   }
+#endif
+
+   uint64_t offset = handle->block_offset + handle->block_size;
+   if (!(ptr = bsv2_reserve(handle, BSV2_KEYFRAME_HEADER_SIZE + size)))
+      return false;
+
+   ptr[0] = BSV2_KEYFRAME;
+   put32(ptr + 1, handle->frame);
+   put32(ptr + 5, flags);
+   put32(ptr + 9, size);
+   memcpy(ptr + BSV2_KEYFRAME_HEADER_SIZE, data, size);
+
+   return bsv2_add_keyframe(handle, handle->frame, offset);
+}
+
+static bool bsv2_write_frame(bsv_movie_t *handle)
+{
+   size_t i;
+   uint8_t *ptr;
+   uint64_t offset = handle->block_offset + handle->block_size;
+
+   if (!(ptr = bsv2_reserve(handle, BSV2_FRAME_HEADER_SIZE + handle->input_count * sizeof(int16_t))))
+      return false;
+
+   ptr[0] = BSV2_FRAME;
+   put16(ptr + 1, (uint16_t)handle->input_count);
+   for (i = 0, ptr += BSV2_FRAME_HEADER_SIZE; i < handle->input_count; i++, ptr += 2)
+      put16(ptr, (uint16_t)handle->inputs[i]);
+
+   handle->input_count = 0;
+
+   if (!bsv2_add_frame(handle, offset))
+      return false;
+   if (handle->block_size >= BSV2_BLOCK_SIZE)
+      return bsv2_flush(handle);
+   return true;
+}
+
+static bool bsv2_truncate_file(FILE *file, uint64_t size)
+{
+#if defined(MOVIE_POSIX_IO)
+   return ftruncate(fileno(file), (off_t)size) == 0;
+#elif defined(_WIN32) && !defined(RARCH_CONSOLE)
+   return _chsize(_fileno(file), (long)size) == 0;
+#else
+   (void)file;
+   (void)size;
+   return false;
+#endif
+}
+
+// Drops everything recorded from the start of the given frame on.
+static void bsv2_truncate(bsv_movie_t *handle, unsigned frame)
+{
+   uint64_t pos = handle->block_offset + handle->block_size;
+
+   if (frame < handle->frame_count)
+   {
+      pos = handle->frame_offset[frame];
+      handle->frame_count = frame;
+   }
+
+   while (handle->keyframe_count && handle->keyframes[handle->keyframe_count - 1].frame >= frame)
+   {
+      handle->keyframe_count--;
+      if (handle->keyframes[handle->keyframe_count].offset < pos)
+         pos = handle->keyframes[handle->keyframe_count].offset;
+   }
+
+   if (pos >= handle->block_offset)
+      handle->block_size = pos - handle->block_offset;
+   else
+   {
+      // Records past the cut are already in the file. Cut them off there too,
+      // or rebuilding the index after a crash would pick them up again.
+      bsv2_flush(handle);
+      fflush(handle->file);
+      if (!bsv2_truncate_file(handle->file, pos))
+         RARCH_WARN("Couldn't truncate movie, it can't be recovered if recording does not finish.\n");
+      fseek(handle->file, (long)pos, SEEK_SET);
+      handle->block_offset = pos;
+   }
+
+   handle->input_count = 0;
+   handle->frame = frame;
+}
+
 static bool init_record(bsv_movie_t *handle, const char *path)
 {
    handle->file = fopen(path, "wb");
@@ -101,32 +602,58 @@ static bool init_record(bsv_movie_t *handle, const char *path)
       return false;
    }
 
-   uint32_t header[4] = {0};
-
-   // This value is supposed to show up as BSV1 in a HEX editor, big-endian.
-   header[MAGIC_INDEX] = swap_if_little32(BSV_MAGIC);
+   handle->version = 2;
+   handle->keyframe_interval = BSV2_KEYFRAME_INTERVAL;
+   handle->state_size = pretro_serialize_size();
+   if (handle->state_size && !(handle->state = (uint8_t*)malloc(handle->state_size)))
+      return false;
 
-   header[CRC_INDEX] = swap_if_big32(g_extern.cart_crc);
+   uint8_t *header = bsv2_reserve(handle, BSV2_HEADER_SIZE);
+   if (!header)
+      return false;
 
-   uint32_t state_size = pretro_serialize_size();
+   // This value is supposed to show up as BSV2 in a HEX editor, big-endian.
+   uint32_t magic = swap_if_little32(BSV2_MAGIC);
+   memcpy(header, &magic, sizeof(magic));
+   put32(header + 4, g_extern.cart_crc);
+   put32(header + 8, handle->state_size);
+   put32(header + 12, handle->keyframe_interval);
+   put64(header + 16, 0);
 
-   header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
-   fwrite(header, 4, sizeof(uint32_t), handle->file);
+   // The starting state.
+   return bsv2_write_keyframe(handle) && bsv2_flush(handle);
+}
 
-   handle->min_file_pos = sizeof(header) + state_size;
-   handle->state_size = state_size;
+// Writes the index and points the header at it.
+static void bsv2_finalize(bsv_movie_t *handle)
+{
+   unsigned i;
+   uint8_t *ptr;
+   uint64_t index_offset = handle->block_offset + handle->block_size;
 
-   if (state_size)
+   if (!(ptr = bsv2_reserve(handle, 8 + handle->frame_count * 8 + handle->keyframe_count * 12)))
    {
-      handle->state = (uint8_t*)malloc(state_size);
-      if (!handle->state)
-         return false;
+      bsv2_flush(handle);
+      return;
+   }
 
-      pretro_serialize(handle->state, state_size);
-      fwrite(handle->state, 1, state_size, handle->file);
+   put32(ptr, handle->frame_count);
+   ptr += 4;
+   for (i = 0; i < handle->frame_count; i++, ptr += 8)
+      put64(ptr, handle->frame_offset[i]);
+
+   put32(ptr, handle->keyframe_count);
+   ptr += 4;
+   for (i = 0; i < handle->keyframe_count; i++, ptr += 12)
+   {
+      put32(ptr, handle->keyframes[i].frame);
+      put64(ptr + 4, handle->keyframes[i].offset);
    }
 
-   return true;
+   uint8_t offset_buf[8];
+   put64(offset_buf, index_offset);
+   if (bsv2_flush(handle) && fseek(handle->file, 16, SEEK_SET) == 0)
+      fwrite(offset_buf, 1, sizeof(offset_buf), handle->file);
 }
 
 void bsv_movie_free(bsv_movie_t *handle)
@@ -134,15 +661,64 @@ void bsv_movie_free(bsv_movie_t *handle)
    if (handle)
    {
       if (handle->file)
+      {
+         if (!handle->playback && handle->version == 2)
+            bsv2_finalize(handle);
          fclose(handle->file);
+      }
       free(handle->state);
       free(handle->frame_pos);
+      free(handle->frame_offset);
+      free(handle->keyframes);
+      free(handle->inputs);
+      free(handle->block);
+      free(handle->packed);
       free(handle);
    }
 }
 
+static bool bsv2_load_frame(bsv_movie_t *handle)
+{
+   uint8_t header[BSV2_FRAME_HEADER_SIZE];
+   size_t i;
+
+   handle->frame_loaded = true;
+   handle->input_count  = 0;
+   handle->input_ptr    = 0;
+
+   if (handle->frame >= handle->frame_count)
+      return false;
+
+   if (!bsv2_read_at(handle, handle->frame_offset[handle->frame], header, sizeof(header)) ||
+         header[0] != BSV2_FRAME)
+      return false;
+
+   size_t count = get16(header + 1);
+   if (!grow_bytes((uint8_t**)&handle->inputs, &handle->input_cap, count * sizeof(int16_t)) ||
+         !bsv2_read_at(handle, handle->read_pos, handle->inputs, count * sizeof(int16_t)))
+      return false;
+
+   for (i = 0; i < count; i++)
+      handle->inputs[i] = (int16_t)get16((const uint8_t*)&handle->inputs[i]);
+   handle->input_count = count;
+   return true;
+}
+
 bool bsv_movie_get_input(bsv_movie_t *handle, int16_t *input)
 {
+   if (handle->version == 2)
+   {
+      if (!handle->frame_loaded)
+         bsv2_load_frame(handle);
+
+      if (handle->frame >= handle->frame_count)
+         return false;
+
+      // Polling more often than when recording, most likely a desync.
+      *input = handle->input_ptr < handle->input_count ? handle->inputs[handle->input_ptr++] : 0;
+      return true;
+   }
+
    if (fread(input, sizeof(int16_t), 1, handle->file) != 1)
       return false;
 
@@ -152,8 +728,14 @@ bool bsv_movie_get_input(bsv_movie_t *handle, int16_t *input)
 
 void bsv_movie_set_input(bsv_movie_t *handle, int16_t input)
 {
-   input = swap_if_big16(input);
-   fwrite(&input, sizeof(int16_t), 1, handle->file);
+   if (handle->input_count >= BSV2_MAX_INPUTS)
+      return;
+
+   if (handle->input_count == handle->input_cap / sizeof(int16_t) &&
+         !grow_bytes((uint8_t**)&handle->inputs, &handle->input_cap, (handle->input_count + 1) * sizeof(int16_t)))
+      return;
+
+   handle->inputs[handle->input_count++] = input;
 }
 
 bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
@@ -170,13 +752,6 @@ bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
    else if (!init_record(handle, path))
       goto error;
 
-   // Just pick something really large :D ~1 million frames rewind should do the trick.
-   if (!(handle->frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
-      goto error; 
-
-   handle->frame_pos[0] = handle->min_file_pos;
-   handle->frame_mask = (1 << 20) - 1;
-
    return handle;
 
 error:
@@ -186,21 +761,44 @@ error:
 
 void bsv_movie_set_frame_start(bsv_movie_t *handle)
 {
-   handle->frame_pos[handle->frame_ptr] = ftell(handle->file);
+   if (handle->version == 1)
+   {
+      handle->frame_pos[handle->frame_ptr] = ftell(handle->file);
+      return;
+   }
+
+   if (handle->playback)
+   {
+      bsv2_load_frame(handle);
+      return;
+   }
+
+   handle->input_count = 0;
+
+   // Rewinding can revisit a frame which already has its keyframe.
+   if (handle->keyframe_interval && handle->frame % handle->keyframe_interval == 0 &&
+         !(handle->keyframe_count && handle->keyframes[handle->keyframe_count - 1].frame == handle->frame))
+      bsv2_write_keyframe(handle);
 }
 
 void bsv_movie_set_frame_end(bsv_movie_t *handle)
 {
-   handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   if (handle->version == 1)
+      handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   else
+   {
+      if (!handle->playback)
+         bsv2_write_frame(handle);
+      handle->frame++;
+      handle->frame_loaded = false;
+   }
 
    handle->first_rewind = !handle->did_rewind;
    handle->did_rewind = false;
 }
 
-void bsv_movie_frame_rewind(bsv_movie_t *handle)
+static void bsv1_frame_rewind(bsv_movie_t *handle)
 {
-   handle->did_rewind = true;
-
    // If we're at the beginning ... :)
    if ((handle->frame_ptr <= 1) && (handle->frame_pos[0] == handle->min_file_pos))
    {
@@ -218,16 +816,73 @@ void bsv_movie_frame_rewind(bsv_movie_t *handle)
 
    // We rewound past the beginning. :O
    if (ftell(handle->file) <= (long)handle->min_file_pos)
+      fseek(handle->file, handle->min_file_pos, SEEK_SET);
+}
+
+void bsv_movie_frame_rewind(bsv_movie_t *handle)
+{
+   handle->did_rewind = true;
+
+   if (handle->version == 1)
    {
-      // If recording, we simply reset the starting point. Nice and easy.
-      if (!handle->playback)
-      {
-         fseek(handle->file, 4 * sizeof(uint32_t), SEEK_SET);
-         pretro_serialize(handle->state, handle->state_size);
-         fwrite(handle->state, 1, handle->state_size, handle->file);
-      }
+      bsv1_frame_rewind(handle);
+      return;
+   }
+
+   // Same as BSV1, the first rewind replays the frame which was just played.
+   unsigned frames = handle->first_rewind ? 1 : 2;
+   unsigned frame = handle->frame > frames ? handle->frame - frames : 0;
+
+   if (handle->playback)
+   {
+      handle->frame = frame;
+      handle->frame_loaded = false;
+   }
+   else
+   {
+      // Rewinding back to the start while recording re-records the starting state.
+      bsv2_truncate(handle, frame);
+   }
+}
+
+bool bsv_movie_seek(bsv_movie_t *handle, unsigned frame, unsigned *keyframe)
+{
+   unsigned lo = 0, hi;
+
+   if (handle->version != 2 || !handle->playback || !handle->keyframe_count || !handle->state_size)
+      return false;
+
+   if (frame > handle->frame_count)
+      frame = handle->frame_count;
+
+   // Last keyframe at or before the requested frame.
+   hi = handle->keyframe_count;
+   while (hi - lo > 1)
+   {
+      unsigned mid = lo + (hi - lo) / 2;
+      if (handle->keyframes[mid].frame <= frame)
+         lo = mid;
       else
-         fseek(handle->file, handle->min_file_pos, SEEK_SET);
+         hi = mid;
    }
+
+   if (!bsv2_load_keyframe(handle, lo))
+      return false;
+
+   handle->first_rewind = false;
+   handle->did_rewind = false;
+   if (keyframe)
+      *keyframe = handle->frame;
+   return true;
+}
+
+unsigned bsv_movie_frame_count(bsv_movie_t *handle)
+{
+   return handle->version == 2 ? handle->frame_count : 0;
+}
+
+unsigned bsv_movie_frame(bsv_movie_t *handle)
+{
+   return handle->version == 2 ? handle->frame : (unsigned)handle->frame_ptr;
 }
 
@@ -21,6 +21,10 @@
 #include "boolean.h"
 
 #define BSV_MAGIC 0x42535631
+#define BSV2_MAGIC 0x42535632
+
+// Frames between savestate keyframes embedded in BSV2 movies.
+#define BSV2_KEYFRAME_INTERVAL 600
 
 #define MAGIC_INDEX 0
 #define SERIALIZER_INDEX 1
@@ -48,6 +52,13 @@ void bsv_movie_set_frame_start(bsv_movie_t *handle); // Debugging purposes.
 void bsv_movie_set_frame_end(bsv_movie_t *handle);
 void bsv_movie_frame_rewind(bsv_movie_t *handle);
 
+// Seeking (BSV2 playback only).
+// Restores the last keyframe at or before frame and continues playback from there.
+// The caller has to run the frames from *keyframe up to frame itself.
+bool bsv_movie_seek(bsv_movie_t *handle, unsigned frame, unsigned *keyframe);
+unsigned bsv_movie_frame_count(bsv_movie_t *handle);
+unsigned bsv_movie_frame(bsv_movie_t *handle);
+
 void bsv_movie_free(bsv_movie_t *handle);
 
 #endif
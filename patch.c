@@ -18,11 +18,17 @@
 
 #include "patch.h"
 #include "hash.h"
+#include "file_path.h"
 #include "boolean.h"
 #include "msvc/msvc_compat.h"
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Runs are copied with memcpy()/memset() and all checksums are computed with
+// crc32_update() over whole runs rather than one byte at a time.
+// Every read from the patch and source, and every write to the target, is bounds checked.
+
 enum bps_mode
 {
    SOURCE_READ = 0,
@@ -37,23 +43,27 @@ struct bps_data
    uint8_t *target_data;
    size_t modify_length, source_length, target_length;
    size_t modify_offset, source_offset, target_offset;
-   uint32_t modify_checksum, source_checksum, target_checksum;
+   uint32_t target_checksum;
 
-   size_t source_relative_offset, target_relative_offset, output_offset;
+   size_t output_offset;
+   bool overflow;
 };
 
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = crc32_adjust(bps->modify_checksum, data);
-   return data;
+   if (bps->modify_offset >= bps->modify_length)
+   {
+      bps->overflow = true;
+      return 0;
+   }
+   return bps->modify_data[bps->modify_offset++];
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
 {
    uint64_t data = 0, shift = 1;
 
-   for (;;)
+   while (!bps->overflow)
    {
       uint8_t x = bps_read(bps);
       data += (x & 0x7f) * shift;
@@ -66,10 +76,53 @@ static uint64_t bps_decode(struct bps_data *bps)
    return data;
 }
 
-static void bps_write(struct bps_data *bps, uint8_t data)
+static uint32_t read32le(const uint8_t *data)
+{
+   return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+      ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static patch_error_t bps_parse_header(struct bps_data *bps,
+      size_t *source_size, size_t *target_size)
+{
+   size_t markup_size;
+
+   if (bps->modify_length < 19)
+      return PATCH_PATCH_TOO_SMALL;
+
+   if ((bps_read(bps) != 'B') || (bps_read(bps) != 'P') || (bps_read(bps) != 'S') || (bps_read(bps) != '1'))
+      return PATCH_PATCH_INVALID_HEADER;
+
+   *source_size = bps_decode(bps);
+   *target_size = bps_decode(bps);
+   markup_size  = bps_decode(bps);
+
+   if (bps->overflow || bps->modify_offset > bps->modify_length - 12 ||
+         markup_size > bps->modify_length - 12 - bps->modify_offset)
+      return PATCH_PATCH_INVALID;
+   bps->modify_offset += markup_size;
+
+   return PATCH_SUCCESS;
+}
+
+patch_error_t bps_patch_size(
+      const uint8_t *modify_data, size_t modify_length,
+      size_t source_length, size_t *target_length)
 {
-   bps->target_data[bps->output_offset++] = data;
-   bps->target_checksum = crc32_adjust(bps->target_checksum, data);
+   size_t source_size, target_size;
+   struct bps_data bps = {0};
+   patch_error_t err;
+
+   (void)source_length;
+   bps.modify_data = modify_data;
+   bps.modify_length = modify_length;
+
+   err = bps_parse_header(&bps, &source_size, &target_size);
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   *target_length = target_size;
+   return PATCH_SUCCESS;
 }
 
 patch_error_t bps_apply_patch(
@@ -77,98 +130,125 @@ patch_error_t bps_apply_patch(
       const uint8_t *source_data, size_t source_length,
       uint8_t *target_data, size_t *target_length)
 {
-   size_t i;
-   if (modify_length < 19)
-      return PATCH_PATCH_TOO_SMALL;
-
+   size_t modify_source_size, modify_target_size;
+   const uint8_t *footer;
    struct bps_data bps = {0};
+   patch_error_t err;
+
    bps.modify_data = modify_data;
    bps.modify_length = modify_length;
    bps.target_data = target_data;
    bps.target_length = *target_length;
    bps.source_data = source_data;
    bps.source_length = source_length;
-   bps.modify_checksum = ~0;
-   bps.target_checksum = ~0;
-
-   if ((bps_read(&bps) != 'B') || (bps_read(&bps) != 'P') || (bps_read(&bps) != 'S') || (bps_read(&bps) != '1'))
-      return PATCH_PATCH_INVALID_HEADER;
+   bps.target_checksum = 0;
 
-   size_t modify_source_size = bps_decode(&bps);
-   size_t modify_target_size = bps_decode(&bps);
-   size_t modify_markup_size = bps_decode(&bps);
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   err = bps_parse_header(&bps, &modify_source_size, &modify_target_size);
+   if (err != PATCH_SUCCESS)
+      return err;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
    if (modify_target_size > bps.target_length)
       return PATCH_TARGET_TOO_SMALL;
 
-   while (bps.modify_offset < bps.modify_length - 12)
+   // Reject the wrong patch or wrong source before doing any work.
+   footer = modify_data + modify_length - 12;
+   if (crc32_calculate(modify_data, modify_length - 4) != read32le(footer + 8))
+      return PATCH_PATCH_CHECKSUM_INVALID;
+   if (crc32_calculate(source_data, source_length) != read32le(footer + 0))
+      return PATCH_SOURCE_CHECKSUM_INVALID;
+
+   // Only the patch body is parsed below, the footer is never read as a command.
+   bps.modify_length -= 12;
+   bps.target_length = modify_target_size;
+
+   while (bps.modify_offset < bps.modify_length)
    {
-      size_t length = bps_decode(&bps);
+      size_t start = bps.output_offset;
+      uint64_t length = bps_decode(&bps);
       unsigned mode = length & 3;
       length = (length >> 2) + 1;
 
+      if (bps.overflow || length > bps.target_length - bps.output_offset)
+         return PATCH_PATCH_INVALID;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-               bps_write(&bps, bps.source_data[bps.output_offset]);
+            if (bps.output_offset + length > bps.source_length)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data + bps.output_offset, length);
             break;
 
          case TARGET_READ:
-            while (length--)
-               bps_write(&bps, bps_read(&bps));
+            if (length > bps.modify_length - bps.modify_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data + bps.modify_offset, length);
+            bps.modify_offset += length;
             break;
 
          case SOURCE_COPY:
          case TARGET_COPY:
          {
-            int offset = bps_decode(&bps);
-            bool negative = offset & 1;
-            offset >>= 1;
-            if (negative)
-               offset = -offset;
+            uint64_t data = bps_decode(&bps);
+            size_t offset = (size_t)(data >> 1);
+            size_t *base = mode == SOURCE_COPY ? &bps.source_offset : &bps.target_offset;
+
+            if (bps.overflow)
+               return PATCH_PATCH_INVALID;
+
+            if (data & 1)
+            {
+               if (offset > *base)
+                  return PATCH_PATCH_INVALID;
+               *base -= offset;
+            }
+            else
+               *base += offset;
 
             if (mode == SOURCE_COPY)
             {
-               bps.source_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.source_data[bps.source_offset++]);
+               if (bps.source_offset > bps.source_length ||
+                     length > bps.source_length - bps.source_offset)
+                  return PATCH_PATCH_INVALID;
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data + bps.source_offset, length);
+               bps.source_offset += length;
             }
             else
             {
-               bps.target_offset += offset;
-               while (length--)
-                  bps_write(&bps, bps.target_data[bps.target_offset++]);
-               break;
+               uint8_t *dst = bps.target_data + bps.output_offset;
+               const uint8_t *src = bps.target_data + bps.target_offset;
+
+               if (bps.target_offset >= bps.output_offset)
+                  return PATCH_PATCH_INVALID;
+
+               // Target copies may overlap the bytes being written (RLE style),
+               // which must be replicated byte by byte.
+               if (bps.target_offset + length <= bps.output_offset)
+                  memcpy(dst, src, length);
+               else
+               {
+                  size_t i;
+                  for (i = 0; i < length; i++)
+                     dst[i] = src[i];
+               }
+               bps.target_offset += length;
             }
             break;
          }
       }
-   }
 
-   uint32_t modify_source_checksum = 0, modify_target_checksum = 0, modify_modify_checksum = 0;
-   for (i = 0; i < 32; i += 8)
-      modify_source_checksum |= bps_read(&bps) << i;
-   for (i = 0; i < 32; i += 8)
-      modify_target_checksum |= bps_read(&bps) << i;
-
-   uint32_t checksum = ~bps.modify_checksum;
-   for (i = 0; i < 32; i += 8)
-      modify_modify_checksum |= bps_read(&bps) << i;
-
-   bps.source_checksum = crc32_calculate(bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+      bps.output_offset += length;
+      bps.target_checksum = crc32_update(bps.target_checksum,
+            bps.target_data + start, bps.output_offset - start);
+   }
 
-   if (bps.source_checksum != modify_source_checksum)
-      return PATCH_SOURCE_CHECKSUM_INVALID;
-   if (bps.target_checksum != modify_target_checksum)
+   if (bps.target_checksum != read32le(footer + 4))
       return PATCH_TARGET_CHECKSUM_INVALID;
-   if (checksum != modify_modify_checksum)
-      return PATCH_PATCH_CHECKSUM_INVALID;
 
    *target_length = modify_target_size;
 
@@ -179,48 +259,22 @@ struct ups_data
 {
    const uint8_t *patch_data, *source_data; 
    uint8_t *target_data;
-   unsigned patch_length, source_length, target_length;
-   unsigned patch_offset, source_offset, target_offset;
-   unsigned patch_checksum, source_checksum, target_checksum;
+   size_t patch_length, source_length, target_length;
+   size_t patch_offset, source_offset, target_offset;
+   uint32_t target_checksum;
 };
 
 static uint8_t ups_patch_read(struct ups_data *data) 
 {
    if (data->patch_offset < data->patch_length) 
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum = crc32_adjust(data->patch_checksum, n);
-      return n;
-   }
-   return 0x00;
-}
-
-static uint8_t ups_source_read(struct ups_data *data) 
-{
-   if (data->source_offset < data->source_length) 
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum = crc32_adjust(data->source_checksum, n);
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
-static void ups_target_write(struct ups_data *data, uint8_t n) 
-{
-   if (data->target_offset < data->target_length) 
-   {
-      data->target_data[data->target_offset] = n;
-      data->target_checksum = crc32_adjust(data->target_checksum, n);
-   }
-
-   data->target_offset++;
-}
-
 static uint64_t ups_decode(struct ups_data *data) 
 {
    uint64_t offset = 0, shift = 1;
-   while (true) 
+   while (data->patch_offset < data->patch_length) 
    {
       uint8_t x = ups_patch_read(data);
       offset += (x & 0x7f) * shift;
@@ -232,99 +286,162 @@ static uint64_t ups_decode(struct ups_data *data)
    return offset;
 }
 
+// Writes length bytes of source XOR'ed with xor_data (if non-NULL) to the target.
+// Source bytes past the end read as 0, target bytes past the end are dropped.
+static void ups_copy(struct ups_data *data, const uint8_t *xor_data, size_t length)
+{
+   size_t i;
+   size_t target_avail = data->target_offset < data->target_length ?
+      data->target_length - data->target_offset : 0;
+   size_t source_avail = data->source_offset < data->source_length ?
+      data->source_length - data->source_offset : 0;
+   size_t write = length < target_avail ? length : target_avail;
+   size_t copy  = write < source_avail ? write : source_avail;
+   uint8_t *dst = data->target_data + data->target_offset;
+   const uint8_t *src = data->source_data + data->source_offset;
+
+   if (xor_data)
+   {
+      for (i = 0; i < copy; i++)
+         dst[i] = src[i] ^ xor_data[i];
+      if (write > copy)
+         memcpy(dst + copy, xor_data + copy, write - copy);
+   }
+   else
+   {
+      memcpy(dst, src, copy);
+      memset(dst + copy, 0, write - copy);
+   }
+
+   data->target_checksum = crc32_update(data->target_checksum, dst, write);
+   data->source_offset += length;
+   data->target_offset += length;
+}
+
+static patch_error_t ups_parse_header(struct ups_data *data,
+      size_t *source_read_length, size_t *target_read_length)
+{
+   if (data->patch_length < 18) 
+      return PATCH_PATCH_INVALID;
+   if (ups_patch_read(data) != 'U') 
+      return PATCH_PATCH_INVALID;
+   if (ups_patch_read(data) != 'P') 
+      return PATCH_PATCH_INVALID;
+   if (ups_patch_read(data) != 'S') 
+      return PATCH_PATCH_INVALID;
+   if (ups_patch_read(data) != '1') 
+      return PATCH_PATCH_INVALID;
+
+   *source_read_length = ups_decode(data);
+   *target_read_length = ups_decode(data);
+
+   // UPS patches apply in both directions.
+   if (data->source_length != *source_read_length && data->source_length != *target_read_length) 
+      return PATCH_SOURCE_INVALID;
+
+   return PATCH_SUCCESS;
+}
+
+patch_error_t ups_patch_size(
+      const uint8_t *patchdata, size_t patchlength,
+      size_t sourcelength, size_t *targetlength)
+{
+   size_t source_read_length, target_read_length;
+   struct ups_data data = {0};
+   patch_error_t err;
+
+   data.patch_data = patchdata;
+   data.patch_length = patchlength;
+   data.source_length = sourcelength;
+
+   err = ups_parse_header(&data, &source_read_length, &target_read_length);
+   if (err != PATCH_SUCCESS)
+      return err;
+
+   *targetlength = (data.source_length == source_read_length ? target_read_length : source_read_length);
+   return PATCH_SUCCESS;
+}
+
 patch_error_t ups_apply_patch(
       const uint8_t *patchdata, size_t patchlength,
       const uint8_t *sourcedata, size_t sourcelength,
       uint8_t *targetdata, size_t *targetlength)
 {
-   size_t i;
+   size_t source_read_length, target_read_length;
+   uint32_t source_checksum, source_read_checksum, target_read_checksum;
+   const uint8_t *footer;
    struct ups_data data = {0};
+   patch_error_t err;
+
    data.patch_data = patchdata;
    data.source_data = sourcedata;
    data.target_data = targetdata;
    data.patch_length = patchlength;
    data.source_length = sourcelength;
    data.target_length = *targetlength;
-   data.patch_checksum = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
-
-   if (data.patch_length < 18) 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'U') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'P') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != 'S') 
-      return PATCH_PATCH_INVALID;
-   if (ups_patch_read(&data) != '1') 
-      return PATCH_PATCH_INVALID;
 
-   unsigned source_read_length = ups_decode(&data);
-   unsigned target_read_length = ups_decode(&data);
+   err = ups_parse_header(&data, &source_read_length, &target_read_length);
+   if (err != PATCH_SUCCESS)
+      return err;
 
-   if (data.source_length != source_read_length && data.source_length != target_read_length) 
-      return PATCH_SOURCE_INVALID;
    *targetlength = (data.source_length == source_read_length ? target_read_length : source_read_length);
    if (data.target_length < *targetlength) 
       return PATCH_TARGET_TOO_SMALL;
    data.target_length = *targetlength;
 
-   while (data.patch_offset < data.patch_length - 12) 
-   {
-      unsigned length = ups_decode(&data);
-      while (length--) 
-         ups_target_write(&data, ups_source_read(&data));
-      while (true) 
-      {
-         uint8_t patch_xor = ups_patch_read(&data);
-         ups_target_write(&data, patch_xor ^ ups_source_read(&data));
-         if (patch_xor == 0) break;
-      }
-   }
+   footer = patchdata + patchlength - 12;
+   if (crc32_calculate(patchdata, patchlength - 4) != read32le(footer + 8))
+      return PATCH_PATCH_INVALID;
 
-   while (data.source_offset < data.source_length) 
-      ups_target_write(&data, ups_source_read(&data));
-   while (data.target_offset < data.target_length) 
-      ups_target_write(&data, ups_source_read(&data));
+   source_read_checksum = read32le(footer + 0);
+   target_read_checksum = read32le(footer + 4);
+   source_checksum = crc32_calculate(sourcedata, sourcelength);
 
-   uint32_t patch_read_checksum = 0, source_read_checksum = 0, target_read_checksum = 0;
-   for (i = 0; i < 4; i++) 
-      source_read_checksum |= ups_patch_read(&data) << (i * 8);
-   for (i = 0; i < 4; i++) 
-      target_read_checksum |= ups_patch_read(&data) << (i * 8);
+   if (source_checksum != source_read_checksum || data.source_length != source_read_length)
+   {
+      // Reverse patching.
+      if (source_checksum != target_read_checksum || data.source_length != target_read_length)
+         return PATCH_SOURCE_INVALID;
+      target_read_checksum = source_read_checksum;
+   }
 
-   uint32_t patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum = ~data.source_checksum;
-   data.target_checksum = ~data.target_checksum;
+   data.patch_length -= 12;
 
-   for (i = 0; i < 4; i++) 
-      patch_read_checksum |= ups_patch_read(&data) << (i * 8);
+   while (data.patch_offset < data.patch_length) 
+   {
+      const uint8_t *xor_data, *end;
+      size_t length = ups_decode(&data);
+      ups_copy(&data, NULL, length);
+
+      // XOR run, terminated by (and including) a zero byte.
+      xor_data = data.patch_data + data.patch_offset;
+      end = (const uint8_t*)memchr(xor_data, 0, data.patch_length - data.patch_offset);
+      if (!end)
+         return PATCH_PATCH_INVALID;
+
+      length = end - xor_data + 1;
+      ups_copy(&data, xor_data, length);
+      data.patch_offset += length;
+   }
 
-   if (patch_result_checksum != patch_read_checksum) 
-      return PATCH_PATCH_INVALID;
+   if (data.target_offset < data.target_length)
+      ups_copy(&data, NULL, data.target_length - data.target_offset);
 
-   if (data.source_checksum == source_read_checksum && data.source_length == source_read_length) 
-   {
-      if (data.target_checksum == target_read_checksum && data.target_length == target_read_length) 
-         return PATCH_SUCCESS;
-      return PATCH_TARGET_INVALID;
-   } 
-   else if (data.source_checksum == target_read_checksum && data.source_length == target_read_length) 
-   {
-      if (data.target_checksum == source_read_checksum && data.target_length == source_read_length) 
-         return PATCH_SUCCESS;
+   if (data.target_checksum != target_read_checksum) 
       return PATCH_TARGET_INVALID;
-   } 
-   else
-      return PATCH_SOURCE_INVALID;
+
+   return PATCH_SUCCESS;
 }
 
-patch_error_t ips_apply_patch(
+static patch_error_t ips_parse(
       const uint8_t *patchdata, size_t patchlen,
       const uint8_t *sourcedata, size_t sourcelength,
-      uint8_t *targetdata, size_t *targetlength)
+      uint8_t *targetdata, size_t *targetlength, size_t *capacity)
 {
+   size_t offset = 5;
+   size_t max_write = sourcelength;
+   size_t target_size = sourcelength;
+
    if (patchlen < 8 ||
          patchdata[0] != 'P' ||
          patchdata[1] != 'A' ||
@@ -333,10 +450,12 @@ patch_error_t ips_apply_patch(
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
 
-   memcpy(targetdata, sourcedata, sourcelength);
-
-   uint32_t offset = 5;
-   *targetlength = sourcelength;
+   if (targetdata)
+   {
+      if (*targetlength < sourcelength)
+         return PATCH_TARGET_TOO_SMALL;
+      memcpy(targetdata, sourcedata, sourcelength);
+   }
 
    for (;;)
    {
@@ -350,14 +469,14 @@ patch_error_t ips_apply_patch(
       if (address == 0x454f46) // EOF
       {
          if (offset == patchlen)
-            return PATCH_SUCCESS;
+            goto success;
          else if (offset == patchlen - 3)
          {
             uint32_t size = patchdata[offset++] << 16;
             size |= patchdata[offset++] << 8;
             size |= patchdata[offset++] << 0;
-            *targetlength = size;
-            return PATCH_SUCCESS;
+            target_size = size;
+            goto success;
          }
       }
 
@@ -372,8 +491,13 @@ patch_error_t ips_apply_patch(
          if (offset > patchlen - length)
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset++];
+         if (targetdata)
+         {
+            if (address + length > *targetlength)
+               return PATCH_TARGET_TOO_SMALL;
+            memcpy(targetdata + address, patchdata + offset, length);
+         }
+         offset += length;
       }
       else // RLE
       {
@@ -386,16 +510,185 @@ patch_error_t ips_apply_patch(
          if (length == 0) // Illegal
             break;
 
-         while (length--)
-            targetdata[address++] = patchdata[offset];
-
+         if (targetdata)
+         {
+            if (address + length > *targetlength)
+               return PATCH_TARGET_TOO_SMALL;
+            memset(targetdata + address, patchdata[offset], length);
+         }
          offset++;
       }
 
-      if (address > *targetlength)
-         *targetlength = address;
+      address += length;
+      if (address > target_size)
+         target_size = address;
+      if (address > max_write)
+         max_write = address;
    }
 
    return PATCH_PATCH_INVALID;
+
+success:
+   // A truncating EOF record can make the result smaller than what was written.
+   if (targetdata && target_size > max_write)
+   {
+      if (target_size > *targetlength)
+         return PATCH_TARGET_TOO_SMALL;
+      memset(targetdata + max_write, 0, target_size - max_write);
+   }
+   *targetlength = target_size;
+   if (capacity)
+      *capacity = target_size > max_write ? target_size : max_write;
+   return PATCH_SUCCESS;
 }
 
+patch_error_t ips_patch_size(
+      const uint8_t *patchdata, size_t patchlen,
+      size_t sourcelength, size_t *targetlength)
+{
+   size_t size = 0;
+   return ips_parse(patchdata, patchlen, NULL, sourcelength, NULL, &size, targetlength);
+}
+
+patch_error_t ips_apply_patch(
+      const uint8_t *patchdata, size_t patchlen,
+      const uint8_t *sourcedata, size_t sourcelength,
+      uint8_t *targetdata, size_t *targetlength)
+{
+   return ips_parse(patchdata, patchlen, sourcedata, sourcelength, targetdata, targetlength, NULL);
+}
+
+// Read-only view of a whole file. Mapped with mmap() where available,
+// so neither the source nor the patch cost anything beyond page cache.
+typedef struct
+{
+#ifdef HAVE_MMAP
+   int fd;
+#endif
+   uint8_t *data;
+   size_t size;
+} patch_file_t;
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static bool patch_file_open(patch_file_t *file, const char *path)
+{
+   struct stat fds;
+
+   file->data = NULL;
+   file->size = 0;
+   file->fd = open(path, O_RDONLY);
+   if (file->fd < 0)
+      return false;
+
+   if (fstat(file->fd, &fds) < 0)
+      goto error;
+
+   file->size = fds.st_size;
+   if (!file->size)
+      return true;
+
+   file->data = (uint8_t*)mmap(NULL, file->size, PROT_READ, MAP_SHARED, file->fd, 0);
+   if (file->data == (uint8_t*)MAP_FAILED)
+   {
+      file->data = NULL;
+      goto error;
+   }
+
+   // Both files are consumed front to back.
+   madvise(file->data, file->size, MADV_SEQUENTIAL);
+   return true;
+
+error:
+   close(file->fd);
+   file->fd = -1;
+   return false;
+}
+
+static void patch_file_close(patch_file_t *file)
+{
+   if (file->data)
+      munmap(file->data, file->size);
+   if (file->fd >= 0)
+      close(file->fd);
+}
+#else
+static bool patch_file_open(patch_file_t *file, const char *path)
+{
+   void *data = NULL;
+   long ret = read_file(path, &data);
+   if (ret < 0)
+      return false;
+
+   file->data = (uint8_t*)data;
+   file->size = ret;
+   return true;
+}
+
+static void patch_file_close(patch_file_t *file)
+{
+   free(file->data);
+}
+#endif
+
+static const struct
+{
+   patch_func_t apply;
+   patch_size_func_t size;
+} patch_formats[] = {
+   { bps_apply_patch, bps_patch_size },
+   { ups_apply_patch, ups_patch_size },
+   { ips_apply_patch, ips_patch_size },
+};
+
+patch_error_t patch_apply_file(enum patch_type type,
+      const char *patch_path, const char *source_path,
+      uint8_t **target_data, size_t *target_length)
+{
+   patch_file_t patch, source;
+   uint8_t *target = NULL;
+   size_t size = 0;
+   patch_error_t err;
+
+   *target_data = NULL;
+   *target_length = 0;
+
+   if (!patch_file_open(&patch, patch_path))
+      return PATCH_PATCH_INVALID;
+   if (!patch_file_open(&source, source_path))
+   {
+      patch_file_close(&patch);
+      return PATCH_SOURCE_INVALID;
+   }
+
+   err = patch_formats[type].size(patch.data, patch.size, source.size, &size);
+   if (err != PATCH_SUCCESS)
+      goto end;
+
+   // Same contract as read_file(), the buffer is NUL-terminated.
+   target = (uint8_t*)malloc(size + 1);
+   if (!target)
+   {
+      err = PATCH_TARGET_TOO_SMALL;
+      goto end;
+   }
+
+   err = patch_formats[type].apply(patch.data, patch.size, source.data, source.size, target, &size);
+   if (err != PATCH_SUCCESS)
+      goto end;
+
+   target[size] = '\0';
+   *target_data = target;
+   *target_length = size;
+   target = NULL;
+
+end:
+   free(target);
+   patch_file_close(&source);
+   patch_file_close(&patch);
+   return err;
+}
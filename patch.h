@@ -40,6 +40,16 @@ typedef enum
 
 typedef patch_error_t (*patch_func_t)(const uint8_t*, size_t, const uint8_t*, size_t, uint8_t*, size_t*);
 
+// Computes how large the target buffer must be to apply a patch to a source of the given size.
+typedef patch_error_t (*patch_size_func_t)(const uint8_t*, size_t, size_t, size_t*);
+
+enum patch_type
+{
+   PATCH_TYPE_BPS = 0,
+   PATCH_TYPE_UPS,
+   PATCH_TYPE_IPS
+};
+
 patch_error_t bps_apply_patch(
       const uint8_t *patch_data, size_t patch_length,
       const uint8_t *source_data, size_t source_length,
@@ -56,4 +66,19 @@ patch_error_t ips_apply_patch(
       const uint8_t *source_data, size_t source_length,
       uint8_t *target_data, size_t *target_length);
 
+patch_error_t bps_patch_size(const uint8_t *patch_data, size_t patch_length,
+      size_t source_length, size_t *target_length);
+patch_error_t ups_patch_size(const uint8_t *patch_data, size_t patch_length,
+      size_t source_length, size_t *target_length);
+patch_error_t ips_patch_size(const uint8_t *patch_data, size_t patch_length,
+      size_t source_length, size_t *target_length);
+
+// Patches the file at source_path with the patch at patch_path.
+// Source and patch are memory mapped when possible and the target is allocated at its exact size,
+// so peak memory is roughly the size of the patched content.
+// On success, *target_data must be freed with free().
+patch_error_t patch_apply_file(enum patch_type type,
+      const char *patch_path, const char *source_path,
+      uint8_t **target_data, size_t *target_length);
+
 #endif
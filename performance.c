@@ -71,7 +71,13 @@
 #include <emscripten.h>
 #endif
 
+#if defined(__linux__) && (defined(__arm__) || defined(__aarch64__)) && !defined(ANDROID)
+#include <sys/auxv.h>
+#define ARM_LINUX_HWCAP
+#endif
+
 #include <string.h>
+#include <stdlib.h>
 
 #define MAX_COUNTERS 64
 static const struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
@@ -79,13 +85,141 @@ static const struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 static unsigned perf_ptr_rarch;
 static unsigned perf_ptr_libretro;
 
+// Scoped instrumentation for RetroArch's own counters (RARCH_PERFORMANCE_*).
+// Every thread gets its own scope stack, per-counter statistics and a ring of recent samples.
+// Only the owning thread writes to these, so recording needs no locks.
+#define PERF_MAX_THREADS 16
+#define PERF_MAX_DEPTH 32
+#define PERF_RING_SIZE 4096 // Power of two.
+#define PERF_HIST_SUB 4 // Buckets per power of two.
+#define PERF_HIST_BUCKETS (64 * PERF_HIST_SUB)
+#define PERF_NO_PARENT 0xff
+#define PERF_NO_ID 0xff // Scope of a counter which could not be registered.
+
+#if defined(_MSC_VER) && !defined(_XBOX)
+#define PERF_TLS __declspec(thread)
+#define perf_atomic_cas(x, old, new) (InterlockedCompareExchange((volatile LONG*)(x), (new), (old)) == (old))
+#define perf_barrier() MemoryBarrier()
+#elif defined(__GNUC__) && !defined(RARCH_CONSOLE) && !defined(EMSCRIPTEN)
+#define PERF_TLS __thread
+#define perf_atomic_cas(x, old, new) __sync_bool_compare_and_swap((x), (old), (new))
+#define perf_barrier() __sync_synchronize()
+#else
+// No thread-local storage, all samples go to a single shared slot.
+#define PERF_TLS
+#define PERF_TLS_NONE
+#define perf_atomic_cas(x, old, new) (*(x) == (old) ? (*(x) = (new), true) : false)
+#define perf_barrier()
+#endif
+
+#ifdef _WIN32
+#define PERF_U64 "%I64u"
+#else
+#define PERF_U64 "%llu"
+#endif
+
+struct perf_stats
+{
+   uint64_t calls;
+   uint64_t total;
+   uint64_t max;
+   uint8_t parent; // Enclosing counter of the first recorded call.
+   uint32_t hist[PERF_HIST_BUCKETS];
+};
+
+struct perf_sample
+{
+   retro_perf_tick_t start;
+   retro_perf_tick_t duration;
+   uint8_t id;
+   uint8_t depth;
+};
+
+struct perf_thread
+{
+   unsigned index;
+   unsigned depth;
+   struct
+   {
+      uint8_t id;
+      retro_perf_tick_t start;
+   } stack[PERF_MAX_DEPTH];
+
+   struct perf_stats stats[MAX_COUNTERS];
+
+   volatile uint32_t ring_head;
+   struct perf_sample ring[PERF_RING_SIZE];
+};
+
+// Slots are claimed by threads as they record their first scope, and given back when
+// threads created by sthread_create() exit. Statistics stay in the slot for the next thread.
+static struct perf_thread *perf_threads[PERF_MAX_THREADS];
+static volatile unsigned perf_thread_used[PERF_MAX_THREADS];
+static PERF_TLS struct perf_thread *perf_thread_self;
+
+// Serializes registration. Lookups are lock-free, so entries are published key last.
+static volatile unsigned perf_register_lock;
+
+// Maps counter pointers to their index in perf_counters_rarch.
+#define PERF_INDEX_SIZE (2 * MAX_COUNTERS)
+static const struct retro_perf_counter *perf_index_key[PERF_INDEX_SIZE];
+static uint8_t perf_index_id[PERF_INDEX_SIZE];
+
+// Reference point to convert ticks to microseconds for traces.
+static retro_perf_tick_t perf_epoch_ticks;
+static retro_time_t perf_epoch_usec;
+
+static inline unsigned perf_index_hash(const struct retro_perf_counter *perf)
+{
+   return (((uint32_t)((uintptr_t)perf >> 3)) * UINT32_C(2654435761)) >> 25;
+}
+
+static int perf_index_find(const struct retro_perf_counter *perf)
+{
+   unsigned i, slot = perf_index_hash(perf);
+   for (i = 0; i < PERF_INDEX_SIZE; i++, slot = (slot + 1) & (PERF_INDEX_SIZE - 1))
+   {
+      if (perf_index_key[slot] == perf)
+         return perf_index_id[slot];
+      if (!perf_index_key[slot])
+         break;
+   }
+   return -1;
+}
+
+static void perf_index_insert(const struct retro_perf_counter *perf, unsigned id)
+{
+   unsigned slot = perf_index_hash(perf);
+   while (perf_index_key[slot])
+      slot = (slot + 1) & (PERF_INDEX_SIZE - 1);
+   perf_index_id[slot]  = id;
+   perf_barrier();
+   perf_index_key[slot] = perf;
+}
+
 void rarch_perf_register(struct retro_perf_counter *perf)
 {
-   if (perf->registered || perf_ptr_rarch >= MAX_COUNTERS)
+   if (perf->registered)
       return;
 
-   perf_counters_rarch[perf_ptr_rarch++] = perf;
-   perf->registered = true;
+   while (!perf_atomic_cas(&perf_register_lock, 0, 1));
+
+   if (!perf->registered && perf_ptr_rarch < MAX_COUNTERS)
+   {
+      if (!perf_epoch_usec)
+      {
+         perf_epoch_ticks = rarch_get_perf_counter();
+         perf_epoch_usec  = rarch_get_time_usec();
+      }
+
+      perf_counters_rarch[perf_ptr_rarch] = perf;
+      perf_index_insert(perf, perf_ptr_rarch);
+      perf_ptr_rarch++;
+      perf->registered = true;
+   }
+
+   perf_barrier();
+   perf_register_lock = 0;
 }
 
 void retro_perf_register(struct retro_perf_counter *perf)
@@ -103,17 +237,343 @@ void retro_perf_clear(void)
    memset(perf_counters_libretro, 0, sizeof(perf_counters_libretro));
 }
 
-#ifdef _WIN32
-#define PERF_LOG_FMT "[PERF]: Avg (%s): %I64u ticks, %I64u runs.\n"
+static struct perf_thread *perf_thread_get(void)
+{
+   unsigned index;
+   struct perf_thread *thread = perf_thread_self;
+   if (thread)
+      return thread;
+
+#ifndef PERF_TLS_NONE
+   for (index = 0; index < PERF_MAX_THREADS; index++)
+      if (perf_atomic_cas(&perf_thread_used[index], 0, 1))
+         break;
+   if (index >= PERF_MAX_THREADS)
+      return NULL;
 #else
-#define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
+   index = 0;
+#endif
+
+   thread = perf_threads[index];
+   if (!thread)
+   {
+      thread = (struct perf_thread*)calloc(1, sizeof(*thread));
+      if (!thread)
+      {
+         perf_thread_used[index] = 0;
+         return NULL;
+      }
+
+      thread->index = index;
+      perf_barrier();
+      perf_threads[index] = thread;
+   }
+
+   perf_thread_self = thread;
+   return thread;
+}
+
+void rarch_perf_thread_exit(void)
+{
+#ifndef PERF_TLS_NONE
+   struct perf_thread *thread = perf_thread_self;
+   if (!thread)
+      return;
+
+   thread->depth = 0;
+   perf_thread_self = NULL;
+   perf_barrier();
+   perf_thread_used[thread->index] = 0;
 #endif
+}
+
+void rarch_perf_free(void)
+{
+   unsigned i;
+   for (i = 0; i < PERF_MAX_THREADS; i++)
+   {
+      free(perf_threads[i]);
+      perf_threads[i] = NULL;
+      perf_thread_used[i] = 0;
+   }
+   perf_thread_self = NULL;
+}
+
+// Tick counts below PERF_HIST_SUB get a bucket each. Every power of two above is split
+// into PERF_HIST_SUB buckets by the two bits below its top bit.
+static inline unsigned perf_hist_bucket(retro_perf_tick_t ticks)
+{
+   unsigned log2 = 0;
+   if (ticks < PERF_HIST_SUB)
+      return (unsigned)ticks;
+
+#if defined(__GNUC__)
+   log2 = 63 - __builtin_clzll(ticks);
+#else
+   while (ticks >> (log2 + 1))
+      log2++;
+#endif
+   return (log2 - 1) * PERF_HIST_SUB + (unsigned)((ticks >> (log2 - 2)) & (PERF_HIST_SUB - 1));
+}
+
+// Smallest tick count which falls into the bucket.
+static uint64_t perf_hist_bucket_base(unsigned bucket)
+{
+   if (bucket < PERF_HIST_SUB)
+      return bucket;
+   return (uint64_t)(PERF_HIST_SUB + bucket % PERF_HIST_SUB) << (bucket / PERF_HIST_SUB - 1);
+}
+
+static void perf_stats_add(struct perf_stats *stats, retro_perf_tick_t duration)
+{
+   stats->calls++;
+   stats->total += duration;
+   if (duration > stats->max)
+      stats->max = duration;
+   stats->hist[perf_hist_bucket(duration)]++;
+}
+
+void rarch_perf_scope_begin(struct retro_perf_counter *perf)
+{
+   struct perf_thread *thread = perf_thread_get();
+   int id = perf_index_find(perf);
+
+   // Scopes are pushed even when the counter could not be registered,
+   // so that every end pops exactly what its begin pushed.
+   if (thread)
+   {
+      if (thread->depth < PERF_MAX_DEPTH)
+         thread->stack[thread->depth].id = id >= 0 ? id : PERF_NO_ID;
+      thread->depth++;
+   }
+
+   rarch_perf_start(perf);
+
+   if (thread && thread->depth <= PERF_MAX_DEPTH)
+      thread->stack[thread->depth - 1].start = perf->start;
+}
+
+void rarch_perf_scope_end(struct retro_perf_counter *perf)
+{
+   struct perf_thread *thread;
+   struct perf_stats *stats;
+   struct perf_sample *sample;
+   retro_perf_tick_t start, duration, now = rarch_get_perf_counter();
+   unsigned depth;
+
+   perf->total += now - perf->start;
+
+   thread = perf_thread_self;
+   if (!thread || !thread->depth)
+      return;
+
+   depth = --thread->depth;
+   if (depth >= PERF_MAX_DEPTH || thread->stack[depth].id == PERF_NO_ID)
+      return;
+
+   // Ignore unbalanced scopes rather than corrupting the statistics.
+   if (perf_counters_rarch[thread->stack[depth].id] != perf)
+      return;
+
+   start    = thread->stack[depth].start;
+   duration = now - start;
+
+   stats = &thread->stats[thread->stack[depth].id];
+   if (!stats->calls)
+      stats->parent = depth ? thread->stack[depth - 1].id : PERF_NO_PARENT;
+   perf_stats_add(stats, duration);
+
+   sample = &thread->ring[thread->ring_head & (PERF_RING_SIZE - 1)];
+   sample->start    = start;
+   sample->duration = duration;
+   sample->id       = thread->stack[depth].id;
+   sample->depth    = depth;
+   // Publish the sample only after it is completely written.
+   perf_barrier();
+   thread->ring_head++;
+}
+
+static uint64_t perf_stats_percentile(const struct perf_stats *stats, unsigned percent)
+{
+   unsigned i;
+   uint64_t seen = 0;
+   uint64_t target = (stats->calls * percent + 99) / 100;
+
+   for (i = 0; i < PERF_HIST_BUCKETS; i++)
+   {
+      seen += stats->hist[i];
+      if (seen >= target)
+      {
+         // Report the upper bound of the bucket, but never more than the worst case seen.
+         uint64_t bound = i + 1 < PERF_HIST_BUCKETS ? perf_hist_bucket_base(i + 1) - 1 : stats->max;
+         return bound < stats->max ? bound : stats->max;
+      }
+   }
+   return stats->max;
+}
+
+static void perf_report_tree(const struct perf_thread *thread, unsigned parent,
+      unsigned depth, const char *filter)
+{
+   unsigned i;
+   static const char indent[] = "                                ";
+
+   for (i = 0; i < perf_ptr_rarch; i++)
+   {
+      const struct perf_stats *stats = &thread->stats[i];
+      if (!stats->calls || stats->parent != parent || i == parent)
+         continue;
+
+      if (!filter || strstr(perf_counters_rarch[i]->ident, filter))
+      {
+         RARCH_LOG("[PERF]: %s%s: " PERF_U64 " runs, avg " PERF_U64 ", p50 " PERF_U64
+               ", p99 " PERF_U64 ", max " PERF_U64 " ticks.\n",
+               indent + sizeof(indent) - 1 - (depth < 16 ? depth : 16) * 2,
+               perf_counters_rarch[i]->ident,
+               (unsigned long long)stats->calls,
+               (unsigned long long)(stats->total / stats->calls),
+               (unsigned long long)perf_stats_percentile(stats, 50),
+               (unsigned long long)perf_stats_percentile(stats, 99),
+               (unsigned long long)stats->max);
+      }
+
+      if (depth < PERF_MAX_DEPTH)
+         perf_report_tree(thread, i, depth + 1, filter);
+   }
+}
+
+void rarch_perf_report(const char *filter)
+{
+   unsigned i;
+
+   for (i = 0; i < PERF_MAX_THREADS; i++)
+   {
+      if (!perf_threads[i])
+         continue;
+
+      RARCH_LOG("[PERF]: Thread #%u:\n", i);
+      perf_report_tree(perf_threads[i], PERF_NO_PARENT, 0, filter);
+   }
+}
+
+// Copies out the samples of a thread's ring which were not overwritten while reading.
+static unsigned perf_ring_snapshot(const struct perf_thread *thread, struct perf_sample *out)
+{
+   uint32_t i, head, first, valid, count = 0;
+
+   head = thread->ring_head;
+   perf_barrier();
+   first = head > PERF_RING_SIZE ? head - PERF_RING_SIZE : 0;
+
+   for (i = first; i != head; i++)
+      out[i - first] = thread->ring[i & (PERF_RING_SIZE - 1)];
+
+   perf_barrier();
+   // Samples at or below head - PERF_RING_SIZE may have been overwritten since.
+   valid = thread->ring_head;
+   valid = valid >= PERF_RING_SIZE ? valid - PERF_RING_SIZE + 1 : 0;
+
+   for (i = first; i != head; i++)
+      if (i >= valid)
+         out[count++] = out[i - first];
+
+   return count;
+}
+
+bool rarch_perf_dump_trace(const char *path)
+{
+   unsigned i, j;
+   bool first = true;
+   double ticks_per_usec = 1.0;
+   struct perf_sample *samples;
+   FILE *file;
+
+   if (!perf_epoch_usec)
+      return false;
+
+   samples = (struct perf_sample*)malloc(PERF_RING_SIZE * sizeof(*samples));
+   if (!samples)
+      return false;
+
+   file = fopen(path, "w");
+   if (!file)
+   {
+      free(samples);
+      return false;
+   }
+
+   if (rarch_get_time_usec() > perf_epoch_usec)
+      ticks_per_usec = (double)(rarch_get_perf_counter() - perf_epoch_ticks) /
+         (double)(rarch_get_time_usec() - perf_epoch_usec);
+   if (ticks_per_usec <= 0.0)
+      ticks_per_usec = 1.0;
+
+   // Chrome trace event format, readable by chrome://tracing and Perfetto.
+   fprintf(file, "{\"traceEvents\":[");
+   for (i = 0; i < PERF_MAX_THREADS; i++)
+   {
+      const struct perf_thread *thread = perf_threads[i];
+      unsigned count;
+      if (!thread)
+         continue;
+
+      fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+            "\"args\":{\"name\":\"RetroArch #%u\"}}", first ? "" : ",", i, i);
+      first = false;
+
+      count = perf_ring_snapshot(thread, samples);
+      for (j = 0; j < count; j++)
+      {
+         fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"perf\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+               "\"ts\":%.3f,\"dur\":%.3f}",
+               perf_counters_rarch[samples[j].id]->ident, i,
+               (double)(int64_t)(samples[j].start - perf_epoch_ticks) / ticks_per_usec,
+               (double)samples[j].duration / ticks_per_usec);
+      }
+   }
+   fprintf(file, "\n],\n\"counters\":[");
+
+   // Aggregate statistics, in ticks.
+   first = true;
+   for (i = 0; i < PERF_MAX_THREADS; i++)
+   {
+      const struct perf_thread *thread = perf_threads[i];
+      if (!thread)
+         continue;
+
+      for (j = 0; j < perf_ptr_rarch; j++)
+      {
+         const struct perf_stats *stats = &thread->stats[j];
+         if (!stats->calls)
+            continue;
+
+         fprintf(file, "%s\n{\"name\":\"%s\",\"tid\":%u,\"parent\":\"%s\",\"calls\":" PERF_U64
+               ",\"total\":" PERF_U64 ",\"p50\":" PERF_U64 ",\"p99\":" PERF_U64 ",\"max\":" PERF_U64 "}",
+               first ? "" : ",", perf_counters_rarch[j]->ident, i,
+               stats->parent != PERF_NO_PARENT ? perf_counters_rarch[stats->parent]->ident : "",
+               (unsigned long long)stats->calls, (unsigned long long)stats->total,
+               (unsigned long long)perf_stats_percentile(stats, 50),
+               (unsigned long long)perf_stats_percentile(stats, 99),
+               (unsigned long long)stats->max);
+         first = false;
+      }
+   }
+   fprintf(file, "\n],\n\"ticksPerMicrosecond\":%.6f}\n", ticks_per_usec);
+
+   free(samples);
+   return fclose(file) == 0;
+}
+
+#define PERF_LOG_FMT "[PERF]: Avg (%s): " PERF_U64 " ticks, " PERF_U64 " runs.\n"
 
 static void log_counters(const struct retro_perf_counter **counters, unsigned num)
 {
    unsigned i;
    for (i = 0; i < num; i++)
    {
+      if (!counters[i]->call_cnt)
+         continue;
+
       RARCH_LOG(PERF_LOG_FMT,
             counters[i]->ident,
             (unsigned long long)counters[i]->total / (unsigned long long)counters[i]->call_cnt,
@@ -126,6 +586,7 @@ void rarch_perf_log(void)
 #if defined(PERF_TEST) || !defined(RARCH_INTERNAL)
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
    log_counters(perf_counters_rarch, perf_ptr_rarch);
+   rarch_perf_report(NULL);
 #endif
 }
 
@@ -135,6 +596,18 @@ void retro_perf_log(void)
    log_counters(perf_counters_libretro, perf_ptr_libretro);
 }
 
+const struct retro_perf_counter **rarch_perf_get_counters(unsigned *num)
+{
+   *num = perf_ptr_rarch;
+   return perf_counters_rarch;
+}
+
+const struct retro_perf_counter **retro_perf_get_counters(unsigned *num)
+{
+   *num = perf_ptr_libretro;
+   return perf_counters_libretro;
+}
+
 retro_perf_tick_t rarch_get_perf_counter(void)
 {
    retro_perf_tick_t time = 0;
@@ -324,6 +797,9 @@ uint64_t rarch_get_cpu_features(void)
    if (flags[2] & (1 << 0))
       cpu |= RETRO_SIMD_SSE3;
 
+   if (flags[2] & (1 << 1))
+      cpu |= RARCH_CPU_PCLMUL;
+
    if (flags[2] & (1 << 9))
       cpu |= RETRO_SIMD_SSSE3;
 
@@ -343,6 +819,8 @@ uint64_t rarch_get_cpu_features(void)
       x86_cpuid(7, flags);
       if (flags[1] & (1 << 5))
          cpu |= RETRO_SIMD_AVX2;
+      if (flags[1] & (1 << 29))
+         cpu |= RARCH_CPU_SHA;
    }
 
    x86_cpuid(0x80000000, flags);
@@ -366,6 +844,8 @@ uint64_t rarch_get_cpu_features(void)
    RARCH_LOG("[CPUID]: SSE4.2: %u\n", !!(cpu & RETRO_SIMD_SSE42));
    RARCH_LOG("[CPUID]: AVX:    %u\n", !!(cpu & RETRO_SIMD_AVX));
    RARCH_LOG("[CPUID]: AVX2:   %u\n", !!(cpu & RETRO_SIMD_AVX2));
+   RARCH_LOG("[CPUID]: PCLMUL: %u\n", !!(cpu & RARCH_CPU_PCLMUL));
+   RARCH_LOG("[CPUID]: SHA:    %u\n", !!(cpu & RARCH_CPU_SHA));
 #elif defined(ANDROID) && defined(ANDROID_ARM)
    uint64_t cpu_flags = android_getCpuFeatures();
    (void)cpu_flags;
@@ -397,5 +877,40 @@ uint64_t rarch_get_cpu_features(void)
    RARCH_LOG("[CPUID]: PS: %u\n", !!(cpu & RETRO_SIMD_PS));
 #endif
 
+#if defined(ARM_LINUX_HWCAP)
+#if defined(__aarch64__)
+   if (getauxval(AT_HWCAP) & (1 << 7)) // HWCAP_CRC32
+      cpu |= RARCH_CPU_CRC32;
+   if (getauxval(AT_HWCAP) & (1 << 6)) // HWCAP_SHA2
+      cpu |= RARCH_CPU_SHA;
+#elif defined(AT_HWCAP2)
+   if (getauxval(AT_HWCAP2) & (1 << 4)) // HWCAP2_CRC32
+      cpu |= RARCH_CPU_CRC32;
+   if (getauxval(AT_HWCAP2) & (1 << 3)) // HWCAP2_SHA2
+      cpu |= RARCH_CPU_SHA;
+#endif
+   RARCH_LOG("[CPUID]: CRC32: %u\n", !!(cpu & RARCH_CPU_CRC32));
+   RARCH_LOG("[CPUID]: SHA:   %u\n", !!(cpu & RARCH_CPU_SHA));
+#endif
+
    return cpu;
 }
+
+unsigned rarch_get_cpu_cores(void)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   SYSTEM_INFO sysinfo;
+   GetSystemInfo(&sysinfo);
+   return sysinfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+   long ret = sysconf(_SC_NPROCESSORS_ONLN);
+   return ret > 0 ? ret : 1;
+#else
+   return 1;
+#endif
+}
+
+uint64_t retro_get_cpu_features(void)
+{
+   return rarch_get_cpu_features() & ~(RARCH_CPU_PCLMUL | RARCH_CPU_CRC32 | RARCH_CPU_SHA);
+}
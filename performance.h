@@ -43,6 +43,10 @@ void retro_perf_clear(void);
 void rarch_perf_log(void);
 void retro_perf_log(void);
 
+// Registered counters of RetroArch and of the core, e.g. for exporting them.
+const struct retro_perf_counter **rarch_perf_get_counters(unsigned *num);
+const struct retro_perf_counter **retro_perf_get_counters(unsigned *num);
+
 static inline void rarch_perf_start(struct retro_perf_counter *perf)
 {
    perf->call_cnt++;
@@ -54,7 +58,30 @@ static inline void rarch_perf_stop(struct retro_perf_counter *perf)
    perf->total += rarch_get_perf_counter() - perf->start;
 }
 
+// Same as rarch_perf_start/stop, but also tracks nesting, per-thread latency histograms
+// and recent samples. Used by the RARCH_PERFORMANCE_* macros.
+void rarch_perf_scope_begin(struct retro_perf_counter *perf);
+void rarch_perf_scope_end(struct retro_perf_counter *perf);
+
+// Logs per-thread counter trees with p50/p99/max. filter matches counter names, NULL for all.
+void rarch_perf_report(const char *filter);
+// Writes recent samples and counter statistics as a Chrome trace (JSON) file.
+bool rarch_perf_dump_trace(const char *path);
+// Gives the calling thread's statistics slot back for reuse. Called when sthread_create() threads exit.
+void rarch_perf_thread_exit(void);
+// Frees all per-thread statistics. Only call once no other thread records scopes.
+void rarch_perf_free(void);
+
 uint64_t rarch_get_cpu_features(void);
+uint64_t retro_get_cpu_features(void); // Same as rarch_get_cpu_features, without the frontend-internal bits.
+// Number of online CPU cores, 1 if it can't be queried.
+unsigned rarch_get_cpu_cores(void);
+
+// Frontend-internal feature bits returned by rarch_get_cpu_features() on top of RETRO_SIMD_*.
+// Not part of the libretro API, so they start above the 32-bit range.
+#define RARCH_CPU_PCLMUL  (UINT64_C(1) << 32) // x86 carry-less multiply.
+#define RARCH_CPU_CRC32   (UINT64_C(1) << 33) // ARMv8 CRC32 instructions.
+#define RARCH_CPU_SHA     (UINT64_C(1) << 34) // x86 SHA extensions or ARMv8 SHA2 instructions.
 
 // Used internally by RetroArch.
 #if defined(PERF_TEST) || !defined(RARCH_INTERNAL)
@@ -64,8 +91,8 @@ uint64_t rarch_get_cpu_features(void);
       if (!(X).registered) \
          rarch_perf_register(&(X)); \
    } while(0)
-#define RARCH_PERFORMANCE_START(X) rarch_perf_start(&(X))
-#define RARCH_PERFORMANCE_STOP(X) rarch_perf_stop(&(X))
+#define RARCH_PERFORMANCE_START(X) rarch_perf_scope_begin(&(X))
+#define RARCH_PERFORMANCE_STOP(X) rarch_perf_scope_end(&(X))
 #else
 #define RARCH_PERFORMANCE_INIT(X)
 #define RARCH_PERFORMANCE_START(X)
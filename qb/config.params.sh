@@ -16,6 +16,8 @@ HAVE_GLES3=no           # Enable OpenGLES3 support
 HAVE_X11=auto           # Disable everything X11.
 HAVE_LIMA=no            # Enable Lima video support
 HAVE_OMAP=no            # Enable OMAP video support
+HAVE_FBDEV=auto         # Enable Linux framebuffer video support
+HAVE_SOFTVIDEO=yes      # Disable the in-memory software video driver
 HAVE_XINERAMA=auto      # Disable Xinerama support.
 HAVE_KMS=auto           # Enable KMS context support
 HAVE_EGL=auto           # Enable EGL context support
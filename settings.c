@@ -107,6 +107,10 @@ const char *config_get_default_video(void)
          return "null";
       case VIDEO_OMAP:
          return "omap";
+      case VIDEO_FBDEV:
+         return "fbdev";
+      case VIDEO_SOFT:
+         return "soft";
       default:
          return NULL;
    }
@@ -250,6 +254,7 @@ void config_set_defaults(void)
    g_settings.video.black_frame_insertion = black_frame_insertion;
    g_settings.video.swap_interval = swap_interval;
    g_settings.video.threaded = video_threaded;
+   g_settings.video.filter_threads = video_filter_threads;
    g_settings.video.smooth = video_smooth;
    g_settings.video.force_aspect = force_aspect;
    g_settings.video.scale_integer = scale_integer;
@@ -296,16 +301,20 @@ void config_set_defaults(void)
    g_settings.rewind_granularity = rewind_granularity;
    g_settings.slowmotion_ratio = slowmotion_ratio;
    g_settings.fastforward_ratio = fastforward_ratio;
+   g_settings.fastforward_turbo = fastforward_turbo;
+   g_settings.fastforward_present_interval = fastforward_present_interval;
    g_settings.pause_nonactive = pause_nonactive;
    g_settings.autosave_interval = autosave_interval;
 
    g_settings.block_sram_overwrite = block_sram_overwrite;
+   g_settings.savestate_compression = savestate_compression;
    g_settings.savestate_auto_index = savestate_auto_index;
    g_settings.savestate_auto_save  = savestate_auto_save;
    g_settings.savestate_auto_load  = savestate_auto_load;
    g_settings.network_cmd_enable   = network_cmd_enable;
    g_settings.network_cmd_port     = network_cmd_port;
    g_settings.stdin_cmd_enable     = stdin_cmd_enable;
+   g_settings.network_cmd_bin_port = network_cmd_bin_port;
    g_settings.game_history_size    = game_history_size;
    g_settings.libretro_log_level   = libretro_log_level;
 
@@ -354,6 +363,7 @@ void config_set_defaults(void)
    g_settings.input.overlay_scale = 1.0f;
    g_settings.input.debug_enable = input_debug_enable;
    g_settings.input.autodetect_enable = input_autodetect_enable;
+   g_settings.input.joypad_poll_on_state = input_joypad_poll_on_state;
    *g_settings.input.keyboard_layout = '\0';
 #ifdef ANDROID
    g_settings.input.back_behavior = BACK_BUTTON_QUIT;
@@ -380,8 +390,10 @@ void config_set_defaults(void)
    *g_settings.libretro_info_path = '\0';
    *g_settings.core_options_path = '\0';
    *g_settings.game_history_path = '\0';
+   *g_settings.network_cmd_bin_socket = '\0';
    *g_settings.cheat_database = '\0';
    *g_settings.cheat_settings_path = '\0';
+   *g_settings.frame_trace_path = '\0';
    *g_settings.screenshot_directory = '\0';
    *g_settings.system_directory = '\0';
    *g_settings.extraction_directory = '\0';
@@ -390,6 +402,9 @@ void config_set_defaults(void)
    *g_settings.content_directory = '\0';
    *g_settings.video.shader_path = '\0';
    *g_settings.video.shader_dir = '\0';
+   *g_settings.video.shader_cache_dir = '\0';
+   *g_settings.video.soft_dump_dir = '\0';
+   *g_settings.video.soft_hash_log = '\0';
 #ifdef HAVE_MENU
    *g_settings.rgui_content_directory = '\0';
    *g_settings.rgui_config_directory = '\0';
@@ -865,14 +880,20 @@ bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_BOOL(video.gpu_record, "video_gpu_record");
    CONFIG_GET_BOOL(video.gpu_screenshot, "video_gpu_screenshot");
 
-#ifdef HAVE_DYLIB
    CONFIG_GET_PATH(video.filter_path, "video_filter");
-#endif
+   CONFIG_GET_INT(video.filter_threads, "video_filter_threads");
 
    CONFIG_GET_PATH(video.shader_dir, "video_shader_dir");
    if (!strcmp(g_settings.video.shader_dir, "default"))
       *g_settings.video.shader_dir = '\0';
 
+   CONFIG_GET_PATH(video.shader_cache_dir, "video_shader_cache_dir");
+   if (!strcmp(g_settings.video.shader_cache_dir, "default"))
+      *g_settings.video.shader_cache_dir = '\0';
+
+   CONFIG_GET_PATH(video.soft_dump_dir, "video_soft_dump_dir");
+   CONFIG_GET_PATH(video.soft_hash_log, "video_soft_hash_log");
+
    CONFIG_GET_FLOAT(input.axis_threshold, "input_axis_threshold");
    CONFIG_GET_BOOL(input.netplay_client_swap_input, "netplay_client_swap_input");
 
@@ -980,14 +1001,20 @@ bool config_load_file(const char *path, bool set_defaults)
       g_settings.slowmotion_ratio = 1.0f;
 
    CONFIG_GET_FLOAT(fastforward_ratio, "fastforward_ratio");
+   CONFIG_GET_BOOL(fastforward_turbo, "fastforward_turbo");
+   CONFIG_GET_INT(fastforward_present_interval, "fastforward_present_interval");
+   if (!g_settings.fastforward_present_interval)
+      g_settings.fastforward_present_interval = 1;
 
    CONFIG_GET_BOOL(pause_nonactive, "pause_nonactive");
    CONFIG_GET_INT(autosave_interval, "autosave_interval");
 
    CONFIG_GET_PATH(cheat_database, "cheat_database_path");
    CONFIG_GET_PATH(cheat_settings_path, "cheat_settings_path");
+   CONFIG_GET_PATH(frame_trace_path, "frame_trace_path");
 
    CONFIG_GET_BOOL(block_sram_overwrite, "block_sram_overwrite");
+   CONFIG_GET_BOOL(savestate_compression, "savestate_compression");
    CONFIG_GET_BOOL(savestate_auto_index, "savestate_auto_index");
    CONFIG_GET_BOOL(savestate_auto_save, "savestate_auto_save");
    CONFIG_GET_BOOL(savestate_auto_load, "savestate_auto_load");
@@ -995,6 +1022,8 @@ bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_BOOL(network_cmd_enable, "network_cmd_enable");
    CONFIG_GET_INT(network_cmd_port, "network_cmd_port");
    CONFIG_GET_BOOL(stdin_cmd_enable, "stdin_cmd_enable");
+   CONFIG_GET_INT(network_cmd_bin_port, "network_cmd_bin_port");
+   CONFIG_GET_PATH(network_cmd_bin_socket, "network_cmd_bin_socket");
 
    CONFIG_GET_PATH(game_history_path, "game_history_path");
    CONFIG_GET_INT(game_history_size, "game_history_size");
@@ -1005,6 +1034,7 @@ bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_BOOL(input.debug_enable, "input_debug_enable");
 
    CONFIG_GET_BOOL(input.autodetect_enable, "input_autodetect_enable");
+   CONFIG_GET_BOOL(input.joypad_poll_on_state, "input_joypad_poll_on_state");
    CONFIG_GET_PATH(input.autoconfig_dir, "joypad_autoconfig_dir");
 
 #ifdef ANDROID
@@ -1308,6 +1338,7 @@ bool config_save_file(const char *path)
    config_set_path(conf, "savefile_directory", *g_extern.savefile_dir ? g_extern.savefile_dir : "default");
    config_set_path(conf, "savestate_directory", *g_extern.savestate_dir ? g_extern.savestate_dir : "default");
    config_set_path(conf, "video_shader_dir", *g_settings.video.shader_dir ? g_settings.video.shader_dir : "default");
+   config_set_path(conf, "video_shader_cache_dir", *g_settings.video.shader_cache_dir ? g_settings.video.shader_cache_dir : "default");
 
    config_set_path(conf, "content_directory", *g_settings.content_directory ? g_settings.content_directory : "default");
 #ifdef HAVE_MENU
@@ -1320,6 +1351,7 @@ bool config_save_file(const char *path)
    config_set_int(conf, "game_history_size", g_settings.game_history_size);
    config_set_path(conf, "joypad_autoconfig_dir", g_settings.input.autoconfig_dir);
    config_set_bool(conf, "input_autodetect_enable", g_settings.input.autodetect_enable);
+   config_set_bool(conf, "input_joypad_poll_on_state", g_settings.input.joypad_poll_on_state);
 
 #ifdef HAVE_OVERLAY
    config_set_path(conf, "overlay_directory", *g_extern.overlay_dir ? g_extern.overlay_dir : "default");
@@ -1361,6 +1393,7 @@ bool config_save_file(const char *path)
    config_set_float(conf, "video_font_size", g_settings.video.font_size);
 
    config_set_bool(conf, "block_sram_overwrite", g_settings.block_sram_overwrite);
+   config_set_bool(conf, "savestate_compression", g_settings.savestate_compression);
    config_set_bool(conf, "savestate_auto_index", g_settings.savestate_auto_index);
    config_set_bool(conf, "savestate_auto_save", g_settings.savestate_auto_save);
    config_set_bool(conf, "savestate_auto_load", g_settings.savestate_auto_load);
@@ -15,6 +15,7 @@
  */
 
 #include "thread.h"
+#include "performance.h"
 #include <stdlib.h>
 
 #if defined(_WIN32)
@@ -53,6 +54,7 @@ static DWORD CALLBACK thread_wrap(void *data_)
 {
    struct thread_data *data = (struct thread_data*)data_;
    data->func(data->userdata);
+   rarch_perf_thread_exit();
    free(data);
    return 0;
 }
@@ -200,6 +202,7 @@ static void *thread_wrap(void *data_)
 {
    struct thread_data *data = (struct thread_data*)data_;
    data->func(data->userdata);
+   rarch_perf_thread_exit();
    free(data);
    return NULL;
 }
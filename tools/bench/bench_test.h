@@ -0,0 +1,47 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_BENCH_TEST_H
+#define __RARCH_BENCH_TEST_H
+
+// --test mode shared by the benches. Each case is one CHECK() line of the bench's run_test(),
+// which returns bench_test_result() as the exit code.
+
+#include <stdio.h>
+#include <string.h>
+#include "boolean.h"
+
+static unsigned bench_test_failed;
+
+static inline void bench_check(const char *name, bool ok)
+{
+   printf("%-48s %s\n", name, ok ? "ok" : "FAILED");
+   if (!ok)
+      bench_test_failed++;
+}
+
+#define CHECK(name, cond) bench_check(name, (cond))
+
+static inline int bench_test_result(void)
+{
+   return bench_test_failed ? 1 : 0;
+}
+
+static inline bool bench_test_mode(int argc, char *argv[])
+{
+   return argc > 1 && strcmp(argv[1], "--test") == 0;
+}
+
+#endif
@@ -0,0 +1,348 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// video4linux2 camera driver test and benchmark. Needs no camera:
+// the driver plays back a file of YUYV frames in place of a device.
+//
+// camera_bench --test
+//    Checks YUYV to XRGB8888 conversion against a per-pixel reference, then runs the driver
+//    on a file, checking converted and YUYV frames and that poll only reports new frames.
+// camera_bench
+//    Times the conversion against plain C, and poll when there is no new frame.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "driver.h"
+#include "gfx/scaler/pixconv.h"
+#include "miscellaneous.h"
+#include "performance.h"
+#include "bench_test.h"
+
+#define BENCH_FRAMES 200
+#define FRAME_FILE "camera_bench.tmp"
+
+#define FRAME_WIDTH  70
+#define FRAME_HEIGHT 20
+#define FILE_FRAMES  3
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245 + 12345;
+   return rng_state >> 16;
+}
+
+static uint8_t *make_yuyv(unsigned size)
+{
+   unsigned i;
+   uint8_t *yuyv = (uint8_t*)malloc(size);
+   if (!yuyv)
+      return NULL;
+
+   for (i = 0; i < size; i++)
+      yuyv[i] = rng();
+   return yuyv;
+}
+
+static uint8_t reference_clamp(int val)
+{
+   return val < 0 ? 0 : (val > 255 ? 255 : val);
+}
+
+// The scaler's fixed point BT.601, a pixel at a time.
+static void reference_convert(uint32_t *output, const uint8_t *input,
+      unsigned width, unsigned height, unsigned out_pitch, unsigned in_pitch)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         const uint8_t *p = input + y * in_pitch + (x & ~1u) * 2;
+         int l = 64 * p[x & 1 ? 2 : 0];
+         int u = p[1] - 128;
+         int v = p[3] - 128;
+
+         uint8_t r = reference_clamp((l + 90 * v + 32) >> 6);
+         uint8_t g = reference_clamp((l - 22 * u - 46 * v + 32) >> 6);
+         uint8_t b = reference_clamp((l + 113 * u + 32) >> 6);
+
+         output[y * (out_pitch >> 2) + x] = (0xffu << 24) | (r << 16) | (g << 8) | b;
+      }
+   }
+}
+
+// Widths with and without a part the SIMD paths leave to C, and padded pitches.
+static bool check_convert(unsigned width)
+{
+   unsigned height = 7, in_pitch = width * 2 + 10, out_pitch = width * 4 + 8;
+   uint8_t *input = make_yuyv(in_pitch * height);
+   uint32_t *output = (uint32_t*)calloc(height, out_pitch);
+   uint32_t *expected = (uint32_t*)calloc(height, out_pitch);
+   bool ok = input && output && expected;
+
+   if (ok)
+   {
+      conv_yuyv_argb8888(output, input, width, height, out_pitch, in_pitch);
+      reference_convert(expected, input, width, height, out_pitch, in_pitch);
+      ok = memcmp(output, expected, height * out_pitch) == 0;
+   }
+
+   free(input);
+   free(output);
+   free(expected);
+   return ok;
+}
+
+// What the core saw in its last frame callback.
+static struct
+{
+   uint8_t data[FRAME_WIDTH * 4 * FRAME_HEIGHT];
+   unsigned width;
+   unsigned height;
+   size_t pitch;
+   unsigned count;
+} received;
+
+static void frame_cb(const uint32_t *buffer, unsigned width, unsigned height, size_t pitch)
+{
+   unsigned y;
+   received.width  = width;
+   received.height = height;
+   received.pitch  = pitch;
+   received.count++;
+
+   if (width == FRAME_WIDTH && height == FRAME_HEIGHT && pitch <= FRAME_WIDTH * 4)
+      for (y = 0; y < height; y++)
+         memcpy(received.data + y * pitch, (const uint8_t*)buffer + y * pitch, pitch);
+}
+
+static uint8_t *write_frame_file(void)
+{
+   unsigned size = FRAME_WIDTH * 2 * FRAME_HEIGHT * FILE_FRAMES;
+   uint8_t *frames = make_yuyv(size);
+   FILE *file = fopen(FRAME_FILE, "wb");
+   bool ok = frames && file && fwrite(frames, 1, size, file) == size;
+
+   if (file)
+      fclose(file);
+   if (!ok)
+   {
+      free(frames);
+      return NULL;
+   }
+   return frames;
+}
+
+static bool wait_frame(void *cam)
+{
+   unsigned i;
+   for (i = 0; i < 2000; i++)
+   {
+      if (camera_v4l2.poll(cam, frame_cb, NULL))
+         return true;
+      rarch_sleep(1);
+   }
+   return false;
+}
+
+// Which frame of the file the core got, or -1.
+static int find_frame(const uint8_t *frames, bool yuyv)
+{
+   unsigned i, frame_size = FRAME_WIDTH * 2 * FRAME_HEIGHT;
+   uint32_t expected[FRAME_WIDTH * FRAME_HEIGHT];
+
+   for (i = 0; i < FILE_FRAMES; i++)
+   {
+      const uint8_t *frame = frames + i * frame_size;
+      if (yuyv)
+      {
+         if (memcmp(received.data, frame, frame_size) == 0)
+            return i;
+      }
+      else
+      {
+         reference_convert(expected, frame, FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH * 4, FRAME_WIDTH * 2);
+         if (memcmp(received.data, expected, sizeof(expected)) == 0)
+            return i;
+      }
+   }
+   return -1;
+}
+
+// Frames of the file come in order, in the format the core asked for.
+// YUYV is only passed on when it is the only raw format requested.
+static bool check_file(uint64_t caps, bool yuyv)
+{
+   uint8_t *frames = write_frame_file();
+   void *cam = frames ? camera_v4l2.init(FRAME_FILE, caps, FRAME_WIDTH, FRAME_HEIGHT) : NULL;
+   bool ok = cam && camera_v4l2.start(cam);
+   int prev = -1;
+   unsigned i;
+
+   for (i = 0; ok && i < 4; i++)
+   {
+      int index;
+      ok = wait_frame(cam) &&
+         received.width == FRAME_WIDTH && received.height == FRAME_HEIGHT &&
+         received.pitch == FRAME_WIDTH * (yuyv ? 2 : 4);
+
+      index = ok ? find_frame(frames, yuyv) : -1;
+      ok = index >= 0 && index != prev;
+      prev = index;
+   }
+
+   if (cam)
+   {
+      camera_v4l2.stop(cam);
+      camera_v4l2.free(cam);
+   }
+   free(frames);
+   remove(FRAME_FILE);
+   return ok;
+}
+
+// A frame is handed over once, and stopped cameras hand over nothing.
+static bool check_poll(void)
+{
+   uint8_t *frames = write_frame_file();
+   void *cam = frames ? camera_v4l2.init(FRAME_FILE, 1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER,
+         FRAME_WIDTH, FRAME_HEIGHT) : NULL;
+   bool ok = cam && camera_v4l2.start(cam) && wait_frame(cam);
+   unsigned count = received.count;
+
+   ok = ok && !camera_v4l2.poll(cam, frame_cb, NULL) && received.count == count;
+
+   if (cam)
+   {
+      camera_v4l2.stop(cam);
+      rarch_sleep(50);
+      ok = ok && !camera_v4l2.poll(cam, frame_cb, NULL) && received.count == count;
+
+      // And start again.
+      ok = ok && camera_v4l2.start(cam) && wait_frame(cam) && received.count == count + 1;
+      camera_v4l2.stop(cam);
+      camera_v4l2.free(cam);
+   }
+   free(frames);
+   remove(FRAME_FILE);
+   return ok;
+}
+
+// Cores without raw framebuffers, and files without a frame size, are refused.
+static bool check_refused(void)
+{
+   uint8_t *frames = write_frame_file();
+   void *gl = frames ? camera_v4l2.init(FRAME_FILE, 1ULL << RETRO_CAMERA_BUFFER_OPENGL_TEXTURE,
+         FRAME_WIDTH, FRAME_HEIGHT) : NULL;
+   void *no_size = frames ? camera_v4l2.init(FRAME_FILE, 1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER, 0, 0) : NULL;
+   void *too_big = frames ? camera_v4l2.init(FRAME_FILE, 1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER,
+         FRAME_WIDTH, FRAME_HEIGHT * FILE_FRAMES + 1) : NULL;
+   bool ok = frames && !gl && !no_size && !too_big;
+
+   if (gl)
+      camera_v4l2.free(gl);
+   if (no_size)
+      camera_v4l2.free(no_size);
+   if (too_big)
+      camera_v4l2.free(too_big);
+   free(frames);
+   remove(FRAME_FILE);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   CHECK("YUYV to XRGB8888, width 64", check_convert(64));
+   CHECK("YUYV to XRGB8888, width 70", check_convert(70));
+   CHECK("YUYV to XRGB8888, width 2", check_convert(2));
+   CHECK("file camera, XRGB8888", check_file(1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER, false));
+   CHECK("file camera, YUYV", check_file(1ULL << RETRO_CAMERA_BUFFER_RAW_YUYV_FRAMEBUFFER, true));
+   CHECK("file camera, both raw formats", check_file((1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER) |
+         (1ULL << RETRO_CAMERA_BUFFER_RAW_YUYV_FRAMEBUFFER), false));
+   CHECK("poll only reports new frames", check_poll());
+   CHECK("refused setups", check_refused());
+
+   return bench_test_result();
+}
+
+static void bench_convert(unsigned width, unsigned height)
+{
+   uint8_t *input = make_yuyv(width * 2 * height);
+   uint32_t *output = (uint32_t*)malloc(width * 4 * height);
+   retro_time_t start, time, ref_time;
+   unsigned i;
+
+   if (!input || !output)
+      goto end;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      conv_yuyv_argb8888(output, input, width, height, width * 4, width * 2);
+   time = rarch_get_time_usec() - start;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      reference_convert(output, input, width, height, width * 4, width * 2);
+   ref_time = rarch_get_time_usec() - start;
+
+   printf("YUYV to XRGB8888 %ux%u: %7.1f us/frame, C: %7.1f us/frame\n",
+         width, height, (double)time / BENCH_FRAMES, (double)ref_time / BENCH_FRAMES);
+
+end:
+   free(input);
+   free(output);
+}
+
+// What a core pays per retro_run() when the camera has nothing new.
+static void bench_poll(void)
+{
+   uint8_t *frames = write_frame_file();
+   void *cam = frames ? camera_v4l2.init(FRAME_FILE, 1ULL << RETRO_CAMERA_BUFFER_RAW_FRAMEBUFFER,
+         FRAME_WIDTH, FRAME_HEIGHT) : NULL;
+   retro_time_t start, time;
+   unsigned i, polls = 100000;
+
+   if (cam && camera_v4l2.start(cam) && wait_frame(cam))
+   {
+      start = rarch_get_time_usec();
+      for (i = 0; i < polls; i++)
+         camera_v4l2.poll(cam, frame_cb, NULL);
+      time = rarch_get_time_usec() - start;
+
+      printf("poll: %7.3f us/call\n", (double)time / polls);
+      camera_v4l2.stop(cam);
+   }
+
+   if (cam)
+      camera_v4l2.free(cam);
+   free(frames);
+   remove(FRAME_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   bench_convert(640, 480);
+   bench_convert(1280, 720);
+   bench_poll();
+   return 0;
+}
@@ -0,0 +1,264 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Cheat search test and benchmark, against a fake core with a block of system RAM.
+//
+// cheat_bench --test
+//    Runs searches of every op and width and checks them against a plain reference,
+//    then checks that pokes are applied after retro_run().
+// cheat_bench [RAM size in MiB]
+//    Times a search over the whole RAM, 8 MiB by default.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "cheat_search.h"
+#include "performance.h"
+#include "bench_test.h"
+
+struct global g_extern;
+
+static uint8_t *core_ram;
+static size_t core_ram_size;
+
+static void *core_get_memory_data(unsigned id)
+{
+   return id == RETRO_MEMORY_SYSTEM_RAM ? core_ram : NULL;
+}
+
+static size_t core_get_memory_size(unsigned id)
+{
+   return id == RETRO_MEMORY_SYSTEM_RAM ? core_ram_size : 0;
+}
+
+static void core_run(void)
+{
+   core_ram[0] = 0;
+}
+
+void *(*pretro_get_memory_data)(unsigned) = core_get_memory_data;
+size_t (*pretro_get_memory_size)(unsigned) = core_get_memory_size;
+void (*pretro_run)(void) = core_run;
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245u + 12345u;
+   return rng_state >> 8;
+}
+
+// Changes some of the RAM, with small values so that every op keeps some candidates.
+static void core_step(void)
+{
+   size_t i, n = core_ram_size / 64;
+   for (i = 0; i < n; i++)
+      core_ram[rng() % core_ram_size] += rng() % 3 - 1;
+}
+
+static uint32_t load(const uint8_t *ptr, unsigned width)
+{
+   uint32_t val = 0;
+   // Native byte order, the same as the search.
+   if (width == 1)
+      val = *ptr;
+   else if (width == 2)
+   {
+      uint16_t v;
+      memcpy(&v, ptr, 2);
+      val = v;
+   }
+   else
+      memcpy(&val, ptr, 4);
+   return val;
+}
+
+static bool reference_match(enum cheat_search_op op, uint32_t cur, uint32_t prev, uint32_t value)
+{
+   switch (op)
+   {
+      case CHEAT_SEARCH_EQ: return cur == value;
+      case CHEAT_SEARCH_NE: return cur != value;
+      case CHEAT_SEARCH_GT: return cur > value;
+      case CHEAT_SEARCH_LT: return cur < value;
+      case CHEAT_SEARCH_UNCHANGED: return cur == prev;
+      case CHEAT_SEARCH_CHANGED: return cur != prev;
+      case CHEAT_SEARCH_INCREASED: return cur > prev;
+      case CHEAT_SEARCH_DECREASED: return cur < prev;
+      default: return false;
+   }
+}
+
+// Runs a few search steps and compares every step with a plain loop over the RAM.
+static bool check_search(unsigned width, const enum cheat_search_op *ops, unsigned num_ops)
+{
+   unsigned i;
+   size_t j, elements = core_ram_size / width;
+   uint8_t *prev = (uint8_t*)malloc(core_ram_size);
+   uint8_t *expected = (uint8_t*)malloc(elements);
+   size_t *offsets = (size_t*)malloc(elements * sizeof(size_t));
+   bool ok = prev && expected && offsets && cheat_search_start(width);
+
+   if (ok)
+   {
+      memset(expected, 1, elements);
+      memcpy(prev, core_ram, core_ram_size);
+   }
+
+   for (i = 0; ok && i < num_ops; i++)
+   {
+      size_t count = 0, num;
+      uint32_t value = load(core_ram + (rng() % elements) * width, width);
+
+      core_step();
+      for (j = 0; j < elements; j++)
+      {
+         expected[j] = expected[j] && reference_match(ops[i],
+               load(core_ram + j * width, width), load(prev + j * width, width), value);
+         count += expected[j];
+      }
+      memcpy(prev, core_ram, core_ram_size);
+
+      if (!cheat_search_refine(ops[i], value) || cheat_search_count() != count)
+      {
+         fprintf(stderr, "Width %u, op %d: %lu candidates, expected %lu.\n", width, ops[i],
+               (unsigned long)cheat_search_count(), (unsigned long)count);
+         ok = false;
+         break;
+      }
+
+      num = cheat_search_candidates(offsets, elements);
+      for (j = 0; j < num; j++)
+         ok = ok && offsets[j] % width == 0 && expected[offsets[j] / width];
+      ok = ok && num == count;
+   }
+
+   free(prev);
+   free(expected);
+   free(offsets);
+   return ok;
+}
+
+static bool check_pokes(void)
+{
+   uint32_t value;
+   bool ok;
+
+   cheat_search_hook_core();
+   // The second poke at 6 replaces the first, the one past the end is kept but never written.
+   ok = cheat_poke_add(0, 1, 0x5a) && cheat_poke_add(6, 2, 0x1234) && cheat_poke_add(6, 2, 0xbeef) &&
+      cheat_poke_add(core_ram_size - 4, 4, 0xdeadbeef) && cheat_poke_add(core_ram_size, 4, 0) &&
+      !cheat_poke_add(8, 3, 0);
+   ok = ok && cheat_poke_count() == 4;
+
+   pretro_run();
+   ok = ok && core_ram[0] == 0x5a &&
+      cheat_search_read(6, 2, &value) && value == 0xbeef &&
+      cheat_search_read(core_ram_size - 4, 4, &value) && value == 0xdeadbeef &&
+      !cheat_search_read(core_ram_size - 2, 4, &value);
+
+   cheat_poke_clear();
+   pretro_run();
+   return ok && core_ram[0] == 0 && cheat_poke_count() == 0;
+}
+
+static int run_test(void)
+{
+   static const enum cheat_search_op value_ops[] = {
+      CHEAT_SEARCH_NE, CHEAT_SEARCH_GT, CHEAT_SEARCH_LT, CHEAT_SEARCH_EQ,
+   };
+   static const enum cheat_search_op prev_ops[] = {
+      CHEAT_SEARCH_UNCHANGED, CHEAT_SEARCH_UNCHANGED, CHEAT_SEARCH_CHANGED, CHEAT_SEARCH_INCREASED,
+   };
+   static const enum cheat_search_op mixed_ops[] = {
+      CHEAT_SEARCH_DECREASED, CHEAT_SEARCH_NE, CHEAT_SEARCH_CHANGED, CHEAT_SEARCH_GT,
+   };
+   static const unsigned widths[] = { 1, 2, 4 };
+   unsigned i;
+   char name[64];
+   size_t i_ram;
+
+   // Odd size, so the last word of candidates is partial and the tail is handled.
+   core_ram_size = 64 * 1024 + 44;
+   core_ram = (uint8_t*)malloc(core_ram_size);
+   if (!core_ram)
+      return 1;
+   for (i_ram = 0; i_ram < core_ram_size; i_ram++)
+      core_ram[i_ram] = rng() % 4;
+
+   for (i = 0; i < 3; i++)
+   {
+      snprintf(name, sizeof(name), "width %u, against value", widths[i]);
+      CHECK(name, check_search(widths[i], value_ops, 4));
+      snprintf(name, sizeof(name), "width %u, against previous", widths[i]);
+      CHECK(name, check_search(widths[i], prev_ops, 4));
+      snprintf(name, sizeof(name), "width %u, mixed", widths[i]);
+      CHECK(name, check_search(widths[i], mixed_ops, 4));
+   }
+
+   // Full range values, where unsigned compares differ from signed ones.
+   for (i_ram = 0; i_ram < core_ram_size; i_ram++)
+      core_ram[i_ram] = rng();
+   for (i = 0; i < 3; i++)
+   {
+      snprintf(name, sizeof(name), "width %u, full range", widths[i]);
+      CHECK(name, check_search(widths[i], mixed_ops, 4));
+   }
+
+   CHECK("pokes", check_pokes());
+
+   cheat_search_deinit();
+   free(core_ram);
+   return bench_test_result();
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned width;
+   size_t i;
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   core_ram_size = (argc > 1 ? strtoul(argv[1], NULL, 0) : 8) * 1024 * 1024;
+   core_ram = (uint8_t*)malloc(core_ram_size);
+   if (!core_ram)
+      return 1;
+   for (i = 0; i < core_ram_size; i++)
+      core_ram[i] = rng() % 4;
+
+   printf("RAM: %.1f MiB\n", core_ram_size / (1024.0 * 1024.0));
+   for (width = 1; width <= 4; width *= 2)
+   {
+      retro_time_t start = rarch_get_time_usec();
+      cheat_search_start(width);
+      retro_time_t started = rarch_get_time_usec();
+      cheat_search_refine(CHEAT_SEARCH_NE, 0);
+      retro_time_t first = rarch_get_time_usec();
+      core_step();
+      retro_time_t stepped = rarch_get_time_usec();
+      cheat_search_refine(CHEAT_SEARCH_UNCHANGED, 0);
+      retro_time_t second = rarch_get_time_usec();
+
+      printf("Width %u: start %.2f ms, first search %.2f ms, second search %.2f ms (%lu candidates left)\n",
+            width, (started - start) / 1000.0, (first - started) / 1000.0, (second - stepped) / 1000.0,
+            (unsigned long)cheat_search_count());
+   }
+
+   cheat_search_deinit();
+   free(core_ram);
+   return 0;
+}
+
@@ -0,0 +1,537 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Headless core benchmark.
+//
+// core_bench [-L core] [-n frames] [-m movie.bsv] [-r rewind MiB] [-t interval] [-s ratio] [-o out.json] [content]
+//    Loads a core through dynamic.c and runs it for a fixed number of frames without any drivers.
+//    Video frames are scaled 2x to ARGB8888 with the bilinear scaler, audio is converted and
+//    resampled to 48 kHz with the sinc resampler, input is either idle or replayed from a BSV movie.
+//    Every frame is serialized and pushed to the rewind buffer, every 60th frame is unserialized again.
+//    Timings are written as JSON. Without -L, the test core in libretro-test/ is used.
+//    With -t, the whole run is fast forwarded in turbo mode, presenting every interval'th frame,
+//    and -s caps the speed at ratio times the core's frame rate. "speed" in the output is the
+//    achieved multiplier over the core's frame rate, e.g. compare -t 8 -r 0 against -r 0.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "general.h"
+#include "driver.h"
+#include "dynamic.h"
+#include "movie.h"
+#include "rewind.h"
+#include "hash.h"
+#include "file_path.h"
+#include "performance.h"
+#include "compat/strl.h"
+#include "audio/resampler.h"
+#include "audio/utils.h"
+#include "gfx/scaler/scaler.h"
+
+#define DEFAULT_CORE "../../libretro-test/test_libretro.so"
+#define DEFAULT_FRAMES 3600
+#define DEFAULT_REWIND_MB 20
+#define OUT_RATE 48000.0
+#define UNSERIALIZE_INTERVAL 60
+#define MAX_AUDIO_FRAMES 8192
+
+struct settings g_settings;
+struct global g_extern;
+driver_t driver;
+
+enum bench_stage
+{
+   STAGE_RUN = 0,
+   STAGE_INPUT_POLL,
+   STAGE_VIDEO,
+   STAGE_AUDIO,
+   STAGE_SERIALIZE,
+   STAGE_REWIND,
+   STAGE_UNSERIALIZE,
+
+   STAGE_COUNT
+};
+
+static const char *stage_names[STAGE_COUNT] = {
+   "run", "input_poll", "video_scale", "audio_resample", "serialize", "rewind", "unserialize",
+};
+
+static struct
+{
+   // Per frame ticks, accumulated over every call within the frame.
+   uint64_t *ticks[STAGE_COUNT];
+   unsigned samples[STAGE_COUNT];
+   unsigned frame;
+
+   struct scaler_ctx scaler;
+   uint32_t *scaled;
+
+   const rarch_resampler_t *resampler;
+   void *resampler_data;
+   double ratio;
+   int16_t audio[MAX_AUDIO_FRAMES * 2];
+   size_t audio_frames;
+   float audio_float[MAX_AUDIO_FRAMES * 2];
+   float audio_out[MAX_AUDIO_FRAMES * 2 * 8];
+
+   bsv_movie_t *movie;
+   bool movie_end;
+} bench;
+
+static inline void stage_add(enum bench_stage stage, retro_perf_tick_t start)
+{
+   bench.ticks[stage][bench.frame] += rarch_get_perf_counter() - start;
+}
+
+static enum scaler_pix_fmt scaler_format(enum retro_pixel_format fmt)
+{
+   switch (fmt)
+   {
+      case RETRO_PIXEL_FORMAT_XRGB8888:
+         return SCALER_FMT_ARGB8888;
+      case RETRO_PIXEL_FORMAT_RGB565:
+         return SCALER_FMT_RGB565;
+      default:
+         return SCALER_FMT_0RGB1555;
+   }
+}
+
+static void video_cb(const void *data, unsigned width, unsigned height, size_t pitch)
+{
+   struct scaler_ctx *ctx = &bench.scaler;
+   retro_perf_tick_t start = rarch_get_perf_counter();
+
+   // Dupes and hardware rendered frames have nothing to scale.
+   if (!data || data == RETRO_HW_FRAME_BUFFER_VALID)
+      return;
+
+   if (ctx->in_width != (int)width || ctx->in_height != (int)height ||
+         ctx->in_fmt != scaler_format(g_extern.system.pix_fmt))
+   {
+      scaler_ctx_gen_reset(ctx);
+      free(bench.scaled);
+
+      ctx->in_width    = width;
+      ctx->in_height   = height;
+      ctx->out_width   = width * 2;
+      ctx->out_height  = height * 2;
+      ctx->out_stride  = width * 2 * sizeof(uint32_t);
+      ctx->in_fmt      = scaler_format(g_extern.system.pix_fmt);
+      ctx->out_fmt     = SCALER_FMT_ARGB8888;
+      ctx->scaler_type = SCALER_TYPE_BILINEAR;
+
+      bench.scaled = (uint32_t*)malloc(ctx->out_stride * ctx->out_height);
+      if (!bench.scaled || !scaler_ctx_gen_filter(ctx))
+      {
+         RARCH_ERR("Failed to set up scaler.\n");
+         exit(1);
+      }
+   }
+
+   ctx->in_stride = pitch;
+   scaler_ctx_scale(ctx, bench.scaled, data);
+   stage_add(STAGE_VIDEO, start);
+}
+
+static void audio_flush(void)
+{
+   struct resampler_data data = {0};
+
+   audio_convert_s16_to_float(bench.audio_float, bench.audio, bench.audio_frames * 2, 1.0f);
+
+   data.data_in      = bench.audio_float;
+   data.data_out     = bench.audio_out;
+   data.input_frames = bench.audio_frames;
+   data.ratio        = bench.ratio;
+   rarch_resampler_process(bench.resampler, bench.resampler_data, &data);
+
+   bench.audio_frames = 0;
+}
+
+static size_t audio_batch_cb(const int16_t *data, size_t frames)
+{
+   size_t written = 0;
+   retro_perf_tick_t start = rarch_get_perf_counter();
+
+   while (written < frames)
+   {
+      size_t avail = MAX_AUDIO_FRAMES - bench.audio_frames;
+      size_t copy  = frames - written < avail ? frames - written : avail;
+
+      memcpy(bench.audio + bench.audio_frames * 2, data + written * 2, copy * 2 * sizeof(int16_t));
+      bench.audio_frames += copy;
+      written += copy;
+
+      if (bench.audio_frames == MAX_AUDIO_FRAMES)
+         audio_flush();
+   }
+
+   stage_add(STAGE_AUDIO, start);
+   return frames;
+}
+
+static void audio_cb(int16_t left, int16_t right)
+{
+   int16_t buf[2] = { left, right };
+   audio_batch_cb(buf, 1);
+}
+
+static void input_poll_cb(void)
+{
+   retro_perf_tick_t start = rarch_get_perf_counter();
+   stage_add(STAGE_INPUT_POLL, start);
+}
+
+static int16_t input_state_cb(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+   int16_t ret = 0;
+   (void)port;
+   (void)device;
+   (void)index;
+   (void)id;
+
+   if (bench.movie && !bench.movie_end && !bsv_movie_get_input(bench.movie, &ret))
+   {
+      bench.movie_end = true;
+      ret = 0;
+   }
+   return ret;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return x < y ? -1 : x > y;
+}
+
+static void print_stage(FILE *out, enum bench_stage stage, unsigned frames,
+      double ticks_per_usec, bool last)
+{
+   unsigned i, count = 0;
+   uint64_t total = 0;
+   uint64_t *sorted = (uint64_t*)malloc((frames + 1) * sizeof(uint64_t));
+   if (!sorted)
+      exit(1);
+
+   for (i = 0; i < frames; i++)
+   {
+      // Stages which do not run every frame only count frames where they ran.
+      if (stage == STAGE_UNSERIALIZE && i % UNSERIALIZE_INTERVAL != UNSERIALIZE_INTERVAL - 1)
+         continue;
+      sorted[count++] = bench.ticks[stage][i];
+      total += bench.ticks[stage][i];
+   }
+   qsort(sorted, count, sizeof(uint64_t), compare_u64);
+
+   fprintf(out, "    \"%s\": { \"samples\": %u, \"total_ms\": %.3f, \"avg_us\": %.3f, "
+         "\"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f }%s\n",
+         stage_names[stage], count, total / ticks_per_usec / 1000.0,
+         count ? total / ticks_per_usec / count : 0.0,
+         count ? sorted[(count - 1) / 2] / ticks_per_usec : 0.0,
+         count ? sorted[(count * 99 - 1) / 100] / ticks_per_usec : 0.0,
+         count ? sorted[count - 1] / ticks_per_usec : 0.0,
+         last ? "" : ",");
+   free(sorted);
+}
+
+static void print_usage(const char *argv0)
+{
+   fprintf(stderr, "Usage: %s [-L core] [-n frames] [-m movie.bsv] [-r rewind MiB] [-t interval] [-s ratio] "
+         "[-o out.json] [content]\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+   int c;
+   unsigned i, frames = DEFAULT_FRAMES, rewind_mb = DEFAULT_REWIND_MB, turbo_interval = 0;
+   float turbo_ratio = -1.0f;
+   const char *core = DEFAULT_CORE;
+   const char *movie_path = NULL;
+   const char *out_path = NULL;
+   const char *content = NULL;
+   void *content_data = NULL;
+   ssize_t content_size = 0;
+   size_t state_size;
+   void *state = NULL;
+   state_manager_t *rewind = NULL;
+   FILE *out = stdout;
+
+   while ((c = getopt(argc, argv, "L:n:m:r:t:s:o:h")) != -1)
+   {
+      switch (c)
+      {
+         case 'L':
+            core = optarg;
+            break;
+         case 'n':
+            frames = strtoul(optarg, NULL, 0);
+            break;
+         case 'm':
+            movie_path = optarg;
+            break;
+         case 'r':
+            rewind_mb = strtoul(optarg, NULL, 0);
+            break;
+         case 't':
+            turbo_interval = strtoul(optarg, NULL, 0);
+            break;
+         case 's':
+            turbo_ratio = strtod(optarg, NULL);
+            break;
+         case 'o':
+            out_path = optarg;
+            break;
+         default:
+            print_usage(argv[0]);
+            return 1;
+      }
+   }
+   if (optind < argc)
+      content = argv[optind];
+   if (!frames)
+   {
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   if (setjmp(g_extern.error_sjlj_context) > 0)
+   {
+      RARCH_ERR("Fatal error: %s\n", g_extern.error_string);
+      return 1;
+   }
+
+   strlcpy(g_settings.libretro, core, sizeof(g_settings.libretro));
+   if (turbo_interval)
+   {
+      // Fast forward held for the whole run.
+      g_settings.fastforward_turbo            = true;
+      g_settings.fastforward_present_interval = turbo_interval;
+      g_settings.fastforward_ratio            = turbo_ratio;
+      driver.nonblock_state                   = true;
+   }
+   hash_init();
+   init_libretro_sym(false);
+
+   pretro_set_video_refresh(video_cb);
+   pretro_set_audio_sample(audio_cb);
+   pretro_set_audio_sample_batch(audio_batch_cb);
+   pretro_set_input_poll(input_poll_cb);
+   pretro_set_input_state(input_state_cb);
+   pretro_get_system_info(&g_extern.system.info);
+   pretro_init();
+
+   struct retro_game_info game = {0};
+   if (content)
+   {
+      game.path = content;
+      if (!g_extern.system.info.need_fullpath)
+      {
+         content_size = read_file(content, &content_data);
+         if (content_size < 0)
+         {
+            RARCH_ERR("Failed to read content \"%s\".\n", content);
+            return 1;
+         }
+         game.data = content_data;
+         game.size = content_size;
+         g_extern.cart_crc = crc32_calculate((const uint8_t*)content_data, content_size);
+      }
+   }
+
+   if (!pretro_load_game(content ? &game : NULL))
+   {
+      RARCH_ERR("Core failed to load content.\n");
+      return 1;
+   }
+   pretro_get_system_av_info(&g_extern.system.av_info);
+
+   if (movie_path && !(bench.movie = bsv_movie_init(movie_path, RARCH_MOVIE_PLAYBACK)))
+      return 1;
+
+   bench.ratio = OUT_RATE / (g_extern.system.av_info.timing.sample_rate > 0.0 ?
+         g_extern.system.av_info.timing.sample_rate : 32000.0);
+   if (!rarch_resampler_realloc(&bench.resampler_data, &bench.resampler, "sinc", bench.ratio))
+   {
+      RARCH_ERR("Failed to set up resampler.\n");
+      return 1;
+   }
+
+   state_size = pretro_serialize_size();
+   if (state_size)
+   {
+      state = malloc(state_size);
+      if (rewind_mb)
+         rewind = state_manager_new(state_size, rewind_mb << 20);
+   }
+
+   for (i = 0; i < STAGE_COUNT; i++)
+   {
+      bench.ticks[i] = (uint64_t*)calloc(frames, sizeof(uint64_t));
+      if (!bench.ticks[i])
+         return 1;
+   }
+
+   retro_perf_tick_t bench_start_ticks = rarch_get_perf_counter();
+   retro_time_t bench_start_usec = rarch_get_time_usec();
+
+   for (bench.frame = 0; bench.frame < frames; bench.frame++)
+   {
+      retro_perf_tick_t start;
+
+      if (bench.movie)
+         bsv_movie_set_frame_start(bench.movie);
+
+      start = rarch_get_perf_counter();
+      pretro_run();
+      stage_add(STAGE_RUN, start);
+
+      if (bench.movie)
+      {
+         bsv_movie_set_frame_end(bench.movie);
+         if (bench.movie_end)
+         {
+            bench.frame++;
+            break;
+         }
+      }
+
+      if (!state)
+         continue;
+
+      start = rarch_get_perf_counter();
+      pretro_serialize(state, state_size);
+      stage_add(STAGE_SERIALIZE, start);
+
+      if (rewind)
+      {
+         void *where = NULL;
+         start = rarch_get_perf_counter();
+         state_manager_push_where(rewind, &where);
+         memcpy(where, state, state_size);
+         state_manager_push_do(rewind);
+         stage_add(STAGE_REWIND, start);
+      }
+
+      if (bench.frame % UNSERIALIZE_INTERVAL == UNSERIALIZE_INTERVAL - 1)
+      {
+         start = rarch_get_perf_counter();
+         pretro_unserialize(state, state_size);
+         stage_add(STAGE_UNSERIALIZE, start);
+      }
+   }
+
+   frames = bench.frame;
+   double wall_usec = (double)(rarch_get_time_usec() - bench_start_usec);
+   double ticks_per_usec = wall_usec > 0.0 ?
+      (double)(rarch_get_perf_counter() - bench_start_ticks) / wall_usec : 1.0;
+   uint64_t run_ticks = 0;
+   for (i = 0; i < frames; i++)
+      run_ticks += bench.ticks[STAGE_RUN][i];
+
+   if (out_path && !(out = fopen(out_path, "w")))
+   {
+      RARCH_ERR("Failed to open \"%s\".\n", out_path);
+      return 1;
+   }
+
+   fprintf(out, "{\n");
+   fprintf(out, "  \"core\": \"%s\",\n", g_extern.system.info.library_name ? g_extern.system.info.library_name : "");
+   fprintf(out, "  \"core_version\": \"%s\",\n", g_extern.system.info.library_version ? g_extern.system.info.library_version : "");
+   fprintf(out, "  \"movie\": %s,\n", bench.movie ? "true" : "false");
+   fprintf(out, "  \"frames\": %u,\n", frames);
+   fprintf(out, "  \"wall_seconds\": %.6f,\n", wall_usec / 1000000.0);
+   fprintf(out, "  \"fps\": %.3f,\n", wall_usec > 0.0 ? frames * 1000000.0 / wall_usec : 0.0);
+   fprintf(out, "  \"run_fps\": %.3f,\n", run_ticks ? frames * 1000000.0 * ticks_per_usec / run_ticks : 0.0);
+   fprintf(out, "  \"speed\": %.3f,\n", wall_usec > 0.0 && g_extern.system.av_info.timing.fps > 0.0 ?
+         frames * 1000000.0 / (wall_usec * g_extern.system.av_info.timing.fps) : 0.0);
+   fprintf(out, "  \"turbo_present_interval\": %u,\n", turbo_interval);
+   fprintf(out, "  \"turbo_ratio\": %.3f,\n", turbo_interval ? turbo_ratio : -1.0f);
+   fprintf(out, "  \"state_size\": %u,\n", (unsigned)state_size);
+   fprintf(out, "  \"resampler_ratio\": %.6f,\n", bench.ratio);
+   fprintf(out, "  \"stages\": {\n");
+   for (i = 0; i < STAGE_COUNT; i++)
+      print_stage(out, (enum bench_stage)i, frames, ticks_per_usec, i == STAGE_COUNT - 1);
+   fprintf(out, "  }\n}\n");
+
+   if (out != stdout)
+      fclose(out);
+
+   if (bench.movie)
+      bsv_movie_free(bench.movie);
+   if (rewind)
+      state_manager_free(rewind);
+   rarch_resampler_freep(&bench.resampler, &bench.resampler_data);
+   scaler_ctx_gen_reset(&bench.scaler);
+   pretro_unload_game();
+   pretro_deinit();
+   uninit_libretro_sym();
+
+   for (i = 0; i < STAGE_COUNT; i++)
+      free(bench.ticks[i]);
+   free(bench.scaled);
+   free(state);
+   free(content_data);
+   return 0;
+}
+
+// Headless stand-ins for driver.c. There is no video, audio or input driver to talk to.
+uintptr_t driver_get_current_framebuffer(void)
+{
+   return 0;
+}
+
+retro_proc_address_t driver_get_proc_address(const char *sym)
+{
+   (void)sym;
+   return NULL;
+}
+
+bool driver_set_rumble_state(unsigned port, enum retro_rumble_effect effect, uint16_t strength)
+{
+   (void)port;
+   (void)effect;
+   (void)strength;
+   return false;
+}
+
+bool driver_set_sensor_state(unsigned port, enum retro_sensor_action action, unsigned rate)
+{
+   (void)port;
+   (void)action;
+   (void)rate;
+   return false;
+}
+
+float driver_sensor_get_input(unsigned port, unsigned action)
+{
+   (void)port;
+   (void)action;
+   return 0.0f;
+}
+
+bool driver_update_system_av_info(const struct retro_system_av_info *info)
+{
+   g_extern.system.av_info = *info;
+   if (bench.resampler)
+   {
+      if (bench.audio_frames)
+         audio_flush();
+      bench.ratio = OUT_RATE / (info->timing.sample_rate > 0.0 ? info->timing.sample_rate : 32000.0);
+   }
+   return true;
+}
@@ -0,0 +1,99 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput benchmark for crc32_update().
+// Compares the runtime selected implementation against the byte-at-a-time table
+// and zlib's crc32(), and checks that all three agree.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <zlib.h>
+#include "hash.h"
+#include "performance.h"
+
+static uint32_t crc32_bytewise(const uint8_t *data, size_t length)
+{
+   size_t i;
+   uint32_t crc = ~0u;
+   for (i = 0; i < length; i++)
+      crc = crc32_adjust(crc, data[i]);
+   return ~crc;
+}
+
+static uint32_t crc32_zlib(const uint8_t *data, size_t length)
+{
+   return crc32(0, data, length);
+}
+
+static uint32_t crc32_rarch(const uint8_t *data, size_t length)
+{
+   return crc32_calculate(data, length);
+}
+
+static double bench(const char *ident, uint32_t (*func)(const uint8_t*, size_t),
+      const uint8_t *data, size_t size, unsigned iterations, uint32_t *crc)
+{
+   unsigned i;
+   retro_time_t start, total;
+   double mbps;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < iterations; i++)
+      *crc = func(data, size);
+   total = rarch_get_time_usec() - start;
+
+   mbps = ((double)size * iterations) / (total ? total : 1);
+   printf("%-10s %8u KiB: %9.1f MB/s (crc 0x%08x)\n", ident, (unsigned)(size >> 10), mbps, (unsigned)*crc);
+   return mbps;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t sizes[] = { 4 << 10, 256 << 10, 64 << 20 };
+   unsigned i, s;
+   size_t max_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+   uint8_t *data = (uint8_t*)malloc(max_size);
+   int ret = 0;
+
+   if (!data)
+      return 1;
+
+   for (i = 0; i < max_size; i++)
+      data[i] = rand();
+
+   hash_init();
+
+   for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+   {
+      uint32_t crc_byte = 0, crc_zlib = 0, crc_rarch = 0;
+      unsigned iterations = (unsigned)((256 << 20) / sizes[s]);
+      if (argc > 1)
+         iterations = strtoul(argv[1], NULL, 0);
+
+      bench("bytewise", crc32_bytewise, data, sizes[s], iterations, &crc_byte);
+      bench("zlib", crc32_zlib, data, sizes[s], iterations, &crc_zlib);
+      bench("rarch", crc32_rarch, data, sizes[s], iterations, &crc_rarch);
+
+      if (crc_byte != crc_zlib || crc_byte != crc_rarch)
+      {
+         fprintf(stderr, "CRC mismatch at %u bytes.\n", (unsigned)sizes[s]);
+         ret = 1;
+      }
+   }
+
+   free(data);
+   return ret;
+}
@@ -0,0 +1,560 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Framebuffer video driver test and benchmark.
+// The driver runs against a fake framebuffer: fbdev_bench.tmp in the current directory,
+// with the fbdev ioctls answered here.
+//
+// fbdev_bench --test
+//    Checks the direct point scaler in every format against a plain reference,
+//    and that the driver pans to complete frames, in order, without touching a buffer on screen.
+// fbdev_bench
+//    Times point scaling into a framebuffer, converting the whole frame around the scaler
+//    as it used to be done, against the direct path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+#include "general.h"
+#include "driver.h"
+#include "gfx/scaler/scaler.h"
+#include "gfx/scaler/scaler_int.h"
+#include "gfx/scaler/pixconv.h"
+#include "thread.h"
+#include "performance.h"
+#include "bench_test.h"
+
+struct settings g_settings;
+struct global g_extern;
+driver_t driver;
+
+#define FB_PATH "fbdev_bench.tmp"
+#define FB_WIDTH 320
+#define FB_HEIGHT 240
+#define BENCH_FRAMES 200
+
+// The fake framebuffer.
+static struct
+{
+   struct fb_var_screeninfo var;
+   unsigned max_buffers;
+   unsigned vsync_usec;
+
+   uint8_t *mem; // Our own mapping of the file.
+   size_t size;
+
+   // The buffer scanned out, and the one panned to until the next vblank.
+   int displayed, pending;
+
+   // What every pan found in its buffer.
+   slock_t *lock;
+   unsigned pans;
+   uint32_t last_index;
+   unsigned errors;
+   bool in_order;
+   bool strict;
+
+   // Viewport the driver is expected to draw.
+   unsigned vp_x, vp_y, vp_width, vp_height;
+} fake;
+
+static unsigned fake_bpp(void)
+{
+   return fake.var.bits_per_pixel / 8;
+}
+
+static size_t fake_buffer_size(void)
+{
+   return (size_t)FB_WIDTH * FB_HEIGHT * fake_bpp();
+}
+
+static uint32_t fake_pixel(const uint8_t *buf, unsigned x, unsigned y)
+{
+   if (fake_bpp() == 2)
+      return ((const uint16_t*)buf)[y * FB_WIDTH + x];
+   return ((const uint32_t*)buf)[y * FB_WIDTH + x];
+}
+
+static uint32_t fake_hash(int buffer)
+{
+   const uint8_t *buf = fake.mem + buffer * fake_buffer_size();
+   uint32_t hash = 2166136261u;
+   size_t i;
+   for (i = 0; i < fake_buffer_size(); i++)
+      hash = (hash ^ buf[i]) * 16777619u;
+   return hash;
+}
+
+// A complete frame is one value in the whole viewport, and black around it.
+static void fake_check_pan(int buffer)
+{
+   const uint8_t *buf = fake.mem + buffer * fake_buffer_size();
+   uint32_t value = fake_pixel(buf, fake.vp_x, fake.vp_y);
+   uint32_t index = fake_bpp() == 2 ? value : ((value >> 3) & 0x1f) | (value >> 10) << 5;
+   unsigned x, y;
+   bool ok = true;
+
+   // Still blank from init.
+   if (!value)
+      return;
+
+   for (y = 0; y < FB_HEIGHT && ok; y++)
+   {
+      for (x = 0; x < FB_WIDTH; x++)
+      {
+         bool inside = x >= fake.vp_x && x < fake.vp_x + fake.vp_width &&
+            y >= fake.vp_y && y < fake.vp_y + fake.vp_height;
+         if (fake_pixel(buf, x, y) != (inside ? value : 0))
+         {
+            ok = false;
+            break;
+         }
+      }
+   }
+
+   slock_lock(fake.lock);
+   fake.pans++;
+   if (!ok)
+      fake.errors++;
+   if (fake.strict ? index != fake.last_index + 1 : index <= fake.last_index)
+      fake.in_order = false;
+   fake.last_index = index;
+   slock_unlock(fake.lock);
+}
+
+static int fake_vsync(void)
+{
+   // Nothing may be drawn to the buffer on screen, or the one about to be.
+   int displayed = fake.displayed, pending = fake.pending;
+   uint32_t hash_displayed = fake_hash(displayed);
+   uint32_t hash_pending = fake_hash(pending);
+
+   usleep(fake.vsync_usec);
+
+   if (fake.max_buffers > 1 && (fake_hash(displayed) != hash_displayed || fake_hash(pending) != hash_pending))
+   {
+      slock_lock(fake.lock);
+      fake.errors++;
+      slock_unlock(fake.lock);
+   }
+
+   fake.displayed = pending;
+   return 0;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+   void *arg;
+   va_list ap;
+   va_start(ap, request);
+   arg = va_arg(ap, void*);
+   va_end(ap);
+   (void)fd;
+
+   switch (request)
+   {
+      case FBIOGET_VSCREENINFO:
+         memcpy(arg, &fake.var, sizeof(fake.var));
+         return 0;
+
+      case FBIOPUT_VSCREENINFO:
+      {
+         const struct fb_var_screeninfo *var = (const struct fb_var_screeninfo*)arg;
+         if (var->xres != FB_WIDTH || var->yres != FB_HEIGHT ||
+               var->yres_virtual > FB_HEIGHT * fake.max_buffers)
+         {
+            errno = EINVAL;
+            return -1;
+         }
+         fake.var = *var;
+         return 0;
+      }
+
+      case FBIOPAN_DISPLAY:
+      {
+         const struct fb_var_screeninfo *var = (const struct fb_var_screeninfo*)arg;
+         if (var->yoffset % FB_HEIGHT || var->yoffset + FB_HEIGHT > fake.var.yres_virtual)
+         {
+            errno = EINVAL;
+            return -1;
+         }
+         fake.var.yoffset = var->yoffset;
+         fake.pending = var->yoffset / FB_HEIGHT;
+         if (fake.mem)
+            fake_check_pan(fake.pending);
+         return 0;
+      }
+
+      case FBIO_WAITFORVSYNC:
+         return fake_vsync();
+
+      case FBIOBLANK:
+         return 0;
+
+      default:
+         errno = ENOTTY;
+         return -1;
+   }
+}
+
+static bool fake_setup(unsigned bits, unsigned max_buffers, unsigned vsync_usec)
+{
+   int fd;
+
+   memset(&fake.var, 0, sizeof(fake.var));
+   fake.var.xres = fake.var.xres_virtual = FB_WIDTH;
+   fake.var.yres = fake.var.yres_virtual = FB_HEIGHT;
+   fake.var.bits_per_pixel = bits;
+   fake.max_buffers = max_buffers;
+   fake.vsync_usec = vsync_usec;
+   fake.displayed = fake.pending = 0;
+   fake.pans = fake.errors = 0;
+   fake.last_index = 0;
+   fake.in_order = true;
+
+   fd = open(FB_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+      return false;
+
+   fake.size = fake_buffer_size() * 3;
+   if (ftruncate(fd, fake.size) < 0)
+   {
+      close(fd);
+      return false;
+   }
+
+   fake.mem = (uint8_t*)mmap(NULL, fake.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (fake.mem == MAP_FAILED)
+   {
+      fake.mem = NULL;
+      return false;
+   }
+
+   setenv("FRAMEBUFFER", FB_PATH, 1);
+   return true;
+}
+
+static void fake_teardown(void)
+{
+   if (fake.mem)
+      munmap(fake.mem, fake.size);
+   fake.mem = NULL;
+   remove(FB_PATH);
+}
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245u + 12345u;
+   return rng_state >> 8;
+}
+
+static unsigned fmt_bpp(enum scaler_pix_fmt fmt)
+{
+   return fmt == SCALER_FMT_ARGB8888 ? 4 : 2;
+}
+
+// Direct point scaling against sampling a plainly converted frame.
+static bool check_scale(enum scaler_pix_fmt in_fmt, enum scaler_pix_fmt out_fmt,
+      int in_width, int in_height, int out_width, int out_height)
+{
+   struct scaler_ctx ctx = {0}, conv = {0};
+   unsigned in_bpp = fmt_bpp(in_fmt), out_bpp = fmt_bpp(out_fmt);
+   int in_stride  = in_width * in_bpp + 12;
+   int out_stride = out_width * out_bpp + 20;
+   uint8_t *input     = (uint8_t*)malloc(in_stride * in_height);
+   uint8_t *converted = (uint8_t*)malloc(in_width * out_bpp * in_height);
+   uint8_t *output    = (uint8_t*)malloc(out_stride * (out_height + 2));
+   bool ok = input && converted && output;
+   int x, y, i;
+
+   for (i = 0; ok && i < in_stride * in_height; i++)
+      input[i] = rng();
+   if (ok)
+      memset(output, 0xaa, out_stride * (out_height + 2));
+
+   ctx.in_fmt = in_fmt;
+   ctx.out_fmt = out_fmt;
+   ctx.scaler_type = SCALER_TYPE_POINT;
+   ctx.in_width = in_width;
+   ctx.in_height = in_height;
+   ctx.in_stride = in_stride;
+   ctx.out_width = out_width;
+   ctx.out_height = out_height;
+   ctx.out_stride = out_stride;
+
+   conv = ctx;
+   conv.out_width = in_width;
+   conv.out_height = in_height;
+   conv.out_stride = in_width * out_bpp;
+
+   ok = ok && scaler_ctx_gen_filter(&ctx) && scaler_ctx_gen_filter(&conv) && ctx.point.enable;
+   if (ok)
+   {
+      scaler_ctx_scale(&ctx, output + out_stride, input);
+      scaler_ctx_scale(&conv, converted, input);
+   }
+
+   for (y = 0; ok && y < out_height; y++)
+   {
+      int in_y = (int)(((2 * (int64_t)y + 1) * in_height) / (2 * out_height));
+      const uint8_t *out_line = output + (y + 1) * out_stride;
+      const uint8_t *in_line = converted + in_y * in_width * out_bpp;
+
+      for (x = 0; ok && x < out_width; x++)
+      {
+         int in_x = (int)(((2 * (int64_t)x + 1) * in_width) / (2 * out_width));
+         ok = memcmp(out_line + x * out_bpp, in_line + in_x * out_bpp, out_bpp) == 0;
+      }
+
+      // Nothing past the end of the line.
+      for (i = out_width * out_bpp; ok && i < out_stride; i++)
+         ok = out_line[i] == 0xaa;
+   }
+
+   // Nor above or below.
+   for (i = 0; ok && i < out_stride; i++)
+      ok = output[i] == 0xaa && output[(out_height + 1) * out_stride + i] == 0xaa;
+
+   scaler_ctx_gen_reset(&ctx);
+   scaler_ctx_gen_reset(&conv);
+   free(input);
+   free(converted);
+   free(output);
+   return ok;
+}
+
+static bool check_scale_sizes(enum scaler_pix_fmt in_fmt, enum scaler_pix_fmt out_fmt)
+{
+   static const int sizes[][4] = {
+      { 256, 224, 512, 448 },  // 2x
+      { 100,  80, 300, 240 },  // 3x
+      { 160, 144, 267, 240 },  // Aspect fit
+      { 320, 240, 160, 120 },  // Down
+      {  37,  11, 111,  67 },  // Odd sizes
+      { 333,  17, 333,  50 },  // Vertical only
+      {   1,   1,  13,   9 },
+   };
+   unsigned i;
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+      if (!check_scale(in_fmt, out_fmt, sizes[i][0], sizes[i][1], sizes[i][2], sizes[i][3]))
+         return false;
+   return true;
+}
+
+static bool check_conv_rgb565(void)
+{
+   uint32_t input[67];
+   uint16_t output[67];
+   unsigned i, round;
+
+   for (round = 0; round < 1000; round++)
+   {
+      for (i = 0; i < 67; i++)
+         input[i] = (rng() << 8) ^ rng();
+
+      conv_argb8888_rgb565(output, input, 67, 1, 0, 0);
+      for (i = 0; i < 67; i++)
+      {
+         uint32_t col = input[i];
+         if (output[i] != (((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f)))
+            return false;
+      }
+   }
+   return true;
+}
+
+static const video_driver_t *start_driver(bool rgb32, bool vsync, void **data)
+{
+   video_info_t info = {0};
+   const input_driver_t *input = NULL;
+   void *input_data = NULL;
+
+   info.vsync = vsync;
+   info.force_aspect = true;
+   info.rgb32 = rgb32;
+
+   *data = video_fbdev.init(&info, &input, &input_data);
+   return *data ? &video_fbdev : NULL;
+}
+
+// Runs frames of a solid, increasing value through the driver.
+static bool check_driver(unsigned bits, bool rgb32, unsigned max_buffers, bool vsync,
+      unsigned width, unsigned height, unsigned vsync_usec,
+      unsigned vp_x, unsigned vp_y, unsigned vp_width, unsigned vp_height)
+{
+   const video_driver_t *drv;
+   void *data = NULL;
+   unsigned bpp = rgb32 ? 4 : 2;
+   uint8_t *frame = (uint8_t*)malloc(width * height * bpp);
+   unsigned i, x, frames = vsync ? 60 : 300;
+   bool ok;
+
+   g_extern.system.aspect_ratio = (float)width / height;
+   g_extern.system.av_info.geometry.base_width = width;
+   g_extern.system.av_info.geometry.base_height = height;
+
+   ok = frame && fake_setup(bits, max_buffers, vsync_usec);
+   fake.vp_x = vp_x;
+   fake.vp_y = vp_y;
+   fake.vp_width = vp_width;
+   fake.vp_height = vp_height;
+   fake.strict = vsync && max_buffers > 1;
+
+   drv = ok ? start_driver(rgb32, vsync, &data) : NULL;
+   ok = ok && drv;
+
+   for (i = 1; ok && i <= frames; i++)
+   {
+      // Frame numbers which survive the trip through RGB565.
+      uint32_t value = rgb32 ? ((i & 0x1f) << 3) | ((i >> 5) << 10) : i;
+      for (x = 0; x < width * height; x++)
+      {
+         if (rgb32)
+            ((uint32_t*)frame)[x] = value;
+         else
+            ((uint16_t*)frame)[x] = value;
+      }
+      ok = drv->frame(data, frame, width, height, width * bpp, NULL);
+   }
+
+   // A single buffer is never panned, it has to have the last frame.
+   if (ok && max_buffers == 1)
+      fake_check_pan(0);
+
+   if (drv && data)
+      drv->free(data);
+
+   ok = ok && fake.errors == 0 && fake.in_order && fake.last_index == frames;
+   // With vsync every frame is shown, without the ones that were too late are dropped.
+   if (max_buffers > 1)
+      ok = ok && (vsync ? fake.pans == frames : fake.pans < frames);
+
+   fake_teardown();
+   free(frame);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   fake.lock = slock_new();
+
+   CHECK("ARGB8888 -> RGB565 conversion", check_conv_rgb565());
+   CHECK("point scale RGB565 -> RGB565", check_scale_sizes(SCALER_FMT_RGB565, SCALER_FMT_RGB565));
+   CHECK("point scale RGB565 -> ARGB8888", check_scale_sizes(SCALER_FMT_RGB565, SCALER_FMT_ARGB8888));
+   CHECK("point scale ARGB8888 -> RGB565", check_scale_sizes(SCALER_FMT_ARGB8888, SCALER_FMT_RGB565));
+   CHECK("point scale ARGB8888 -> ARGB8888", check_scale_sizes(SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888));
+   CHECK("point scale 0RGB1555 -> RGB565", check_scale_sizes(SCALER_FMT_0RGB1555, SCALER_FMT_RGB565));
+
+   CHECK("16-bit fb, 3 buffers, vsync",
+         check_driver(16, false, 3, true, 160, 120, 1000, 0, 0, 320, 240));
+   CHECK("16-bit fb, 3 buffers, no vsync",
+         check_driver(16, false, 3, false, 160, 120, 2000, 0, 0, 320, 240));
+   CHECK("32-bit fb, 3 buffers, vsync, letterboxed",
+         check_driver(32, true, 3, true, 160, 144, 1000, 26, 0, 267, 240));
+   CHECK("16-bit fb, XRGB8888 frames, integer scale",
+         check_driver(16, true, 3, true, 100, 80, 1000, 10, 0, 300, 240));
+   CHECK("16-bit fb, single buffer",
+         check_driver(16, false, 1, true, 320, 240, 100, 0, 0, 320, 240));
+
+   slock_free(fake.lock);
+   return bench_test_result();
+}
+
+// Scaling as it was done before the direct path: the whole frame is converted to ARGB8888,
+// point scaled, and converted again.
+static void scale_old(struct scaler_ctx *ctx, uint32_t *in_frame, uint32_t *out_frame,
+      void *output, const void *input)
+{
+   conv_rgb565_argb8888(in_frame, input, ctx->in_width, ctx->in_height,
+         ctx->in_width * 4, ctx->in_stride);
+   scaler_argb8888_point_special(ctx, out_frame, in_frame,
+         ctx->out_width, ctx->out_height, ctx->in_width, ctx->in_height,
+         ctx->out_width * 4, ctx->in_width * 4);
+   conv_argb8888_rgb565(output, out_frame, ctx->out_width, ctx->out_height,
+         ctx->out_stride, ctx->out_width * 4);
+}
+
+static void bench_scale(int in_width, int in_height, int out_width, int out_height)
+{
+   struct scaler_ctx ctx = {0};
+   uint16_t *input  = (uint16_t*)malloc(in_width * in_height * 2);
+   uint16_t *output = (uint16_t*)malloc(out_width * out_height * 2);
+   uint32_t *in_frame  = (uint32_t*)malloc(in_width * in_height * 4);
+   uint32_t *out_frame = (uint32_t*)malloc(out_width * out_height * 4);
+   retro_time_t start, old_time, new_time;
+   int i;
+
+   if (!input || !output || !in_frame || !out_frame)
+      goto end;
+
+   for (i = 0; i < in_width * in_height; i++)
+      input[i] = rng();
+
+   ctx.in_fmt = ctx.out_fmt = SCALER_FMT_RGB565;
+   ctx.scaler_type = SCALER_TYPE_POINT;
+   ctx.in_width = in_width;
+   ctx.in_height = in_height;
+   ctx.in_stride = in_width * 2;
+   ctx.out_width = out_width;
+   ctx.out_height = out_height;
+   ctx.out_stride = out_width * 2;
+   if (!scaler_ctx_gen_filter(&ctx))
+      goto end;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      scale_old(&ctx, in_frame, out_frame, output, input);
+   old_time = rarch_get_time_usec() - start;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      scaler_ctx_scale(&ctx, output, input);
+   new_time = rarch_get_time_usec() - start;
+
+   printf("%4dx%-4d -> %4dx%-4d  converted frame: %7.1f us  direct: %7.1f us\n",
+         in_width, in_height, out_width, out_height,
+         (double)old_time / BENCH_FRAMES, (double)new_time / BENCH_FRAMES);
+
+end:
+   scaler_ctx_gen_reset(&ctx);
+   free(input);
+   free(output);
+   free(in_frame);
+   free(out_frame);
+}
+
+int main(int argc, char *argv[])
+{
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   printf("RGB565 point scaling, %d frames\n", BENCH_FRAMES);
+   bench_scale(320, 240, 640, 480);
+   bench_scale(320, 240, 1280, 960);
+   bench_scale(256, 224, 1066, 800);
+   bench_scale(640, 480, 1920, 1080);
+   return 0;
+}
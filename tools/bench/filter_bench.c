@@ -0,0 +1,277 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// CPU filter test and benchmark, for the built-in filters.
+//
+// filter_bench --test
+//    Checks that threaded output matches single threaded output for every filter and format,
+//    checks scale2x against a plain reference, and that flat frames stay flat.
+// filter_bench [threads]
+//    Times every filter and format on 256x224 frames, single threaded and with the
+//    given number of threads (one per CPU core by default).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "gfx/filter.h"
+#include "performance.h"
+#include "bench_test.h"
+
+struct global g_extern;
+
+#define FRAME_WIDTH 256
+#define FRAME_HEIGHT 224
+#define BENCH_FRAMES 300
+
+static const char *filters[] = { "scale2x", "2xsai", "ntsc" };
+static const enum retro_pixel_format formats[] = { RETRO_PIXEL_FORMAT_RGB565, RETRO_PIXEL_FORMAT_XRGB8888 };
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245u + 12345u;
+   return rng_state >> 8;
+}
+
+static unsigned bpp(enum retro_pixel_format fmt)
+{
+   return fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2;
+}
+
+// Blocky frame with a few colors, so the edge rules of the filters get exercised.
+static void *make_frame(enum retro_pixel_format fmt, unsigned width, unsigned height)
+{
+   static const uint32_t palette[4] = { 0x000000, 0xffffff, 0xf83018, 0x2060f8 };
+   unsigned x, y;
+   uint8_t *frame = (uint8_t*)malloc(width * height * bpp(fmt));
+   if (!frame)
+      return NULL;
+
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint32_t col = palette[rng() % 4];
+         if (x && rng() % 4)
+            col = fmt == RETRO_PIXEL_FORMAT_XRGB8888 ?
+               ((uint32_t*)frame)[y * width + x - 1] : palette[0];
+
+         if (fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+            ((uint32_t*)frame)[y * width + x] = col;
+         else
+            ((uint16_t*)frame)[y * width + x] = ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f);
+      }
+   }
+   return frame;
+}
+
+// Filters a frame into a tightly packed buffer. Returns NULL if the filter could not be created.
+static void *run_filter(const char *ident, unsigned threads, enum retro_pixel_format fmt,
+      const void *frame, unsigned width, unsigned height,
+      unsigned *out_width, unsigned *out_height, unsigned *out_bpp)
+{
+   void *out;
+   rarch_softfilter_t *filt = rarch_softfilter_new(ident, threads, fmt, width, height);
+   if (!filt)
+      return NULL;
+
+   rarch_softfilter_get_output_size(filt, out_width, out_height, width, height);
+   *out_bpp = bpp(rarch_softfilter_get_output_format(filt));
+   out = calloc(*out_width * *out_height, *out_bpp);
+   if (out)
+      rarch_softfilter_process(filt, out, *out_width * *out_bpp,
+            frame, width, height, width * bpp(fmt));
+
+   rarch_softfilter_free(filt);
+   return out;
+}
+
+static bool check_threads(const char *ident, enum retro_pixel_format fmt)
+{
+   unsigned width = 97, height = 61;
+   unsigned w1, h1, b1, w4, h4, b4;
+   void *frame = make_frame(fmt, width, height);
+   void *single = run_filter(ident, 1, fmt, frame, width, height, &w1, &h1, &b1);
+   void *threaded = run_filter(ident, 4, fmt, frame, width, height, &w4, &h4, &b4);
+   bool ok = frame && single && threaded && w1 == w4 && h1 == h4 && b1 == b4 &&
+      memcmp(single, threaded, w1 * h1 * b1) == 0;
+
+   free(frame);
+   free(single);
+   free(threaded);
+   return ok;
+}
+
+static bool check_scale2x(void)
+{
+   unsigned width = 53, height = 37, out_width, out_height, out_bpp, x, y;
+   uint32_t *frame = (uint32_t*)make_frame(RETRO_PIXEL_FORMAT_XRGB8888, width, height);
+   uint32_t *out = (uint32_t*)run_filter("scale2x", 3, RETRO_PIXEL_FORMAT_XRGB8888,
+         frame, width, height, &out_width, &out_height, &out_bpp);
+   bool ok = frame && out && out_width == 2 * width && out_height == 2 * height && out_bpp == 4;
+
+   for (y = 0; ok && y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint32_t B = frame[(y ? y - 1 : y) * width + x];
+         uint32_t D = frame[y * width + (x ? x - 1 : x)];
+         uint32_t E = frame[y * width + x];
+         uint32_t F = frame[y * width + (x + 1 < width ? x + 1 : x)];
+         uint32_t H = frame[(y + 1 < height ? y + 1 : y) * width + x];
+         uint32_t E0 = D == B && B != F && D != H ? D : E;
+         uint32_t E1 = B == F && B != D && F != H ? F : E;
+         uint32_t E2 = D == H && D != B && H != F ? D : E;
+         uint32_t E3 = H == F && D != H && B != F ? F : E;
+         const uint32_t *o = out + 2 * y * out_width + 2 * x;
+
+         ok = ok && o[0] == E0 && o[1] == E1 && o[out_width] == E2 && o[out_width + 1] == E3;
+      }
+   }
+
+   free(frame);
+   free(out);
+   return ok;
+}
+
+static bool check_flat(const char *ident, enum retro_pixel_format fmt, int tolerance)
+{
+   unsigned width = 40, height = 24, out_width, out_height, out_bpp, i, c;
+   unsigned count = width * height;
+   uint32_t col = 0x40a0c0;
+   uint8_t *frame = (uint8_t*)malloc(count * bpp(fmt));
+   uint8_t *out;
+   bool ok;
+
+   if (!frame)
+      return false;
+   for (i = 0; i < count; i++)
+   {
+      if (fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+         ((uint32_t*)frame)[i] = col;
+      else
+         ((uint16_t*)frame)[i] = ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) | ((col >> 3) & 0x001f);
+   }
+
+   out = (uint8_t*)run_filter(ident, 2, fmt, frame, width, height, &out_width, &out_height, &out_bpp);
+   ok = out != NULL;
+
+   for (i = 0; ok && i < out_width * out_height; i++)
+   {
+      uint32_t px = out_bpp == 4 ? ((uint32_t*)out)[i] : ((uint16_t*)out)[i];
+      if (out_bpp == 2)
+      {
+         ok = ok && px == ((uint16_t*)frame)[0];
+         continue;
+      }
+
+      for (c = 0; c < 24; c += 8)
+      {
+         int diff = (int)((px >> c) & 0xff) - (int)((col >> c) & 0xff);
+         // RGB565 input loses the low bits.
+         int tol = tolerance + (fmt == RETRO_PIXEL_FORMAT_RGB565 ? 8 : 0);
+         ok = ok && diff >= -tol && diff <= tol;
+      }
+   }
+
+   free(frame);
+   free(out);
+   return ok;
+}
+
+static int run_test(void)
+{
+   unsigned i, j;
+   char name[64];
+
+   for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+   {
+      for (j = 0; j < 2; j++)
+      {
+         snprintf(name, sizeof(name), "%s %s, threaded", filters[i], bpp(formats[j]) == 4 ? "XRGB8888" : "RGB565");
+         CHECK(name, check_threads(filters[i], formats[j]));
+         snprintf(name, sizeof(name), "%s %s, flat", filters[i], bpp(formats[j]) == 4 ? "XRGB8888" : "RGB565");
+         CHECK(name, check_flat(filters[i], formats[j], 2));
+      }
+   }
+
+   CHECK("scale2x reference", check_scale2x());
+   CHECK("unknown filter", !rarch_softfilter_new("does-not-exist", 1, RETRO_PIXEL_FORMAT_RGB565, 256, 224));
+   CHECK("0RGB1555 is rejected", !rarch_softfilter_new("scale2x", 1, RETRO_PIXEL_FORMAT_0RGB1555, 256, 224));
+
+   return bench_test_result();
+}
+
+static void bench_filter(const char *ident, enum retro_pixel_format fmt, unsigned threads)
+{
+   unsigned i, out_width, out_height, out_bpp;
+   retro_time_t start, total;
+   void *frame = make_frame(fmt, FRAME_WIDTH, FRAME_HEIGHT);
+   rarch_softfilter_t *filt = rarch_softfilter_new(ident, threads, fmt, FRAME_WIDTH, FRAME_HEIGHT);
+   void *out;
+
+   if (!frame || !filt)
+   {
+      free(frame);
+      rarch_softfilter_free(filt);
+      return;
+   }
+
+   rarch_softfilter_get_output_size(filt, &out_width, &out_height, FRAME_WIDTH, FRAME_HEIGHT);
+   out_bpp = bpp(rarch_softfilter_get_output_format(filt));
+   out = malloc(out_width * out_height * out_bpp);
+
+   if (out)
+   {
+      start = rarch_get_time_usec();
+      for (i = 0; i < BENCH_FRAMES; i++)
+         rarch_softfilter_process(filt, out, out_width * out_bpp,
+               frame, FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH * bpp(fmt));
+      total = rarch_get_time_usec() - start;
+
+      printf("%-8s %-8s %2u thread(s): %7.3f ms/frame, %8.1f Mpix/s out\n",
+            ident, bpp(fmt) == 4 ? "XRGB8888" : "RGB565", threads,
+            total / 1000.0 / BENCH_FRAMES,
+            (double)out_width * out_height * BENCH_FRAMES / (total ? total : 1));
+   }
+
+   free(out);
+   free(frame);
+   rarch_softfilter_free(filt);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j, threads;
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   threads = argc > 1 ? strtoul(argv[1], NULL, 0) : rarch_get_cpu_cores();
+   printf("Frame: %ux%u, %u frames\n", FRAME_WIDTH, FRAME_HEIGHT, BENCH_FRAMES);
+
+   for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+   {
+      for (j = 0; j < 2; j++)
+      {
+         bench_filter(filters[i], formats[j], 1);
+         if (threads > 1)
+            bench_filter(filters[i], formats[j], threads);
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,389 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// BSV movie test and benchmark, against a fake core whose state depends on every input.
+//
+// movie_bench --test
+//    Records a movie with rewinds, then checks playback, seeking, index recovery
+//    of an unclosed movie and BSV1 playback.
+// movie_bench [frames]
+//    Times recording, playback and seeking of a long movie.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "movie.h"
+#include "performance.h"
+#include "file_path.h"
+#include "bench_test.h"
+
+struct global g_extern;
+
+#define STATE_WORDS 4096
+#define MOVIE_PATH "movie_bench.bsv"
+#define COPY_PATH "movie_bench_copy.bsv"
+
+static uint32_t core_state[STATE_WORDS];
+
+static size_t core_serialize_size(void)
+{
+   return sizeof(core_state);
+}
+
+static bool core_serialize(void *data, size_t size)
+{
+   memcpy(data, core_state, size);
+   return true;
+}
+
+static bool core_unserialize(const void *data, size_t size)
+{
+   memcpy(core_state, data, size);
+   return true;
+}
+
+size_t (*pretro_serialize_size)(void) = core_serialize_size;
+bool (*pretro_serialize)(void*, size_t) = core_serialize;
+bool (*pretro_unserialize)(const void*, size_t) = core_unserialize;
+
+// How often the fake core polls input this frame.
+static unsigned core_polls(void)
+{
+   return 1 + core_state[0] % 4;
+}
+
+// Mixes an input into the state. Only a few words change per frame, like a real game.
+static void core_apply(int16_t input)
+{
+   uint32_t h = core_state[0] * 2654435761u + (uint16_t)input + 1;
+   core_state[0] = h;
+   core_state[1 + (h >> 7) % (STATE_WORDS - 1)] ^= h;
+   core_state[1 + (h >> 19) % (STATE_WORDS - 1)] += input;
+}
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245u + 12345u;
+   return rng_state >> 8;
+}
+
+struct history
+{
+   uint32_t (*states)[STATE_WORDS]; // State at the start of every frame.
+   unsigned frames;
+};
+
+static void record_frame(bsv_movie_t *movie)
+{
+   unsigned i, polls;
+
+   bsv_movie_set_frame_start(movie);
+   polls = core_polls();
+   for (i = 0; i < polls; i++)
+   {
+      int16_t input = (int16_t)(rng() & 0xfff);
+      bsv_movie_set_input(movie, input);
+      core_apply(input);
+   }
+   bsv_movie_set_frame_end(movie);
+}
+
+// Rewinds one frame, and plays the rewound frame right away, the way the frontend does it.
+static void record_rewind(bsv_movie_t *movie, struct history *hist)
+{
+   bsv_movie_frame_rewind(movie);
+   memcpy(core_state, hist->states[bsv_movie_frame(movie)], sizeof(core_state));
+   record_frame(movie);
+   memcpy(hist->states[bsv_movie_frame(movie)], core_state, sizeof(core_state));
+}
+
+static bool record(const char *path, unsigned frames, bool rewinds, struct history *hist)
+{
+   bsv_movie_t *movie;
+
+   memset(core_state, 0, sizeof(core_state));
+   if (!(movie = bsv_movie_init(path, RARCH_MOVIE_RECORD)))
+      return false;
+
+   while (bsv_movie_frame(movie) < frames)
+   {
+      unsigned frame = bsv_movie_frame(movie);
+      if (hist)
+         memcpy(hist->states[frame], core_state, sizeof(core_state));
+
+      record_frame(movie);
+
+      // Hold rewind for a few frames now and then.
+      if (rewinds && frame > 10 && rng() % 97 == 0)
+      {
+         unsigned n = 1 + rng() % 8;
+         while (n--)
+            record_rewind(movie, hist);
+      }
+   }
+
+   if (hist)
+   {
+      memcpy(hist->states[frames], core_state, sizeof(core_state));
+      hist->frames = frames;
+   }
+   bsv_movie_free(movie);
+   return true;
+}
+
+// Plays from the current position up to frame end, checking every state against the history.
+static bool play(bsv_movie_t *movie, unsigned end, const struct history *hist)
+{
+   unsigned i;
+   while (bsv_movie_frame(movie) < end)
+   {
+      unsigned frame = bsv_movie_frame(movie);
+      if (hist && memcmp(core_state, hist->states[frame], sizeof(core_state)))
+      {
+         fprintf(stderr, "State mismatch at frame %u.\n", frame);
+         return false;
+      }
+
+      bsv_movie_set_frame_start(movie);
+      unsigned polls = core_polls();
+      for (i = 0; i < polls; i++)
+      {
+         int16_t input;
+         if (!bsv_movie_get_input(movie, &input))
+         {
+            fprintf(stderr, "Movie ended early at frame %u.\n", frame);
+            return false;
+         }
+         core_apply(input);
+      }
+      bsv_movie_set_frame_end(movie);
+   }
+   return !hist || memcmp(core_state, hist->states[end], sizeof(core_state)) == 0;
+}
+
+static bool check_playback(const char *path, const struct history *hist)
+{
+   int16_t input;
+   memset(core_state, 0xaa, sizeof(core_state));
+
+   bsv_movie_t *movie = bsv_movie_init(path, RARCH_MOVIE_PLAYBACK);
+   if (!movie || bsv_movie_frame_count(movie) != hist->frames || !play(movie, hist->frames, hist))
+      return false;
+
+   bsv_movie_set_frame_start(movie);
+   bool ended = !bsv_movie_get_input(movie, &input);
+   bsv_movie_free(movie);
+   return ended;
+}
+
+static bool check_seek(const char *path, const struct history *hist)
+{
+   unsigned i;
+   bsv_movie_t *movie = bsv_movie_init(path, RARCH_MOVIE_PLAYBACK);
+   if (!movie)
+      return false;
+
+   for (i = 0; i < 50; i++)
+   {
+      unsigned keyframe = 0;
+      unsigned target = rng() % hist->frames;
+
+      if (!bsv_movie_seek(movie, target, &keyframe) ||
+            keyframe > target || target - keyframe >= BSV2_KEYFRAME_INTERVAL ||
+            memcmp(core_state, hist->states[keyframe], sizeof(core_state)) ||
+            !play(movie, target, hist))
+      {
+         fprintf(stderr, "Seek to frame %u failed.\n", target);
+         bsv_movie_free(movie);
+         return false;
+      }
+   }
+
+   bsv_movie_free(movie);
+   return true;
+}
+
+static bool copy_without_index(const char *src, const char *dst)
+{
+   void *buf = NULL;
+   ssize_t size = read_file(src, &buf);
+   if (size < 24)
+      return false;
+
+   // Clear the index offset and cut the index off, as if recording crashed.
+   uint64_t index_offset = 0;
+   memcpy(&index_offset, (uint8_t*)buf + 16, sizeof(index_offset));
+   memset((uint8_t*)buf + 16, 0, 8);
+   bool ret = write_file(dst, buf, (size_t)index_offset);
+   free(buf);
+   return ret;
+}
+
+// Rewinds far back into what was already written, then reads the movie as if recording crashed there.
+// Records past the cut must be gone from the file.
+static bool check_cut_recovery(struct history *hist)
+{
+   void *buf = NULL;
+   ssize_t size;
+   unsigned cut;
+   bsv_movie_t *movie;
+
+   memset(core_state, 0, sizeof(core_state));
+   if (!(movie = bsv_movie_init(MOVIE_PATH, RARCH_MOVIE_RECORD)))
+      return false;
+
+   while (bsv_movie_frame(movie) < 3000)
+   {
+      memcpy(hist->states[bsv_movie_frame(movie)], core_state, sizeof(core_state));
+      record_frame(movie);
+   }
+   while (bsv_movie_frame(movie) > 1000)
+      record_rewind(movie, hist);
+   cut = bsv_movie_frame(movie);
+
+   size = read_file(MOVIE_PATH, &buf);
+   bool ret = size > 0 && write_file(COPY_PATH, buf, size);
+   free(buf);
+   bsv_movie_free(movie);
+   if (!ret)
+      return false;
+
+   memset(core_state, 0xaa, sizeof(core_state));
+   movie = bsv_movie_init(COPY_PATH, RARCH_MOVIE_PLAYBACK);
+   ret = movie && bsv_movie_frame_count(movie) <= cut &&
+      play(movie, bsv_movie_frame_count(movie), hist);
+   if (movie)
+      bsv_movie_free(movie);
+   return ret;
+}
+
+static bool check_bsv1(void)
+{
+   unsigned frame, i;
+   uint32_t start[STATE_WORDS];
+   FILE *file = fopen(COPY_PATH, "wb");
+   if (!file)
+      return false;
+
+   uint32_t header[4] = { swap_if_little32(BSV_MAGIC), 0, swap_if_big32(g_extern.cart_crc),
+      swap_if_big32(sizeof(core_state)) };
+   for (i = 0; i < STATE_WORDS; i++)
+      core_state[i] = rng();
+   memcpy(start, core_state, sizeof(start));
+   fwrite(header, sizeof(header), 1, file);
+   fwrite(core_state, sizeof(core_state), 1, file);
+
+   for (frame = 0; frame < 1000; frame++)
+   {
+      unsigned polls = core_polls();
+      for (i = 0; i < polls; i++)
+      {
+         int16_t input = swap_if_big16((int16_t)(rng() & 0xfff));
+         fwrite(&input, sizeof(input), 1, file);
+         core_apply(swap_if_big16(input));
+      }
+   }
+   fclose(file);
+
+   uint32_t expected[STATE_WORDS];
+   memcpy(expected, core_state, sizeof(expected));
+   memset(core_state, 0, sizeof(core_state));
+
+   bsv_movie_t *movie = bsv_movie_init(COPY_PATH, RARCH_MOVIE_PLAYBACK);
+   if (!movie || memcmp(core_state, start, sizeof(start)))
+      return false;
+   for (frame = 0; frame < 1000; frame++)
+   {
+      bsv_movie_set_frame_start(movie);
+      unsigned polls = core_polls();
+      for (i = 0; i < polls; i++)
+      {
+         int16_t input;
+         if (!bsv_movie_get_input(movie, &input))
+            return false;
+         core_apply(input);
+      }
+      bsv_movie_set_frame_end(movie);
+   }
+   bsv_movie_free(movie);
+   return memcmp(core_state, expected, sizeof(expected)) == 0;
+}
+
+static int run_test(void)
+{
+   unsigned frames = 5000;
+   struct history hist = {0};
+
+   hist.states = (uint32_t (*)[STATE_WORDS])malloc((frames + 1) * sizeof(*hist.states));
+   if (!hist.states)
+      return 1;
+
+   CHECK("record with rewinds", record(MOVIE_PATH, frames, true, &hist));
+   CHECK("playback", check_playback(MOVIE_PATH, &hist));
+   CHECK("seek", check_seek(MOVIE_PATH, &hist));
+   CHECK("index recovery", copy_without_index(MOVIE_PATH, COPY_PATH) && check_playback(COPY_PATH, &hist));
+   CHECK("index recovery after cutting into the file", check_cut_recovery(&hist));
+   CHECK("BSV1 playback", check_bsv1());
+
+   remove(MOVIE_PATH);
+   remove(COPY_PATH);
+   free(hist.states);
+   return bench_test_result();
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, frames = 60 * 60 * 60;
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+   if (argc > 1)
+      frames = strtoul(argv[1], NULL, 0);
+
+   retro_time_t start = rarch_get_time_usec();
+   if (!record(MOVIE_PATH, frames, false, NULL))
+      return 1;
+   retro_time_t recorded = rarch_get_time_usec();
+
+   void *buf = NULL;
+   ssize_t size = read_file(MOVIE_PATH, &buf);
+   free(buf);
+
+   bsv_movie_t *movie = bsv_movie_init(MOVIE_PATH, RARCH_MOVIE_PLAYBACK);
+   if (!movie || !play(movie, frames, NULL))
+      return 1;
+   retro_time_t played = rarch_get_time_usec();
+
+   for (i = 0; i < 100; i++)
+   {
+      unsigned keyframe;
+      if (!bsv_movie_seek(movie, rng() % frames, &keyframe))
+         return 1;
+   }
+   retro_time_t seeked = rarch_get_time_usec();
+   bsv_movie_free(movie);
+
+   printf("Frames:   %u (%.1f minutes at 60 fps)\n", frames, frames / 3600.0);
+   printf("Size:     %.2f MiB (%u keyframes of %u bytes)\n", size / (1024.0 * 1024.0),
+         (frames + BSV2_KEYFRAME_INTERVAL - 1) / BSV2_KEYFRAME_INTERVAL, (unsigned)sizeof(core_state));
+   printf("Record:   %.1f ms\n", (recorded - start) / 1000.0);
+   printf("Playback: %.1f ms\n", (played - recorded) / 1000.0);
+   printf("Seek:     %.3f ms avg\n", (seeked - played) / 100000.0);
+
+   remove(MOVIE_PATH);
+   return 0;
+}
@@ -0,0 +1,391 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Software overlay compositor test and benchmark.
+//
+// overlay_bench --test
+//    Checks blending into RGB565 and XRGB8888 against a per-pixel reference,
+//    filtering, placement and clipping.
+// overlay_bench
+//    Times compositing a mostly transparent full screen overlay, as gamepad overlays are,
+//    against blending every pixel of it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "driver.h"
+#include "gfx/soft_overlay.h"
+#include "performance.h"
+#include "bench_test.h"
+
+#define BENCH_FRAMES 200
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245 + 12345;
+   return rng_state >> 16;
+}
+
+// Random colors, with runs of transparent, opaque and translucent texels.
+static uint32_t *make_image(unsigned width, unsigned height)
+{
+   unsigned i, run = 0, alpha = 0;
+   uint32_t *pixels = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+   if (!pixels)
+      return NULL;
+
+   for (i = 0; i < width * height; i++)
+   {
+      if (!run--)
+      {
+         run = rng() % 23;
+         switch (rng() % 3)
+         {
+            case 0: alpha = 0; break;
+            case 1: alpha = 255; break;
+            default: alpha = 1 + rng() % 254; break;
+         }
+      }
+      pixels[i] = (alpha << 24) | ((rng() << 8) & 0xffffff) | (rng() & 0xff);
+   }
+   return pixels;
+}
+
+static void *make_buffer(unsigned bpp, unsigned width, unsigned height)
+{
+   unsigned i;
+   uint8_t *buffer = (uint8_t*)malloc(width * height * bpp);
+   if (!buffer)
+      return NULL;
+
+   for (i = 0; i < width * height * bpp; i++)
+      buffer[i] = rng();
+   if (bpp == 4) // X is always set by the drivers.
+      for (i = 0; i < width * height; i++)
+         ((uint32_t*)buffer)[i] |= 0xffu << 24;
+   return buffer;
+}
+
+// The compositor's blend of one unscaled texel: premultiplied, modulated, then added.
+static void reference_blend(void *pixel, unsigned bpp, uint32_t col, unsigned mod)
+{
+   unsigned a = col >> 24;
+   unsigned m = a + (a >> 7);
+   unsigned s[3], d[3], c, k;
+
+   s[0] = (((col >> 16) & 0xff) * m) >> 8;
+   s[1] = (((col >>  8) & 0xff) * m) >> 8;
+   s[2] = (((col >>  0) & 0xff) * m) >> 8;
+
+   if (!a)
+      return;
+
+   if (bpp == 2)
+   {
+      unsigned p = *(uint16_t*)pixel;
+      d[0] = (((p >> 11) & 0x1f) << 3) | (((p >> 11) & 0x1f) >> 2);
+      d[1] = (((p >>  5) & 0x3f) << 2) | (((p >>  5) & 0x3f) >> 4);
+      d[2] = (((p >>  0) & 0x1f) << 3) | (((p >>  0) & 0x1f) >> 2);
+   }
+   else
+   {
+      uint32_t p = *(uint32_t*)pixel;
+      d[0] = (p >> 16) & 0xff;
+      d[1] = (p >>  8) & 0xff;
+      d[2] = (p >>  0) & 0xff;
+   }
+
+   if (mod < 256)
+   {
+      a = (a * mod) >> 8;
+      for (c = 0; c < 3; c++)
+         s[c] = (s[c] * mod) >> 8;
+   }
+
+   k = 256 - (a + (a >> 7));
+   for (c = 0; c < 3; c++)
+   {
+      s[c] += (d[c] * k) >> 8;
+      if (s[c] > 255)
+         s[c] = 255;
+   }
+
+   if (bpp == 2)
+      *(uint16_t*)pixel = ((s[0] >> 3) << 11) | ((s[1] >> 2) << 5) | (s[2] >> 3);
+   else
+      *(uint32_t*)pixel = (0xffu << 24) | (s[0] << 16) | (s[1] << 8) | s[2];
+}
+
+// Blends an image drawn at its own size at (x, y), clipped to the clip rectangle.
+static void reference_render(void *buffer, unsigned bpp, unsigned width,
+      const uint32_t *image, unsigned image_width, unsigned image_height, int x, int y,
+      int clip_x0, int clip_y0, int clip_x1, int clip_y1, unsigned mod)
+{
+   int i, j;
+   for (j = 0; j < (int)image_height; j++)
+   {
+      for (i = 0; i < (int)image_width; i++)
+      {
+         if (x + i < clip_x0 || x + i >= clip_x1 || y + j < clip_y0 || y + j >= clip_y1)
+            continue;
+         reference_blend((uint8_t*)buffer + ((y + j) * width + x + i) * bpp, bpp,
+               image[j * image_width + i], mod);
+      }
+   }
+}
+
+static soft_overlay_t *load_overlay(const uint32_t *pixels, unsigned width, unsigned height)
+{
+   struct texture_image image;
+   soft_overlay_t *ov = soft_overlay_new();
+   if (!ov)
+      return NULL;
+
+   image.width = width;
+   image.height = height;
+   image.pixels = (uint32_t*)pixels;
+   if (!soft_overlay_load(ov, &image, 1))
+   {
+      soft_overlay_free(ov);
+      return NULL;
+   }
+   soft_overlay_enable(ov, true);
+   return ov;
+}
+
+// An image at its own size over the whole buffer, which SIMD paths see with odd widths and offsets.
+static bool check_blend(unsigned bpp, float alpha)
+{
+   unsigned width = 37, height = 19;
+   uint32_t *image = make_image(width, height);
+   void *buffer = make_buffer(bpp, width, height);
+   void *expected = malloc(width * height * bpp);
+   soft_overlay_t *ov = image ? load_overlay(image, width, height) : NULL;
+   bool ok = image && buffer && expected && ov;
+
+   if (ok)
+   {
+      memcpy(expected, buffer, width * height * bpp);
+      reference_render(expected, bpp, width, image, width, height, 0, 0, 0, 0, width, height,
+            alpha >= 1.0f ? 256 : (unsigned)(alpha * 256.0f));
+
+      soft_overlay_set_alpha(ov, 0, alpha);
+      ok = !soft_overlay_render(ov, buffer, width * bpp, bpp, width, height, NULL) &&
+         memcmp(buffer, expected, width * height * bpp) == 0;
+
+      // The second frame uses the image as scaled for the first.
+      memcpy(buffer, expected, width * height * bpp);
+      reference_render(expected, bpp, width, image, width, height, 0, 0, 0, 0, width, height,
+            alpha >= 1.0f ? 256 : (unsigned)(alpha * 256.0f));
+      ok = ok && !soft_overlay_render(ov, buffer, width * bpp, bpp, width, height, NULL) &&
+         memcmp(buffer, expected, width * height * bpp) == 0;
+   }
+
+   soft_overlay_free(ov);
+   free(image);
+   free(buffer);
+   free(expected);
+   return ok;
+}
+
+// Half an image hanging off the left of the buffer, and below it.
+static bool check_clipping(unsigned bpp)
+{
+   unsigned width = 64, height = 64;
+   uint32_t *image = make_image(32, 64);
+   void *buffer = make_buffer(bpp, width, height);
+   void *expected = malloc(width * height * bpp);
+   soft_overlay_t *ov = image ? load_overlay(image, 32, 64) : NULL;
+   bool ok = image && buffer && expected && ov;
+
+   if (ok)
+   {
+      memcpy(expected, buffer, width * height * bpp);
+      reference_render(expected, bpp, width, image, 32, 64, -16, 32, 0, 0, width, height, 256);
+
+      soft_overlay_vertex_geom(ov, 0, -0.25f, 0.5f, 0.5f, 1.0f);
+      ok = !soft_overlay_render(ov, buffer, width * bpp, bpp, width, height, NULL) &&
+         memcmp(buffer, expected, width * height * bpp) == 0;
+   }
+
+   soft_overlay_free(ov);
+   free(image);
+   free(buffer);
+   free(expected);
+   return ok;
+}
+
+// Overlays fit the viewport, unless they are full screen.
+static bool check_viewport(bool full_screen)
+{
+   unsigned width = 80, height = 60;
+   struct rarch_viewport vp = {0};
+   unsigned image_width = full_screen ? width : 64, image_height = full_screen ? height : 48;
+   uint32_t *image = make_image(image_width, image_height);
+   uint32_t *buffer = (uint32_t*)make_buffer(4, width, height);
+   uint32_t *expected = (uint32_t*)malloc(width * height * 4);
+   soft_overlay_t *ov = NULL;
+   unsigned i;
+   bool ok;
+
+   vp.x = 8;
+   vp.y = 6;
+   vp.width = 64;
+   vp.height = 48;
+
+   if (image)
+   {
+      // Something to draw on every border.
+      for (i = 0; i < image_width; i++)
+         image[i] = image[(image_height - 1) * image_width + i] = 0x80ffffff;
+      for (i = 0; i < image_height; i++)
+         image[i * image_width] = image[i * image_width + image_width - 1] = 0x80ffffff;
+      ov = load_overlay(image, image_width, image_height);
+   }
+   ok = image && buffer && expected && ov;
+
+   if (ok)
+   {
+      memcpy(expected, buffer, width * height * 4);
+      if (full_screen)
+         reference_render(expected, 4, width, image, image_width, image_height, 0, 0, 0, 0, width, height, 256);
+      else
+         reference_render(expected, 4, width, image, image_width, image_height, vp.x, vp.y,
+               vp.x, vp.y, vp.x + vp.width, vp.y + vp.height, 256);
+
+      soft_overlay_full_screen(ov, full_screen);
+      ok = soft_overlay_render(ov, buffer, width * 4, 4, width, height, &vp) == full_screen &&
+         memcmp(buffer, expected, width * height * 4) == 0;
+   }
+
+   soft_overlay_free(ov);
+   free(image);
+   free(buffer);
+   free(expected);
+   return ok;
+}
+
+// Filtering between an opaque white and black texel, and transparent images drawing nothing.
+static bool check_filtering(void)
+{
+   uint32_t texels[2] = { 0xffffffff, 0xff000000 };
+   uint32_t clear[2] = { 0x00ffffff, 0x00ffffff };
+   uint32_t expected[4] = { 0xffffffff, 0xffbfbfbf, 0xff3f3f3f, 0xff000000 };
+   uint32_t buffer[4] = {0};
+   soft_overlay_t *ov = load_overlay(texels, 2, 1);
+   bool ok = ov != NULL;
+
+   ok = ok && !soft_overlay_render(ov, buffer, sizeof(buffer), 4, 4, 1, NULL) &&
+      memcmp(buffer, expected, sizeof(buffer)) == 0;
+   soft_overlay_free(ov);
+
+   memset(buffer, 0x55, sizeof(buffer));
+   ov = load_overlay(clear, 2, 1);
+   ok = ok && ov && !soft_overlay_render(ov, buffer, sizeof(buffer), 4, 4, 1, NULL) &&
+      buffer[0] == 0x55555555 && buffer[3] == 0x55555555;
+
+   // Disabled.
+   if (ov)
+   {
+      soft_overlay_enable(ov, false);
+      ok = ok && !soft_overlay_enabled(ov);
+   }
+   soft_overlay_free(ov);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   CHECK("blend XRGB8888", check_blend(4, 1.0f));
+   CHECK("blend XRGB8888, alpha 0.5", check_blend(4, 0.5f));
+   CHECK("blend RGB565", check_blend(2, 1.0f));
+   CHECK("blend RGB565, alpha 0.3", check_blend(2, 0.3f));
+   CHECK("clipping XRGB8888", check_clipping(4));
+   CHECK("clipping RGB565", check_clipping(2));
+   CHECK("viewport", check_viewport(false));
+   CHECK("full screen", check_viewport(true));
+   CHECK("filtering", check_filtering());
+
+   return bench_test_result();
+}
+
+static void bench_render(unsigned bpp, unsigned width, unsigned height, float alpha)
+{
+   uint32_t *texels = (uint32_t*)malloc(256 * 256 * 4);
+   void *buffer = make_buffer(bpp, width, height);
+   soft_overlay_t *ov = NULL;
+   uint32_t *scaled = NULL;
+   retro_time_t start, time, ref_time;
+   unsigned i;
+
+   if (!texels || !buffer)
+      goto end;
+
+   // Mostly transparent: buttons in the bottom corners.
+   for (i = 0; i < 256 * 256; i++)
+   {
+      unsigned x = i % 256, y = i / 256;
+      texels[i] = y > 160 && (x < 64 || x > 192) ? (y > 200 ? 0xffffffff : 0x80ffffff) : 0;
+   }
+
+   ov = load_overlay(texels, 256, 256);
+   if (!ov)
+      goto end;
+   soft_overlay_set_alpha(ov, 0, alpha);
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      soft_overlay_render(ov, buffer, width * bpp, bpp, width, height, NULL);
+   time = rarch_get_time_usec() - start;
+
+   // Every pixel of the overlay blended, as it was done per driver.
+   scaled = (uint32_t*)malloc(width * height * 4);
+   if (!scaled)
+      goto end;
+   for (i = 0; i < width * height; i++)
+      scaled[i] = texels[(i / width * 256 / height) * 256 + (i % width) * 256 / width];
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      reference_render(buffer, bpp, width, scaled, width, height, 0, 0, 0, 0, width, height,
+            alpha >= 1.0f ? 256 : (unsigned)(alpha * 256.0f));
+   ref_time = rarch_get_time_usec() - start;
+
+   printf("%s %ux%u, alpha %.1f: %7.1f us/frame, every pixel: %7.1f us/frame\n",
+         bpp == 2 ? "RGB565  " : "XRGB8888", width, height, alpha,
+         (double)time / BENCH_FRAMES, (double)ref_time / BENCH_FRAMES);
+
+end:
+   soft_overlay_free(ov);
+   free(scaled);
+   free(texels);
+   free(buffer);
+}
+
+int main(int argc, char *argv[])
+{
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   bench_render(4, 640, 480, 1.0f);
+   bench_render(4, 640, 480, 0.5f);
+   bench_render(2, 640, 480, 1.0f);
+   bench_render(4, 1280, 960, 1.0f);
+   bench_render(2, 1280, 960, 1.0f);
+   return 0;
+}
@@ -0,0 +1,508 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Soft-patching test corpus and benchmark.
+//
+// patch_bench --test
+//    Generates random source/target pairs, encodes them as BPS, UPS and IPS,
+//    and checks that patching reproduces the target and rejects corrupted patches.
+// patch_bench [size in MiB]
+//    Compares time and peak memory of the buffered path (read source and patch,
+//    4x target buffer) against patch_apply_file(). Each run is done in its own process.
+//    Peak RSS includes the page cache of mapped files, peak heap does not.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "patch.h"
+#include "hash.h"
+#include "file_path.h"
+#include "performance.h"
+
+struct buffer
+{
+   uint8_t *data;
+   size_t size, cap;
+};
+
+static void put(struct buffer *buf, uint8_t c)
+{
+   if (buf->size == buf->cap)
+   {
+      buf->cap = buf->cap ? buf->cap * 2 : 256;
+      buf->data = (uint8_t*)realloc(buf->data, buf->cap);
+   }
+   buf->data[buf->size++] = c;
+}
+
+static void put_data(struct buffer *buf, const void *data, size_t size)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      put(buf, ((const uint8_t*)data)[i]);
+}
+
+static void put32le(struct buffer *buf, uint32_t val)
+{
+   put(buf, val >> 0);
+   put(buf, val >> 8);
+   put(buf, val >> 16);
+   put(buf, val >> 24);
+}
+
+static void put_number(struct buffer *buf, uint64_t data)
+{
+   for (;;)
+   {
+      uint8_t x = data & 0x7f;
+      data >>= 7;
+      if (!data)
+      {
+         put(buf, 0x80 | x);
+         break;
+      }
+      put(buf, x);
+      data--;
+   }
+}
+
+static void put_footer(struct buffer *buf, const uint8_t *src, size_t src_size,
+      const uint8_t *dst, size_t dst_size)
+{
+   put32le(buf, crc32_calculate(src, src_size));
+   put32le(buf, crc32_calculate(dst, dst_size));
+   put32le(buf, crc32_calculate(buf->data, buf->size));
+}
+
+static void bps_command(struct buffer *buf, unsigned mode, size_t length)
+{
+   put_number(buf, ((uint64_t)(length - 1) << 2) | mode);
+}
+
+static void bps_offset(struct buffer *buf, size_t *rel, size_t offset)
+{
+   if (offset >= *rel)
+      put_number(buf, (uint64_t)(offset - *rel) << 1);
+   else
+      put_number(buf, ((uint64_t)(*rel - offset) << 1) | 1);
+   *rel = offset;
+}
+
+// Uses all four BPS commands: SourceRead for unchanged bytes, TargetCopy for
+// byte runs, SourceCopy for data moved by one block, TargetRead for the rest.
+static void encode_bps(struct buffer *buf, const uint8_t *src, size_t src_size,
+      const uint8_t *dst, size_t dst_size)
+{
+   size_t i = 0, source_rel = 0, target_rel = 0;
+
+   put_data(buf, "BPS1", 4);
+   put_number(buf, src_size);
+   put_number(buf, dst_size);
+   put_number(buf, 0);
+
+   while (i < dst_size)
+   {
+      size_t len = 0;
+
+      while (i + len < dst_size && i + len < src_size && src[i + len] == dst[i + len])
+         len++;
+      if (len)
+      {
+         bps_command(buf, 0, len);
+         i += len;
+         continue;
+      }
+
+      while (i > 0 && i + len < dst_size && dst[i + len] == dst[i - 1])
+         len++;
+      if (len >= 4)
+      {
+         bps_command(buf, 3, len);
+         bps_offset(buf, &target_rel, i - 1);
+         target_rel += len;
+         i += len;
+         continue;
+      }
+
+      len = 0;
+      while (i >= 64 && i - 64 + len < src_size && i + len < dst_size &&
+            src[i - 64 + len] == dst[i + len])
+         len++;
+      if (len >= 8)
+      {
+         bps_command(buf, 2, len);
+         bps_offset(buf, &source_rel, i - 64);
+         source_rel += len;
+         i += len;
+         continue;
+      }
+
+      len = 1;
+      while (i + len < dst_size && (i + len >= src_size || src[i + len] != dst[i + len]))
+         len++;
+      bps_command(buf, 1, len);
+      put_data(buf, dst + i, len);
+      i += len;
+   }
+
+   put_footer(buf, src, src_size, dst, dst_size);
+}
+
+static void encode_ups(struct buffer *buf, const uint8_t *src, size_t src_size,
+      const uint8_t *dst, size_t dst_size)
+{
+   size_t i, relative = 0;
+   size_t max = src_size > dst_size ? src_size : dst_size;
+
+   put_data(buf, "UPS1", 4);
+   put_number(buf, src_size);
+   put_number(buf, dst_size);
+
+   for (i = 0; i < max; i++)
+   {
+      uint8_t x = (i < src_size ? src[i] : 0) ^ (i < dst_size ? dst[i] : 0);
+      if (!x)
+         continue;
+
+      put_number(buf, i - relative);
+      while (i < max && x)
+      {
+         put(buf, x);
+         i++;
+         x = (i < src_size ? src[i] : 0) ^ (i < dst_size ? dst[i] : 0);
+      }
+      put(buf, 0);
+      relative = i + 1;
+   }
+
+   put_footer(buf, src, src_size, dst, dst_size);
+}
+
+static void encode_ips(struct buffer *buf, const uint8_t *src, size_t src_size,
+      const uint8_t *dst, size_t dst_size)
+{
+   size_t i = 0;
+   put_data(buf, "PATCH", 5);
+
+   while (i < dst_size)
+   {
+      size_t len = 0;
+      if (i < src_size && src[i] == dst[i])
+      {
+         i++;
+         continue;
+      }
+
+      while (i + len < dst_size && len < 0xffff && dst[i + len] == dst[i])
+         len++;
+
+      put(buf, i >> 16);
+      put(buf, i >> 8);
+      put(buf, i >> 0);
+      if (len >= 8) // RLE
+      {
+         put(buf, 0);
+         put(buf, 0);
+         put(buf, len >> 8);
+         put(buf, len >> 0);
+         put(buf, dst[i]);
+      }
+      else
+      {
+         len = 0;
+         while (i + len < dst_size && len < 0xffff && (i + len >= src_size || src[i + len] != dst[i + len]))
+            len++;
+         put(buf, len >> 8);
+         put(buf, len >> 0);
+         put_data(buf, dst + i, len);
+      }
+      i += len;
+   }
+
+   put_data(buf, "EOF", 3);
+   if (dst_size < src_size)
+   {
+      put(buf, dst_size >> 16);
+      put(buf, dst_size >> 8);
+      put(buf, dst_size >> 0);
+   }
+}
+
+typedef void (*encode_func_t)(struct buffer*, const uint8_t*, size_t, const uint8_t*, size_t);
+
+static const struct
+{
+   const char *ident;
+   enum patch_type type;
+   patch_func_t apply;
+   encode_func_t encode;
+} formats[] = {
+   { "BPS", PATCH_TYPE_BPS, bps_apply_patch, encode_bps },
+   { "UPS", PATCH_TYPE_UPS, ups_apply_patch, encode_ups },
+   { "IPS", PATCH_TYPE_IPS, ips_apply_patch, encode_ips },
+};
+
+#define FORMATS (sizeof(formats) / sizeof(formats[0]))
+
+static void make_target(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size, unsigned edits)
+{
+   unsigned i;
+   size_t j;
+
+   for (j = 0; j < dst_size; j++)
+      dst[j] = j < src_size ? src[j] : rand();
+
+   for (i = 0; i < edits; i++)
+   {
+      size_t pos = rand() % dst_size;
+      size_t len = 1 + rand() % 300;
+      unsigned kind = rand() % 3;
+      if (pos + len > dst_size)
+         len = dst_size - pos;
+
+      for (j = 0; j < len; j++)
+      {
+         if (kind == 0)
+            dst[pos + j] = rand();
+         else if (kind == 1)
+            dst[pos + j] = 0xaa;
+         else if (pos + j >= 64)
+            dst[pos + j] = src[(pos + j - 64) % src_size];
+      }
+   }
+}
+
+static bool write_buffer(const char *path, const uint8_t *data, size_t size)
+{
+   return write_file(path, data, size);
+}
+
+static int run_tests(void)
+{
+   unsigned i, f;
+   unsigned failed = 0, passed = 0;
+   char src_path[] = "/tmp/patch_test_src";
+   char patch_path[] = "/tmp/patch_test_patch";
+
+   for (i = 0; i < 300; i++)
+   {
+      size_t src_size = 1 + rand() % 20000;
+      size_t dst_size = i % 3 == 0 ? src_size : 1 + rand() % 20000;
+      uint8_t *src = (uint8_t*)malloc(src_size);
+      uint8_t *dst = (uint8_t*)malloc(dst_size);
+      size_t j;
+
+      for (j = 0; j < src_size; j++)
+         src[j] = rand();
+      make_target(src, src_size, dst, dst_size, 1 + rand() % 40);
+      write_buffer(src_path, src, src_size);
+
+      for (f = 0; f < FORMATS; f++)
+      {
+         struct buffer patch = {0};
+         uint8_t *out = NULL;
+         size_t out_size = 0;
+         patch_error_t err;
+
+         formats[f].encode(&patch, src, src_size, dst, dst_size);
+         write_buffer(patch_path, patch.data, patch.size);
+
+         err = patch_apply_file(formats[f].type, patch_path, src_path, &out, &out_size);
+         if (err != PATCH_SUCCESS || out_size != dst_size || memcmp(out, dst, dst_size))
+         {
+            fprintf(stderr, "[%s] case %u: patch failed (error %u).\n", formats[f].ident, i, (unsigned)err);
+            failed++;
+         }
+         else
+            passed++;
+         free(out);
+
+         // UPS also applies in reverse.
+         if (formats[f].type == PATCH_TYPE_UPS)
+         {
+            size_t size = src_size;
+            uint8_t *rev = (uint8_t*)malloc(src_size);
+            err = ups_apply_patch(patch.data, patch.size, dst, dst_size, rev, &size);
+            if (err != PATCH_SUCCESS || size != src_size || memcmp(rev, src, src_size))
+            {
+               fprintf(stderr, "[UPS] case %u: reverse patch failed (error %u).\n", i, (unsigned)err);
+               failed++;
+            }
+            else
+               passed++;
+            free(rev);
+         }
+
+         // Corrupted patches must be rejected by BPS and UPS checksums,
+         // and must never write out of bounds for any format.
+         if (patch.size > 16)
+         {
+            patch.data[rand() % (patch.size - 12)] ^= 1 + rand() % 255;
+            write_buffer(patch_path, patch.data, patch.size);
+            err = patch_apply_file(formats[f].type, patch_path, src_path, &out, &out_size);
+            if (err == PATCH_SUCCESS && formats[f].type != PATCH_TYPE_IPS)
+            {
+               fprintf(stderr, "[%s] case %u: corrupted patch accepted.\n", formats[f].ident, i);
+               failed++;
+            }
+            else
+               passed++;
+            free(out);
+         }
+
+         free(patch.data);
+      }
+
+      free(src);
+      free(dst);
+   }
+
+   unlink(src_path);
+   unlink(patch_path);
+   printf("%u passed, %u failed.\n", passed, failed);
+   return failed ? 1 : 0;
+}
+
+// Anonymous (heap) resident memory in KiB. Mapped file pages are page cache
+// and can be dropped by the kernel at any time, so they are reported separately.
+static long rss_anon_kib(void)
+{
+   char line[256];
+   long kib = -1;
+   FILE *file = fopen("/proc/self/status", "r");
+   if (!file)
+      return -1;
+
+   while (fgets(line, sizeof(line), file))
+      if (sscanf(line, "RssAnon: %ld", &kib) == 1)
+         break;
+
+   fclose(file);
+   return kib;
+}
+
+static long peak_anon;
+
+// The path used before patch_apply_file(): whole source and patch in memory and a 4x target buffer.
+static patch_error_t apply_buffered(unsigned f, const char *patch_path, const char *src_path,
+      uint8_t **out, size_t *out_size)
+{
+   void *patch = NULL, *src = NULL;
+   long patch_size = read_file(patch_path, &patch);
+   long src_size = read_file(src_path, &src);
+   patch_error_t err;
+
+   *out_size = src_size * 4;
+   *out = (uint8_t*)malloc(*out_size);
+   err = formats[f].apply((const uint8_t*)patch, patch_size, (const uint8_t*)src, src_size, *out, out_size);
+   peak_anon = rss_anon_kib();
+
+   free(src);
+   free(patch);
+   return err;
+}
+
+static void bench_child(unsigned f, bool mapped, const char *patch_path, const char *src_path, uint32_t expected)
+{
+   uint8_t *out = NULL;
+   size_t out_size = 0;
+   struct rusage usage;
+   retro_time_t start = rarch_get_time_usec();
+   patch_error_t err = mapped ?
+      patch_apply_file(formats[f].type, patch_path, src_path, &out, &out_size) :
+      apply_buffered(f, patch_path, src_path, &out, &out_size);
+   retro_time_t total = rarch_get_time_usec() - start;
+
+   if (mapped)
+      peak_anon = rss_anon_kib();
+
+   getrusage(RUSAGE_SELF, &usage);
+   printf("%s %-8s: %8.2f ms, peak heap %7ld KiB, peak RSS %7ld KiB%s\n", formats[f].ident,
+         mapped ? "mapped" : "buffered", total / 1000.0, peak_anon, (long)usage.ru_maxrss,
+         err == PATCH_SUCCESS && crc32_calculate(out, out_size) == expected ? "" : " (FAILED)");
+   free(out);
+}
+
+static int run_bench(size_t size)
+{
+   unsigned f;
+   const char *src_path = "/tmp/patch_bench_src";
+   const char *patch_path = "/tmp/patch_bench_patch";
+
+   for (f = 0; f < FORMATS; f++)
+   {
+      unsigned mapped;
+      uint32_t expected;
+      struct buffer patch = {0};
+      uint8_t *src, *dst;
+      size_t i;
+
+      // IPS offsets are 24-bit.
+      if (formats[f].type == PATCH_TYPE_IPS && size > (1 << 24))
+      {
+         printf("IPS skipped, content is larger than 16 MiB.\n");
+         continue;
+      }
+
+      src = (uint8_t*)malloc(size);
+      dst = (uint8_t*)malloc(size);
+      if (!src || !dst)
+         return 1;
+
+      srand(size);
+      for (i = 0; i < size; i++)
+         src[i] = rand();
+      make_target(src, size, dst, size, size >> 12);
+      expected = crc32_calculate(dst, size);
+
+      formats[f].encode(&patch, src, size, dst, size);
+      write_buffer(src_path, src, size);
+      write_buffer(patch_path, patch.data, patch.size);
+
+      // Nothing of the test data may be resident when forking, it would count towards the child's peak.
+      free(patch.data);
+      free(src);
+      free(dst);
+
+      for (mapped = 0; mapped < 2; mapped++)
+      {
+         pid_t pid;
+         fflush(stdout);
+         pid = fork();
+         if (pid == 0)
+         {
+            bench_child(f, mapped, patch_path, src_path, expected);
+            fflush(stdout);
+            _exit(0);
+         }
+         waitpid(pid, NULL, 0);
+      }
+   }
+
+   unlink(src_path);
+   unlink(patch_path);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc > 1 && strcmp(argv[1], "--test") == 0)
+      return run_tests();
+
+   return run_bench((size_t)(argc > 1 ? strtoul(argv[1], NULL, 0) : 64) << 20);
+}
@@ -0,0 +1,127 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Performance counter test and benchmark.
+// performance.c is pulled in directly so the duration histogram can be checked.
+//
+// perf_bench --test
+//    Checks the histogram buckets and the percentiles reported from them.
+// perf_bench [scopes]
+//    Times nested RARCH_PERFORMANCE_START/STOP scopes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../performance.c"
+#include "bench_test.h"
+
+// Every bucket starts right after the previous one ends, up to the one of the largest tick count.
+static bool check_buckets(void)
+{
+   unsigned bucket, last = perf_hist_bucket(~(retro_perf_tick_t)0);
+
+   for (bucket = 0; bucket < last; bucket++)
+   {
+      uint64_t base = perf_hist_bucket_base(bucket);
+      uint64_t next = perf_hist_bucket_base(bucket + 1);
+      if (next <= base || perf_hist_bucket(base) != bucket || perf_hist_bucket(next - 1) != bucket)
+         return false;
+   }
+   return last < PERF_HIST_BUCKETS && perf_hist_bucket(perf_hist_bucket_base(last)) == last;
+}
+
+static uint64_t percentile_of(const retro_perf_tick_t *durations, unsigned count, unsigned percent)
+{
+   unsigned i;
+   struct perf_stats stats;
+
+   memset(&stats, 0, sizeof(stats));
+   for (i = 0; i < count; i++)
+      perf_stats_add(&stats, durations[i]);
+   return perf_stats_percentile(&stats, percent);
+}
+
+// Short durations fall into buckets of their own, so their percentiles are exact.
+static bool check_small_percentiles(void)
+{
+   retro_perf_tick_t durations[700];
+   unsigned i;
+
+   for (i = 1; i < 8; i++)
+   {
+      retro_perf_tick_t same[10] = { i, i, i, i, i, i, i, i, i, i };
+      if (percentile_of(same, 10, 50) != i || percentile_of(same, 10, 99) != i)
+         return false;
+   }
+
+   // 100 of every duration from 1 to 7.
+   for (i = 0; i < 700; i++)
+      durations[i] = 1 + i % 7;
+   return percentile_of(durations, 700, 50) == 4 && percentile_of(durations, 700, 99) == 7 &&
+      percentile_of(durations, 700, 1) == 1;
+}
+
+// Longer durations are reported as the end of their bucket, at most a quarter too high,
+// and never above the worst case.
+static bool check_large_percentiles(void)
+{
+   retro_perf_tick_t durations[100];
+   unsigned i;
+
+   for (i = 0; i < 100; i++)
+      durations[i] = 1000 + i * 1000;
+
+   uint64_t p50 = percentile_of(durations, 100, 50);
+   uint64_t p99 = percentile_of(durations, 100, 99);
+   uint64_t p100 = percentile_of(durations, 100, 100);
+   return p50 >= 50000 && p50 < 50000 * 5 / 4 &&
+      p99 >= 99000 && p99 <= 100000 && p100 == 100000;
+}
+
+static int run_test(void)
+{
+   CHECK("buckets are contiguous", check_buckets());
+   CHECK("percentiles of 1 to 7 ticks", check_small_percentiles());
+   CHECK("percentiles of long durations", check_large_percentiles());
+
+   return bench_test_result();
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, scopes = 1000000;
+   retro_time_t start, total;
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+   if (argc > 1)
+      scopes = strtoul(argv[1], NULL, 0);
+
+   RARCH_PERFORMANCE_INIT(outer);
+   RARCH_PERFORMANCE_INIT(inner);
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < scopes; i += 2)
+   {
+      RARCH_PERFORMANCE_START(outer);
+      RARCH_PERFORMANCE_START(inner);
+      RARCH_PERFORMANCE_STOP(inner);
+      RARCH_PERFORMANCE_STOP(outer);
+   }
+   total = rarch_get_time_usec() - start;
+
+   printf("%u scopes: %.1f ns per scope\n", scopes, total * 1000.0 / (scopes ? scopes : 1));
+   rarch_perf_free();
+   return 0;
+}
@@ -0,0 +1,349 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// RGUI software renderer test and benchmark, without a video driver.
+//
+// rgui_bench --test
+//    Checks that glyphs match the font bitmap, and that painting only the dirty rows
+//    gives the same framebuffer as painting every frame in full.
+// rgui_bench
+//    Times a menu with a moving cursor and scrolling ticker, drawn the way RGUI used to
+//    (full redraw, one font bit per pixel), in full with the new renderer, and with dirty rows.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frontend/menu/disp/rgui_draw.h"
+#include "gfx/fonts/bitmap.h"
+#include "performance.h"
+#include "bench_test.h"
+
+#define MENU_WIDTH 320
+#define MENU_HEIGHT 240
+#define MENU_ENTRIES 19
+#define BENCH_FRAMES 3000
+
+static uint16_t framebuf[400 * 240];
+static uint16_t reference[400 * 240];
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245u + 12345u;
+   return rng_state >> 8;
+}
+
+static uint16_t gray_filler(unsigned x, unsigned y)
+{
+   unsigned col = (((x >> 1) + (y >> 1)) & 1) + 1;
+   return (col << 13) | (col << 9) | (col << 5) | (12 << 0);
+}
+
+static uint16_t green_filler(unsigned x, unsigned y)
+{
+   unsigned col = (((x >> 1) + (y >> 1)) & 1) + 1;
+   return (col << 13) | (col << 10) | (col << 5) | (12 << 0);
+}
+
+// RGUI before dirty tracking: a filler call per pixel, a font bit test per pixel.
+static void old_fill_rect(unsigned x, unsigned y, unsigned width, unsigned height,
+      uint16_t (*col)(unsigned x, unsigned y))
+{
+   unsigned i, j;
+   for (j = y; j < y + height; j++)
+      for (i = x; i < x + width; i++)
+         framebuf[j * MENU_WIDTH + i] = col(i, j);
+}
+
+static void old_blit_line(int x, int y, const char *message, uint16_t color)
+{
+   int i, j;
+   while (*message)
+   {
+      for (j = 0; j < FONT_HEIGHT; j++)
+      {
+         for (i = 0; i < FONT_WIDTH; i++)
+         {
+            uint8_t rem = 1 << ((i + j * FONT_WIDTH) & 7);
+            int offset = (i + j * FONT_WIDTH) >> 3;
+            if (bitmap_bin[FONT_OFFSET((unsigned char)*message) + offset] & rem)
+               framebuf[(y + j) * MENU_WIDTH + (x + i)] = color;
+         }
+      }
+
+      x += FONT_WIDTH_STRIDE;
+      message++;
+   }
+}
+
+// Menu state for one frame, roughly what rgui_render() draws.
+struct menu_frame
+{
+   unsigned selection;
+   unsigned ticker;
+   bool messagebox;
+};
+
+static void menu_line(char *buf, size_t size, const struct menu_frame *frame, unsigned entry)
+{
+   bool selected = entry == frame->selection;
+   snprintf(buf, size, "%c %-29.29s %-19s", selected ? '>' : ' ',
+         selected ? "Some long entry name that scrolls" + frame->ticker % 8 : "Entry name",
+         entry & 1 ? "ON" : "OFF");
+}
+
+static void draw_old(const struct menu_frame *frame)
+{
+   char line[128];
+   unsigned i;
+
+   old_fill_rect(0, 0, MENU_WIDTH, MENU_HEIGHT, gray_filler);
+   old_fill_rect(5, 5, MENU_WIDTH - 10, 5, green_filler);
+   old_fill_rect(5, MENU_HEIGHT - 10, MENU_WIDTH - 10, 5, green_filler);
+   old_fill_rect(5, 5, 5, MENU_HEIGHT - 10, green_filler);
+   old_fill_rect(MENU_WIDTH - 10, 5, 5, MENU_HEIGHT - 10, green_filler);
+
+   snprintf(line, sizeof(line), "MENU %u", frame->ticker / 4);
+   old_blit_line(30, 15, line, 0x7f7f);
+   for (i = 0; i < MENU_ENTRIES; i++)
+   {
+      menu_line(line, sizeof(line), frame, i);
+      old_blit_line(15, 27 + i * FONT_HEIGHT_STRIDE, line, i == frame->selection ? 0x7f7f : 0xffff);
+   }
+}
+
+static void draw_new(rgui_draw_t *draw, const struct menu_frame *frame)
+{
+   char line[128];
+   unsigned i;
+
+   rgui_draw_begin(draw);
+   rgui_draw_rect(draw, 0, 0, MENU_WIDTH, MENU_HEIGHT, gray_filler);
+   rgui_draw_rect(draw, 5, 5, MENU_WIDTH - 10, 5, green_filler);
+   rgui_draw_rect(draw, 5, MENU_HEIGHT - 10, MENU_WIDTH - 10, 5, green_filler);
+   rgui_draw_rect(draw, 5, 5, 5, MENU_HEIGHT - 10, green_filler);
+   rgui_draw_rect(draw, MENU_WIDTH - 10, 5, 5, MENU_HEIGHT - 10, green_filler);
+
+   snprintf(line, sizeof(line), "MENU %u", frame->ticker / 4);
+   rgui_draw_text(draw, 30, 15, line, 0x7f7f);
+   for (i = 0; i < MENU_ENTRIES; i++)
+   {
+      menu_line(line, sizeof(line), frame, i);
+      rgui_draw_text(draw, 15, 27 + i * FONT_HEIGHT_STRIDE, line, i == frame->selection ? 0x7f7f : 0xffff);
+   }
+
+   if (frame->messagebox)
+   {
+      rgui_draw_rect(draw, 100, 100, 120, 30, green_filler);
+      rgui_draw_rect(draw, 105, 105, 110, 20, gray_filler);
+      rgui_draw_text(draw, 110, 110, "Loading ...", 0xffff);
+   }
+}
+
+static void next_frame(struct menu_frame *frame, unsigned index)
+{
+   frame->ticker = index / 15;
+   if (index % 10 == 0)
+      frame->selection = (frame->selection + 1) % MENU_ENTRIES;
+}
+
+static bool check_glyphs(void)
+{
+   unsigned c, x, y, first_row, rows;
+   bool ok = true;
+   char msg[2] = {0};
+   rgui_draw_t *draw = rgui_draw_new(bitmap_bin);
+   if (!draw)
+      return false;
+
+   for (c = 1; c < 256 && ok; c++)
+   {
+      msg[0] = c;
+      memset(framebuf, 0, sizeof(framebuf));
+      old_blit_line(3, 2, msg, 0xffff);
+      memcpy(reference, framebuf, sizeof(reference));
+
+      memset(framebuf, 0, sizeof(framebuf));
+      rgui_draw_invalidate(draw);
+      rgui_draw_begin(draw);
+      rgui_draw_text(draw, 3, 2, msg, 0xffff);
+      rgui_draw_end(draw, framebuf, MENU_WIDTH * 2, MENU_WIDTH, MENU_HEIGHT, &first_row, &rows);
+
+      for (y = 0; y < 16; y++)
+         for (x = 0; x < 16; x++)
+            ok = ok && framebuf[y * MENU_WIDTH + x] == reference[y * MENU_WIDTH + x];
+   }
+
+   rgui_draw_free(draw);
+   return ok;
+}
+
+static bool check_fills(void)
+{
+   unsigned first_row, rows, i;
+   bool ok;
+   rgui_draw_t *draw = rgui_draw_new(bitmap_bin);
+   if (!draw)
+      return false;
+
+   memset(framebuf, 0, sizeof(framebuf));
+   old_fill_rect(0, 0, MENU_WIDTH, MENU_HEIGHT, gray_filler);
+   old_fill_rect(3, 7, 37, 11, green_filler);
+   old_fill_rect(1, 50, 2, 3, green_filler);
+   memcpy(reference, framebuf, sizeof(reference));
+
+   memset(framebuf, 0, sizeof(framebuf));
+   rgui_draw_begin(draw);
+   rgui_draw_rect(draw, 0, 0, MENU_WIDTH, MENU_HEIGHT, gray_filler);
+   rgui_draw_rect(draw, 3, 7, 37, 11, green_filler);
+   rgui_draw_rect(draw, 1, 50, 2, 3, green_filler);
+   // Clipped away, or partly.
+   rgui_draw_rect(draw, -4, MENU_HEIGHT + 3, 10, 10, green_filler);
+   rgui_draw_text(draw, -8, MENU_HEIGHT - 4, "clipped", 0xffff);
+   rgui_draw_end(draw, framebuf, MENU_WIDTH * 2, MENU_WIDTH, MENU_HEIGHT, &first_row, &rows);
+
+   ok = first_row == 0 && rows == MENU_HEIGHT;
+   for (i = 0; i < MENU_WIDTH * (MENU_HEIGHT - 4); i++)
+      ok = ok && framebuf[i] == reference[i];
+
+   rgui_draw_free(draw);
+   return ok;
+}
+
+enum frame_action
+{
+   FRAME_DRAW = 0,
+   FRAME_IDLE,
+   FRAME_OVERLAY
+};
+
+// Frames drawn in full by rgui_render(), skipped, or a message box layered on the last one.
+static void apply_frame(rgui_draw_t *draw, enum frame_action action, const struct menu_frame *frame)
+{
+   if (action == FRAME_DRAW)
+      draw_new(draw, frame);
+   else if (action == FRAME_OVERLAY)
+      rgui_draw_text(draw, 40, 200, "Saved state.", 0xffff);
+}
+
+// Renders random menu frames with dirty rows and in full, and compares every frame.
+static bool check_dirty(void)
+{
+   unsigned i, y, first_row, rows, full_first, full_rows;
+   struct menu_frame frame = {0};
+   static uint16_t before[400 * 240];
+   rgui_draw_t *dirty = rgui_draw_new(bitmap_bin);
+   rgui_draw_t *full = rgui_draw_new(bitmap_bin);
+   bool ok = dirty && full;
+
+   memset(framebuf, 0, sizeof(framebuf));
+   memset(reference, 0, sizeof(reference));
+
+   for (i = 0; ok && i < 2000; i++)
+   {
+      enum frame_action action = rng() % 8 == 0 ? FRAME_IDLE :
+         (rng() % 8 == 0 ? FRAME_OVERLAY : FRAME_DRAW);
+
+      next_frame(&frame, i);
+      if (rng() % 7 == 0)
+         frame.selection = rng() % MENU_ENTRIES;
+      frame.messagebox = rng() % 5 == 0;
+
+      memcpy(before, framebuf, sizeof(framebuf));
+      apply_frame(dirty, action, &frame);
+      rgui_draw_end(dirty, framebuf, MENU_WIDTH * 2, MENU_WIDTH, MENU_HEIGHT, &first_row, &rows);
+
+      apply_frame(full, action, &frame);
+      rgui_draw_invalidate(full);
+      rgui_draw_end(full, reference, MENU_WIDTH * 2, MENU_WIDTH, MENU_HEIGHT, &full_first, &full_rows);
+
+      ok = memcmp(framebuf, reference, MENU_WIDTH * MENU_HEIGHT * sizeof(uint16_t)) == 0;
+      ok = ok && full_first == 0 && full_rows == MENU_HEIGHT;
+      if (action == FRAME_IDLE)
+         ok = ok && rows == 0;
+
+      // Every row that changed must be in the range handed to the video driver.
+      for (y = 0; ok && y < MENU_HEIGHT; y++)
+      {
+         bool changed = memcmp(before + y * MENU_WIDTH, framebuf + y * MENU_WIDTH,
+               MENU_WIDTH * sizeof(uint16_t)) != 0;
+         ok = !changed || (y >= first_row && y < first_row + rows);
+      }
+   }
+
+   rgui_draw_free(dirty);
+   rgui_draw_free(full);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   CHECK("glyphs match font bitmap", check_glyphs());
+   CHECK("rectangle fills and clipping", check_fills());
+   CHECK("dirty rows match full redraw", check_dirty());
+
+   return bench_test_result();
+}
+
+static void bench(const char *name, rgui_draw_t *draw, bool invalidate)
+{
+   unsigned i, first_row, rows;
+   uint64_t uploaded = 0;
+   struct menu_frame frame = {0};
+   retro_time_t start = rarch_get_time_usec(), total;
+
+   for (i = 0; i < BENCH_FRAMES; i++)
+   {
+      next_frame(&frame, i);
+      if (!draw)
+      {
+         draw_old(&frame);
+         uploaded += MENU_HEIGHT;
+         continue;
+      }
+
+      draw_new(draw, &frame);
+      if (invalidate)
+         rgui_draw_invalidate(draw);
+      rgui_draw_end(draw, framebuf, MENU_WIDTH * 2, MENU_WIDTH, MENU_HEIGHT, &first_row, &rows);
+      uploaded += rows;
+   }
+   total = rarch_get_time_usec() - start;
+
+   printf("%-24s %8.2f us/frame, %6.1f rows uploaded/frame\n", name,
+         (double)total / BENCH_FRAMES, (double)uploaded / BENCH_FRAMES);
+}
+
+int main(int argc, char *argv[])
+{
+   rgui_draw_t *draw;
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   draw = rgui_draw_new(bitmap_bin);
+   if (!draw)
+      return 1;
+
+   printf("Menu: %ux%u, %u entries, cursor moves every 10 frames, %u frames\n",
+         MENU_WIDTH, MENU_HEIGHT, MENU_ENTRIES, BENCH_FRAMES);
+   bench("old, full redraw", NULL, false);
+   bench("new, full redraw", draw, true);
+   bench("new, dirty rows", draw, false);
+
+   rgui_draw_free(draw);
+   return 0;
+}
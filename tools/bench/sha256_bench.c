@@ -0,0 +1,78 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput benchmark for SHA256.
+// hash.c is pulled in directly so the portable block function can be timed
+// against the one selected at runtime.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../hash.c"
+
+static double bench(const char *ident, sha256_blocks_t blocks,
+      const uint8_t *data, size_t size, unsigned iterations, char *out)
+{
+   unsigned i;
+   retro_time_t start, total;
+
+   sha256_blocks_impl = blocks;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < iterations; i++)
+      sha256_hash(out, data, size);
+   total = rarch_get_time_usec() - start;
+
+   double mbps = ((double)size * iterations) / (total ? total : 1);
+   printf("%-8s %8u KiB: %8.1f MB/s (%.16s...)\n", ident, (unsigned)(size >> 10), mbps, out);
+   return mbps;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t sizes[] = { 1 << 10, 64 << 10, 1 << 20, 32 << 20 };
+   unsigned i, s;
+   size_t max_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+   uint8_t *data = (uint8_t*)malloc(max_size);
+   sha256_blocks_t best;
+   int ret = 0;
+
+   if (!data)
+      return 1;
+
+   for (i = 0; i < max_size; i++)
+      data[i] = rand();
+
+   best = sha256_find_impl(rarch_get_cpu_features());
+
+   for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+   {
+      char ref[65], opt[65];
+      unsigned iterations = (unsigned)((128 << 20) / sizes[s]);
+      if (argc > 1)
+         iterations = strtoul(argv[1], NULL, 0);
+
+      bench("scalar", sha256_blocks_c, data, sizes[s], iterations, ref);
+      bench("best", best, data, sizes[s], iterations, opt);
+
+      if (strcmp(ref, opt) != 0)
+      {
+         fprintf(stderr, "SHA256 mismatch at %u bytes.\n", (unsigned)sizes[s]);
+         ret = 1;
+      }
+   }
+
+   free(data);
+   return ret;
+}
@@ -0,0 +1,496 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Shader preset cache test and benchmark.
+// Presets and sources are written to shader_cache_bench.tmp/ in the current directory.
+//
+// shader_cache_bench --test
+//    Checks that cached presets load exactly like parsed ones, and that changing the
+//    preset or any inlined source, or damaging an entry, is never served from the cache.
+//    Files are backdated, like presets that have been around for a while, unless a test
+//    wants them written right before the entry.
+// shader_cache_bench
+//    Times loading a 12 pass preset by parsing, and from the cache.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <utime.h>
+#include "general.h"
+#include "file.h"
+#include "hash.h"
+#include "gfx/shader_cache.h"
+#include "performance.h"
+#include "bench_test.h"
+
+#define TMP_DIR "shader_cache_bench.tmp"
+#define CACHE_DIR TMP_DIR "/cache"
+#define PRESET_PATH TMP_DIR "/preset.glslp"
+#define NUM_PASSES 12
+#define BENCH_LOADS 500
+
+static void write_string(const char *path, const char *str)
+{
+   write_file(path, str, strlen(str));
+}
+
+static void write_source(unsigned pass, unsigned version)
+{
+   char path[PATH_MAX], source[4096];
+   unsigned i;
+   size_t len;
+
+   snprintf(path, sizeof(path), TMP_DIR "/pass%u.glsl", pass);
+   len = snprintf(source, sizeof(source),
+         "// Pass %u, version %u\n"
+         "#if defined(VERTEX)\n"
+         "attribute vec4 VertexCoord;\n"
+         "void main() { gl_Position = VertexCoord; }\n"
+         "#elif defined(FRAGMENT)\n"
+         "uniform sampler2D Texture;\n"
+         "void main() { gl_FragColor = vec4(%u.0); }\n"
+         "#endif\n", pass, version, pass);
+
+   // Realistic sizes, so hashing the sources isn't free.
+   for (i = 0; i < 48 && len < sizeof(source) - 64; i++)
+      len += snprintf(source + len, sizeof(source) - len, "// Padding line %u of the shader source.\n", i);
+
+   write_string(path, source);
+}
+
+static void write_preset(unsigned passes, const char *extra)
+{
+   char preset[8192];
+   size_t len = 0;
+   unsigned i;
+
+   len += snprintf(preset + len, sizeof(preset) - len, "shaders = %u\n", passes);
+   for (i = 0; i < passes; i++)
+   {
+      len += snprintf(preset + len, sizeof(preset) - len,
+            "shader%u = pass%u.glsl\n"
+            "filter_linear%u = %s\n"
+            "wrap_mode%u = repeat\n"
+            "scale_type%u = source\n"
+            "scale%u = %u.0\n"
+            "float_framebuffer%u = %s\n",
+            i, i, i, i & 1 ? "true" : "false", i, i, i, 1 + (i & 1), i, i & 2 ? "true" : "false");
+   }
+
+   len += snprintf(preset + len, sizeof(preset) - len,
+         "textures = lut\n"
+         "lut = lut.png\n"
+         "lut_linear = true\n"
+         "imports = \"frame;input\"\n"
+         "frame_semantic = transition\n"
+         "frame_wram = 7e0100\n"
+         "input_semantic = capture\n"
+         "input_input_slot = 1\n"
+         "input_mask = 0x0f\n"
+         "%s", extra);
+
+   write_string(PRESET_PATH, preset);
+}
+
+static void set_mtime(const char *path, time_t mtime)
+{
+   struct utimbuf times;
+   times.actime = mtime;
+   times.modtime = mtime;
+   utime(path, &times);
+}
+
+static void set_source_mtime(unsigned pass, time_t mtime)
+{
+   char path[PATH_MAX];
+   snprintf(path, sizeof(path), TMP_DIR "/pass%u.glsl", pass);
+   set_mtime(path, mtime);
+}
+
+// An hour ago, so the cache can trust sizes and times alone.
+static void backdate(void)
+{
+   unsigned i;
+   for (i = 0; i < NUM_PASSES; i++)
+      set_source_mtime(i, time(NULL) - 3600);
+   set_mtime(PRESET_PATH, time(NULL) - 3600);
+}
+
+static void setup(void)
+{
+   unsigned i;
+   path_mkdir(TMP_DIR);
+   for (i = 0; i < NUM_PASSES; i++)
+      write_source(i, 0);
+   write_preset(NUM_PASSES, "");
+   backdate();
+}
+
+static void clear_cache(void)
+{
+   unsigned i;
+   struct string_list *list;
+   if (!path_is_directory(CACHE_DIR))
+      return;
+
+   list = dir_list_new(CACHE_DIR, NULL, false);
+   if (!list)
+      return;
+
+   for (i = 0; i < list->size; i++)
+      remove(list->elems[i].data);
+   dir_list_free(list);
+}
+
+static void free_shader(struct gfx_shader *shader)
+{
+   unsigned i;
+   if (!shader)
+      return;
+
+   for (i = 0; i < GFX_MAX_SHADERS; i++)
+   {
+      free(shader->pass[i].source.xml.vertex);
+      free(shader->pass[i].source.xml.fragment);
+   }
+   free(shader->script);
+   free(shader);
+}
+
+static struct gfx_shader *load(const char *cache_dir)
+{
+   struct gfx_shader *shader = (struct gfx_shader*)calloc(1, sizeof(*shader));
+   if (shader && !gfx_shader_cache_read_preset(cache_dir, PRESET_PATH, shader, true))
+   {
+      free_shader(shader);
+      return NULL;
+   }
+   return shader;
+}
+
+static bool string_equal(const char *a, const char *b)
+{
+   if (!a || !b)
+      return a == b;
+   return strcmp(a, b) == 0;
+}
+
+// Clears what comes after the terminator of a string in a fixed size field.
+static void clear_tail(char *str, size_t size)
+{
+   size_t len = strnlen(str, size);
+   memset(str + len, 0, size - len);
+}
+
+// Pointers are cleared, and so are the unused bytes of strings, which the cache doesn't store.
+static void make_plain(struct gfx_shader *shader)
+{
+   unsigned i;
+
+   for (i = 0; i < GFX_MAX_SHADERS; i++)
+   {
+      shader->pass[i].source.xml.vertex = shader->pass[i].source.xml.fragment = NULL;
+      clear_tail(shader->pass[i].source.cg, sizeof(shader->pass[i].source.cg));
+   }
+   for (i = 0; i < GFX_MAX_TEXTURES; i++)
+   {
+      clear_tail(shader->lut[i].id, sizeof(shader->lut[i].id));
+      clear_tail(shader->lut[i].path, sizeof(shader->lut[i].path));
+   }
+   for (i = 0; i < GFX_MAX_VARIABLES; i++)
+      clear_tail(shader->variable[i].id, sizeof(shader->variable[i].id));
+
+   clear_tail(shader->prefix, sizeof(shader->prefix));
+   clear_tail(shader->script_path, sizeof(shader->script_path));
+   clear_tail(shader->script_class, sizeof(shader->script_class));
+   shader->script = NULL;
+}
+
+static bool shader_equal(const struct gfx_shader *a, const struct gfx_shader *b)
+{
+   struct gfx_shader *plain_a, *plain_b;
+   unsigned i;
+   bool ok;
+
+   if (!a || !b || a->passes != b->passes)
+      return false;
+
+   for (i = 0; i < a->passes; i++)
+   {
+      if (!string_equal(a->pass[i].source.xml.vertex, b->pass[i].source.xml.vertex) ||
+            !string_equal(a->pass[i].source.xml.fragment, b->pass[i].source.xml.fragment))
+         return false;
+   }
+   if (!string_equal(a->script, b->script))
+      return false;
+
+   // Everything but the pointers and unused bytes must be identical.
+   plain_a = (struct gfx_shader*)malloc(sizeof(*plain_a));
+   plain_b = (struct gfx_shader*)malloc(sizeof(*plain_b));
+   if (!plain_a || !plain_b)
+   {
+      free(plain_a);
+      free(plain_b);
+      return false;
+   }
+
+   memcpy(plain_a, a, sizeof(*a));
+   memcpy(plain_b, b, sizeof(*b));
+   make_plain(plain_a);
+   make_plain(plain_b);
+
+   ok = memcmp(plain_a, plain_b, sizeof(*plain_a)) == 0;
+   free(plain_a);
+   free(plain_b);
+   return ok;
+}
+
+static unsigned count_entries(void)
+{
+   unsigned count;
+   struct string_list *list = dir_list_new(CACHE_DIR, "preset", false);
+   if (!list)
+      return 0;
+   count = list->size;
+   dir_list_free(list);
+   return count;
+}
+
+// Loads the preset as it is on disk twice through the cache, and compares with a plain parse.
+static bool check_load(void)
+{
+   struct gfx_shader *ref = load(NULL);
+   struct gfx_shader *miss = load(CACHE_DIR);
+   struct gfx_shader *hit = load(CACHE_DIR);
+   bool ok = ref && shader_equal(ref, miss) && shader_equal(ref, hit);
+
+   free_shader(ref);
+   free_shader(miss);
+   free_shader(hit);
+   return ok;
+}
+
+static bool check_hit(void)
+{
+   struct gfx_shader *shader;
+   bool ok;
+
+   clear_cache();
+   ok = check_load() && count_entries() == 1;
+
+   // The sources are inlined, the pass paths are gone.
+   shader = load(CACHE_DIR);
+   ok = ok && shader && !*shader->pass[0].source.cg &&
+      strstr(shader->pass[3].source.xml.vertex, "Pass 3, version 0") &&
+      shader->pass[1].filter == RARCH_FILTER_LINEAR && shader->pass[2].fbo.fp_fbo &&
+      shader->luts == 1 && shader->variables == 2;
+
+   free_shader(shader);
+   return ok;
+}
+
+static bool check_source_change(void)
+{
+   struct gfx_shader *shader;
+   bool ok;
+
+   clear_cache();
+   ok = check_load();
+   write_source(5, 1);
+   ok = ok && check_load();
+
+   shader = load(CACHE_DIR);
+   ok = ok && shader && strstr(shader->pass[5].source.xml.vertex, "Pass 5, version 1");
+   free_shader(shader);
+
+   write_source(5, 0);
+   backdate();
+   return ok;
+}
+
+// A source rewritten with the same size and time is only caught by its hash,
+// which the cache checks when the source is no older than the entry.
+static bool check_same_time_change(void)
+{
+   struct gfx_shader *shader;
+   time_t later = time(NULL) + 3600;
+   bool ok;
+
+   clear_cache();
+   set_source_mtime(5, later);
+   ok = check_load();
+   write_source(5, 1);
+   set_source_mtime(5, later);
+   ok = ok && check_load();
+
+   shader = load(CACHE_DIR);
+   ok = ok && shader && strstr(shader->pass[5].source.xml.vertex, "Pass 5, version 1");
+   free_shader(shader);
+
+   write_source(5, 0);
+   backdate();
+   return ok;
+}
+
+// Older sources are only stat'ed, a different time alone is enough to parse again.
+static bool check_old_change(void)
+{
+   struct gfx_shader *shader;
+   bool ok;
+
+   clear_cache();
+   ok = check_load();
+   write_source(5, 1);
+   set_source_mtime(5, time(NULL) - 7200);
+
+   shader = load(CACHE_DIR);
+   ok = ok && shader && strstr(shader->pass[5].source.xml.vertex, "Pass 5, version 1");
+   free_shader(shader);
+
+   write_source(5, 0);
+   backdate();
+   return ok;
+}
+
+static bool check_preset_change(void)
+{
+   bool ok;
+
+   clear_cache();
+   ok = check_load();
+   write_preset(NUM_PASSES - 4, "");
+   ok = ok && check_load() && count_entries() == 1;
+   write_preset(NUM_PASSES, "");
+   backdate();
+   return ok;
+}
+
+static bool check_damaged(void)
+{
+   struct string_list *list;
+   bool ok;
+
+   clear_cache();
+   ok = check_load();
+
+   list = dir_list_new(CACHE_DIR, "preset", false);
+   ok = ok && list && list->size == 1;
+   if (ok)
+   {
+      uint8_t *data = NULL;
+      long len = read_file(list->elems[0].data, (void**)&data);
+      ok = len > 64;
+      if (ok)
+      {
+         data[len / 2] ^= 0x55;
+         write_file(list->elems[0].data, data, len);
+         ok = check_load();
+
+         // Cut short.
+         write_file(list->elems[0].data, data, len / 3);
+         ok = ok && check_load();
+      }
+      free(data);
+   }
+
+   dir_list_free(list);
+   return ok;
+}
+
+static bool check_include(void)
+{
+   bool ok;
+
+   clear_cache();
+   write_string(TMP_DIR "/extra.cfg", "");
+   write_preset(NUM_PASSES, "#include \"extra.cfg\"\n");
+   ok = check_load() && count_entries() == 0;
+   write_preset(NUM_PASSES, "");
+   backdate();
+   return ok;
+}
+
+static bool check_blob(void)
+{
+   uint8_t key[SHADER_CACHE_KEY_SIZE] = {1, 2, 3};
+   uint8_t other[SHADER_CACHE_KEY_SIZE] = {3, 2, 1};
+   uint8_t data[1000];
+   size_t size = 0;
+   unsigned i;
+   void *blob;
+   bool ok;
+
+   for (i = 0; i < sizeof(data); i++)
+      data[i] = i * 7;
+
+   ok = gfx_shader_cache_write_blob(CACHE_DIR, key, data, sizeof(data));
+   blob = gfx_shader_cache_read_blob(CACHE_DIR, key, &size);
+   ok = ok && blob && size == sizeof(data) && memcmp(blob, data, size) == 0;
+   free(blob);
+
+   ok = ok && !gfx_shader_cache_read_blob(CACHE_DIR, other, &size);
+   ok = ok && !gfx_shader_cache_read_blob("", key, &size);
+   return ok;
+}
+
+static int run_test(void)
+{
+   setup();
+   CHECK("cached preset matches parsed", check_hit());
+   CHECK("changed source", check_source_change());
+   CHECK("changed source with the same size and time", check_same_time_change());
+   CHECK("changed source with an older time", check_old_change());
+   CHECK("changed preset", check_preset_change());
+   CHECK("damaged entry", check_damaged());
+   CHECK("preset with #include isn't cached", check_include());
+   CHECK("blobs", check_blob());
+   clear_cache();
+
+   return bench_test_result();
+}
+
+int main(int argc, char *argv[])
+{
+   retro_time_t start, parse_time, cache_time;
+   unsigned i;
+
+   // CRC32 and SHA256 as the frontend has them.
+   hash_init();
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   setup();
+   clear_cache();
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_LOADS; i++)
+      free_shader(load(NULL));
+   parse_time = rarch_get_time_usec() - start;
+
+   free_shader(load(CACHE_DIR));
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_LOADS; i++)
+      free_shader(load(CACHE_DIR));
+   cache_time = rarch_get_time_usec() - start;
+
+   printf("%u pass preset, %u loads\n", NUM_PASSES, BENCH_LOADS);
+   printf("parsed: %8.1f us/load\n", (double)parse_time / BENCH_LOADS);
+   printf("cached: %8.1f us/load\n", (double)cache_time / BENCH_LOADS);
+
+   clear_cache();
+   return 0;
+}
@@ -0,0 +1,462 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Software video driver test and benchmark.
+// Hash logs and frame dumps are written to soft_bench.tmp/ in the current directory.
+//
+// soft_bench --test
+//    Checks the framebuffer the driver presents, through its hash log, screenshots and dumps:
+//    viewport layout, messages and overlay compositing.
+// soft_bench
+//    Times whole frames through the driver, with and without a full screen overlay.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "driver.h"
+#include "file_path.h"
+#include "hash.h"
+#include "gfx/scaler/scaler.h"
+#include "gfx/rpng/rpng.h"
+#include "performance.h"
+#include "bench_test.h"
+
+struct settings g_settings;
+struct global g_extern;
+driver_t driver;
+
+#define TMP_DIR "soft_bench.tmp"
+#define HASH_LOG TMP_DIR "/hash.log"
+#define DUMP_DIR TMP_DIR "/dump"
+#define BENCH_FRAMES 500
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245 + 12345;
+   return rng_state >> 16;
+}
+
+static void *make_frame(bool rgb32, unsigned width, unsigned height)
+{
+   unsigned i;
+   unsigned bpp = rgb32 ? 4 : 2;
+   uint8_t *frame = (uint8_t*)malloc(width * height * bpp);
+   if (!frame)
+      return NULL;
+
+   for (i = 0; i < width * height * bpp; i++)
+      frame[i] = rng();
+   return frame;
+}
+
+static void set_geometry(unsigned width, unsigned height, float aspect)
+{
+   g_extern.system.aspect_ratio = aspect;
+   g_extern.system.av_info.geometry.base_width = width;
+   g_extern.system.av_info.geometry.base_height = height;
+}
+
+static void *start_driver(bool rgb32, unsigned width, unsigned height)
+{
+   video_info_t info = {0};
+   const input_driver_t *input = NULL;
+   void *input_data = NULL;
+
+   info.width = width;
+   info.height = height;
+   info.force_aspect = true;
+   info.rgb32 = rgb32;
+
+   return video_soft.init(&info, &input, &input_data);
+}
+
+// Hashes from the log, one per frame.
+static unsigned read_hash_log(uint32_t *hashes, unsigned max_hashes)
+{
+   unsigned count = 0, index, hash;
+   FILE *file = fopen(HASH_LOG, "r");
+   if (!file)
+      return 0;
+
+   while (count < max_hashes && fscanf(file, "%u %x", &index, &hash) == 2 && index == count)
+      hashes[count++] = hash;
+
+   fclose(file);
+   return count;
+}
+
+// The framebuffer the driver should present: black, with the frame point scaled into the viewport.
+static uint32_t *reference_fb(bool rgb32, const void *frame, unsigned width, unsigned height,
+      unsigned fb_width, unsigned fb_height, unsigned vp_x, unsigned vp_y, unsigned vp_width, unsigned vp_height)
+{
+   struct scaler_ctx ctx = {0};
+   uint32_t *fb = (uint32_t*)calloc(fb_width * fb_height, sizeof(uint32_t));
+   if (!fb)
+      return NULL;
+
+   ctx.in_fmt = rgb32 ? SCALER_FMT_ARGB8888 : SCALER_FMT_RGB565;
+   ctx.out_fmt = SCALER_FMT_ARGB8888;
+   ctx.scaler_type = SCALER_TYPE_POINT;
+   ctx.in_width = width;
+   ctx.in_height = height;
+   ctx.in_stride = width * (rgb32 ? 4 : 2);
+   ctx.out_width = vp_width;
+   ctx.out_height = vp_height;
+   ctx.out_stride = fb_width * sizeof(uint32_t);
+
+   if (!scaler_ctx_gen_filter(&ctx))
+   {
+      free(fb);
+      return NULL;
+   }
+   scaler_ctx_scale(&ctx, fb + vp_y * fb_width + vp_x, frame);
+   scaler_ctx_gen_reset(&ctx);
+
+   // The driver presents opaque pixels, whatever the scaler leaves in the top byte.
+   for (vp_y = 0; vp_y < fb_width * fb_height; vp_y++)
+      fb[vp_y] |= 0xffu << 24;
+   return fb;
+}
+
+// Frames are laid out like the other drivers do, and the rest of the framebuffer stays black.
+static bool check_layout(bool rgb32, unsigned width, unsigned height, float aspect, bool scale_integer,
+      unsigned fb_width, unsigned fb_height, unsigned vp_x, unsigned vp_y, unsigned vp_width, unsigned vp_height)
+{
+   void *data;
+   void *frame = make_frame(rgb32, width, height);
+   uint32_t *ref = NULL;
+   uint32_t hashes[4];
+   struct rarch_viewport vp;
+   bool ok;
+
+   g_settings.video.scale_integer = scale_integer;
+   set_geometry(width, height, aspect);
+
+   remove(HASH_LOG);
+   strlcpy(g_settings.video.soft_hash_log, HASH_LOG, sizeof(g_settings.video.soft_hash_log));
+   data = start_driver(rgb32, fb_width, fb_height);
+   ok = frame && data;
+
+   if (ok)
+   {
+      ok = video_soft.frame(data, frame, width, height, width * (rgb32 ? 4 : 2), NULL);
+      // A duplicate leaves everything as it is.
+      ok = ok && video_soft.frame(data, NULL, width, height, 0, NULL);
+      video_soft.viewport_info(data, &vp);
+      ok = ok && vp.x == (int)vp_x && vp.y == (int)vp_y && vp.width == vp_width && vp.height == vp_height &&
+         vp.full_width == fb_width && vp.full_height == fb_height;
+   }
+
+   if (data)
+      video_soft.free(data);
+   *g_settings.video.soft_hash_log = '\0';
+   g_settings.video.scale_integer = false;
+
+   if (ok)
+      ref = reference_fb(rgb32, frame, width, height, fb_width, fb_height, vp_x, vp_y, vp_width, vp_height);
+
+   ok = ok && ref && read_hash_log(hashes, 4) == 2 &&
+      hashes[0] == hashes[1] && hashes[0] == crc32_calculate((const uint8_t*)ref, fb_width * fb_height * sizeof(uint32_t));
+
+   free(ref);
+   free(frame);
+   return ok;
+}
+
+// Screenshots are the viewport, bottom-up BGR24. The dump is the whole framebuffer.
+static bool check_readback(void)
+{
+   void *data;
+   unsigned width = 160, height = 144, fb_width = 400, fb_height = 300;
+   unsigned vp_x = 33, vp_width = 333;
+   void *frame = make_frame(false, width, height);
+   uint32_t *ref = NULL, *png = NULL;
+   unsigned png_width = 0, png_height = 0, x, y;
+   uint8_t *shot = (uint8_t*)malloc(vp_width * fb_height * 3);
+   char path[PATH_MAX];
+   bool ok;
+
+   set_geometry(width, height, 10.0f / 9.0f);
+   strlcpy(g_settings.video.soft_dump_dir, DUMP_DIR, sizeof(g_settings.video.soft_dump_dir));
+   data = start_driver(false, fb_width, fb_height);
+   ok = frame && shot && data;
+   ok = ok && video_soft.frame(data, frame, width, height, width * 2, NULL);
+   ok = ok && video_soft.read_viewport(data, shot);
+   if (data)
+      video_soft.free(data);
+   *g_settings.video.soft_dump_dir = '\0';
+
+   if (ok)
+      ref = reference_fb(false, frame, width, height, fb_width, fb_height, vp_x, 0, vp_width, fb_height);
+   ok = ok && ref;
+
+   for (y = 0; ok && y < fb_height; y++)
+   {
+      const uint8_t *line = shot + (fb_height - 1 - y) * vp_width * 3;
+      for (x = 0; ok && x < vp_width; x++)
+      {
+         uint32_t pixel = ref[y * fb_width + vp_x + x];
+         ok = line[x * 3 + 0] == (uint8_t)(pixel >> 0) &&
+            line[x * 3 + 1] == (uint8_t)(pixel >> 8) &&
+            line[x * 3 + 2] == (uint8_t)(pixel >> 16);
+      }
+   }
+
+   fill_pathname_join(path, DUMP_DIR, "frame-000000.png", sizeof(path));
+   ok = ok && rpng_load_image_argb(path, &png, &png_width, &png_height) &&
+      png_width == fb_width && png_height == fb_height;
+   for (x = 0; ok && x < fb_width * fb_height; x++)
+      ok = (png[x] | (0xffu << 24)) == ref[x];
+
+   remove(path);
+   free(png);
+   free(ref);
+   free(shot);
+   free(frame);
+   return ok;
+}
+
+// Reads back a 4:3 frame filling the framebuffer, as XRGB8888 top-down.
+static bool read_fb(void *data, uint32_t *fb, unsigned width, unsigned height)
+{
+   unsigned x, y;
+   uint8_t *shot = (uint8_t*)malloc(width * height * 3);
+   bool ok = shot && video_soft.read_viewport(data, shot);
+
+   for (y = 0; ok && y < height; y++)
+   {
+      const uint8_t *line = shot + (height - 1 - y) * width * 3;
+      for (x = 0; x < width; x++)
+         fb[y * width + x] = (line[x * 3 + 2] << 16) | (line[x * 3 + 1] << 8) | line[x * 3 + 0];
+   }
+
+   free(shot);
+   return ok;
+}
+
+static bool near(unsigned a, unsigned b)
+{
+   return a + 2 >= b && b + 2 >= a;
+}
+
+// Whether pixel is the overlay color in the bottom right quarter, and the frame color elsewhere.
+// Texels are filtered, so the middle of the quarter where red turns transparent is not checked.
+static bool overlay_pixel_ok(uint32_t pixel, unsigned x, unsigned y, bool half)
+{
+   if (y >= 120 && x >= 160 && x < 220)
+   {
+      if (half)
+         return near(pixel >> 16, 0x80) && ((pixel >> 8) & 0xff) == 0 && near(pixel & 0xff, 0x80);
+      return pixel == 0xff0000;
+   }
+   if (y >= 120 && x >= 160 && x < 260)
+      return true;
+   return pixel == 0x0000ff;
+}
+
+// A blue frame, with two opaque red and two transparent texels stretched over the bottom right quarter.
+static bool check_overlay(void)
+{
+#ifdef HAVE_OVERLAY
+   const video_overlay_interface_t *iface = NULL;
+   uint32_t texels[4] = { 0xffff0000, 0xffff0000, 0x00000000, 0x00000000 };
+   struct texture_image image;
+   unsigned width = 64, height = 48, fb_width = 320, fb_height = 240, x, y, i;
+   uint32_t *frame = (uint32_t*)malloc(width * height * 4);
+   uint32_t *fb = (uint32_t*)malloc(fb_width * fb_height * 4);
+   void *data;
+   bool ok;
+
+   set_geometry(width, height, 4.0f / 3.0f);
+   data = start_driver(true, fb_width, fb_height);
+   ok = frame && fb && data;
+   if (!ok)
+      goto end;
+
+   for (i = 0; i < width * height; i++)
+      frame[i] = 0x0000ff;
+
+   image.width = 4;
+   image.height = 1;
+   image.pixels = texels;
+
+   video_soft.overlay_interface(data, &iface);
+   ok = iface->load(data, &image, 1);
+   iface->vertex_geom(data, 0, 0.5f, 0.5f, 0.5f, 0.5f);
+   iface->enable(data, true);
+
+   ok = ok && video_soft.frame(data, frame, width, height, width * 4, NULL) && read_fb(data, fb, fb_width, fb_height);
+   for (y = 0; ok && y < fb_height; y++)
+      for (x = 0; ok && x < fb_width; x++)
+         ok = overlay_pixel_ok(fb[y * fb_width + x], x, y, false);
+
+   // Half transparent.
+   iface->set_alpha(data, 0, 0.5f);
+   ok = ok && video_soft.frame(data, frame, width, height, width * 4, NULL) && read_fb(data, fb, fb_width, fb_height);
+   for (y = 0; ok && y < fb_height; y++)
+      for (x = 0; ok && x < fb_width; x++)
+         ok = overlay_pixel_ok(fb[y * fb_width + x], x, y, true);
+
+   // Only the transparent texels.
+   iface->set_alpha(data, 0, 1.0f);
+   iface->tex_geom(data, 0, 0.75f, 0.0f, 0.25f, 1.0f);
+   ok = ok && video_soft.frame(data, frame, width, height, width * 4, NULL) && read_fb(data, fb, fb_width, fb_height);
+   for (i = 0; ok && i < fb_width * fb_height; i++)
+      ok = fb[i] == 0x0000ff;
+
+   // Disabled.
+   iface->tex_geom(data, 0, 0.0f, 0.0f, 1.0f, 1.0f);
+   iface->enable(data, false);
+   ok = ok && video_soft.frame(data, frame, width, height, width * 4, NULL) && read_fb(data, fb, fb_width, fb_height);
+   for (i = 0; ok && i < fb_width * fb_height; i++)
+      ok = fb[i] == 0x0000ff;
+
+end:
+   if (data)
+      video_soft.free(data);
+   free(frame);
+   free(fb);
+   return ok;
+#else
+   return true;
+#endif
+}
+
+// Messages are drawn in the message color, and are gone with the next frame.
+static bool check_message(void)
+{
+   unsigned width = 64, height = 48, fb_width = 320, fb_height = 240, i, drawn = 0;
+   uint32_t *frame = (uint32_t*)calloc(width * height, 4);
+   uint32_t *fb = (uint32_t*)malloc(fb_width * fb_height * 4);
+   void *data;
+   bool ok;
+
+   g_settings.video.font_enable = true;
+   g_settings.video.msg_pos_x = 0.05f;
+   g_settings.video.msg_pos_y = 0.05f;
+   g_settings.video.msg_color_r = 1.0f;
+   g_settings.video.msg_color_g = 1.0f;
+   g_settings.video.msg_color_b = 0.0f;
+
+   set_geometry(width, height, 4.0f / 3.0f);
+   data = start_driver(true, fb_width, fb_height);
+   ok = frame && fb && data;
+
+   ok = ok && video_soft.frame(data, frame, width, height, width * 4, "Message") && read_fb(data, fb, fb_width, fb_height);
+   for (i = 0; ok && i < fb_width * fb_height; i++)
+   {
+      // Anti-aliased edges blend towards black.
+      ok = (fb[i] & 0xff) == 0 && (fb[i] >> 16) == ((fb[i] >> 8) & 0xff);
+      drawn += fb[i] == 0xffff00;
+   }
+   ok = ok && drawn > 20;
+
+   ok = ok && video_soft.frame(data, frame, width, height, width * 4, NULL) && read_fb(data, fb, fb_width, fb_height);
+   for (i = 0; ok && i < fb_width * fb_height; i++)
+      ok = fb[i] == 0;
+
+   if (data)
+      video_soft.free(data);
+   g_settings.video.font_enable = false;
+   free(frame);
+   free(fb);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   path_mkdir(TMP_DIR);
+
+   CHECK("full screen, RGB565",
+         check_layout(false, 320, 240, 4.0f / 3.0f, false, 640, 480, 0, 0, 640, 480));
+   CHECK("pillarboxed, XRGB8888",
+         check_layout(true, 256, 224, 8.0f / 7.0f, false, 640, 480, 45, 0, 549, 480));
+   CHECK("letterboxed, RGB565",
+         check_layout(false, 240, 160, 3.0f / 2.0f, false, 320, 240, 0, 13, 320, 213));
+   CHECK("integer scale",
+         check_layout(false, 256, 224, 8.0f / 7.0f, true, 800, 600, 144, 76, 512, 448));
+   CHECK("screenshot and dump", check_readback());
+   CHECK("overlay", check_overlay());
+   CHECK("message", check_message());
+
+   remove(HASH_LOG);
+   return bench_test_result();
+}
+
+static void bench_frames(unsigned width, unsigned height, unsigned fb_width, unsigned fb_height, bool overlay)
+{
+   void *data;
+   void *frame = make_frame(false, width, height);
+   uint32_t *texels = (uint32_t*)malloc(256 * 256 * 4);
+   retro_time_t start, time;
+   unsigned i;
+
+   set_geometry(width, height, 4.0f / 3.0f);
+   data = start_driver(false, fb_width, fb_height);
+   if (!data || !frame || !texels)
+      goto end;
+
+#ifdef HAVE_OVERLAY
+   if (overlay)
+   {
+      // Mostly transparent, like gamepad overlays.
+      const video_overlay_interface_t *iface = NULL;
+      struct texture_image image;
+
+      for (i = 0; i < 256 * 256; i++)
+         texels[i] = (i % 256) < 64 || (i / 256) > 192 ? 0x80ffffff : 0;
+
+      image.width = 256;
+      image.height = 256;
+      image.pixels = texels;
+      video_soft.overlay_interface(data, &iface);
+      iface->load(data, &image, 1);
+      iface->full_screen(data, true);
+      iface->enable(data, true);
+   }
+#else
+   if (overlay)
+      goto end;
+#endif
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      video_soft.frame(data, frame, width, height, width * 2, NULL);
+   time = rarch_get_time_usec() - start;
+
+   printf("%ux%u -> %ux%u%s: %8.1f us/frame, %6.0f fps\n", width, height, fb_width, fb_height,
+         overlay ? " + overlay" : "", (double)time / BENCH_FRAMES, BENCH_FRAMES * 1000000.0 / time);
+
+end:
+   if (data)
+      video_soft.free(data);
+   free(texels);
+   free(frame);
+}
+
+int main(int argc, char *argv[])
+{
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   bench_frames(320, 240, 640, 480, false);
+   bench_frames(320, 240, 640, 480, true);
+   bench_frames(320, 240, 1280, 960, false);
+   bench_frames(320, 240, 1280, 960, true);
+   return 0;
+}
@@ -0,0 +1,260 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Shader state tracker test and benchmark.
+//
+// state_bench --test
+//    Runs random imports over changing RAM, and checks every uniform against
+//    the per-element evaluation the tracker used to do.
+// state_bench
+//    Times 64 imports per frame, old evaluation against the compiled one.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "general.h"
+#include "gfx/state_tracker.h"
+#include "performance.h"
+#include "bench_test.h"
+
+struct settings g_settings;
+driver_t driver;
+
+// No input driver here, so the tracker never touches the binds.
+void input_push_analog_dpad(struct retro_keybind *binds, unsigned mode)
+{
+   (void)binds;
+   (void)mode;
+}
+
+void input_pop_analog_dpad(struct retro_keybind *binds)
+{
+   (void)binds;
+}
+
+#define NUM_IMPORTS 64
+#define WRAM_SIZE 0x2000
+#define BENCH_FRAMES 200000
+
+static uint8_t wram[WRAM_SIZE];
+static struct state_tracker_uniform_info imports[NUM_IMPORTS];
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245u + 12345u;
+   return rng_state >> 8;
+}
+
+// The tracker as it used to be: one switch per element, fetching up to three times.
+struct ref_element
+{
+   const struct state_tracker_uniform_info *info;
+   uint32_t prev[2];
+   int frame_count;
+   int frame_count_prev;
+   uint32_t old_value;
+   int transition_count;
+};
+
+static struct ref_element ref[NUM_IMPORTS];
+static const uint16_t ref_input[2];
+
+static uint16_t ref_fetch(const struct ref_element *elem)
+{
+   const struct state_tracker_uniform_info *info = elem->info;
+   uint16_t mask = info->mask ? info->mask : 0xffff;
+   uint16_t val;
+
+   if (info->ram_type == RARCH_STATE_INPUT_SLOT1 || info->ram_type == RARCH_STATE_INPUT_SLOT2)
+      val = ref_input[info->ram_type == RARCH_STATE_INPUT_SLOT2];
+   else
+      val = info->ram_type == RARCH_STATE_WRAM ? wram[info->addr] : 0;
+
+   val &= mask;
+   if (info->equal && val != info->equal)
+      val = 0;
+   return val;
+}
+
+static void ref_update(struct state_tracker_uniform *uniform, struct ref_element *elem, unsigned frame_count)
+{
+   uniform->id = elem->info->id;
+
+   switch (elem->info->type)
+   {
+      case RARCH_STATE_CAPTURE:
+         uniform->value = ref_fetch(elem);
+         break;
+      case RARCH_STATE_CAPTURE_PREV:
+         if (elem->prev[0] != ref_fetch(elem))
+         {
+            elem->prev[1] = elem->prev[0];
+            elem->prev[0] = ref_fetch(elem);
+         }
+         uniform->value = elem->prev[1];
+         break;
+      case RARCH_STATE_TRANSITION:
+         if (elem->old_value != ref_fetch(elem))
+         {
+            elem->old_value = ref_fetch(elem);
+            elem->frame_count = frame_count;
+         }
+         uniform->value = elem->frame_count;
+         break;
+      case RARCH_STATE_TRANSITION_COUNT:
+         if (elem->old_value != ref_fetch(elem))
+         {
+            elem->old_value = ref_fetch(elem);
+            elem->transition_count++;
+         }
+         uniform->value = elem->transition_count;
+         break;
+      case RARCH_STATE_TRANSITION_PREV:
+         if (elem->old_value != ref_fetch(elem))
+         {
+            elem->old_value = ref_fetch(elem);
+            elem->frame_count_prev = elem->frame_count;
+            elem->frame_count = frame_count;
+         }
+         uniform->value = elem->frame_count_prev;
+         break;
+      default:
+         break;
+   }
+}
+
+static void make_imports(unsigned count)
+{
+   unsigned i;
+   memset(ref, 0, sizeof(ref));
+
+   for (i = 0; i < count; i++)
+   {
+      struct state_tracker_uniform_info *var = &imports[i];
+      unsigned ram = rng() % 8;
+
+      snprintf(var->id, sizeof(var->id), "import%u", i);
+      var->addr = rng() % WRAM_SIZE;
+      var->type = (enum state_tracker_type)(rng() % (RARCH_STATE_TRANSITION_PREV + 1));
+      var->ram_type = ram == 0 ? RARCH_STATE_INPUT_SLOT1 : (ram == 1 ? RARCH_STATE_INPUT_SLOT2 : RARCH_STATE_WRAM);
+      var->mask = rng() % 2 ? 0 : (rng() & 0xff);
+      var->equal = rng() % 4 ? 0 : (rng() & 0xff & (var->mask ? var->mask : 0xff));
+      ref[i].info = var;
+   }
+}
+
+// RAM that changes a bit every frame, some bytes much more often than others.
+static void mutate_wram(void)
+{
+   unsigned i;
+   for (i = 0; i < 16; i++)
+      wram[rng() % WRAM_SIZE] = rng();
+   for (i = 0; i < 64; i++)
+      wram[i] += i & 3;
+}
+
+static bool check_tracker(unsigned count, unsigned elem)
+{
+   unsigned frame, i, cnt;
+   struct state_tracker_info info = {0};
+   struct state_tracker_uniform got[NUM_IMPORTS], expected[NUM_IMPORTS];
+   state_tracker_t *tracker;
+   bool ok = true;
+
+   make_imports(count);
+   info.wram = wram;
+   info.info = imports;
+   info.info_elem = count;
+
+   tracker = state_tracker_init(&info);
+   if (!tracker)
+      return false;
+
+   for (frame = 1; ok && frame <= 2000; frame++)
+   {
+      mutate_wram();
+      cnt = state_get_uniform(tracker, got, elem, frame);
+      for (i = 0; i < count; i++)
+         ref_update(&expected[i], &ref[i], frame);
+
+      ok = cnt == (count < elem ? count : elem);
+      for (i = 0; ok && i < cnt; i++)
+         ok = strcmp(got[i].id, expected[i].id) == 0 && got[i].value == expected[i].value;
+   }
+
+   state_tracker_free(tracker);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   CHECK("64 imports", check_tracker(NUM_IMPORTS, NUM_IMPORTS));
+   CHECK("7 imports", check_tracker(7, NUM_IMPORTS));
+   CHECK("64 imports, room for 10 uniforms", check_tracker(NUM_IMPORTS, 10));
+
+   return bench_test_result();
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned frame, i;
+   struct state_tracker_info info = {0};
+   struct state_tracker_uniform uniforms[NUM_IMPORTS];
+   state_tracker_t *tracker;
+   retro_time_t start, old_time, new_time;
+   float sum = 0.0f;
+
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   for (i = 0; i < WRAM_SIZE; i++)
+      wram[i] = rng();
+
+   make_imports(NUM_IMPORTS);
+   info.wram = wram;
+   info.info = imports;
+   info.info_elem = NUM_IMPORTS;
+   tracker = state_tracker_init(&info);
+   if (!tracker)
+      return 1;
+
+   start = rarch_get_time_usec();
+   for (frame = 1; frame <= BENCH_FRAMES; frame++)
+   {
+      wram[frame % 64]++;
+      for (i = 0; i < NUM_IMPORTS; i++)
+         ref_update(&uniforms[i], &ref[i], frame);
+      sum += uniforms[frame % NUM_IMPORTS].value;
+   }
+   old_time = rarch_get_time_usec() - start;
+
+   start = rarch_get_time_usec();
+   for (frame = 1; frame <= BENCH_FRAMES; frame++)
+   {
+      wram[frame % 64]++;
+      state_get_uniform(tracker, uniforms, NUM_IMPORTS, frame);
+      sum += uniforms[frame % NUM_IMPORTS].value;
+   }
+   new_time = rarch_get_time_usec() - start;
+
+   printf("%u imports, %u frames (checksum %.0f)\n", NUM_IMPORTS, BENCH_FRAMES, sum);
+   printf("per element: %7.1f ns/frame\n", old_time * 1000.0 / BENCH_FRAMES);
+   printf("compiled:    %7.1f ns/frame\n", new_time * 1000.0 / BENCH_FRAMES);
+
+   state_tracker_free(tracker);
+   return 0;
+}
@@ -0,0 +1,334 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// XVideo RGB to YUV conversion test and benchmark. Needs no X server.
+//
+// xvideo_bench --test
+//    Checks YUY2 and UYVY output from RGB565 and XRGB8888 against a per-pixel reference,
+//    with widths the SIMD paths do not divide, padded pitches and threaded bands.
+// xvideo_bench
+//    Times the conversion against the lookup tables the driver used before, single and multi-threaded.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gfx/xvideo_conv.h"
+#include "performance.h"
+#include "bench_test.h"
+
+#define BENCH_FRAMES 200
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+   rng_state = rng_state * 1103515245 + 12345;
+   return rng_state >> 16;
+}
+
+static void *make_frame(unsigned height, unsigned pitch)
+{
+   unsigned i;
+   uint8_t *frame = (uint8_t*)malloc(pitch * height);
+   if (!frame)
+      return NULL;
+
+   for (i = 0; i < pitch * height; i++)
+      frame[i] = rng();
+   return frame;
+}
+
+static void rgb_at(bool rgb32, const void *frame, unsigned pitch, unsigned x, unsigned y,
+      unsigned *r, unsigned *g, unsigned *b)
+{
+   const uint8_t *line = (const uint8_t*)frame + y * pitch;
+
+   if (rgb32)
+   {
+      uint32_t p = ((const uint32_t*)line)[x];
+      *r = (p >> 16) & 0xff;
+      *g = (p >>  8) & 0xff;
+      *b = (p >>  0) & 0xff;
+   }
+   else
+   {
+      unsigned p = ((const uint16_t*)line)[x];
+      *r = ((p >> 11) & 0x1f) * 255 / 31;
+      *g = ((p >>  5) & 0x3f) * 255 / 63;
+      *b = ((p >>  0) & 0x1f) * 255 / 31;
+   }
+}
+
+// BT.601 limited range, rounded. Bit replicated 565 is within 1 of the exact expansion used here,
+// which moves Y, U and V by less than one step before rounding.
+static void reference_yuv(unsigned r, unsigned g, unsigned b, unsigned *y, unsigned *u, unsigned *v)
+{
+   *y = ( 66 * r + 129 * g +  25 * b + 128 + (16 << 8)) >> 8;
+   *u = (-38 * (int)r -  74 * (int)g + 112 * (int)b + 128 + (128 << 8)) >> 8;
+   *v = (112 * (int)r -  94 * (int)g -  18 * (int)b + 128 + (128 << 8)) >> 8;
+}
+
+static bool near(unsigned a, unsigned b, unsigned tolerance)
+{
+   return a > b ? a - b <= tolerance : b - a <= tolerance;
+}
+
+// Every input pixel is a 2x2 block of Y, with its own U and V.
+static bool check_output(enum xv_conv_format format, bool rgb32, const uint8_t *output, unsigned out_pitch,
+      const void *frame, unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned x, y, tolerance = rgb32 ? 0 : 1;
+
+   for (y = 0; y < height; y++)
+   {
+      const uint8_t *row0 = output + 2 * y * out_pitch;
+      const uint8_t *row1 = row0 + out_pitch;
+
+      if (memcmp(row0, row1, width * 4) != 0)
+         return false;
+
+      for (x = 0; x < width; x++)
+      {
+         unsigned r, g, b, ey, eu, ev;
+         const uint8_t *p = row0 + x * 4;
+         unsigned y0 = format == XV_CONV_UYVY ? p[1] : p[0];
+         unsigned y1 = format == XV_CONV_UYVY ? p[3] : p[2];
+         unsigned u  = format == XV_CONV_UYVY ? p[0] : p[1];
+         unsigned v  = format == XV_CONV_UYVY ? p[2] : p[3];
+
+         rgb_at(rgb32, frame, pitch, x, y, &r, &g, &b);
+         reference_yuv(r, g, b, &ey, &eu, &ev);
+
+         if (y0 != y1 || !near(y0, ey, tolerance) || !near(u, eu, tolerance) || !near(v, ev, tolerance))
+            return false;
+      }
+   }
+   return true;
+}
+
+// Odd sizes, and pitches with padding. The image must not be written past width or height.
+static bool check_convert(enum xv_conv_format format, bool rgb32, unsigned threads)
+{
+   unsigned width = 37, height = threads > 1 ? 131 : 19;
+   unsigned bpp = rgb32 ? 4 : 2;
+   unsigned pitch = width * bpp + 12;
+   unsigned out_pitch = width * 4 + 20;
+   size_t out_size = 2 * height * out_pitch + 64;
+   void *frame = make_frame(height, pitch);
+   uint8_t *output = (uint8_t*)malloc(out_size);
+   xv_conv_t *conv = xv_conv_new(format, rgb32, threads);
+   bool ok = frame && output && conv;
+   unsigned i, y;
+
+   if (ok)
+   {
+      memset(output, 0x5a, out_size);
+      xv_conv_frame(conv, output, out_pitch, frame, width, height, pitch);
+      ok = check_output(format, rgb32, output, out_pitch, frame, width, height, pitch);
+
+      for (y = 0; y < 2 * height; y++)
+         for (i = width * 4; i < out_pitch; i++)
+            ok = ok && output[y * out_pitch + i] == 0x5a;
+      for (i = 2 * height * out_pitch; i < out_size; i++)
+         ok = ok && output[i] == 0x5a;
+   }
+
+   xv_conv_free(conv);
+   free(frame);
+   free(output);
+   return ok;
+}
+
+// Bands split at any row, and frames of any height, give the output of a single thread.
+static bool check_threads(bool rgb32)
+{
+   unsigned width = 64, height = 240, pitch = width * (rgb32 ? 4 : 2), out_pitch = width * 4;
+   void *frame = make_frame(height, pitch);
+   uint8_t *single = (uint8_t*)malloc(2 * height * out_pitch);
+   uint8_t *threaded = (uint8_t*)malloc(2 * height * out_pitch);
+   xv_conv_t *conv = xv_conv_new(XV_CONV_YUY2, rgb32, XV_CONV_MAX_THREADS);
+   bool ok = frame && single && threaded && conv;
+   unsigned h;
+
+   for (h = 1; ok && h <= height; h += 7)
+   {
+      memset(threaded, 0, 2 * h * out_pitch);
+      xv_conv_rows(XV_CONV_YUY2, rgb32, single, out_pitch, frame, width, h, pitch);
+      xv_conv_frame(conv, threaded, out_pitch, frame, width, h, pitch);
+      ok = memcmp(single, threaded, 2 * h * out_pitch) == 0;
+   }
+
+   xv_conv_free(conv);
+   free(frame);
+   free(single);
+   free(threaded);
+   return ok;
+}
+
+// The driver's previous conversion: floating point, truncated, into 64 KiB tables.
+static void old_calculate_yuv(uint8_t *y, uint8_t *u, uint8_t *v, unsigned r, unsigned g, unsigned b)
+{
+   int y_ = (int)(+((double)r * 0.257) + ((double)g * 0.504) + ((double)b * 0.098) +  16.0);
+   int u_ = (int)(-((double)r * 0.148) - ((double)g * 0.291) + ((double)b * 0.439) + 128.0);
+   int v_ = (int)(+((double)r * 0.439) - ((double)g * 0.368) - ((double)b * 0.071) + 128.0);
+
+   *y = y_ < 0 ? 0 : (y_ > 255 ? 255 : y_);
+   *u = u_ < 0 ? 0 : (u_ > 255 ? 255 : u_);
+   *v = v_ < 0 ? 0 : (v_ > 255 ? 255 : v_);
+}
+
+struct old_tables
+{
+   uint8_t y[0x10000];
+   uint8_t u[0x10000];
+   uint8_t v[0x10000];
+};
+
+static struct old_tables *old_tables_new(void)
+{
+   unsigned i;
+   struct old_tables *t = (struct old_tables*)malloc(sizeof(*t));
+   if (!t)
+      return NULL;
+
+   for (i = 0; i < 0x10000; i++)
+   {
+      unsigned r = (i >> 11) & 0x1f, g = (i >> 5) & 0x3f, b = (i >> 0) & 0x1f;
+      old_calculate_yuv(&t->y[i], &t->u[i], &t->v[i],
+            (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+   }
+   return t;
+}
+
+static void old_render16_yuy2(const struct old_tables *t, uint8_t *output, unsigned out_pitch,
+      const uint16_t *input, unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++)
+   {
+      uint8_t *out = output + 2 * y * out_pitch;
+      const uint16_t *in = input + y * (pitch >> 1);
+
+      for (x = 0; x < width; x++, out += 4)
+      {
+         uint16_t p = in[x];
+         out[0] = out[out_pitch + 0] = t->y[p];
+         out[1] = out[out_pitch + 1] = t->u[p];
+         out[2] = out[out_pitch + 2] = t->y[p];
+         out[3] = out[out_pitch + 3] = t->v[p];
+      }
+   }
+}
+
+// Within a step of the old float conversion, for every RGB565 color.
+static bool check_old_tables(void)
+{
+   struct old_tables *t = old_tables_new();
+   uint16_t *frame = (uint16_t*)malloc(0x10000 * sizeof(uint16_t));
+   uint8_t *output = (uint8_t*)malloc(2 * 0x10000 * 4);
+   bool ok = t && frame && output;
+   unsigned i;
+
+   if (ok)
+   {
+      for (i = 0; i < 0x10000; i++)
+         frame[i] = i;
+      xv_conv_rows(XV_CONV_YUY2, false, output, 256 * 4, frame, 256, 256, 256 * 2);
+
+      for (i = 0; ok && i < 0x10000; i++)
+      {
+         const uint8_t *p = output + (i / 256) * 2 * 256 * 4 + (i % 256) * 4;
+         ok = near(p[0], t->y[i], 1) && near(p[1], t->u[i], 1) && near(p[3], t->v[i], 1);
+      }
+   }
+
+   free(t);
+   free(frame);
+   free(output);
+   return ok;
+}
+
+static int run_test(void)
+{
+
+   CHECK("RGB565 to YUY2", check_convert(XV_CONV_YUY2, false, 1));
+   CHECK("RGB565 to UYVY", check_convert(XV_CONV_UYVY, false, 1));
+   CHECK("XRGB8888 to YUY2", check_convert(XV_CONV_YUY2, true, 1));
+   CHECK("XRGB8888 to UYVY", check_convert(XV_CONV_UYVY, true, 1));
+   CHECK("RGB565 to UYVY, 4 threads", check_convert(XV_CONV_UYVY, false, 4));
+   CHECK("XRGB8888 to YUY2, 3 threads", check_convert(XV_CONV_YUY2, true, 3));
+   CHECK("threaded bands, RGB565", check_threads(false));
+   CHECK("threaded bands, XRGB8888", check_threads(true));
+   CHECK("close to the old lookup tables", check_old_tables());
+
+   return bench_test_result();
+}
+
+static void bench_convert(bool rgb32, unsigned width, unsigned height)
+{
+   unsigned pitch = width * (rgb32 ? 4 : 2), out_pitch = width * 4;
+   void *frame = make_frame(height, pitch);
+   uint8_t *output = (uint8_t*)malloc(2 * height * out_pitch);
+   struct old_tables *t = rgb32 ? NULL : old_tables_new();
+   xv_conv_t *conv = xv_conv_new(XV_CONV_YUY2, rgb32, rarch_get_cpu_cores());
+   retro_time_t start, time, threaded_time, old_time = 0;
+   unsigned i;
+
+   if (!frame || !output || !conv || (!rgb32 && !t))
+      goto end;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      xv_conv_rows(XV_CONV_YUY2, rgb32, output, out_pitch, frame, width, height, pitch);
+   time = rarch_get_time_usec() - start;
+
+   start = rarch_get_time_usec();
+   for (i = 0; i < BENCH_FRAMES; i++)
+      xv_conv_frame(conv, output, out_pitch, frame, width, height, pitch);
+   threaded_time = rarch_get_time_usec() - start;
+
+   if (t)
+   {
+      start = rarch_get_time_usec();
+      for (i = 0; i < BENCH_FRAMES; i++)
+         old_render16_yuy2(t, output, out_pitch, (const uint16_t*)frame, width, height, pitch);
+      old_time = rarch_get_time_usec() - start;
+   }
+
+   printf("%s %ux%u: %7.1f us/frame, threaded (%u): %7.1f us/frame",
+         rgb32 ? "XRGB8888" : "RGB565  ", width, height, (double)time / BENCH_FRAMES,
+         xv_conv_threads(conv), (double)threaded_time / BENCH_FRAMES);
+   if (t)
+      printf(", tables: %7.1f us/frame", (double)old_time / BENCH_FRAMES);
+   printf("\n");
+
+end:
+   xv_conv_free(conv);
+   free(t);
+   free(frame);
+   free(output);
+}
+
+int main(int argc, char *argv[])
+{
+   if (bench_test_mode(argc, argv))
+      return run_test();
+
+   bench_convert(false, 320, 240);
+   bench_convert(false, 640, 480);
+   bench_convert(true, 320, 240);
+   bench_convert(true, 640, 480);
+   return 0;
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+
+"""
+Python 3 script which converts a RetroArch frame trace (frame_trace_path) to Chrome trace format.
+The result can be opened in chrome://tracing or Perfetto.
+License: Public domain
+"""
+
+import sys
+import json
+import struct
+
+HEADER = struct.Struct('<4sIIIQQ')
+NAME_SIZE = 16
+NONE = 0xffffffffffffffff
+
+def read_trace(path):
+   with open(path, 'rb') as f:
+      data = f.read()
+
+   magic, version, stage_count, frame_count, ticks, usec = HEADER.unpack_from(data, 0)
+   if magic != b'RAFT' or version != 2:
+      raise ValueError('{} is not a version 2 frame trace.'.format(path))
+
+   offset = HEADER.size
+   stages = []
+   for i in range(stage_count):
+      name = data[offset:offset + NAME_SIZE].split(b'\0')[0].decode('ascii')
+      stages.append(name)
+      offset += NAME_SIZE
+
+   record = struct.Struct('<QQ' + 'QQI' * stage_count)
+   frames = []
+   for i in range(frame_count):
+      fields = record.unpack_from(data, offset)
+      offset += record.size
+      frames.append((fields[0], fields[1], [fields[2 + 3 * j:5 + 3 * j] for j in range(stage_count)]))
+
+   ticks_per_usec = float(ticks) / usec if usec else 1.0
+   return stages, frames, ticks_per_usec
+
+def convert(stages, frames, ticks_per_usec):
+   # Every stage gets its own track. Stages called several times per frame are
+   # shown as one block starting at the first call, with the accumulated time.
+   events = [{ 'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': 0, 'args': { 'name': 'frame' } }]
+   for i, name in enumerate(stages):
+      events.append({ 'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': i + 1, 'args': { 'name': name } })
+
+   for index, (start, duration, stage_records) in enumerate(frames):
+      ts = start / ticks_per_usec
+      events.append({ 'name': 'frame', 'cat': 'frame', 'ph': 'X', 'pid': 1, 'tid': 0,
+         'ts': ts, 'dur': duration / ticks_per_usec, 'args': { 'frame': index } })
+
+      for i, (offset, ticks, calls) in enumerate(stage_records):
+         if offset == NONE or calls == 0:
+            continue
+         events.append({ 'name': stages[i], 'cat': 'stage', 'ph': 'X', 'pid': 1, 'tid': i + 1,
+            'ts': ts + offset / ticks_per_usec, 'dur': ticks / ticks_per_usec, 'args': { 'calls': calls } })
+
+   return { 'traceEvents': events, 'displayTimeUnit': 'ms' }
+
+def main():
+   if len(sys.argv) != 3:
+      print('Usage: {} frame-trace.bin trace.json'.format(sys.argv[0]))
+      return 1
+
+   stages, frames, ticks_per_usec = read_trace(sys.argv[1])
+   with open(sys.argv[2], 'w') as f:
+      json.dump(convert(stages, frames, ticks_per_usec), f)
+
+   print('Converted {} frames.'.format(len(frames)))
+   return 0
+
+if __name__ == '__main__':
+   sys.exit(main())